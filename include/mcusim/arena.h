@@ -0,0 +1,63 @@
+/*
+ * This file is part of MCUSim, an XSPICE library with microcontrollers.
+ *
+ * Copyright (C) 2017-2019 MCUSim Developers, see AUTHORS.txt for contributors.
+ *
+ * MCUSim is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MCUSim is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+/*
+ * There are declarations for an arena - a simple allocator to give away
+ * blocks of memory which are released all at once. */
+#ifndef MSIM_ARENA_H_
+#define MSIM_ARENA_H_ 1
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Minimum size of a chunk the blocks are allocated from, in bytes. */
+#define MSIM_ARENA_CHUNKSZ	(256*1024)
+/* Alignment of the allocated blocks, in bytes. */
+#define MSIM_ARENA_ALIGN	16
+
+struct MSIM_ArenaChunk;
+
+/* Structure to describe an arena.
+ *
+ * Zero-initialized structure is an empty arena. The arena isn't
+ * thread-safe, a single owner is supposed to allocate blocks from it.
+ *
+ * head			The latest chunk to allocate blocks from. */
+typedef struct MSIM_ARENA {
+	struct MSIM_ArenaChunk *head;
+} MSIM_ARENA;
+
+/* Allocates a zero-filled block of memory from the arena.
+ *
+ * Returns:
+ * Pointer to the block.
+ * NULL			If there is not enough memory. */
+void *MSIM_ARENA_Alloc(struct MSIM_ARENA *a, size_t size);
+
+/* Releases all of the blocks allocated from the arena. Arena is empty
+ * and can be used again after this call. */
+void MSIM_ARENA_Free(struct MSIM_ARENA *a);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MSIM_ARENA_H_ */
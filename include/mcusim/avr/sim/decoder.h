@@ -27,10 +27,38 @@
 extern "C" {
 #endif
 
+#include <stdint.h>
+
+struct MSIM_AVR;
+
+/* Maximum number of cycles per instruction of a block. */
+#define MSIM_AVR_BLOCK_MAXCYCLES	4
+
+/* Handler of a decoded instruction. */
+typedef void (*MSIM_AVR_InstFunc)(struct MSIM_AVR *mcu, const uint32_t inst);
+
 int MSIM_AVR_Step(struct MSIM_AVR *mcu);
 
+uint32_t MSIM_AVR_StepBlock(struct MSIM_AVR *mcu, uint32_t cycles,
+                           uint32_t stop_pc);
+
+MSIM_AVR_InstFunc MSIM_AVR_BlockInst(struct MSIM_AVR *mcu, uint32_t pc,
+                                     uint16_t *inst, uint8_t *sync_sreg);
+
+uint64_t MSIM_AVR_StepThreaded(struct MSIM_AVR *mcu, uint64_t cycles,
+                               uint32_t stop_pc);
+
 int MSIM_AVR_Is32(unsigned int inst);
 
+void MSIM_AVR_FlushDecoded(struct MSIM_AVR *mcu, uint32_t addr,
+                           uint32_t words);
+
+void MSIM_AVR_DecodeAll(struct MSIM_AVR *mcu);
+
+int MSIM_AVR_IsPollLoop(struct MSIM_AVR *mcu, uint32_t head, uint32_t tail);
+
+void MSIM_AVR_SyncSREG(struct MSIM_AVR *mcu);
+
 #ifdef __cplusplus
 }
 #endif
@@ -35,6 +35,10 @@ void MSIM_AVR_RSPInit(struct MSIM_AVR *mcu, uint16_t portn);
 void MSIM_AVR_RSPClose(struct MSIM_AVR *mcu);
 int MSIM_AVR_RSPHandle(struct MSIM_AVR *mcu);
 
+/* Takes a snapshot of the MCU to execute it in reverse from, once it's
+ * time to. Returns a number of cycles to take the next snapshot after. */
+uint64_t MSIM_AVR_RSPRecord(struct MSIM_AVR *mcu);
+
 #ifdef __cplusplus
 }
 #endif
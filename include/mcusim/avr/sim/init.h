@@ -30,6 +30,7 @@ typedef struct MSIM_InitArgs {
 	uint8_t *dm;
 	uint32_t pmsz;
 	uint32_t dmsz;
+	uint8_t pty;		/* Open a pseudo-terminal for USART */
 } MSIM_InitArgs;
 
 /* Initialize MCU as ATmega8A */
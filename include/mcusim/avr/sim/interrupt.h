@@ -30,6 +30,10 @@ extern "C" {
 /* AVR IRQ limit, i.e. maximum number of interrupt vectors. */
 #define MSIM_AVR_IRQNUM			64
 
+/* Bit of the interrupt request of the given vector. Vector with the lower
+ * number has the higher priority. */
+#define MSIM_AVR_IRQ(vec)		(((uint64_t)1) << (vec))
+
 /* Forward declaration of the structure to describe AVR microcontroller
  * instance. */
 struct MSIM_AVR;
@@ -39,7 +43,9 @@ struct MSIM_AVR;
 typedef struct MSIM_AVR_INT {
 	uint32_t reset_pc;		/* Reset address */
 	uint32_t ivt;			/* Interrupt vectors table address */
-	uint8_t irq[MSIM_AVR_IRQNUM];	/* Flags for interrupt requests */
+	uint64_t irq;			/* Interrupt requests, bit per vector */
+	uint8_t poll;			/* Interrupt flags or enable bits
+					   may have been changed */
 	uint8_t exec_main;		/* Exe instruction from the main
 					   program after an exit from ISR */
 	uint8_t trap_at_isr;		/* Flag to enter stopped mode when
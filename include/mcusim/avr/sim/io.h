@@ -23,6 +23,13 @@
 extern "C" {
 #endif
 
+struct MSIM_AVR;
+
+/* Peripheral may be notified when firmware accesses its I/O register.
+ * The register is already accessed, its previous value is given. */
+typedef void (*MSIM_AVR_IOFunc)(struct MSIM_AVR *mcu, uint32_t reg,
+                                uint8_t old);
+
 /* I/O register of the AVR microcontroller */
 typedef struct MSIM_AVR_IOReg {
 	char name[16];
@@ -30,6 +37,8 @@ typedef struct MSIM_AVR_IOReg {
 	uint8_t *addr;		/* Pointer to the register in DM */
 	uint8_t reset;		/* Value after MCU reset */
 	uint8_t mask;		/* Access mask (1 - R/W or W, 0 - R) */
+	MSIM_AVR_IOFunc write;	/* Register is written by firmware */
+	MSIM_AVR_IOFunc read;	/* Register is read by firmware */
 } MSIM_AVR_IOReg;
 
 /*
@@ -57,6 +66,7 @@ typedef struct MSIM_AVR_IOPort {
 } MSIM_AVR_IOPort;
 
 int MSIM_AVR_IOSyncPinx(struct MSIM_AVR *mcu);
+int MSIM_AVR_IOWatchPorts(struct MSIM_AVR *mcu);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,49 @@
+/*
+ * This file is part of MCUSim, an XSPICE library with microcontrollers.
+ *
+ * Copyright (C) 2017-2019 MCUSim Developers, see AUTHORS.txt for contributors.
+ *
+ * MCUSim is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MCUSim is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* Translation of the hot blocks of instructions to native code. */
+#ifndef MSIM_AVR_JIT_H_
+#define MSIM_AVR_JIT_H_ 1
+
+#ifndef MSIM_MAIN_HEADER_H_
+	#error "Please, include mcusim/mcusim.h instead of this header."
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+struct MSIM_AVR;
+
+int MSIM_AVR_JITAvail(void);
+
+uint32_t MSIM_AVR_JITRun(struct MSIM_AVR *mcu, uint32_t cycles,
+                         uint32_t stop_pc);
+
+void MSIM_AVR_JITFlush(struct MSIM_AVR *mcu, uint32_t addr, uint32_t words);
+
+void MSIM_AVR_JITFree(struct MSIM_AVR *mcu);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MSIM_AVR_JIT_H_ */
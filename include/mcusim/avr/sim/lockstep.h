@@ -0,0 +1,112 @@
+/*
+ * This file is part of MCUSim, an XSPICE library with microcontrollers.
+ *
+ * Copyright (C) 2017-2019 MCUSim Developers, see AUTHORS.txt for contributors.
+ *
+ * MCUSim is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MCUSim is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* Lockstep execution of two MCU instances to validate an instruction
+ * execution engine against another one. */
+#ifndef MSIM_AVR_LOCKSTEP_H_
+#define MSIM_AVR_LOCKSTEP_H_ 1
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+/* Forward declaration of the structure to describe AVR microcontroller
+ * instance. */
+struct MSIM_AVR;
+
+/* Locations of the MCU state to be reported as different, max */
+#define MSIM_AVR_DIVERGE_LOCS		8
+
+/* Way to run the tested MCU. Reference MCU is always run cycle by cycle
+ * (see MSIM_AVR_SimStep). */
+enum MSIM_AVR_LockstepMode {
+	AVR_LOCKSTEP_RUN = 0,		/* Runs of cycles (MSIM_AVR_SimRun) */
+	AVR_LOCKSTEP_INST		/* Instructions (MSIM_AVR_SimInst) */
+};
+
+/* Location of the MCU state which may differ. */
+enum MSIM_AVR_DivergeLoc {
+	AVR_DIVERGE_PC = 0,		/* Program counter */
+	AVR_DIVERGE_TICK,		/* Cycles passed */
+	AVR_DIVERGE_STATE,		/* State of the MCU */
+	AVR_DIVERGE_RESULT,		/* Result of the instruction */
+	AVR_DIVERGE_DM,			/* Data memory */
+	AVR_DIVERGE_PM			/* Program memory */
+};
+
+/* Difference between the MCU instances.
+ *
+ * loc		Location of the MCU state.
+ *
+ * addr		Address of the DM byte or the PM word.
+ *
+ * ref, test	Values of the reference and tested MCUs. */
+typedef struct MSIM_AVR_DivergeVal {
+	enum MSIM_AVR_DivergeLoc loc;
+	uint32_t addr;
+	uint64_t ref;
+	uint64_t test;
+} MSIM_AVR_DivergeVal;
+
+/* First divergence of the MCU instances run in lockstep.
+ *
+ * inst		Instructions executed by both MCUs before the divergent one
+ *		(or the first one of the divergent run).
+ *
+ * pc		Address of the divergent instruction, in 16-bits words.
+ *
+ * opcode	Words of the divergent instruction.
+ *
+ * tick		Cycles passed before the divergent instruction.
+ *
+ * run		Cycles of the divergent run of the tested MCU (run mode), or
+ *		its instructions (1 - divergent instruction is found).
+ *
+ * vals		Locations of the MCU state which differ after the divergent
+ *		instruction or run (the first ones only). */
+typedef struct MSIM_AVR_Diverge {
+	uint64_t inst;
+	uint32_t pc;
+	uint16_t opcode[2];
+	uint64_t tick;
+	uint64_t run;
+	MSIM_AVR_DivergeVal vals[MSIM_AVR_DIVERGE_LOCS];
+	uint32_t vals_num;
+} MSIM_AVR_Diverge;
+
+/* Executes instructions by the reference and tested MCUs initialized from
+ * the same firmware and compares their states (PC, cycles, data and
+ * program memories) after each N instructions (or N cycles of the tested
+ * MCU in run mode). Reference MCU catches up with the cycles of the tested
+ * one. States are compared after shorter runs since the last equal ones if
+ * they differ.
+ *
+ * Returns 0 if both MCUs executed the given number of instructions or
+ * stopped in the same state, 1 if they diverged or -1 in case of error. */
+int MSIM_AVR_Lockstep(struct MSIM_AVR *ref, struct MSIM_AVR *test,
+                      enum MSIM_AVR_LockstepMode mode, uint64_t insts,
+                      uint32_t every, struct MSIM_AVR_Diverge *div);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MSIM_AVR_LOCKSTEP_H_ */
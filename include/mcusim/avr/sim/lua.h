@@ -25,16 +25,24 @@ extern "C" {
 
 #include "mcusim/avr/sim/sim.h"
 
-/* Maximum number of device models defined as Lua scripts to be loaded
- * during a simulation. */
-#define MSIM_AVR_LUAMODELS			256
+#define MSIM_AVR_LUAPARAMS	64		/* Maximum # of parameters */
+
+/* Parameter of the models, it's available as a global variable. */
+typedef struct MSIM_AVR_LUAParam {
+	char name[64];
+	char val[256];
+} MSIM_AVR_LUAParam;
 
 /* Load peripherals written in Lua from a given list file. */
-int MSIM_AVR_LUALoadModel(struct MSIM_AVR *mcu, char *model);
+int MSIM_AVR_LUALoadModel(struct MSIM_AVR *mcu, char *model,
+                          const MSIM_AVR_LUAParam *params,
+                          uint32_t params_num);
 /* Close previously created Lua states. */
-void MSIM_AVR_LUACleanModels(void);
+void MSIM_AVR_LUACleanModels(struct MSIM_AVR *mcu);
 /* Call a "tick" function of the models during each cycle of simulation. */
 void MSIM_AVR_LUATickModels(struct MSIM_AVR *mcu);
+/* Number of the loaded models. */
+uint32_t MSIM_AVR_LUAModels(struct MSIM_AVR *mcu);
 
 #ifdef __cplusplus
 }
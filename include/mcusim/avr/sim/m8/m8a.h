@@ -36,6 +36,10 @@
 
 int
 MSIM_M8AUpdate(struct MSIM_AVR *mcu, struct MSIM_AVRConf *cnf);
+uint32_t
+MSIM_M8AIdle(struct MSIM_AVR *mcu, uint32_t cycles);
+uint32_t
+MSIM_M8ASkip(struct MSIM_AVR *mcu, uint32_t cycles);
 int
 MSIM_M8ASetFuse(struct MSIM_AVR *mcu, struct MSIM_AVRConf *cnf);
 int
@@ -43,6 +47,495 @@ MSIM_M8ASetLock(struct MSIM_AVR *mcu, struct MSIM_AVRConf *cnf);
 int
 MSIM_M8AResetSPM(struct MSIM_AVR *mcu, struct MSIM_AVRConf *cnf);
 
+/* Timers/counters of the MCU */
+static const struct MSIM_AVR_TMR TIMERS_M8A[] = {
+	[0] = {
+		/* ---------------- Basic config ------------------- */
+		.tcnt = { IOBYTE(TCNT0) },
+		.disabled = IONOBIT(),
+		.size = 8,
+		/* ------------- Clock select config --------------- */
+		.cs = {
+			IOBIT(TCCR0, CS00), IOBIT(TCCR0, CS01),
+			IOBIT(TCCR0, CS02)
+		},
+		.cs_div = { 0, 0, 3, 6, 8, 10 }, /* Power of 2 */
+		/* ------- Waveform generation mode config --------- */
+		.wgm = IONOBITA(),
+		.wgm_op = NOWGMA(),
+		/* ------------ Input capture config --------------- */
+		.icr = IONOBITA(),
+		.icp = IONOBIT(),
+		.ices = IONOBITA(),
+		/* ------------- Interrupts config ----------------- */
+		.iv_ovf = {
+			.enable = IOBIT(TIMSK, TOIE0),
+			.raised = IOBIT(TIFR, TOV0),
+			.vector = TIMER0_OVF_vect_num
+		},
+		.iv_ic = NOINTV(),
+		/* ----------- Output compare config --------------- */
+		.comp = NOCOMPA(),
+	},
+	[1] = {
+		/* ---------------- Basic config ------------------- */
+		.tcnt = { IOBYTE(TCNT1L), IOBYTE(TCNT1H) },
+		.disabled = IONOBIT(),
+		.size = 16,
+		/* ------------- Clock select config --------------- */
+		.cs = {
+			IOBIT(TCCR1B, CS10), IOBIT(TCCR1B, CS11),
+			IOBIT(TCCR1B, CS12)
+		},
+		.cs_div = { 0, 0, 3, 6, 8, 10 }, /* Power of 2 */
+		/* ------- Waveform generation mode config --------- */
+		.wgm = {
+			IOBIT(TCCR1A, WGM10), IOBIT(TCCR1A, WGM11),
+			IOBIT(TCCR1B, WGM12), IOBIT(TCCR1B, WGM13)
+		},
+		.wgm_op = {
+			[0] = {
+				.kind = WGM_NORMAL,
+				.size = 16,
+				.top = 0xFFFF,
+				.updocr_at = UPD_ATIMMEDIATE,
+				.settov_at = UPD_ATMAX,
+			},
+			[1] = {
+				.kind = WGM_PCPWM,
+				.size = 8,
+				.top = 0x00FF,
+				.updocr_at = UPD_ATTOP,
+				.settov_at = UPD_ATBOTTOM,
+			},
+			[2] = {
+				.kind = WGM_PCPWM,
+				.size = 9,
+				.top = 0x01FF,
+				.updocr_at = UPD_ATTOP,
+				.settov_at = UPD_ATBOTTOM,
+			},
+			[3] = {
+				.kind = WGM_PCPWM,
+				.size = 10,
+				.top = 0x03FF,
+				.updocr_at = UPD_ATTOP,
+				.settov_at = UPD_ATBOTTOM,
+			},
+			[4] = {
+				.kind = WGM_CTC,
+				.rtop = {
+					IOBYTE(OCR1AL), IOBYTE(OCR1AH)
+				},
+				.updocr_at = UPD_ATIMMEDIATE,
+				.settov_at = UPD_ATMAX,
+			},
+			[5] = {
+				.kind = WGM_FASTPWM,
+				.size = 8,
+				.top = 0x00FF,
+				.updocr_at = UPD_ATBOTTOM,
+				.settov_at = UPD_ATTOP,
+			},
+			[6] = {
+				.kind = WGM_FASTPWM,
+				.size = 9,
+				.top = 0x01FF,
+				.updocr_at = UPD_ATBOTTOM,
+				.settov_at = UPD_ATTOP,
+			},
+			[7] = {
+				.kind = WGM_FASTPWM,
+				.size = 10,
+				.top = 0x01FF,
+				.updocr_at = UPD_ATBOTTOM,
+				.settov_at = UPD_ATTOP,
+			},
+			[8] = {
+				.kind = WGM_PFCPWM,
+				.rtop = {
+					IOBYTE(ICR1L), IOBYTE(ICR1H)
+				},
+				.updocr_at = UPD_ATBOTTOM,
+				.settov_at = UPD_ATBOTTOM,
+			},
+			[9] = {
+				.kind = WGM_PFCPWM,
+				.rtop = {
+					IOBYTE(OCR1AL), IOBYTE(OCR1AH)
+				},
+				.updocr_at = UPD_ATBOTTOM,
+				.settov_at = UPD_ATBOTTOM,
+			},
+			[10] = {
+				.kind = WGM_PCPWM,
+				.rtop = {
+					IOBYTE(ICR1L), IOBYTE(ICR1H)
+				},
+				.updocr_at = UPD_ATTOP,
+				.settov_at = UPD_ATBOTTOM,
+			},
+			[11] = {
+				.kind = WGM_PCPWM,
+				.rtop = {
+					IOBYTE(OCR1AL), IOBYTE(OCR1AH)
+				},
+				.updocr_at = UPD_ATTOP,
+				.settov_at = UPD_ATBOTTOM,
+			},
+			[12] = {
+				.kind = WGM_CTC,
+				.rtop = {
+					IOBYTE(ICR1L), IOBYTE(ICR1H)
+				},
+				.updocr_at = UPD_ATIMMEDIATE,
+				.settov_at = UPD_ATMAX,
+			},
+			[13] = {
+				.kind = WGM_NONE,
+			},
+			[14] = {
+				.kind = WGM_FASTPWM,
+				.rtop = {
+					IOBYTE(ICR1L), IOBYTE(ICR1H)
+				},
+				.updocr_at = UPD_ATBOTTOM,
+				.settov_at = UPD_ATTOP,
+			},
+			[15] = {
+				.kind = WGM_FASTPWM,
+				.rtop = {
+					IOBYTE(OCR1AL), IOBYTE(OCR1AH)
+				},
+				.updocr_at = UPD_ATBOTTOM,
+				.settov_at = UPD_ATTOP,
+			},
+		},
+		/* ------------ Input capture config --------------- */
+		.icr = { IOBYTE(ICR1L), IOBYTE(ICR1H) },
+		.icp = IOBIT(PORTB, PB0),
+		.ices = { IOBIT(TCCR1B, ICES1) },
+		/* ------------- Interrupts config ----------------- */
+		.iv_ovf = {
+			.enable = IOBIT(TIMSK, TOIE1),
+			.raised = IOBIT(TIFR, TOV1),
+			.vector = TIMER1_OVF_vect_num
+		},
+		.iv_ic = {
+			.enable = IOBIT(TIMSK, TICIE1),
+			.raised = IOBIT(TIFR, ICF1),
+			.vector = TIMER1_CAPT_vect_num
+		},
+		/* ----------- Output compare config --------------- */
+		.comp = {
+			[0] = {
+				.ocr = {
+					IOBYTE(OCR1AL), IOBYTE(OCR1AH)
+				},
+				.pin = IOBIT(PORTB, PB1),
+				.ddp = IOBIT(DDRB, PB1),
+				.com = IOBITS(TCCR1A, COM1A0, 0x3, 2),
+				.com_op = {
+					[0] = {
+						COM_DISC,
+						COM_TGONCM,
+						COM_CLONCM,
+						COM_STONCM,
+					},
+					[1] = {
+						COM_DISC,
+						COM_DISC,
+						COM_CLONUP_STONDOWN,
+						COM_STONUP_CLONDOWN,
+					},
+					[2] = {
+						COM_DISC,
+						COM_DISC,
+						COM_CLONUP_STONDOWN,
+						COM_STONUP_CLONDOWN,
+					},
+					[3] = {
+						COM_DISC,
+						COM_DISC,
+						COM_CLONUP_STONDOWN,
+						COM_STONUP_CLONDOWN,
+					},
+					[4] = {
+						COM_DISC,
+						COM_TGONCM,
+						COM_CLONCM,
+						COM_STONCM,
+					},
+					[5] = {
+						COM_DISC,
+						COM_DISC,
+						COM_CLONCM_STATBOT,
+						COM_STONCM_CLATBOT,
+					},
+					[6] = {
+						COM_DISC,
+						COM_DISC,
+						COM_CLONCM_STATBOT,
+						COM_STONCM_CLATBOT,
+					},
+					[7] = {
+						COM_DISC,
+						COM_DISC,
+						COM_CLONCM_STATBOT,
+						COM_STONCM_CLATBOT,
+					},
+					[8] = {
+						COM_DISC,
+						COM_DISC,
+						COM_CLONUP_STONDOWN,
+						COM_STONUP_CLONDOWN,
+					},
+					[9] = {
+						COM_DISC,
+						COM_TGONCM,
+						COM_CLONUP_STONDOWN,
+						COM_STONUP_CLONDOWN,
+					},
+					[10] = {
+						COM_DISC,
+						COM_DISC,
+						COM_CLONUP_STONDOWN,
+						COM_STONUP_CLONDOWN,
+					},
+					[11] = {
+						COM_DISC,
+						COM_DISC,
+						COM_CLONUP_STONDOWN,
+						COM_STONUP_CLONDOWN,
+					},
+					[12] = {
+						COM_DISC,
+						COM_TGONCM,
+						COM_CLONCM,
+						COM_STONCM,
+					},
+					[14] = {
+						COM_DISC,
+						COM_DISC,
+						COM_CLONCM_STATBOT,
+						COM_STONCM_CLATBOT,
+					},
+					[15] = {
+						COM_DISC,
+						COM_TGONCM,
+						COM_CLONCM_STATBOT,
+						COM_STONCM_CLATBOT,
+					},
+				},
+				.iv = {
+					.enable = IOBIT(TIMSK, OCIE1A),
+					.raised = IOBIT(TIFR, OCF1A),
+					.vector = TIMER1_COMPA_vect_num
+				},
+			},
+			[1] = {
+				.ocr = {
+					IOBYTE(OCR1BL), IOBYTE(OCR1BH)
+				},
+				.pin = IOBIT(PORTB, PB2),
+				.ddp = IOBIT(DDRB, PB2),
+				.com = IOBITS(TCCR1A, COM1B0, 0x3, 2),
+				.com_op = {
+					[0] = {
+						COM_DISC,
+						COM_TGONCM,
+						COM_CLONCM,
+						COM_STONCM,
+					},
+					[1] = {
+						COM_DISC,
+						COM_DISC,
+						COM_CLONUP_STONDOWN,
+						COM_STONUP_CLONDOWN,
+					},
+					[2] = {
+						COM_DISC,
+						COM_DISC,
+						COM_CLONUP_STONDOWN,
+						COM_STONUP_CLONDOWN,
+					},
+					[3] = {
+						COM_DISC,
+						COM_DISC,
+						COM_CLONUP_STONDOWN,
+						COM_STONUP_CLONDOWN,
+					},
+					[4] = {
+						COM_DISC,
+						COM_TGONCM,
+						COM_CLONCM,
+						COM_STONCM,
+					},
+					[5] = {
+						COM_DISC,
+						COM_DISC,
+						COM_CLONCM_STATBOT,
+						COM_STONCM_CLATBOT,
+					},
+					[6] = {
+						COM_DISC,
+						COM_DISC,
+						COM_CLONCM_STATBOT,
+						COM_STONCM_CLATBOT,
+					},
+					[7] = {
+						COM_DISC,
+						COM_DISC,
+						COM_CLONCM_STATBOT,
+						COM_STONCM_CLATBOT,
+					},
+					[8] = {
+						COM_DISC,
+						COM_DISC,
+						COM_CLONUP_STONDOWN,
+						COM_STONUP_CLONDOWN,
+					},
+					[9] = {
+						COM_DISC,
+						COM_DISC,
+						COM_CLONUP_STONDOWN,
+						COM_STONUP_CLONDOWN,
+					},
+					[10] = {
+						COM_DISC,
+						COM_DISC,
+						COM_CLONUP_STONDOWN,
+						COM_STONUP_CLONDOWN,
+					},
+					[11] = {
+						COM_DISC,
+						COM_DISC,
+						COM_CLONUP_STONDOWN,
+						COM_STONUP_CLONDOWN,
+					},
+					[12] = {
+						COM_DISC,
+						COM_TGONCM,
+						COM_CLONCM,
+						COM_STONCM,
+					},
+					[14] = {
+						COM_DISC,
+						COM_DISC,
+						COM_CLONCM_STATBOT,
+						COM_STONCM_CLATBOT,
+					},
+					[15] = {
+						COM_DISC,
+						COM_DISC,
+						COM_CLONCM_STATBOT,
+						COM_STONCM_CLATBOT,
+					},
+				},
+				.iv = {
+					.enable = IOBIT(TIMSK, OCIE1B),
+					.raised = IOBIT(TIFR, OCF1B),
+					.vector = TIMER1_COMPB_vect_num
+				},
+			},
+		},
+	},
+	[2] = {
+		/* ---------------- Basic config ------------------- */
+		.tcnt = { IOBYTE(TCNT2) },
+		.disabled = IONOBIT(),
+		.size = 8,
+		/* ------------- Clock select config --------------- */
+		.cs = {
+			IOBIT(TCCR2, CS20), IOBIT(TCCR2, CS21),
+			IOBIT(TCCR2, CS22)
+		},
+		.cs_div = { 0, 0, 3, 5, 6, 7, 8, 10 }, /* Power of 2 */
+		/* ------- Waveform generation mode config --------- */
+		.wgm = { IOBIT(TCCR2, WGM20), IOBIT(TCCR2, WGM21) },
+		.wgm_op = {
+			[0] = {
+				.kind = WGM_NORMAL,
+				.size = 8,
+				.top = 0xFF,
+				.updocr_at = UPD_ATIMMEDIATE,
+				.settov_at = UPD_ATMAX,
+			},
+			[1] = {
+				.kind = WGM_PCPWM,
+				.size = 8,
+				.top = 0xFF,
+				.updocr_at = UPD_ATTOP,
+				.settov_at = UPD_ATBOTTOM,
+			},
+			[2] = {
+				.kind = WGM_CTC,
+				.rtop = { IOBYTE(OCR2) },
+				.updocr_at = UPD_ATIMMEDIATE,
+				.settov_at = UPD_ATMAX,
+			},
+			[3] = {
+				.kind = WGM_FASTPWM,
+				.size = 8,
+				.top = 0xFF,
+				.updocr_at = UPD_ATBOTTOM,
+				.settov_at = UPD_ATMAX,
+			},
+		},
+		/* ------------ Input capture config --------------- */
+		.icr = IONOBITA(),
+		.icp = IONOBIT(),
+		.ices = IONOBITA(),
+		/* ------------- Interrupts config ----------------- */
+		.iv_ovf = {
+			.enable = IOBIT(TIMSK, TOIE2),
+			.raised = IOBIT(TIFR, TOV2),
+			.vector = TIMER2_OVF_vect_num
+		},
+		.iv_ic = NOINTV(),
+		/* ----------- Output compare config --------------- */
+		.comp = {
+			[0] = {
+				.ocr = { IOBYTE(OCR2) },
+				.pin = IOBIT(PORTB, PB3),
+				.ddp = IOBIT(DDRB, PB3),
+				.com = IOBITS(TCCR2, COM20, 0x3, 2),
+				.com_op = {
+					[0] = {
+						COM_DISC,
+						COM_TGONCM,
+						COM_CLONCM,
+						COM_STONCM,
+					},
+					[1] = {
+						COM_DISC,
+						COM_DISC,
+						COM_CLONUP_STONDOWN,
+						COM_STONUP_CLONDOWN,
+					},
+					[2] = {
+						COM_DISC,
+						COM_TGONCM,
+						COM_CLONCM,
+						COM_STONCM,
+					},
+					[3] = {
+						COM_DISC,
+						COM_DISC,
+						COM_CLONCM_STATBOT,
+						COM_STONCM_CLATBOT,
+					},
+				},
+				.iv = {
+					.enable = IOBIT(TIMSK, OCIE2),
+					.raised = IOBIT(TIFR, OCF2),
+					.vector = TIMER2_COMP_vect_num
+				},
+			},
+		},
+	},
+};
+
 const static struct MSIM_AVR ORIG_M8A = {
 	.name = "ATmega8A",
 	.signature = { SIGNATURE_0, SIGNATURE_1, SIGNATURE_2 },
@@ -56,6 +549,8 @@ const static struct MSIM_AVR ORIG_M8A = {
 	.xmega = 0,
 	.reduced_core = 0,
 	.spm_pagesize = SPM_PAGESIZE,
+	.se = IOBIT(MCUCR, SE),
+	.sm = { IOBITS(MCUCR, SM0, 0x7, 3) },
 	.flashstart = FLASHSTART,
 	.flashend = FLASHEND,
 	.ramstart = RAMSTART,
@@ -69,6 +564,8 @@ const static struct MSIM_AVR ORIG_M8A = {
 	.set_fusef = MSIM_M8ASetFuse,
 	.set_lockf = MSIM_M8ASetLock,
 	.tick_perf = MSIM_M8AUpdate,
+	.idle_perf = MSIM_M8AIdle,
+	.skip_perf = MSIM_M8ASkip,
 	.reset_spm = MSIM_M8AResetSPM,
 	.fuse = { LFUSE_DEFAULT, HFUSE_DEFAULT, 0xFF },
 	.bls = {
@@ -80,493 +577,6 @@ const static struct MSIM_AVR ORIG_M8A = {
 		.reset_pc = 0x0000,
 		.ivt = 0x0002,
 	},
-	.timers = {
-		[0] = {
-			/* ---------------- Basic config ------------------- */
-			.tcnt = { IOBYTE(TCNT0) },
-			.disabled = IONOBIT(),
-			.size = 8,
-			/* ------------- Clock select config --------------- */
-			.cs = {
-				IOBIT(TCCR0, CS00), IOBIT(TCCR0, CS01),
-				IOBIT(TCCR0, CS02)
-			},
-			.cs_div = { 0, 0, 3, 6, 8, 10 }, /* Power of 2 */
-			/* ------- Waveform generation mode config --------- */
-			.wgm = IONOBITA(),
-			.wgm_op = NOWGMA(),
-			/* ------------ Input capture config --------------- */
-			.icr = IONOBITA(),
-			.icp = IONOBIT(),
-			.ices = IONOBITA(),
-			/* ------------- Interrupts config ----------------- */
-			.iv_ovf = {
-				.enable = IOBIT(TIMSK, TOIE0),
-				.raised = IOBIT(TIFR, TOV0),
-				.vector = TIMER0_OVF_vect_num
-			},
-			.iv_ic = NOINTV(),
-			/* ----------- Output compare config --------------- */
-			.comp = NOCOMPA(),
-		},
-		[1] = {
-			/* ---------------- Basic config ------------------- */
-			.tcnt = { IOBYTE(TCNT1L), IOBYTE(TCNT1H) },
-			.disabled = IONOBIT(),
-			.size = 16,
-			/* ------------- Clock select config --------------- */
-			.cs = {
-				IOBIT(TCCR1B, CS10), IOBIT(TCCR1B, CS11),
-				IOBIT(TCCR1B, CS12)
-			},
-			.cs_div = { 0, 0, 3, 6, 8, 10 }, /* Power of 2 */
-			/* ------- Waveform generation mode config --------- */
-			.wgm = {
-				IOBIT(TCCR1A, WGM10), IOBIT(TCCR1A, WGM11),
-				IOBIT(TCCR1B, WGM12), IOBIT(TCCR1B, WGM13)
-			},
-			.wgm_op = {
-				[0] = {
-					.kind = WGM_NORMAL,
-					.size = 16,
-					.top = 0xFFFF,
-					.updocr_at = UPD_ATIMMEDIATE,
-					.settov_at = UPD_ATMAX,
-				},
-				[1] = {
-					.kind = WGM_PCPWM,
-					.size = 8,
-					.top = 0x00FF,
-					.updocr_at = UPD_ATTOP,
-					.settov_at = UPD_ATBOTTOM,
-				},
-				[2] = {
-					.kind = WGM_PCPWM,
-					.size = 9,
-					.top = 0x01FF,
-					.updocr_at = UPD_ATTOP,
-					.settov_at = UPD_ATBOTTOM,
-				},
-				[3] = {
-					.kind = WGM_PCPWM,
-					.size = 10,
-					.top = 0x03FF,
-					.updocr_at = UPD_ATTOP,
-					.settov_at = UPD_ATBOTTOM,
-				},
-				[4] = {
-					.kind = WGM_CTC,
-					.rtop = {
-						IOBYTE(OCR1AL), IOBYTE(OCR1AH)
-					},
-					.updocr_at = UPD_ATIMMEDIATE,
-					.settov_at = UPD_ATMAX,
-				},
-				[5] = {
-					.kind = WGM_FASTPWM,
-					.size = 8,
-					.top = 0x00FF,
-					.updocr_at = UPD_ATBOTTOM,
-					.settov_at = UPD_ATTOP,
-				},
-				[6] = {
-					.kind = WGM_FASTPWM,
-					.size = 9,
-					.top = 0x01FF,
-					.updocr_at = UPD_ATBOTTOM,
-					.settov_at = UPD_ATTOP,
-				},
-				[7] = {
-					.kind = WGM_FASTPWM,
-					.size = 10,
-					.top = 0x01FF,
-					.updocr_at = UPD_ATBOTTOM,
-					.settov_at = UPD_ATTOP,
-				},
-				[8] = {
-					.kind = WGM_PFCPWM,
-					.rtop = {
-						IOBYTE(ICR1L), IOBYTE(ICR1H)
-					},
-					.updocr_at = UPD_ATBOTTOM,
-					.settov_at = UPD_ATBOTTOM,
-				},
-				[9] = {
-					.kind = WGM_PFCPWM,
-					.rtop = {
-						IOBYTE(OCR1AL), IOBYTE(OCR1AH)
-					},
-					.updocr_at = UPD_ATBOTTOM,
-					.settov_at = UPD_ATBOTTOM,
-				},
-				[10] = {
-					.kind = WGM_PCPWM,
-					.rtop = {
-						IOBYTE(ICR1L), IOBYTE(ICR1H)
-					},
-					.updocr_at = UPD_ATTOP,
-					.settov_at = UPD_ATBOTTOM,
-				},
-				[11] = {
-					.kind = WGM_PCPWM,
-					.rtop = {
-						IOBYTE(OCR1AL), IOBYTE(OCR1AH)
-					},
-					.updocr_at = UPD_ATTOP,
-					.settov_at = UPD_ATBOTTOM,
-				},
-				[12] = {
-					.kind = WGM_CTC,
-					.rtop = {
-						IOBYTE(ICR1L), IOBYTE(ICR1H)
-					},
-					.updocr_at = UPD_ATIMMEDIATE,
-					.settov_at = UPD_ATMAX,
-				},
-				[13] = {
-					.kind = WGM_NONE,
-				},
-				[14] = {
-					.kind = WGM_FASTPWM,
-					.rtop = {
-						IOBYTE(ICR1L), IOBYTE(ICR1H)
-					},
-					.updocr_at = UPD_ATBOTTOM,
-					.settov_at = UPD_ATTOP,
-				},
-				[15] = {
-					.kind = WGM_FASTPWM,
-					.rtop = {
-						IOBYTE(OCR1AL), IOBYTE(OCR1AH)
-					},
-					.updocr_at = UPD_ATBOTTOM,
-					.settov_at = UPD_ATTOP,
-				},
-			},
-			/* ------------ Input capture config --------------- */
-			.icr = { IOBYTE(ICR1L), IOBYTE(ICR1H) },
-			.icp = IOBIT(PORTB, PB0),
-			.ices = { IOBIT(TCCR1B, ICES1) },
-			/* ------------- Interrupts config ----------------- */
-			.iv_ovf = {
-				.enable = IOBIT(TIMSK, TOIE1),
-				.raised = IOBIT(TIFR, TOV1),
-				.vector = TIMER1_OVF_vect_num
-			},
-			.iv_ic = {
-				.enable = IOBIT(TIMSK, TICIE1),
-				.raised = IOBIT(TIFR, ICF1),
-				.vector = TIMER1_CAPT_vect_num
-			},
-			/* ----------- Output compare config --------------- */
-			.comp = {
-				[0] = {
-					.ocr = {
-						IOBYTE(OCR1AL), IOBYTE(OCR1AH)
-					},
-					.pin = IOBIT(PORTB, PB1),
-					.ddp = IOBIT(DDRB, PB1),
-					.com = IOBITS(TCCR1A, COM1A0, 0x3, 2),
-					.com_op = {
-						[0] = {
-							COM_DISC,
-							COM_TGONCM,
-							COM_CLONCM,
-							COM_STONCM,
-						},
-						[1] = {
-							COM_DISC,
-							COM_DISC,
-							COM_CLONUP_STONDOWN,
-							COM_STONUP_CLONDOWN,
-						},
-						[2] = {
-							COM_DISC,
-							COM_DISC,
-							COM_CLONUP_STONDOWN,
-							COM_STONUP_CLONDOWN,
-						},
-						[3] = {
-							COM_DISC,
-							COM_DISC,
-							COM_CLONUP_STONDOWN,
-							COM_STONUP_CLONDOWN,
-						},
-						[4] = {
-							COM_DISC,
-							COM_TGONCM,
-							COM_CLONCM,
-							COM_STONCM,
-						},
-						[5] = {
-							COM_DISC,
-							COM_DISC,
-							COM_CLONCM_STATBOT,
-							COM_STONCM_CLATBOT,
-						},
-						[6] = {
-							COM_DISC,
-							COM_DISC,
-							COM_CLONCM_STATBOT,
-							COM_STONCM_CLATBOT,
-						},
-						[7] = {
-							COM_DISC,
-							COM_DISC,
-							COM_CLONCM_STATBOT,
-							COM_STONCM_CLATBOT,
-						},
-						[8] = {
-							COM_DISC,
-							COM_DISC,
-							COM_CLONUP_STONDOWN,
-							COM_STONUP_CLONDOWN,
-						},
-						[9] = {
-							COM_DISC,
-							COM_TGONCM,
-							COM_CLONUP_STONDOWN,
-							COM_STONUP_CLONDOWN,
-						},
-						[10] = {
-							COM_DISC,
-							COM_DISC,
-							COM_CLONUP_STONDOWN,
-							COM_STONUP_CLONDOWN,
-						},
-						[11] = {
-							COM_DISC,
-							COM_DISC,
-							COM_CLONUP_STONDOWN,
-							COM_STONUP_CLONDOWN,
-						},
-						[12] = {
-							COM_DISC,
-							COM_TGONCM,
-							COM_CLONCM,
-							COM_STONCM,
-						},
-						[14] = {
-							COM_DISC,
-							COM_DISC,
-							COM_CLONCM_STATBOT,
-							COM_STONCM_CLATBOT,
-						},
-						[15] = {
-							COM_DISC,
-							COM_TGONCM,
-							COM_CLONCM_STATBOT,
-							COM_STONCM_CLATBOT,
-						},
-					},
-					.iv = {
-						.enable = IOBIT(TIMSK, OCIE1A),
-						.raised = IOBIT(TIFR, OCF1A),
-						.vector = TIMER1_COMPA_vect_num
-					},
-				},
-				[1] = {
-					.ocr = {
-						IOBYTE(OCR1BL), IOBYTE(OCR1BH)
-					},
-					.pin = IOBIT(PORTB, PB2),
-					.ddp = IOBIT(DDRB, PB2),
-					.com = IOBITS(TCCR1A, COM1B0, 0x3, 2),
-					.com_op = {
-						[0] = {
-							COM_DISC,
-							COM_TGONCM,
-							COM_CLONCM,
-							COM_STONCM,
-						},
-						[1] = {
-							COM_DISC,
-							COM_DISC,
-							COM_CLONUP_STONDOWN,
-							COM_STONUP_CLONDOWN,
-						},
-						[2] = {
-							COM_DISC,
-							COM_DISC,
-							COM_CLONUP_STONDOWN,
-							COM_STONUP_CLONDOWN,
-						},
-						[3] = {
-							COM_DISC,
-							COM_DISC,
-							COM_CLONUP_STONDOWN,
-							COM_STONUP_CLONDOWN,
-						},
-						[4] = {
-							COM_DISC,
-							COM_TGONCM,
-							COM_CLONCM,
-							COM_STONCM,
-						},
-						[5] = {
-							COM_DISC,
-							COM_DISC,
-							COM_CLONCM_STATBOT,
-							COM_STONCM_CLATBOT,
-						},
-						[6] = {
-							COM_DISC,
-							COM_DISC,
-							COM_CLONCM_STATBOT,
-							COM_STONCM_CLATBOT,
-						},
-						[7] = {
-							COM_DISC,
-							COM_DISC,
-							COM_CLONCM_STATBOT,
-							COM_STONCM_CLATBOT,
-						},
-						[8] = {
-							COM_DISC,
-							COM_DISC,
-							COM_CLONUP_STONDOWN,
-							COM_STONUP_CLONDOWN,
-						},
-						[9] = {
-							COM_DISC,
-							COM_DISC,
-							COM_CLONUP_STONDOWN,
-							COM_STONUP_CLONDOWN,
-						},
-						[10] = {
-							COM_DISC,
-							COM_DISC,
-							COM_CLONUP_STONDOWN,
-							COM_STONUP_CLONDOWN,
-						},
-						[11] = {
-							COM_DISC,
-							COM_DISC,
-							COM_CLONUP_STONDOWN,
-							COM_STONUP_CLONDOWN,
-						},
-						[12] = {
-							COM_DISC,
-							COM_TGONCM,
-							COM_CLONCM,
-							COM_STONCM,
-						},
-						[14] = {
-							COM_DISC,
-							COM_DISC,
-							COM_CLONCM_STATBOT,
-							COM_STONCM_CLATBOT,
-						},
-						[15] = {
-							COM_DISC,
-							COM_DISC,
-							COM_CLONCM_STATBOT,
-							COM_STONCM_CLATBOT,
-						},
-					},
-					.iv = {
-						.enable = IOBIT(TIMSK, OCIE1B),
-						.raised = IOBIT(TIFR, OCF1B),
-						.vector = TIMER1_COMPB_vect_num
-					},
-				},
-			},
-		},
-		[2] = {
-			/* ---------------- Basic config ------------------- */
-			.tcnt = { IOBYTE(TCNT2) },
-			.disabled = IONOBIT(),
-			.size = 8,
-			/* ------------- Clock select config --------------- */
-			.cs = {
-				IOBIT(TCCR2, CS20), IOBIT(TCCR2, CS21),
-				IOBIT(TCCR2, CS22)
-			},
-			.cs_div = { 0, 0, 3, 5, 6, 7, 8, 10 }, /* Power of 2 */
-			/* ------- Waveform generation mode config --------- */
-			.wgm = { IOBIT(TCCR2, WGM20), IOBIT(TCCR2, WGM21) },
-			.wgm_op = {
-				[0] = {
-					.kind = WGM_NORMAL,
-					.size = 8,
-					.top = 0xFF,
-					.updocr_at = UPD_ATIMMEDIATE,
-					.settov_at = UPD_ATMAX,
-				},
-				[1] = {
-					.kind = WGM_PCPWM,
-					.size = 8,
-					.top = 0xFF,
-					.updocr_at = UPD_ATTOP,
-					.settov_at = UPD_ATBOTTOM,
-				},
-				[2] = {
-					.kind = WGM_CTC,
-					.rtop = { IOBYTE(OCR2) },
-					.updocr_at = UPD_ATIMMEDIATE,
-					.settov_at = UPD_ATMAX,
-				},
-				[3] = {
-					.kind = WGM_FASTPWM,
-					.size = 8,
-					.top = 0xFF,
-					.updocr_at = UPD_ATBOTTOM,
-					.settov_at = UPD_ATMAX,
-				},
-			},
-			/* ------------ Input capture config --------------- */
-			.icr = IONOBITA(),
-			.icp = IONOBIT(),
-			.ices = IONOBITA(),
-			/* ------------- Interrupts config ----------------- */
-			.iv_ovf = {
-				.enable = IOBIT(TIMSK, TOIE2),
-				.raised = IOBIT(TIFR, TOV2),
-				.vector = TIMER2_OVF_vect_num
-			},
-			.iv_ic = NOINTV(),
-			/* ----------- Output compare config --------------- */
-			.comp = {
-				[0] = {
-					.ocr = { IOBYTE(OCR2) },
-					.pin = IOBIT(PORTB, PB3),
-					.ddp = IOBIT(DDRB, PB3),
-					.com = IOBITS(TCCR2, COM20, 0x3, 2),
-					.com_op = {
-						[0] = {
-							COM_DISC,
-							COM_TGONCM,
-							COM_CLONCM,
-							COM_STONCM,
-						},
-						[1] = {
-							COM_DISC,
-							COM_DISC,
-							COM_CLONUP_STONDOWN,
-							COM_STONUP_CLONDOWN,
-						},
-						[2] = {
-							COM_DISC,
-							COM_TGONCM,
-							COM_CLONCM,
-							COM_STONCM,
-						},
-						[3] = {
-							COM_DISC,
-							COM_DISC,
-							COM_CLONCM_STATBOT,
-							COM_STONCM_CLATBOT,
-						},
-					},
-					.iv = {
-						.enable = IOBIT(TIMSK, OCIE2),
-						.raised = IOBIT(TIFR, OCF2),
-						.vector = TIMER2_COMP_vect_num
-					},
-				},
-			},
-		},
-	},
 	.wdt = {
 		.wdton = FBIT(1, WDTON),
 		.wde = IOBIT(WDTCR, WDE),
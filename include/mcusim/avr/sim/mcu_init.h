@@ -20,10 +20,14 @@
 #ifndef MSIM_AVR_MCUINIT_H_
 #define MSIM_AVR_MCUINIT_H_ 1
 
-/* A model-independent function to initialize an AVR MCU */
+/* A model-independent function to initialize an AVR MCU. Timers of the
+ * model are copied to the memory of the MCU. */
 static inline int
-mcu_init(const MSIM_AVR *orig, MSIM_AVR *mcu, MSIM_InitArgs *args)
+mcu_init(const MSIM_AVR *orig, const MSIM_AVR_TMR *timers,
+         uint32_t timers_num, MSIM_AVR *mcu, MSIM_InitArgs *args)
 {
+	MSIM_ARENA arena;
+	char *logbuf;
 	uint32_t i, pmsz, dmsz;
 	uint32_t pm_size = args->pmsz;
 	uint32_t dm_size = args->dmsz;
@@ -32,9 +36,17 @@ mcu_init(const MSIM_AVR *orig, MSIM_AVR *mcu, MSIM_InitArgs *args)
 		MSIM_LOG_FATAL("MCU instance should not be null");
 		return 255;
 	}
+	if (mcu->log == NULL) {
+		MSIM_LOG_FATAL("log buffer of the MCU should be allocated");
+		return 255;
+	}
 
 	/* Copy MCU from the original one declared in a header file. */
+	arena = mcu->arena;
+	logbuf = mcu->log;
 	(*mcu) = (*orig);
+	mcu->arena = arena;
+	mcu->log = logbuf;
 
 	if (SPMCSR > 0) {
 		mcu->spmcsr = &mcu->dm[SPMCSR];
@@ -47,18 +59,20 @@ mcu_init(const MSIM_AVR *orig, MSIM_AVR *mcu, MSIM_InitArgs *args)
 	/* Program memory */
 	pmsz = mcu->flashend - mcu->flashstart + 1;
 	if (pm_size < pmsz) {
-		snprintf(mcu->log, sizeof mcu->log, "program memory is "
+		snprintf(mcu->log, MSIM_AVR_LOGSZ, "program memory is "
 		         "limited by %" PRIu32 " bytes, %" PRIu32 " bytes is "
 		         "not enough", pmsz, pm_size);
 		MSIM_LOG_FATAL(mcu->log);
 		return 255;
 	}
-	mcu->pm_size = pm_size;
+	/* Two extra words let a 32-bit instruction be fetched at the
+	 * last word of the PM. */
+	mcu->pm_size = (pmsz >> 1) + 2;
 
 	/* Data memory */
 	dmsz = mcu->regs_num + mcu->ioregs_num + mcu->ramsize;
 	if (dm_size < dmsz) {
-		snprintf(mcu->log, sizeof mcu->log, "data memory is limited "
+		snprintf(mcu->log, MSIM_AVR_LOGSZ, "data memory is limited "
 		         "by %" PRIu32 " bytes, %" PRIu32 " bytes is not "
 		         "enough", dmsz, dm_size);
 		MSIM_LOG_FATAL(mcu->log);
@@ -66,6 +80,36 @@ mcu_init(const MSIM_AVR *orig, MSIM_AVR *mcu, MSIM_InitArgs *args)
 	}
 	mcu->dm_size = dm_size;
 
+	/* Memories are sized to the MCU model */
+	mcu->pm = MSIM_ARENA_Alloc(&mcu->arena,
+	                           mcu->pm_size * sizeof *mcu->pm);
+	mcu->pmp = MSIM_ARENA_Alloc(&mcu->arena,
+	                            mcu->pm_size * sizeof *mcu->pmp);
+	mcu->bp = MSIM_ARENA_Alloc(&mcu->arena, (mcu->pm_size + 7) >> 3);
+	mcu->pm_dirty = MSIM_ARENA_Alloc(&mcu->arena, (((mcu->pm_size +
+	                MSIM_AVR_SNAP_PAGESZ - 1) / MSIM_AVR_SNAP_PAGESZ) +
+	                7) >> 3);
+	mcu->dpm = MSIM_ARENA_Alloc(&mcu->arena,
+	                            mcu->pm_size * sizeof *mcu->dpm);
+	mcu->ioregs = MSIM_ARENA_Alloc(&mcu->arena, (mcu->regs_num +
+	                               mcu->ioregs_num) * sizeof *mcu->ioregs);
+	mcu->vcd = MSIM_ARENA_Alloc(&mcu->arena, sizeof *mcu->vcd);
+	mcu->pty = MSIM_ARENA_Alloc(&mcu->arena, sizeof *mcu->pty);
+	mcu->timers = MSIM_ARENA_Alloc(&mcu->arena,
+	                               timers_num * sizeof *mcu->timers);
+	if ((mcu->pm == NULL) || (mcu->pmp == NULL) || (mcu->bp == NULL) ||
+	                (mcu->pm_dirty == NULL) ||
+	                (mcu->dpm == NULL) || (mcu->ioregs == NULL) ||
+	                (mcu->vcd == NULL) || (mcu->pty == NULL) ||
+	                (mcu->timers == NULL)) {
+		MSIM_LOG_FATAL("failed to allocate memories of the MCU");
+		return 255;
+	}
+	if (timers_num > 0U) {
+		memcpy(mcu->timers, timers, timers_num * sizeof *timers);
+	}
+	mcu->timers_num = timers_num;
+
 	mcu->sreg = &mcu->dm[SREG];
 	mcu->sph = &mcu->dm[SPH];
 	mcu->spl = &mcu->dm[SPL];
@@ -96,14 +140,17 @@ mcu_init(const MSIM_AVR *orig, MSIM_AVR *mcu, MSIM_InitArgs *args)
 	}
 
 	/* Init descriptors of the I/O registers */
-	for (i = 0; i < MSIM_AVR_DMSZ; i++) {
+	for (i = 0; i < (mcu->regs_num + mcu->ioregs_num); i++) {
 		mcu->ioregs[i].off = -1;
 	}
 	/* Init registers to be included into VCD dump */
 	for (i = 0; i < MSIM_AVR_VCD_REGS; i++) {
-		mcu->vcd.regs[i].i = -1;
-		mcu->vcd.regs[i].reg_lowi = -1;
+		mcu->vcd->regs[i].i = -1;
+		mcu->vcd->regs[i].reg_lowi = -1;
 	}
+	/* Pseudo-terminal is opened by the MCU model if it has USART */
+	mcu->pty->master_fd = -1;
+	mcu->pty->slave_fd = -1;
 
 #ifdef AVR_INIT_IOREGS
 	struct MSIM_AVR_IOReg ioregs[] = AVR_INIT_IOREGS;
@@ -111,7 +158,8 @@ mcu_init(const MSIM_AVR *orig, MSIM_AVR *mcu, MSIM_InitArgs *args)
 
 	/* Fill descriptors of the available I/O registers */
 	for (i = 0; i < ioregs_num; i++) {
-		if ((ioregs[i].off > 0) && (ioregs[i].off < MSIM_AVR_DMSZ)) {
+		if ((ioregs[i].off > 0) && ((uint32_t)ioregs[i].off <
+		                (mcu->regs_num + mcu->ioregs_num))) {
 			mcu->ioregs[ioregs[i].off] = ioregs[i];
 			mcu->ioregs[ioregs[i].off].addr =
 			        &mcu->dm[ioregs[i].off];
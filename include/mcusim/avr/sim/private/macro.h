@@ -50,7 +50,10 @@
 #define PM(v)			(mcu->pm[(v)])
 #define DM(v)			(mcu->dm[(v)])
 #define IOR(v)			(DM(SFR + (v)))
-#define MPM(v)			(mcu->mpm[(v)])
+
+/* Helps to test whether a breakpoint is set at the PM word. */
+#define BP(v)			((mcu->bp_num != 0U) && \
+				 ((mcu->bp[(v) >> 3] >> ((v) & 7U)) & 1U))
 
 #define LOG			(mcu->log)
 #define LOGSZ			(MSIM_AVR_LOGSZ)
@@ -66,21 +69,17 @@
 #define IO(io, v)		((mcu->dm[io])&(~(mcu->ioregs[io].mask))) | \
 				((v)&(mcu->ioregs[io].mask))
 
-/* Helps to test whether I/O register of the AVR MCU been written or not. */
-#define IS_WRIT(mcu, io)	(((mcu->writ_io[0]) == (io)) || \
-				 ((mcu->writ_io[1]) == (io)) || \
-				 ((mcu->writ_io[2]) == (io)) || \
-				 ((mcu->writ_io[3]) == (io)))
-/* Helps to test whether I/O register of the AVR MCU been read or not. */
-#define IS_READ(mcu, io)	(((mcu->read_io[0]) == (io)) || \
-				 ((mcu->read_io[1]) == (io)) || \
-				 ((mcu->read_io[2]) == (io)) || \
-				 ((mcu->read_io[3]) == (io)))
-
 /* Helps to test whether location is I/O register or not. */
 #define IS_IO(mcu, loc)		((mcu->regs_num <= loc) && \
 				 (loc < (mcu->regs_num+mcu->ioregs_num)))
 
+/* Notify a peripheral that its I/O register has been read by firmware. */
+#define READ_IO(loc) do {						\
+	if (IS_IO(mcu, loc) && (mcu->ioregs[loc].read != NULL)) {	\
+		mcu->ioregs[loc].read(mcu, loc, DM(loc));		\
+	}								\
+} while (0)
+
 /* Read an AVR status register (SREG). */
 #define SR(mcu, flag)		((uint8_t)((*mcu->sreg >> (flag))&1))
 
@@ -100,6 +99,9 @@
  * instruction should be finished within required number of cycles in spite
  * of the fact that major of the AVR instructions occupy 1 clock cycle only.
  *
+ * Intermediate cycles are performed right here if the instruction is
+ * going to be completed within a single step (see MSIM_AVR_SimInst).
+ *
  * mcu		Pointer to the MCU instance structure.
  * cond		Condition to start skipping cycles.
  * cycl		Number of cycles to skip (this is a number of cycles per
@@ -110,7 +112,10 @@
 		/* It is the first cycle of a multi-cycle instruction */\
 		mcu->mci = 1;					\
 		mcu->ic_left = cycl;					\
-		return;							\
+		if (!mcu->whole_inst) {					\
+			return;						\
+		}							\
+		MSIM_AVR_SimCycles(mcu);				\
 	}								\
 	if (mcu->mci && mcu->ic_left) {				\
 		/* Skip intermediate cycles */				\
@@ -122,12 +127,16 @@
 } while (0)
 
 /* Write value to the data space. Location will be checked against space of
- * I/O registers and access mask will be applied if necessary. */
+ * I/O registers and access mask will be applied if necessary. Peripheral
+ * which owns the I/O register is notified about the write. */
 #ifndef DEBUG
 #define WRITE_DS(loc, v) do {						\
 	if (IS_IO(mcu, loc)) {						\
+		uint8_t io_old = DM(loc);				\
 		DM(loc) = ((uint8_t)IO(loc, v));			\
-		mcu->writ_io[0] = loc;					\
+		if (mcu->ioregs[loc].write != NULL) {			\
+			mcu->ioregs[loc].write(mcu, loc, io_old);	\
+		}							\
 	} else {							\
 		DM(loc) = v;						\
 	}								\
@@ -140,6 +149,7 @@
 #ifdef DEBUG
 #define WRITE_DS(loc, v) do {						\
 	if (IS_IO(mcu, loc)) {						\
+		uint8_t io_old = DM(loc);				\
 		if (mcu->ioregs[loc].off < 0) {				\
 			snprintf(LOG, LOGSZ, "firmware is trying to "	\
 			         "write to unknown I/O register: 0x%04"	\
@@ -147,7 +157,9 @@
 			MSIM_LOG_DEBUG(LOG);				\
 		}							\
 		DM(loc) = IO(loc, v);					\
-		mcu->writ_io[0] = loc;					\
+		if (mcu->ioregs[loc].write != NULL) {			\
+			mcu->ioregs[loc].write(mcu, loc, io_old);	\
+		}							\
 	} else {							\
 		DM(loc) = v;						\
 	}								\
@@ -20,7 +20,9 @@
 #define MSIM_AVR_SIM_H_ 1
 
 #include <stdint.h>
+#include <signal.h>
 #include <pthread.h>
+#include "mcusim/arena.h"
 #include "mcusim/pty.h"
 #include "mcusim/tsq.h"
 #include "mcusim/avr/sim/vcd.h"
@@ -31,12 +33,13 @@
 #include "mcusim/avr/sim/bootloader.h"
 #include "mcusim/avr/sim/timer.h"
 
-#define MSIM_AVR_PMSZ		(256*1024)	/* Program Memory size */
+#define MSIM_AVR_PMSZ		(256*1024)	/* Max. Program Memory size */
 #define MSIM_AVR_PM_PAGESZ	(1024)		/* PM page size */
 #define MSIM_AVR_DMSZ		(64*1024)	/* Data Memory size */
 #define MSIM_AVR_LOGSZ		(64*1024)	/* Log buffer size */
-#define MSIM_AVR_MAXTMRS	(32)		/* Maximum # of timers */
 #define MSIM_AVR_MAXIOPORTS	(32)		/* Maximum # of I/O ports */
+#define MSIM_AVR_LOOPSZ		(512)		/* GP and I/O regs of a loop */
+#define MSIM_AVR_LUAMODELS	(256)		/* Maximum # of Lua models */
 
 #ifdef __cplusplus
 extern "C" {
@@ -44,11 +47,18 @@ extern "C" {
 
 struct MSIM_AVR;
 struct MSIM_AVRConf;
+struct MSIM_AVR_RSP;
+struct MSIM_AVR_JIT;
+struct lua_State;
 
 /* Simulated MCU may provide its own implementations of the functions in order
  * to support these features (fuses, locks, timers, IRQs, etc.). */
 typedef int (*MSIM_AVRFunc)(struct MSIM_AVR *mcu, struct MSIM_AVRConf *cnf);
 
+/* Simulated MCU may also report a number of cycles (up to the given one)
+ * its peripherals won't do anything observable and skip these cycles. */
+typedef uint32_t (*MSIM_AVRIdleFunc)(struct MSIM_AVR *mcu, uint32_t cycles);
+
 /* State of a simulated AVR microcontroller. Some of these states are
  * AVR-native, others - added by the simulator to manipulate a simulation
  * process. */
@@ -75,6 +85,25 @@ enum MSIM_AVR_ClkSource {
 	AVR_INT_128K_RC_CLK		/* Internal 128kHz RC Oscillator*/
 };
 
+/* Sleep modes of the AVR microcontroller (values of the SM bits). */
+enum MSIM_AVR_SleepMode {
+	AVR_SLEEP_IDLE,
+	AVR_SLEEP_ADCNR,		/* ADC noise reduction */
+	AVR_SLEEP_PWRDOWN,		/* Power-down */
+	AVR_SLEEP_PWRSAVE,		/* Power-save */
+	AVR_SLEEP_RESERVED4,
+	AVR_SLEEP_RESERVED5,
+	AVR_SLEEP_STANDBY,		/* Standby */
+	AVR_SLEEP_EXTSTANDBY		/* Extended standby */
+};
+
+/* Engine to execute instructions of the simulated AVR microcontroller. */
+enum MSIM_AVR_Engine {
+	AVR_DECODER_ENGINE,		/* Call handlers of the decoder */
+	AVR_THREADED_ENGINE,		/* Direct-threaded dispatch */
+	AVR_JIT_ENGINE			/* Threaded, hot blocks translated */
+};
+
 /* Configuration to be passed to the MCU-specific functions. */
 typedef struct MSIM_AVRConf {
 	uint32_t fuse_n;
@@ -82,10 +111,37 @@ typedef struct MSIM_AVRConf {
 	uint8_t lock_v;
 } MSIM_AVRConf;
 
+/* Instruction of the program memory decoded already. */
+typedef struct MSIM_AVR_Inst {
+	uint16_t inst;			/* Opcode (first 16-bit word) */
+	uint8_t op;			/* Index of the instruction handler */
+	uint8_t hits;			/* Blocks started here (JIT engine) */
+} MSIM_AVR_Inst;
+
+/* Operands of the last subtraction (CP, SUB, SBCI, etc.) to evaluate
+ * flags of SREG from. Flags are written to SREG when they're accessed. */
+typedef struct MSIM_AVR_LazySR {
+	uint8_t pend;			/* Flags aren't written to SREG yet */
+	uint8_t rd;			/* Minuend */
+	uint8_t rr;			/* Subtrahend (without carry) */
+	uint8_t r;			/* Result */
+	uint8_t z;			/* Zero flag */
+} MSIM_AVR_LazySR;
+
+/* Short loop to poll registers, it may be fast-forwarded. */
+typedef struct MSIM_AVR_Loop {
+	uint32_t head;			/* First instruction of the loop */
+	uint32_t tail;			/* Instruction to jump back from */
+	uint64_t tick;			/* Cycle the head was reached at */
+	uint8_t poll;			/* Loop polls registers only */
+	uint8_t regs[MSIM_AVR_LOOPSZ];	/* GP and I/O registers at head */
+	MSIM_AVR_LazySR lsr;		/* Lazy SREG flags at head */
+} MSIM_AVR_Loop;
+
 /* Instance of the 8-bit AVR microcontroller */
 typedef struct MSIM_AVR {
 	char name[20];			/* Name of the MCU */
-	char log[MSIM_AVR_LOGSZ];	/* Buffer to print a log message to */
+	char *log;			/* Buffer to print a log message to */
 	uint8_t signature[3];		/* Signature of the MCU */
 
 	uint8_t xmega;			/* AVR XMega flag */
@@ -109,9 +165,13 @@ typedef struct MSIM_AVR {
 
 	uint32_t spm_pagesize;		/* PM page size, in bytes (for SPM) */
 	uint8_t *spmcsr;		/* SPMCSR register address */
+	uint8_t spmen_cycles;		/* Clear SPMEN in # of cycles */
+	uint8_t spmen_clear;		/* SPMEN is to be cleared */
+
+	MSIM_AVR_IOBit se;		/* Sleep enable bit */
+	MSIM_AVR_IOBit sm[4];		/* Sleep mode select bits */
 
 	uint32_t freq;			/* Clock frequency, in Hz */
-	pthread_mutex_t freq_mutex;	/* Lock before accessing frequency */
 
 	uint32_t pc;			/* Program counter, in 16-bits words */
 	uint8_t pc_bits;		/* PC bits (16-bit, 22-bit, etc.) */
@@ -121,8 +181,12 @@ typedef struct MSIM_AVR {
 
 	uint8_t ic_left;		/* Cycles to finish cur. instruction */
 	uint8_t mci;			/* Multi-cycle instruction flag */
+	uint8_t whole_inst;		/* Complete instruction in one step */
+	uint8_t in_block;		/* Instruction is executed in a block */
+	uint32_t block_cycles;		/* Cycles of the instruction in block */
 
 	uint8_t *sreg;			/* SREG register pointer */
+	MSIM_AVR_LazySR lsr;		/* SREG flags to be evaluated */
 	uint8_t *sph;			/* SPH register pointer */
 	uint8_t *spl;			/* SPL register pointer */
 	uint8_t *eind;			/* EIND register pointer */
@@ -131,18 +195,20 @@ typedef struct MSIM_AVR {
 	uint8_t *rampx;			/* Ext. X-pointer register pointer */
 	uint8_t *rampd;			/* Ext. direct register pointer */
 
-	uint16_t pm[MSIM_AVR_PMSZ];	/* Program memory (PM) */
-	uint16_t pmp[MSIM_AVR_PMSZ];	/* Page buffer for program memory */
-	uint16_t mpm[MSIM_AVR_PMSZ];	/* Match points memory (MPM) */
-	uint32_t pm_size;		/* Actual PM size */
-	uint8_t read_from_mpm;		/* Read instruction from MPM flag */
+	uint16_t *pm;			/* Program memory (PM) */
+	uint16_t *pmp;			/* Page buffer for program memory */
+	MSIM_AVR_Inst *dpm;		/* Pre-decoded program memory */
+	uint32_t pm_size;		/* Actual PM size, in 16-bits words */
+	uint8_t *pm_dirty;		/* PM pages modified since snapshot */
+	uint32_t snap_id;		/* Snapshot PM pages are tracked from */
+	uint32_t snap_seq;		/* # of snapshots taken */
+	uint8_t *bp;			/* Breakpoints, bit per PM word */
+	uint32_t bp_num;		/* # of breakpoints set */
+	uint8_t bp_hit;			/* Stopped at a breakpoint flag */
 
 	uint8_t dm[MSIM_AVR_DMSZ];	/* Data memory (DM) */
 	uint32_t dm_size;		/* Actual DM size */
 
-	uint32_t writ_io[4];		/* I/O written on a previous cycle */
-	uint32_t read_io[4];		/* I/O read on a previous cycle */
-
 	uint32_t sfr_off;		/* Offset to I/O registers in DM */
 	uint32_t regs_num;		/* # of general purpose registers */
 	uint32_t ioregs_num;		/* # of I/O registers */
@@ -150,23 +216,43 @@ typedef struct MSIM_AVR {
 	MSIM_AVRFunc set_fusef;		/* Configure AVR fuses */
 	MSIM_AVRFunc set_lockf;		/* Configure AVR lock bits */
 	MSIM_AVRFunc tick_perf;		/* Tick AVR peripherals */
+	MSIM_AVRIdleFunc idle_perf;	/* Idle cycles of AVR peripherals */
+	MSIM_AVRIdleFunc skip_perf;	/* Skip idle cycles of peripherals */
 	MSIM_AVRFunc pass_irqs;		/* Provide IRQs */
 	MSIM_AVRFunc reset_spm;		/* Reset SPM instruction */
 
 	enum MSIM_AVR_State state;	/* State of the MCU */
-	pthread_mutex_t state_mutex;	/* Lock before accessing MCU state */
+	enum MSIM_AVR_SleepMode sleep_mode; /* Sleep mode of the MCU */
 	enum MSIM_AVR_ClkSource clk_source; /* Current MCU clock source */
 
 	MSIM_AVR_BLD bls;		/* Bootloader section details */
 	MSIM_AVR_INT intr;		/* Details to work with IRQs */
 	MSIM_AVR_WDT wdt;		/* Watchdog timer of the MCU */
-	MSIM_AVR_VCD vcd;		/* Details to work with VCD file */
+	MSIM_AVR_VCD *vcd;		/* Details to work with VCD file */
 	MSIM_AVR_USART usart;		/* Details to work with USART */
-	MSIM_PTY pty;			/* Details to work with POSIX PTY */
+	MSIM_PTY *pty;			/* Details to work with POSIX PTY */
+	MSIM_AVR_Loop loop;		/* Loop to be fast-forwarded */
 
-	MSIM_AVR_IOReg ioregs[MSIM_AVR_DMSZ];		/* I/O registers */
+	MSIM_AVR_IOReg *ioregs;				/* I/O registers */
 	MSIM_AVR_IOPort ioports[MSIM_AVR_MAXIOPORTS];	/* I/O ports */
-	MSIM_AVR_TMR timers[MSIM_AVR_MAXTMRS];		/* Timers/counters */
+	uint8_t io_sync;				/* Pins to be synced */
+	MSIM_AVR_TMR *timers;				/* Timers/counters */
+	uint32_t timers_num;				/* # of timers */
+
+	MSIM_ARENA arena;		/* Memories sized to the MCU model */
+
+	/* Details of the instance below aren't a part of the MCU state */
+	pthread_mutex_t freq_mutex;	/* Lock before accessing frequency */
+	pthread_mutex_t state_mutex;	/* Lock before accessing MCU state */
+	enum MSIM_AVR_Engine engine;	/* Instruction execution engine */
+	struct MSIM_AVR_JIT *jit;	/* Blocks translated to native code */
+	char ckpt_file[4096];		/* Checkpoint file to write */
+	uint64_t ckpt_tick;		/* Cycle to write the checkpoint at */
+	volatile sig_atomic_t ckpt_req;	/* Checkpoint is requested */
+	struct MSIM_AVR_RSP *rsp;	/* GDB RSP state */
+	struct lua_State *lua[MSIM_AVR_LUAMODELS]; /* Models in Lua */
+	uint32_t lua_num;		/* # of models in Lua */
+	struct MSIM_AVR_USARTLink *usart_link; /* USART of another MCU */
 } MSIM_AVR;
 
 #ifdef __cplusplus
@@ -34,12 +34,28 @@ extern "C" {
 #endif
 
 int	MSIM_AVR_Init(MSIM_AVR *mcu, MSIM_CFG *conf);
+void	MSIM_AVR_Configure(MSIM_AVR *mcu, MSIM_CFG *conf);
+void	MSIM_AVR_Free(MSIM_AVR *mcu);
 int	MSIM_AVR_Simulate(MSIM_AVR *mcu, uint8_t ft);
 int	MSIM_AVR_SimStep(MSIM_AVR *mcu, uint8_t ft);
+int	MSIM_AVR_SimInst(MSIM_AVR *mcu, uint8_t ft, uint32_t *cycles);
+int	MSIM_AVR_SimRun(MSIM_AVR *mcu, uint8_t ft, uint64_t cycles);
+int	MSIM_AVR_SimRunTo(MSIM_AVR *mcu, uint8_t ft, uint64_t cycles,
+                          uint32_t pc);
+void	MSIM_AVR_SimCycles(MSIM_AVR *mcu);
+void	MSIM_AVR_SimInstBegin(MSIM_AVR *mcu);
+void	MSIM_AVR_SimInstEnd(MSIM_AVR *mcu);
+uint64_t MSIM_AVR_SimLoop(MSIM_AVR *mcu, uint32_t pc, uint64_t cycles,
+                          uint32_t stop_pc);
 int	MSIM_AVR_SaveProgMem(MSIM_AVR *mcu, const char *f);
 int	MSIM_AVR_LoadProgMem(MSIM_AVR *mcu, const char *f);
 int	MSIM_AVR_LoadDataMem(MSIM_AVR *mcu, const char *f);
 
+void	MSIM_AVR_Sleep(MSIM_AVR *mcu);
+
+int	MSIM_AVR_SetBreak(MSIM_AVR *mcu, uint32_t pc);
+int	MSIM_AVR_ClearBreak(MSIM_AVR *mcu, uint32_t pc);
+
 void	MSIM_AVR_StackPush(MSIM_AVR *mcu, uint8_t val);
 uint8_t	MSIM_AVR_StackPop(MSIM_AVR *mcu);
 
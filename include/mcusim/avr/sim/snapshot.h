@@ -0,0 +1,102 @@
+/*
+ * This file is part of MCUSim, an XSPICE library with microcontrollers.
+ *
+ * Copyright (C) 2017-2019 MCUSim Developers, see AUTHORS.txt for contributors.
+ *
+ * MCUSim is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MCUSim is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* Snapshots of the AVR MCU state to restore it quickly and checkpoints to
+ * resume a simulation from. */
+#ifndef MSIM_AVR_SNAPSHOT_H_
+#define MSIM_AVR_SNAPSHOT_H_ 1
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+/* Forward declaration of the structure to describe AVR microcontroller
+ * instance. */
+struct MSIM_AVR;
+struct MSIM_AVR_TMR;
+
+/* Page of the program memory to track its modifications, in 16-bits
+ * words. */
+#define MSIM_AVR_SNAP_PAGESZ		64
+
+/* Version of the checkpoint file format. It should be changed each time
+ * the format is changed. Layout of the MCU state is checked by its
+ * fingerprint written to the checkpoint. */
+#define MSIM_AVR_CKPT_VERSION		5
+
+/* Snapshot of the MCU state.
+ *
+ * mcu		MCU the snapshot is taken from. It can be restored to this
+ *		instance only.
+ *
+ * state	Copy of the MCU instance.
+ *
+ * pm		Copy of the program memory.
+ *
+ * pm_size	Size of the program memory copy, in 16-bits words.
+ *
+ * timers	Copy of the timers (they're allocated apart from the
+ *		instance).
+ *
+ * timers_num	Number of the timers copied.
+ *
+ * id		Snapshot number. Pages of the program memory modified
+ *		since the latest snapshot taken (or restored) are tracked
+ *		only. */
+typedef struct MSIM_AVR_Snap {
+	struct MSIM_AVR *mcu;
+	struct MSIM_AVR *state;
+	uint16_t *pm;
+	uint32_t pm_size;
+	struct MSIM_AVR_TMR *timers;
+	uint32_t timers_num;
+	uint32_t id;
+} MSIM_AVR_Snap;
+
+/* Takes a snapshot of the MCU state. Memory for the snapshot is allocated
+ * once and reused by the following snapshots. */
+int MSIM_AVR_Snapshot(struct MSIM_AVR *mcu, struct MSIM_AVR_Snap *snap);
+
+/* Restores the MCU state from a snapshot. Pages of the program memory
+ * modified since the snapshot are copied back only, the used part of the
+ * data memory, timers and the rest of the state are copied as a whole. */
+int MSIM_AVR_Restore(struct MSIM_AVR *mcu, struct MSIM_AVR_Snap *snap);
+
+/* Releases memory of the snapshot. */
+void MSIM_AVR_SnapFree(struct MSIM_AVR_Snap *snap);
+
+/* Writes the MCU state (including the data and program memories) to
+ * a checkpoint file. */
+int MSIM_AVR_SaveCheckpoint(struct MSIM_AVR *mcu, const char *file);
+
+/* Resumes the MCU from a checkpoint file. MCU should be initialized as
+ * the same model the checkpoint was written from. */
+int MSIM_AVR_LoadCheckpoint(struct MSIM_AVR *mcu, const char *file);
+
+/* Marks pages of the program memory in the given range (in 16-bits words)
+ * as modified since the latest snapshot. */
+void MSIM_AVR_SnapTouch(struct MSIM_AVR *mcu, uint32_t addr, uint32_t words);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MSIM_AVR_SNAPSHOT_H_ */
@@ -136,9 +136,16 @@ typedef struct MSIM_AVR_TMR {
 	struct MSIM_AVR_INTVec iv_ic;		/* Input capture */
 
 	struct MSIM_AVR_TMR_COMP comp[16];	/* Output compare channels */
+
+	uint32_t idle;				/* Cycles till the next event */
 } MSIM_AVR_TMR;
 
-int MSIM_AVR_TMRUpdate(struct MSIM_AVR *mcu);
+int		MSIM_AVR_TMRUpdate(struct MSIM_AVR *mcu);
+uint32_t	MSIM_AVR_TMRNum(struct MSIM_AVR *mcu);
+uint32_t	MSIM_AVR_TMRIdle(struct MSIM_AVR *mcu);
+void		MSIM_AVR_TMRSkip(struct MSIM_AVR *mcu, uint32_t cycles);
+void		MSIM_AVR_TMRWake(struct MSIM_AVR *mcu);
+int		MSIM_AVR_TMRWatch(struct MSIM_AVR *mcu);
 
 #ifdef __cplusplus
 }
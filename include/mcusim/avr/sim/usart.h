@@ -30,8 +30,28 @@ typedef struct MSIM_AVR_USART {
 	uint32_t tx_ticks;	/* USART ticks passed since last Tx */
 	uint32_t rx_presc;	/* Rx clock prescaler, (UBRR+1) */
 	uint32_t tx_presc;	/* Tx clock prescaler, m*(UBRR+1) */
+	uint8_t ucsrc_buf;	/* UCSRC shared with UBRRH (buffer) */
+	uint8_t ubrrh_buf;	/* UBRRH shared with UCSRC (buffer) */
+	uint8_t ubrrl_buf;	/* UBRRL (buffer) */
+	uint8_t ubrr_writ;	/* UBRRL or UBRRH/UCSRC has been written */
 } MSIM_AVR_USART;
 
+/* Size of the buffers of USART connected to another MCU */
+#define MSIM_AVR_USARTLINK_BUFSZ	64
+
+/*
+ * USART connected to USART of another MCU instead of a pseudo-terminal.
+ * MCU writes Tx and reads Rx buffer while it's simulated, data is moved
+ * between the buffers of the MCUs while both of them are paused.
+ */
+typedef struct MSIM_AVR_USARTLink {
+	uint8_t tx[MSIM_AVR_USARTLINK_BUFSZ];	/* Data to be sent */
+	uint32_t tx_len;			/* Length of Tx data */
+	uint8_t rx[MSIM_AVR_USARTLINK_BUFSZ];	/* Data received */
+	uint32_t rx_len;			/* Length of Rx data */
+	uint32_t rx_pos;			/* Rx data read already */
+} MSIM_AVR_USARTLink;
+
 #ifdef __cplusplus
 }
 #endif
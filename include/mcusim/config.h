@@ -29,6 +29,19 @@
 extern "C" {
 #endif
 
+/* Maximum number of scenarios to be run from the MCU booted once */
+#define MSIM_CFG_SCENARIOS	256
+
+/* Default port of the GDB RSP target */
+#define MSIM_CFG_RSP_PORT	12750
+
+/* Maximum length of a token (file path, name, etc.) of the lines of board
+ * files, manifests, etc. */
+#define MSIM_CFG_TOKSZ		4096
+
+/* Maximum number of options to be swept */
+#define MSIM_CFG_SWEEPS		16
+
 /* Full path to the installed configuration file of MCUSim */
 #define MSIM_CFG_FILE	"@CMAKE_INSTALL_PREFIX@/@MSIM_CONF_DIR@/mcusim.conf"
 
@@ -55,18 +68,42 @@ typedef struct MSIM_CFG {
 	uint8_t reset_flash;
 	uint8_t firmware_test;
 	uint8_t trap_at_isr;
+	uint8_t usart_pty;
 	uint32_t rsp_port;
+	enum MSIM_AVR_Engine engine;
 
 	char lua_models[MSIM_AVR_LUAMODELS][4096];
 	uint32_t lua_models_num;
+	MSIM_AVR_LUAParam lua_params[MSIM_AVR_LUAPARAMS];
+	uint32_t lua_params_num;
 
 	char vcd_file[4096];
 	char dump_regs[MSIM_AVR_VCD_REGS][16];
 	uint32_t dump_regs_num;
+
+	char ckpt_file[4096];
+	uint64_t ckpt_tick;
+	char resume_file[4096];
+
+	uint32_t warm_pc;
+	uint8_t has_warm_pc;
+	char scenarios[MSIM_CFG_SCENARIOS][4096];
+	uint32_t scenarios_num;
+
+	char sweeps[MSIM_CFG_SWEEPS][4096];
+	uint32_t sweeps_num;
+	char sweep_file[4096];
 } MSIM_CFG;
 
 int	MSIM_CFG_Read(MSIM_CFG *cfg, const char *f);
+uint64_t MSIM_CFG_SweepRuns(MSIM_CFG *cfg);
+int	MSIM_CFG_SweepValue(MSIM_CFG *cfg, uint32_t sweep, uint64_t run,
+                            char *key, uint32_t klen, char *val,
+                            uint32_t vlen);
+int	MSIM_CFG_Sweep(MSIM_CFG *cfg, uint64_t run);
 int	MSIM_CFG_PrintVersion(void);
+int	MSIM_CFG_NextToken(const char **str, char *tok, uint32_t len);
+void	MSIM_CFG_OptError(int c);
 
 #ifdef __cplusplus
 }
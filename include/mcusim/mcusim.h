@@ -25,9 +25,12 @@
 #include "mcusim/avr/sim/decoder.h"
 #include "mcusim/avr/sim/gdb.h"
 #include "mcusim/avr/sim/interrupt.h"
+#include "mcusim/avr/sim/jit.h"
 #include "mcusim/avr/sim/lua.h"
 #include "mcusim/avr/sim/sim.h"
 #include "mcusim/avr/sim/simcore.h"
+#include "mcusim/avr/sim/snapshot.h"
+#include "mcusim/avr/sim/lockstep.h"
 #include "mcusim/avr/sim/vcd.h"
 #include "mcusim/avr/sim/wdt.h"
 #include "mcusim/avr/sim/usart.h"
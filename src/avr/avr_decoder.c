@@ -29,9 +29,24 @@
 #include "mcusim/bit/private/macro.h"
 #include "mcusim/avr/sim/private/macro.h"
 
-static int	decode_inst(MSIM_AVR *, const uint32_t);
-
-static void	exec_in_out(MSIM_AVR *, const uint32_t, uint8_t, uint8_t);
+/* Flags of SREG which may be evaluated lazily (H, S, V, N, Z and C). */
+#define SREG_FLAGS		0x3FU
+
+/* Function to execute a decoded instruction. */
+typedef void (*exec_func)(MSIM_AVR *, const uint32_t);
+
+static uint8_t	decode_inst(const uint32_t);
+static uint8_t	sub_flags(const MSIM_AVR_LazySR *);
+static uint8_t	read_flag(MSIM_AVR *, const uint8_t);
+static void	lazy_sub(MSIM_AVR *, const uint8_t, const uint8_t, const uint8_t,
+                         const uint8_t);
+static uint32_t	run_decoded(MSIM_AVR *, const uint32_t, const uint32_t);
+static uint32_t	run_threaded(MSIM_AVR *, const uint32_t, const uint32_t);
+static MSIM_AVR_Inst *chain_inst(MSIM_AVR *, const uint64_t, const uint32_t,
+                                 const uint64_t, uint32_t *, const uint64_t);
+
+static void	exec_nop(MSIM_AVR *, const uint32_t);
+static void	exec_in_out(MSIM_AVR *, const uint32_t);
 static void	exec_cp(MSIM_AVR *, const uint32_t);
 static void	exec_cpi(MSIM_AVR *, const uint32_t);
 static void	exec_cpc(MSIM_AVR *, const uint32_t);
@@ -45,11 +60,11 @@ static void	exec_brcs_brlo(MSIM_AVR *, const uint32_t);
 static void	exec_rcall(MSIM_AVR *, const uint32_t);
 static void	exec_sts(MSIM_AVR *, const uint32_t);
 static void	exec_sts16(MSIM_AVR *mcu, const uint32_t inst);
-static void	exec_ret(MSIM_AVR *);
+static void	exec_ret(MSIM_AVR *, const uint32_t);
 static void	exec_ori_sbr(MSIM_AVR *, const uint32_t);
-static void	exec_sbi_cbi(MSIM_AVR *, const uint32_t, uint8_t);
-static void	exec_sbis_sbic(MSIM_AVR *, const uint32_t, uint8_t);
-static void	exec_push_pop(MSIM_AVR *, const uint32_t, uint8_t);
+static void	exec_sbi_cbi(MSIM_AVR *, const uint32_t);
+static void	exec_sbis_sbic(MSIM_AVR *, const uint32_t);
+static void	exec_push_pop(MSIM_AVR *, const uint32_t);
 static void	exec_movw(MSIM_AVR *, const uint32_t);
 static void	exec_mov(MSIM_AVR *, const uint32_t);
 static void	exec_sbci(MSIM_AVR *, const uint32_t);
@@ -59,7 +74,7 @@ static void	exec_and(MSIM_AVR *, const uint32_t);
 static void	exec_sub(MSIM_AVR *, const uint32_t);
 static void	exec_subi(MSIM_AVR *, const uint32_t);
 static void	exec_sbc(MSIM_AVR *, const uint32_t);
-static void	exec_cli(MSIM_AVR *);
+static void	exec_cli(MSIM_AVR *, const uint32_t);
 static void	exec_adiw(MSIM_AVR *, const uint32_t);
 static void	exec_adc_rol(MSIM_AVR *, const uint32_t);
 static void	exec_add_lsl(MSIM_AVR *, const uint32_t);
@@ -69,7 +84,8 @@ static void	exec_bld(MSIM_AVR *, const uint32_t);
 static void	exec_brbc(MSIM_AVR *, const uint32_t);
 static void	exec_brbs(MSIM_AVR *, const uint32_t);
 static void	exec_brcc_brsh(MSIM_AVR *, const uint32_t);
-static void	exec_break(MSIM_AVR *);
+static void	exec_break(MSIM_AVR *, const uint32_t);
+static void	exec_sleep(MSIM_AVR *, const uint32_t);
 static void	exec_breq(MSIM_AVR *, const uint32_t);
 static void	exec_brhc(MSIM_AVR *, const uint32_t);
 static void	exec_brhs(MSIM_AVR *, const uint32_t);
@@ -84,21 +100,21 @@ static void	exec_brvs(MSIM_AVR *, const uint32_t);
 static void	exec_bset(MSIM_AVR *, const uint32_t);
 static void	exec_bst(MSIM_AVR *, const uint32_t);
 static void	exec_call(MSIM_AVR *, const uint32_t);
-static void	exec_clc(MSIM_AVR *);
-static void	exec_clh(MSIM_AVR *);
-static void	exec_cln(MSIM_AVR *);
-static void	exec_cls(MSIM_AVR *);
-static void	exec_clt(MSIM_AVR *);
-static void	exec_clv(MSIM_AVR *);
-static void	exec_clz(MSIM_AVR *);
+static void	exec_clc(MSIM_AVR *, const uint32_t);
+static void	exec_clh(MSIM_AVR *, const uint32_t);
+static void	exec_cln(MSIM_AVR *, const uint32_t);
+static void	exec_cls(MSIM_AVR *, const uint32_t);
+static void	exec_clt(MSIM_AVR *, const uint32_t);
+static void	exec_clv(MSIM_AVR *, const uint32_t);
+static void	exec_clz(MSIM_AVR *, const uint32_t);
 static void	exec_com(MSIM_AVR *, const uint32_t);
 static void	exec_cpse(MSIM_AVR *, const uint32_t);
 static void	exec_dec(MSIM_AVR *, const uint32_t);
 static void	exec_fmul(MSIM_AVR *, const uint32_t);
 static void	exec_fmuls(MSIM_AVR *, const uint32_t);
 static void	exec_fmulsu(MSIM_AVR *, const uint32_t);
-static void	exec_icall(MSIM_AVR *);
-static void	exec_ijmp(MSIM_AVR *);
+static void	exec_icall(MSIM_AVR *, const uint32_t);
+static void	exec_ijmp(MSIM_AVR *, const uint32_t);
 static void	exec_inc(MSIM_AVR *, const uint32_t);
 static void	exec_jmp(MSIM_AVR *, const uint32_t);
 static void	exec_lac(MSIM_AVR *, const uint32_t);
@@ -110,19 +126,19 @@ static void	exec_lpm(MSIM_AVR *, const uint32_t);
 static void	exec_lsr(MSIM_AVR *, const uint32_t);
 static void	exec_sbrc(MSIM_AVR *, const uint32_t);
 static void	exec_sbrs(MSIM_AVR *, const uint32_t);
-static void	exec_eicall(MSIM_AVR *);
-static void	exec_eijmp(MSIM_AVR *);
+static void	exec_eicall(MSIM_AVR *, const uint32_t);
+static void	exec_eijmp(MSIM_AVR *, const uint32_t);
 static void	exec_xch(MSIM_AVR *, const uint32_t);
 static void	exec_ror(MSIM_AVR *, const uint32_t);
 static void	exec_swap(MSIM_AVR *, const uint32_t);
-static void	exec_reti(MSIM_AVR *);
-static void	exec_sev(MSIM_AVR *);
-static void	exec_set(MSIM_AVR *);
-static void	exec_ses(MSIM_AVR *);
-static void	exec_sen(MSIM_AVR *);
-static void	exec_sei(MSIM_AVR *);
-static void	exec_seh(MSIM_AVR *);
-static void	exec_sec(MSIM_AVR *);
+static void	exec_reti(MSIM_AVR *, const uint32_t);
+static void	exec_sev(MSIM_AVR *, const uint32_t);
+static void	exec_set(MSIM_AVR *, const uint32_t);
+static void	exec_ses(MSIM_AVR *, const uint32_t);
+static void	exec_sen(MSIM_AVR *, const uint32_t);
+static void	exec_sei(MSIM_AVR *, const uint32_t);
+static void	exec_seh(MSIM_AVR *, const uint32_t);
+static void	exec_sec(MSIM_AVR *, const uint32_t);
 static void	exec_or(MSIM_AVR *, const uint32_t);
 static void	exec_neg(MSIM_AVR *, const uint32_t);
 static void	exec_ser(MSIM_AVR *, const uint32_t);
@@ -131,8 +147,8 @@ static void	exec_muls(MSIM_AVR *, const uint32_t);
 static void	exec_mulsu(MSIM_AVR *, const uint32_t);
 static void	exec_elpm(MSIM_AVR *, const uint32_t);
 static void	exec_spm(MSIM_AVR *, const uint32_t);
-static void	exec_sez(MSIM_AVR *);
-static void	exec_wdr(MSIM_AVR *);
+static void	exec_sez(MSIM_AVR *, const uint32_t);
+static void	exec_wdr(MSIM_AVR *, const uint32_t);
 static void	exec_st_x(MSIM_AVR *, const uint32_t);
 static void	exec_st_y(MSIM_AVR *, const uint32_t);
 static void	exec_st_ydisp(MSIM_AVR *, const uint32_t);
@@ -146,29 +162,252 @@ static void	exec_ld_z(MSIM_AVR *, const uint32_t);
 static void	exec_ld_zdisp(MSIM_AVR *, const uint32_t);
 static void	exec_ld(MSIM_AVR *, const uint32_t, uint8_t *, uint8_t *, uint8_t);
 
+/* Instructions supported by the decoder: index and handler of each. */
+#define AVR_INSTRUCTIONS(X)						\
+	X(OP_NOP, exec_nop)						\
+	X(OP_MULS, exec_muls)						\
+	X(OP_MULSU, exec_mulsu)						\
+	X(OP_FMUL, exec_fmul)						\
+	X(OP_FMULS, exec_fmuls)						\
+	X(OP_FMULSU, exec_fmulsu)					\
+	X(OP_CPC, exec_cpc)						\
+	X(OP_SBC, exec_sbc)						\
+	X(OP_ADD_LSL, exec_add_lsl)					\
+	X(OP_MOVW, exec_movw)						\
+	X(OP_CPSE, exec_cpse)						\
+	X(OP_CP, exec_cp)						\
+	X(OP_SUB, exec_sub)						\
+	X(OP_ADC_ROL, exec_adc_rol)					\
+	X(OP_AND, exec_and)						\
+	X(OP_EOR_CLR, exec_eor_clr)					\
+	X(OP_OR, exec_or)						\
+	X(OP_MOV, exec_mov)						\
+	X(OP_CPI, exec_cpi)						\
+	X(OP_SBCI, exec_sbci)						\
+	X(OP_SUBI, exec_subi)						\
+	X(OP_ORI_SBR, exec_ori_sbr)					\
+	X(OP_ANDI_CBR, exec_andi_cbr)					\
+	X(OP_LD_ZDISP, exec_ld_zdisp)					\
+	X(OP_LD_YDISP, exec_ld_ydisp)					\
+	X(OP_ST_ZDISP, exec_st_zdisp)					\
+	X(OP_ST_YDISP, exec_st_ydisp)					\
+	X(OP_LD_Z, exec_ld_z)						\
+	X(OP_LD_Y, exec_ld_y)						\
+	X(OP_ST_Z, exec_st_z)						\
+	X(OP_ST_Y, exec_st_y)						\
+	X(OP_ADIW, exec_adiw)						\
+	X(OP_BCLR, exec_bclr)						\
+	X(OP_BSET, exec_bset)						\
+	X(OP_JMP, exec_jmp)						\
+	X(OP_CALL, exec_call)						\
+	X(OP_MUL, exec_mul)						\
+	X(OP_SEC, exec_sec)						\
+	X(OP_IJMP, exec_ijmp)						\
+	X(OP_SEZ, exec_sez)						\
+	X(OP_EIJMP, exec_eijmp)						\
+	X(OP_SEN, exec_sen)						\
+	X(OP_SEV, exec_sev)						\
+	X(OP_SES, exec_ses)						\
+	X(OP_SEH, exec_seh)						\
+	X(OP_SET, exec_set)						\
+	X(OP_SEI, exec_sei)						\
+	X(OP_CLC, exec_clc)						\
+	X(OP_CLZ, exec_clz)						\
+	X(OP_CLN, exec_cln)						\
+	X(OP_CLV, exec_clv)						\
+	X(OP_CLS, exec_cls)						\
+	X(OP_CLH, exec_clh)						\
+	X(OP_CLT, exec_clt)						\
+	X(OP_CLI, exec_cli)						\
+	X(OP_RET, exec_ret)						\
+	X(OP_ICALL, exec_icall)						\
+	X(OP_RETI, exec_reti)						\
+	X(OP_EICALL, exec_eicall)					\
+	X(OP_BREAK, exec_break)						\
+	X(OP_SLEEP, exec_sleep)						\
+	X(OP_WDR, exec_wdr)						\
+	X(OP_LPM, exec_lpm)						\
+	X(OP_ELPM, exec_elpm)						\
+	X(OP_SPM, exec_spm)						\
+	X(OP_LDS, exec_lds)						\
+	X(OP_LD_X, exec_ld_x)						\
+	X(OP_PUSH_POP, exec_push_pop)					\
+	X(OP_STS, exec_sts)						\
+	X(OP_XCH, exec_xch)						\
+	X(OP_LAS, exec_las)						\
+	X(OP_LAC, exec_lac)						\
+	X(OP_LAT, exec_lat)						\
+	X(OP_ST_X, exec_st_x)						\
+	X(OP_COM, exec_com)						\
+	X(OP_NEG, exec_neg)						\
+	X(OP_SWAP, exec_swap)						\
+	X(OP_INC, exec_inc)						\
+	X(OP_ASR, exec_asr)						\
+	X(OP_LSR, exec_lsr)						\
+	X(OP_ROR, exec_ror)						\
+	X(OP_DEC, exec_dec)						\
+	X(OP_SBIW, exec_sbiw)						\
+	X(OP_SBI_CBI, exec_sbi_cbi)					\
+	X(OP_SBIS_SBIC, exec_sbis_sbic)					\
+	X(OP_LDS16, exec_lds16)						\
+	X(OP_STS16, exec_sts16)						\
+	X(OP_IN_OUT, exec_in_out)					\
+	X(OP_RJMP, exec_rjmp)						\
+	X(OP_RCALL, exec_rcall)						\
+	X(OP_SER, exec_ser)						\
+	X(OP_LDI, exec_ldi)						\
+	X(OP_BLD, exec_bld)						\
+	X(OP_BST, exec_bst)						\
+	X(OP_SBRC, exec_sbrc)						\
+	X(OP_SBRS, exec_sbrs)						\
+	X(OP_BRBC, exec_brbc)						\
+	X(OP_BRBS, exec_brbs)						\
+	X(OP_BRCS_BRLO, exec_brcs_brlo)					\
+	X(OP_BREQ, exec_breq)						\
+	X(OP_BRMI, exec_brmi)						\
+	X(OP_BRVS, exec_brvs)						\
+	X(OP_BRLT, exec_brlt)						\
+	X(OP_BRHS, exec_brhs)						\
+	X(OP_BRTS, exec_brts)						\
+	X(OP_BRIE, exec_brie)						\
+	X(OP_BRCC_BRSH, exec_brcc_brsh)					\
+	X(OP_BRNE, exec_brne)						\
+	X(OP_BRPL, exec_brpl)						\
+	X(OP_BRVC, exec_brvc)						\
+	X(OP_BRGE, exec_brge)						\
+	X(OP_BRHC, exec_brhc)						\
+	X(OP_BRTC, exec_brtc)						\
+	X(OP_BRID, exec_brid)
+
+#define OP_ENUM(op, f)		op,
+#define OP_HANDLER(op, f)	[op] = f,
+#define OP_LABEL(op, f)		[op] = &&L_##op,
+#define OP_LABEL_EXEC(op, f)	L_##op: f(mcu, inst); THREADED_NEXT;
+#define OP_LABEL_CHAIN(op, f)	L_##op: f(mcu, inst); CHAINED_NEXT;
+
+/* Computed goto is a GCC extension (supported by Clang also). Blocks are
+ * run by the decoder engine with other compilers. */
+#if defined(__GNUC__) || defined(__clang__)
+#define COMPUTED_GOTO		1
+#endif
+
+/* Indexes of the instruction handlers, 0 - unknown instruction. */
+enum {
+	OP_UNKNOWN = 0,
+	AVR_INSTRUCTIONS(OP_ENUM)
+	OP_NUM
+};
+
+/* Indexes of the instruction handlers by 16-bit opcodes. */
+#include "mcusim/avr/sim/private/decoder_tbl.h"
+
+/* Instruction handlers to be called by index of the decoded instruction. */
+static const exec_func exec_tbl[OP_NUM] = {
+	[OP_UNKNOWN] = NULL,
+	AVR_INSTRUCTIONS(OP_HANDLER)
+};
+
+/* Instructions which may be executed while flags of SREG are evaluated
+ * lazily, i.e. they read flags via read_flag only and don't access data
+ * memory except the general purpose registers. */
+static const uint8_t lazy_tbl[OP_NUM] = {
+	[OP_NOP] = 1,
+	[OP_CP] = 1,
+	[OP_CPC] = 1,
+	[OP_CPI] = 1,
+	[OP_SUB] = 1,
+	[OP_SUBI] = 1,
+	[OP_SBC] = 1,
+	[OP_SBCI] = 1,
+	[OP_CPSE] = 1,
+	[OP_MOV] = 1,
+	[OP_MOVW] = 1,
+	[OP_LDI] = 1,
+	[OP_SER] = 1,
+	[OP_SBRC] = 1,
+	[OP_SBRS] = 1,
+	[OP_RJMP] = 1,
+	[OP_BRBC] = 1,
+	[OP_BRBS] = 1,
+};
+
+/* Instructions which may be executed within a block, i.e. they access
+ * the general purpose registers, SREG (except I flag) and program memory
+ * only. See MSIM_AVR_StepBlock. */
+static const uint8_t block_tbl[OP_NUM] = {
+	[OP_NOP] = 1,
+	[OP_MULS] = 1,
+	[OP_MULSU] = 1,
+	[OP_FMUL] = 1,
+	[OP_FMULS] = 1,
+	[OP_FMULSU] = 1,
+	[OP_MUL] = 1,
+	[OP_CPC] = 1,
+	[OP_SBC] = 1,
+	[OP_ADD_LSL] = 1,
+	[OP_MOVW] = 1,
+	[OP_CPSE] = 1,
+	[OP_CP] = 1,
+	[OP_SUB] = 1,
+	[OP_ADC_ROL] = 1,
+	[OP_AND] = 1,
+	[OP_EOR_CLR] = 1,
+	[OP_OR] = 1,
+	[OP_MOV] = 1,
+	[OP_CPI] = 1,
+	[OP_SBCI] = 1,
+	[OP_SUBI] = 1,
+	[OP_ORI_SBR] = 1,
+	[OP_ANDI_CBR] = 1,
+	[OP_ADIW] = 1,
+	[OP_SBIW] = 1,
+	[OP_COM] = 1,
+	[OP_NEG] = 1,
+	[OP_SWAP] = 1,
+	[OP_INC] = 1,
+	[OP_ASR] = 1,
+	[OP_LSR] = 1,
+	[OP_ROR] = 1,
+	[OP_DEC] = 1,
+	[OP_SER] = 1,
+	[OP_LDI] = 1,
+	[OP_BLD] = 1,
+	[OP_BST] = 1,
+	[OP_SBRC] = 1,
+	[OP_SBRS] = 1,
+	[OP_BRBC] = 1,
+	[OP_BRBS] = 1,
+	[OP_RJMP] = 1,
+	[OP_JMP] = 1,
+	[OP_IJMP] = 1,
+	[OP_LPM] = 1,
+};
+
 int
 MSIM_AVR_Step(MSIM_AVR *mcu)
 {
-	uint16_t i = 0;
+	MSIM_AVR_Inst *ci;
+	uint16_t i;
+	uint8_t op;
 	int rc = 0;
 
-	/* Clean I/O read/written during the previous MCU cycle */
-	for (uint32_t j = 0; j < ARRSZ(mcu->writ_io); j++) {
-		mcu->writ_io[j] = 0;
-	}
-	for (uint32_t j = 0; j < ARRSZ(mcu->read_io); j++) {
-		mcu->read_io[j] = 0;
+	/* Instruction may be decoded already */
+	ci = &mcu->dpm[mcu->pc];
+	if (ci->op == OP_UNKNOWN) {
+		ci->inst = PM(mcu->pc);
+		ci->op = decode_inst(ci->inst);
 	}
+	i = ci->inst;
+	op = ci->op;
 
-	/* Find instruction to decode */
-	i = (!mcu->read_from_mpm) ? PM(mcu->pc) : MPM(mcu->pc);
-
-	/* Reset 'read from MPM' flag */
-	if (mcu->read_from_mpm) {
-		mcu->read_from_mpm = 0;
+	/* Flags evaluated lazily are written before they may be accessed */
+	if ((mcu->lsr.pend != 0U) && (lazy_tbl[op] == 0U)) {
+		MSIM_AVR_SyncSREG(mcu);
 	}
 
-	if (decode_inst(mcu, i)) {
+	if (op != OP_UNKNOWN) {
+		exec_tbl[op](mcu, i);
+	} else {
 		snprintf(LOG, LOGSZ, "unknown instruction: 0x%04"
 		         PRIx16 ", pc=0x%06" PRIx32, i, mcu->pc);
 		MSIM_LOG_FATAL(LOG);
@@ -187,526 +426,472 @@ MSIM_AVR_Step(MSIM_AVR *mcu)
 	return rc;
 }
 
-/* Checks whether instruction occupies 32 bits (two 16-bit words) or not.*/
-int
-MSIM_AVR_Is32(uint32_t inst)
+/*
+ * Executes instructions which don't access peripherals (see block_tbl)
+ * until they fit into the given number of cycles and the program counter
+ * doesn't reach the given address. Peripherals aren't updated here, so it
+ * is up to the caller to skip the returned number of cycles.
+ */
+uint32_t
+MSIM_AVR_StepBlock(MSIM_AVR *mcu, uint32_t cycles, uint32_t stop_pc)
+{
+	const uint8_t whole_inst = mcu->whole_inst;
+	uint32_t n;
+
+	/* Block may be run from a chain of the threaded engine */
+	mcu->whole_inst = 1;
+	mcu->in_block = 1;
+	if ((mcu->engine == AVR_JIT_ENGINE) && (mcu->bp_num == 0U)) {
+		n = MSIM_AVR_JITRun(mcu, cycles, stop_pc);
+	} else if (mcu->engine != AVR_DECODER_ENGINE) {
+		n = run_threaded(mcu, cycles, stop_pc);
+	} else {
+		n = run_decoded(mcu, cycles, stop_pc);
+	}
+	mcu->in_block = 0;
+	mcu->whole_inst = whole_inst;
+
+	return n;
+}
+
+/*
+ * Returns handler of the instruction at the given address if it may be
+ * executed within a block (see block_tbl) or NULL. Opcode is returned also
+ * and the flag whether SREG should be synced before the instruction.
+ */
+MSIM_AVR_InstFunc
+MSIM_AVR_BlockInst(MSIM_AVR *mcu, uint32_t pc, uint16_t *inst,
+                   uint8_t *sync_sreg)
 {
-	return ((inst&0xFE0F) == 0x9200) ||		/* STS */
-	       ((inst&0xFE0F) == 0x9000) ||		/* LDS */
-	       ((inst&0xFE0E) == 0x940C) ||		/* JMP */
-	       ((inst&0xFE0E) == 0x940E);		/* CALL */
+	MSIM_AVR_Inst *ci;
+
+	if ((pc > (mcu->flashend >> 1)) || ((pc + 2) >= mcu->pm_size) ||
+	                BP(pc)) {
+		return NULL;
+	}
+
+	ci = &mcu->dpm[pc];
+	if (ci->op == OP_UNKNOWN) {
+		ci->inst = PM(pc);
+		ci->op = decode_inst(ci->inst);
+	}
+	if (block_tbl[ci->op] == 0U) {
+		return NULL;
+	}
+
+	*inst = ci->inst;
+	*sync_sreg = (uint8_t)((lazy_tbl[ci->op] == 0U) ? 1 : 0);
+	return exec_tbl[ci->op];
 }
 
-static int
-decode_inst(MSIM_AVR *mcu, const uint32_t inst)
+/* Decoder engine. Instructions of a block are executed one by one via the
+ * table of handlers. */
+static uint32_t
+run_decoded(MSIM_AVR *mcu, const uint32_t cycles, const uint32_t stop_pc)
 {
-	uint8_t done = 0;
+	MSIM_AVR_Inst *ci;
+	uint32_t n = 0;
 
-	switch (inst & 0xF000) {
-	case 0x0000:
-		if ((inst&0xFF00) == 0x0200) {
-			exec_muls(mcu, inst);
-			break;
-		} else if ((inst&0xFF88) == 0x0300) {
-			exec_mulsu(mcu, inst);
-			break;
-		} else if ((inst & 0xFF88) == 0x308) {
-			exec_fmul(mcu, inst);
-			break;
-		} else if ((inst & 0xFF88) == 0x380) {
-			exec_fmuls(mcu, inst);
-			break;
-		} else if ((inst & 0xFF88) == 0x388) {
-			exec_fmulsu(mcu, inst);
+	while (((cycles - n) >= MSIM_AVR_BLOCK_MAXCYCLES) &&
+	                (mcu->pc != stop_pc) &&
+	                (mcu->pc <= (mcu->flashend >> 1)) &&
+	                ((mcu->pc + 2) < mcu->pm_size)) {
+		ci = &mcu->dpm[mcu->pc];
+		if (ci->op == OP_UNKNOWN) {
+			ci->inst = PM(mcu->pc);
+			ci->op = decode_inst(ci->inst);
+		}
+		if ((block_tbl[ci->op] == 0U) || BP(mcu->pc)) {
 			break;
 		}
 
-		switch (inst) {
-		case 0x0000: /* NOP – No Operation */
-#ifdef DEBUG
-			if (mcu->pc == 0U) {
-				snprintf(LOG, LOGSZ, "NOP at: pc=0x%06" PRIX32,
-				         mcu->pc);
-				MSIM_LOG_WARN(LOG);
-			}
+		if ((mcu->lsr.pend != 0U) && (lazy_tbl[ci->op] == 0U)) {
+			MSIM_AVR_SyncSREG(mcu);
+		}
+
+		mcu->block_cycles = 1;
+		exec_tbl[ci->op](mcu, ci->inst);
+		n += mcu->block_cycles;
+	}
+
+	return n;
+}
+
+#ifdef COMPUTED_GOTO
+/* Dispatch of the threaded engine. It is replicated after each handler, so
+ * the next instruction of the block is jumped to directly from the previous
+ * one. The block ends on an instruction which can't be executed within it,
+ * a breakpoint or once the cycles are spent. */
+#define THREADED_NEXT							\
+	do {								\
+		n += mcu->block_cycles;					\
+		THREADED_DISPATCH;					\
+	} while (0)
+
+/* Dispatch of the chains of the threaded engine (see chain_inst). */
+#define CHAINED_NEXT							\
+	do {								\
+		MSIM_AVR_SimInstEnd(mcu);				\
+		insts++;						\
+		CHAINED_DISPATCH;					\
+	} while (0)
+
+#define CHAINED_DISPATCH						\
+	do {								\
+		ci = chain_inst(mcu, cycles, stop_pc, tick, &prev_pc,	\
+		                insts);					\
+		if (ci == NULL) {					\
+			goto done;					\
+		}							\
+		inst = ci->inst;					\
+		__extension__ ({ goto *labels[ci->op]; });		\
+	} while (0)
+
+#define THREADED_DISPATCH						\
+	do {								\
+		if (((cycles - n) < MSIM_AVR_BLOCK_MAXCYCLES) ||	\
+		                (mcu->pc == stop_pc) ||			\
+		                (mcu->pc > (mcu->flashend >> 1)) ||	\
+		                ((mcu->pc + 2) >= mcu->pm_size)) {	\
+			goto done;					\
+		}							\
+		ci = &mcu->dpm[mcu->pc];				\
+		if (ci->op == OP_UNKNOWN) {				\
+			ci->inst = PM(mcu->pc);				\
+			ci->op = decode_inst(ci->inst);			\
+		}							\
+		if ((block_tbl[ci->op] == 0U) || BP(mcu->pc)) {	\
+			goto done;					\
+		}							\
+		if ((mcu->lsr.pend != 0U) &&				\
+		                (lazy_tbl[ci->op] == 0U)) {		\
+			MSIM_AVR_SyncSREG(mcu);				\
+		}							\
+		mcu->block_cycles = 1;					\
+		inst = ci->inst;					\
+		__extension__ ({ goto *labels[ci->op]; });		\
+	} while (0)
+
+/* Threaded engine. Instructions of a block are chained, i.e. each handler
+ * is followed by a jump to the handler of the next instruction instead of
+ * returning to the loop of the block. */
+static uint32_t
+run_threaded(MSIM_AVR *mcu, const uint32_t cycles, const uint32_t stop_pc)
+{
+	__extension__ static const void *const labels[OP_NUM] = {
+		AVR_INSTRUCTIONS(OP_LABEL)
+	};
+	MSIM_AVR_Inst *ci;
+	uint32_t inst, n = 0;
+
+	THREADED_DISPATCH;
+	AVR_INSTRUCTIONS(OP_LABEL_EXEC)
+done:
+	return n;
+}
+#else
+static uint32_t
+run_threaded(MSIM_AVR *mcu, const uint32_t cycles, const uint32_t stop_pc)
+{
+	return run_decoded(mcu, cycles, stop_pc);
+}
 #endif
-			mcu->pc += 1;
-			break;
-		default:
-			switch (inst & 0xFC00) {
-			case 0x0400:
-				exec_cpc(mcu, inst);
-				done = 1;
-				break;
-			case 0x0800:
-				exec_sbc(mcu, inst);
-				done = 1;
-				break;
-			case 0x0C00:
-				exec_add_lsl(mcu, inst);
-				done = 1;
-				break;
-			default:
-				break;
-			}
 
-			if (done != 0) {
+/*
+ * Executes instructions by the threaded engine, i.e. each handler is
+ * followed by a jump to the handler of the next instruction, until the
+ * given number of cycles passed, the program counter reaches the given
+ * address (after the first instruction) or the MCU isn't running anymore.
+ * Unlike blocks, any instruction may be chained here because peripherals
+ * are updated on each cycle (see MSIM_AVR_SimInstBegin). Chain stops at an
+ * instruction which should be performed by exec_cycle (breakpoint, unknown
+ * instruction, etc.). Returns a number of the performed instructions.
+ */
+uint64_t
+MSIM_AVR_StepThreaded(MSIM_AVR *mcu, uint64_t cycles, uint32_t stop_pc)
+{
+	const uint64_t tick = mcu->tick;
+	const uint8_t whole_inst = mcu->whole_inst;
+	MSIM_AVR_Inst *ci;
+	uint64_t insts = 0;
+	uint32_t prev_pc = mcu->pc;
+#ifdef COMPUTED_GOTO
+	__extension__ static const void *const labels[OP_NUM] = {
+		AVR_INSTRUCTIONS(OP_LABEL)
+	};
+	uint32_t inst;
+#endif
+
+	mcu->whole_inst = 1;
+#ifdef COMPUTED_GOTO
+	CHAINED_DISPATCH;
+	AVR_INSTRUCTIONS(OP_LABEL_CHAIN)
+done:
+#else
+	while ((ci = chain_inst(mcu, cycles, stop_pc, tick, &prev_pc,
+	                        insts)) != NULL) {
+		exec_tbl[ci->op](mcu, ci->inst);
+		MSIM_AVR_SimInstEnd(mcu);
+		insts++;
+	}
+#endif
+	mcu->whole_inst = whole_inst;
+
+	return insts;
+}
+
+/*
+ * Returns the next instruction to be chained by the threaded engine or
+ * NULL if it should be performed the other way. Idle loops are skipped
+ * and loops are executed in blocks between the instructions the same way
+ * the fast path of the simulation does.
+ */
+static MSIM_AVR_Inst *
+chain_inst(MSIM_AVR *mcu, const uint64_t cycles, const uint32_t stop_pc,
+           const uint64_t tick, uint32_t *prev_pc, const uint64_t insts)
+{
+	MSIM_AVR_Inst *ci = NULL;
+	uint64_t n;
+
+	do {
+		if (insts > 0U) {
+			n = mcu->tick - tick;
+			if ((n >= cycles) || (mcu->state != AVR_RUNNING)) {
 				break;
 			}
+			MSIM_AVR_SimLoop(mcu, *prev_pc, cycles - n, stop_pc);
 
-			switch (inst & 0xFF00) {
-			case 0x0100:
-				exec_movw(mcu, inst);
+			n = mcu->tick - tick;
+			if ((n >= cycles) || (mcu->pc == stop_pc)) {
 				break;
-			default:
-				return -1;
 			}
-			break;
 		}
-		break;
-	case 0x1000:
-		switch (inst & 0xFC00) {
-		case 0x1000:
-			exec_cpse(mcu, inst);
-			break;
-		case 0x1400:
-			exec_cp(mcu, inst);
-			break;
-		case 0x1800:
-			exec_sub(mcu, inst);
-			break;
-		case 0x1C00:
-			exec_adc_rol(mcu, inst);
+		if ((mcu->state != AVR_RUNNING) || (mcu->ic_left != 0U) ||
+		                (mcu->pc > (mcu->flashend >> 1)) ||
+		                ((mcu->pc + 2) >= mcu->pm_size) ||
+		                BP(mcu->pc)) {
 			break;
-		default:
-			return -1;
 		}
-		break;
-	case 0x2000:
-		switch (inst & 0xFC00) {
-		case 0x2000:
-			exec_and(mcu, inst);
-			break;
-		case 0x2400:
-			exec_eor_clr(mcu, inst);
-			break;
-		case 0x2800:
-			exec_or(mcu, inst);
-			break;
-		case 0x2C00:
-			exec_mov(mcu, inst);
-			break;
-		default:
-			return -1;
+
+		ci = &mcu->dpm[mcu->pc];
+		if (ci->op == OP_UNKNOWN) {
+			ci->inst = PM(mcu->pc);
+			ci->op = decode_inst(ci->inst);
 		}
-		break;
-	case 0x3000:
-		exec_cpi(mcu, inst);
-		break;
-	case 0x4000:
-		exec_sbci(mcu, inst);
-		break;
-	case 0x5000:
-		exec_subi(mcu, inst);
-		break;
-	case 0x6000:
-		exec_ori_sbr(mcu, inst);
-		break;
-	case 0x7000:
-		exec_andi_cbr(mcu, inst);
-		break;
-	case 0x8000:
-		/*
-		 * 0xD208 - an exact mask for LDD and STD with Y and Z with
-		 * displacement.
-		 */
-		switch (inst & 0xD208) {
-		case 0x8000:
-			exec_ld_zdisp(mcu, inst);
-			done = 1;
-			break;
-		case 0x8008:
-			exec_ld_ydisp(mcu, inst);
-			done = 1;
-			break;
-		case 0x8200:
-			exec_st_zdisp(mcu, inst);
-			done = 1;
-			break;
-		case 0x8208:
-			exec_st_ydisp(mcu, inst);
-			done = 1;
+		if (ci->op == OP_UNKNOWN) {
+			ci = NULL;
 			break;
 		}
 
-		if (done != 0) {
-			break;
+		*prev_pc = mcu->pc;
+		MSIM_AVR_SimInstBegin(mcu);
+		if ((mcu->lsr.pend != 0U) && (lazy_tbl[ci->op] == 0U)) {
+			MSIM_AVR_SyncSREG(mcu);
 		}
+	} while (0);
 
-		switch (inst & 0xFE0F) {
-		case 0x8000:
-			exec_ld_z(mcu, inst);
-			break;
-		case 0x8008:
-			exec_ld_y(mcu, inst);
-			break;
-		case 0x8200:
-			exec_st_z(mcu, inst);
-			break;
-		case 0x8208:
-			exec_st_y(mcu, inst);
-			break;
-		default:
-			return -1;
+	return ci;
+}
+
+/* Drops pre-decoded instructions of the program memory in the given range
+ * (in 16-bit words). It should be called each time the program memory is
+ * modified (SPM, GDB, loading a firmware, etc.). */
+void
+MSIM_AVR_FlushDecoded(MSIM_AVR *mcu, uint32_t addr, uint32_t words)
+{
+	if (addr >= mcu->pm_size) {
+		return;
+	}
+	if (words > (mcu->pm_size - addr)) {
+		words = mcu->pm_size - addr;
+	}
+	memset(&mcu->dpm[addr], 0, words * sizeof mcu->dpm[0]);
+
+	/* Modified pages are restored from a snapshot */
+	MSIM_AVR_SnapTouch(mcu, addr, words);
+
+	/* Native code of the modified blocks is dropped */
+	MSIM_AVR_JITFlush(mcu, addr, words);
+
+	/* Loop to be fast-forwarded may be changed too */
+	mcu->loop.head = UINT32_MAX;
+	mcu->loop.poll = 0;
+}
+
+/* Decodes the whole program memory in advance. Copies of the MCU (forked
+ * processes, for example) share the decoded instructions then instead of
+ * decoding them on their own. */
+void
+MSIM_AVR_DecodeAll(MSIM_AVR *mcu)
+{
+	MSIM_AVR_Inst *ci;
+
+	for (uint32_t pc = 0; pc < mcu->pm_size; pc++) {
+		ci = &mcu->dpm[pc];
+		if (ci->op == OP_UNKNOWN) {
+			ci->inst = PM(pc);
+			ci->op = decode_inst(ci->inst);
 		}
-		break;
-	case 0x9000:
-		if ((inst & 0xFF00) == 0x9600) {
-			exec_adiw(mcu, inst);
-			break;
-		} else if ((inst & 0xFF8F) == 0x9488) {
-			exec_bclr(mcu, inst);
-			break;
-		} else if ((inst & 0xFF8F) == 0x9408) {
-			exec_bset(mcu, inst);
-			break;
-		} else if ((inst & 0xFE0E) == 0x940C) {
-			exec_jmp(mcu, inst);
-			break;
-		} else if ((inst & 0xFE0E) == 0x940E) {
-			exec_call(mcu, inst);
-			break;
-		} else if ((inst&0xFC00) == 0x9C00) {
-			exec_mul(mcu, inst);
-			break;
+	}
+}
+
+/* Checks whether instructions of the program memory in the given range (in
+ * 16-bit words, inclusively) only read registers and jump within the range,
+ * i.e. they're unable to write data memory or call a subroutine. There
+ * should be no breakpoints in the range also. */
+int
+MSIM_AVR_IsPollLoop(MSIM_AVR *mcu, uint32_t head, uint32_t tail)
+{
+	MSIM_AVR_Inst *ci;
+	uint32_t pc = head;
+	int rc = 1;
+
+	while ((rc != 0) && (pc <= tail) && (pc < mcu->pm_size)) {
+		ci = &mcu->dpm[pc];
+		if (ci->op == OP_UNKNOWN) {
+			ci->inst = PM(pc);
+			ci->op = decode_inst(ci->inst);
 		}
 
-		switch (inst) {
-		case 0x9408:
-			exec_sec(mcu);
-			break;
-		case 0x9409:
-			exec_ijmp(mcu);
-			break;
-		case 0x9418:
-			exec_sez(mcu);
-			break;
-		case 0x9419:
-			exec_eijmp(mcu);
-			break;
-		case 0x9428:
-			exec_sen(mcu);
-			break;
-		case 0x9438:
-			exec_sev(mcu);
-			break;
-		case 0x9448:
-			exec_ses(mcu);
-			break;
-		case 0x9458:
-			exec_seh(mcu);
-			break;
-		case 0x9468:
-			exec_set(mcu);
-			break;
-		case 0x9478:
-			exec_sei(mcu);
-			break;
-		case 0x9488:
-			exec_clc(mcu);
-			break;
-		case 0x9498:
-			exec_clz(mcu);
-			break;
-		case 0x94A8:
-			exec_cln(mcu);
-			break;
-		case 0x94B8:
-			exec_clv(mcu);
-			break;
-		case 0x94C8:
-			exec_cls(mcu);
-			break;
-		case 0x94D8:
-			exec_clh(mcu);
-			break;
-		case 0x94E8:
-			exec_clt(mcu);
-			break;
-		case 0x94F8:
-			exec_cli(mcu);
-			break;
-		case 0x9508:
-			exec_ret(mcu);
-			break;
-		case 0x9509:
-			exec_icall(mcu);
-			break;
-		case 0x9518:
-			exec_reti(mcu);
-			break;
-		case 0x9519:
-			exec_eicall(mcu);
-			break;
-		case 0x9598:
-			exec_break(mcu);
-			break;
-		case 0x95A8:
-			exec_wdr(mcu);
-			break;
-		case 0x95C8:
-			exec_lpm(mcu, inst);
-			break;
-		case 0x95D8:
-			exec_elpm(mcu, inst);
-			break;
-		case 0x95E8:
-		case 0x95F8:
-			exec_spm(mcu, inst);
+		switch (ci->op) {
+		case OP_NOP:
+		case OP_CP:
+		case OP_CPC:
+		case OP_CPI:
+		case OP_CPSE:
+		case OP_AND:
+		case OP_ANDI_CBR:
+		case OP_MOV:
+		case OP_LDI:
+		case OP_LDS:
+		case OP_LDS16:
+		case OP_LD_YDISP:
+		case OP_LD_ZDISP:
+		case OP_SBIS_SBIC:
+		case OP_SBRC:
+		case OP_SBRS:
+		case OP_RJMP:
+		case OP_BRBC:
+		case OP_BRBS:
+		case OP_BRCS_BRLO:
+		case OP_BREQ:
+		case OP_BRMI:
+		case OP_BRVS:
+		case OP_BRLT:
+		case OP_BRHS:
+		case OP_BRTS:
+		case OP_BRIE:
+		case OP_BRCC_BRSH:
+		case OP_BRNE:
+		case OP_BRPL:
+		case OP_BRVC:
+		case OP_BRGE:
+		case OP_BRHC:
+		case OP_BRTC:
+		case OP_BRID:
+			break;
+		case OP_IN_OUT:
+			/* OUT writes I/O register */
+			rc = ((ci->inst & 0x0800) == 0U) ? 1 : 0;
 			break;
 		default:
-			switch (inst & 0xFE0F) {
-			case 0x9000:
-				exec_lds(mcu, inst);
-				break;
-			case 0x9001:
-			case 0x9002:
-				exec_ld_z(mcu, inst);
-				break;
-			case 0x9004:
-			case 0x9005:
-				exec_lpm(mcu, inst);
-				break;
-			case 0x9006:
-			case 0x9007:
-				exec_elpm(mcu, inst);
-				break;
-			case 0x9009:
-			case 0x900A:
-				exec_ld_y(mcu, inst);
-				break;
-			case 0x900C:
-			case 0x900D:
-			case 0x900E:
-				exec_ld_x(mcu, inst);
-				break;
-			case 0x900F:
-				exec_push_pop(mcu, inst, 0);
-				break;
-			case 0x9200:
-				exec_sts(mcu, inst);
-				break;
-			case 0x9201:
-			case 0x9202:
-				exec_st_z(mcu, inst);
-				break;
-			case 0x9204:
-				exec_xch(mcu, inst);
-				break;
-			case 0x9205:
-				exec_las(mcu, inst);
-				break;
-			case 0x9206:
-				exec_lac(mcu, inst);
-				break;
-			case 0x9207:
-				exec_lat(mcu, inst);
-				break;
-			case 0x9209:
-			case 0x920A:
-				exec_st_y(mcu, inst);
-				break;
-			case 0x920C:
-			case 0x920D:
-			case 0x920E:
-				exec_st_x(mcu, inst);
-				break;
-			case 0x920F:
-				exec_push_pop(mcu, inst, 1);
-				break;
-			case 0x9400:
-				exec_com(mcu, inst);
-				break;
-			case 0x9401:
-				exec_neg(mcu, inst);
-				break;
-			case 0x9402:
-				exec_swap(mcu, inst);
-				break;
-			case 0x9403:
-				exec_inc(mcu, inst);
-				break;
-			case 0x9405:
-				exec_asr(mcu, inst);
-				break;
-			case 0x9406:
-				exec_lsr(mcu, inst);
-				break;
-			case 0x9407:
-				exec_ror(mcu, inst);
-				break;
-			case 0x940A:
-				exec_dec(mcu, inst);
-				break;
-			default:
-				switch (inst & 0xFF00) {
-				case 0x9700:
-					exec_sbiw(mcu, inst);
-					break;
-				case 0x9800:
-					exec_sbi_cbi(mcu, inst, 0);
-					break;
-				case 0x9900:
-					exec_sbis_sbic(mcu, inst, 0);
-					break;
-				case 0x9A00:
-					exec_sbi_cbi(mcu, inst, 1);
-					break;
-				case 0x9B00:
-					exec_sbis_sbic(mcu, inst, 1);
-					break;
-				default:
-					return -1;
-				}
-			}
-			break;
-		}
-		break;
-	case 0xA000:
-		/*
-		 * 0xD208 - an exact mask for LDD and STD with Y and Z with
-		 * displacement.
-		 */
-		switch (inst & 0xD208) {
-		case 0x8000:
-			exec_ld_zdisp(mcu, inst);
-			done = 1;
-			break;
-		case 0x8008:
-			exec_ld_ydisp(mcu, inst);
-			done = 1;
-			break;
-		case 0x8200:
-			exec_st_zdisp(mcu, inst);
-			done = 1;
-			break;
-		case 0x8208:
-			exec_st_ydisp(mcu, inst);
-			done = 1;
+			rc = 0;
 			break;
 		}
 
-		if (done != 0) {
-			break;
+		/* Loop with a breakpoint isn't skipped */
+		if (BP(pc)) {
+			rc = 0;
 		}
 
-		if ((inst & 0xF800) == 0xA000) {
-			exec_lds16(mcu, inst);
-			break;
-		}
-		if ((inst & 0xF800) == 0xA800) {
-			exec_sts16(mcu, inst);
-			break;
-		}
-		break;
-	case 0xB000:
-		exec_in_out(mcu, inst,
-		            (uint8_t)((inst & 0x01F0) >> 4),
-		            (uint8_t)((inst & 0x0F) |
-		                      ((inst & 0x0600) >> 5)));
-		break;
-	case 0xC000:
-		exec_rjmp(mcu, inst);
-		break;
-	case 0xD000:
-		exec_rcall(mcu, inst);
-		break;
-	case 0xE000:
-		if ((inst&0xFF0F) == 0xEF0F) {
-			exec_ser(mcu, inst);
-			break;
-		}
-		exec_ldi(mcu, inst);
-		break;
-	case 0xF000:
-		if ((inst & 0xFE08) == 0xF800) {
-			exec_bld(mcu, inst);
-			break;
-		} else if ((inst & 0xFE08) == 0xFA00) {
-			exec_bst(mcu, inst);
-			break;
-		} else if ((inst & 0xFE08) == 0xFC00) {
-			exec_sbrc(mcu, inst);
-			break;
-		} else if ((inst & 0xFE08) == 0xFE00) {
-			exec_sbrs(mcu, inst);
-			break;
-		} else if ((inst & 0xFC00) == 0xF400) {
-			exec_brbc(mcu, inst);
-			break;
-		} else if ((inst & 0xFC00) == 0xF000) {
-			exec_brbs(mcu, inst);
-			break;
-		}
+		pc += MSIM_AVR_Is32(ci->inst) ? 2U : 1U;
+	}
 
-		switch (inst & 0xFC07) {
-		case 0xF000:
-			exec_brcs_brlo(mcu, inst);
-			break;
-		case 0xF001:
-			exec_breq(mcu, inst);
-			break;
-		case 0xF002:
-			exec_brmi(mcu, inst);
-			break;
-		case 0xF003:
-			exec_brvs(mcu, inst);
-			break;
-		case 0xF004:
-			exec_brlt(mcu, inst);
-			break;
-		case 0xF005:
-			exec_brhs(mcu, inst);
-			break;
-		case 0xF006:
-			exec_brts(mcu, inst);
-			break;
-		case 0xF007:
-			exec_brie(mcu, inst);
-			break;
-		case 0xF400:
-			exec_brcc_brsh(mcu, inst);
-			break;
-		case 0xF401:
-			exec_brne(mcu, inst);
-			break;
-		case 0xF402:
-			exec_brpl(mcu, inst);
-			break;
-		case 0xF403:
-			exec_brvc(mcu, inst);
-			break;
-		case 0xF404:
-			exec_brge(mcu, inst);
-			break;
-		case 0xF405:
-			exec_brhc(mcu, inst);
-			break;
-		case 0xF406:
-			exec_brtc(mcu, inst);
-			break;
-		case 0xF407:
-			exec_brid(mcu, inst);
-			break;
-		default:
-			return -1;
-		}
-		break;
-	default:
-		return -1;
+	return rc;
+}
+
+/* Writes flags of SREG evaluated lazily. It should be called before SREG
+ * is accessed outside of the decoder (GDB, Lua models, VCD, etc.). */
+void
+MSIM_AVR_SyncSREG(MSIM_AVR *mcu)
+{
+	if (mcu->lsr.pend != 0U) {
+		*mcu->sreg = (uint8_t)((*mcu->sreg & ~SREG_FLAGS) |
+		                       sub_flags(&mcu->lsr));
+		mcu->lsr.pend = 0;
 	}
+}
+
+/* Evaluates H, S, V, N, Z and C flags of the subtraction. */
+static uint8_t
+sub_flags(const MSIM_AVR_LazySR *lsr)
+{
+	const uint32_t rd = lsr->rd;
+	const uint32_t rr = lsr->rr;
+	const uint32_t r = lsr->r;
+	const uint32_t buf = (~rd & rr) | (rr & r) | (r & ~rd);
+	const uint32_t n = (r >> 7) & 1U;
+	const uint32_t v = (((rd & ~rr & ~r) | (~rd & rr & r)) >> 7) & 1U;
 
-	return 0;
+	return (uint8_t)((((buf >> 7) & 1U) << SR_CARRY) |
+	                 ((uint32_t)lsr->z << SR_ZERO) |
+	                 (n << SR_NEG) | (v << SR_TCOF) |
+	                 ((n ^ v) << SR_SIGN) |
+	                 (((buf >> 3) & 1U) << SR_HCARRY));
+}
+
+/* Reads a flag of SREG which may be evaluated lazily. */
+static uint8_t
+read_flag(MSIM_AVR *mcu, const uint8_t flag)
+{
+	uint8_t sr = *mcu->sreg;
+
+	if (mcu->lsr.pend != 0U) {
+		sr = (uint8_t)((sr & ~SREG_FLAGS) | sub_flags(&mcu->lsr));
+	}
+	return (uint8_t)((sr >> flag) & 1U);
+}
+
+/* Saves operands of the subtraction to evaluate flags of SREG from. */
+static void
+lazy_sub(MSIM_AVR *mcu, const uint8_t rd, const uint8_t rr, const uint8_t r,
+         const uint8_t z)
+{
+	mcu->lsr.rd = rd;
+	mcu->lsr.rr = rr;
+	mcu->lsr.r = r;
+	mcu->lsr.z = z;
+	mcu->lsr.pend = 1;
+}
+
+/* Checks whether instruction occupies 32 bits (two 16-bit words) or not.*/
+int
+MSIM_AVR_Is32(uint32_t inst)
+{
+	return ((inst&0xFE0F) == 0x9200) ||		/* STS */
+	       ((inst&0xFE0F) == 0x9000) ||		/* LDS */
+	       ((inst&0xFE0E) == 0x940C) ||		/* JMP */
+	       ((inst&0xFE0E) == 0x940E);		/* CALL */
+}
+
+/* Opcode is decoded by the table generated from avr_decoder.def. */
+static uint8_t
+decode_inst(const uint32_t inst)
+{
+	return decode_tbl[inst & 0xFFFFU];
+}
+
+static void
+exec_nop(MSIM_AVR *mcu, const uint32_t inst)
+{
+	/* NOP – No Operation */
+#ifdef DEBUG
+	if (mcu->pc == 0U) {
+		snprintf(LOG, LOGSZ, "NOP at: pc=0x%06" PRIX32, mcu->pc);
+		MSIM_LOG_WARN(LOG);
+	}
+#endif
+	mcu->pc += 1;
 }
 
 static void
@@ -728,13 +913,17 @@ exec_eor_clr(MSIM_AVR *mcu, const uint32_t inst)
 }
 
 static void
-exec_in_out(MSIM_AVR *mcu, const uint32_t inst, uint8_t reg, uint8_t io_loc)
+exec_in_out(MSIM_AVR *mcu, const uint32_t inst)
 {
+	const uint8_t reg = (uint8_t)((inst & 0x01F0) >> 4);
+	const uint8_t io_loc = (uint8_t)((inst & 0x0F) |
+	                                 ((inst & 0x0600) >> 5));
+
 	switch (inst & 0xF800) {
 	/* IN - Load an I/O Location to Register */
 	case 0xB000:
 		mcu->dm[reg] = mcu->dm[io_loc + mcu->sfr_off];
-		mcu->read_io[0] = io_loc + mcu->sfr_off;
+		READ_IO(io_loc + mcu->sfr_off);
 		break;
 	/* OUT – Store Register to I/O Location */
 	case 0xB800:
@@ -749,22 +938,16 @@ exec_cpi(MSIM_AVR *mcu, const uint32_t inst)
 {
 	/* CPI – Compare with Immediate */
 	uint8_t rd, rd_addr, c;
-	int r, buf;
+	int r;
 
 	rd_addr = (uint8_t)(((inst & 0xF0) >> 4) + 16);
 	c = (uint8_t)((inst & 0x0F) | ((inst & 0x0F00) >> 4));
 
 	rd = mcu->dm[rd_addr];
 	r = mcu->dm[rd_addr] - c;
-	buf = (~rd & c) | (c & r) | (r & ~rd);
 	mcu->pc++;
 
-	UPDSR(mcu, SR_CARRY, (buf >> 7) & 0x01);
-	UPDSR(mcu, SR_NEG, (r >> 7) & 1);
-	UPDSR(mcu, SR_TCOF, (((rd & ~c & ~r) | (~rd & c & r)) >> 7) & 1);
-	UPDSR(mcu, SR_SIGN, SR(mcu, SR_NEG) ^ SR(mcu, SR_TCOF));
-	UPDSR(mcu, SR_HCARRY, (buf >> 3) & 1);
-	UPDSR(mcu, SR_ZERO, !r ? 1 : 0);
+	lazy_sub(mcu, rd, c, (uint8_t)r, !r ? 1 : 0);
 }
 
 static void
@@ -773,24 +956,17 @@ exec_cpc(MSIM_AVR *mcu, const uint32_t inst)
 	/* CPC – Compare with Carry */
 	uint8_t rd, rd_addr;
 	uint8_t rr, rr_addr;
-	int r, buf;
+	int r;
 
 	rd_addr = (uint8_t)((inst & 0x01F0) >> 4);
 	rr_addr = (uint8_t)((inst & 0x0F) | ((inst & 0x0200) >> 5));
 	rd = DM(rd_addr);
 	rr = DM(rr_addr);
-	r = DM(rd_addr)-DM(rr_addr)-SR(mcu, SR_CARRY);
+	r = DM(rd_addr)-DM(rr_addr)-read_flag(mcu, SR_CARRY);
 	mcu->pc++;
-	buf = (~rd & rr) | (rr & r) | (r & ~rd);
 
-	UPDSR(mcu, SR_CARRY, (buf >> 7) & 1);
-	UPDSR(mcu, SR_HCARRY, (buf >> 3) & 1);
-	UPDSR(mcu, SR_NEG, (r >> 7) & 1);
-	UPDSR(mcu, SR_TCOF, (((rd & ~rr & ~r) | (~rd & rr & r)) >> 7) & 1);
-	UPDSR(mcu, SR_SIGN, SR(mcu, SR_NEG) ^ SR(mcu, SR_TCOF));
-	if (r != 0) {
-		UPDSR(mcu, SR_ZERO, 0);
-	}
+	lazy_sub(mcu, rd, rr, (uint8_t)r,
+	         (r != 0) ? 0 : read_flag(mcu, SR_ZERO));
 }
 
 static void
@@ -799,7 +975,7 @@ exec_cp(MSIM_AVR *mcu, const uint32_t inst)
 	/* CP - Compare */
 	uint8_t rd, rd_addr;
 	uint8_t rr, rr_addr;
-	int buf, r;
+	int r;
 
 	rd_addr = (uint8_t)((inst & 0x01F0) >> 4);
 	rr_addr = (uint8_t)((inst & 0x0F) | ((inst & 0x0200) >> 5));
@@ -807,14 +983,8 @@ exec_cp(MSIM_AVR *mcu, const uint32_t inst)
 	rr = mcu->dm[rr_addr];
 	r = mcu->dm[rd_addr] - mcu->dm[rr_addr];
 	mcu->pc++;
-	buf = (~rd & rr) | (rr & r) | (r & ~rd);
 
-	UPDSR(mcu, SR_CARRY, (buf >> 7) & 1);
-	UPDSR(mcu, SR_HCARRY, (buf >> 3) & 1);
-	UPDSR(mcu, SR_NEG, (r >> 7) & 1);
-	UPDSR(mcu, SR_TCOF, (((rd & ~rr & ~r) | (~rd & rr & r)) >> 7) & 1);
-	UPDSR(mcu, SR_SIGN, SR(mcu, SR_NEG) ^ SR(mcu, SR_TCOF));
-	UPDSR(mcu, SR_ZERO, !r ? 1 : 0);
+	lazy_sub(mcu, rd, rr, (uint8_t)r, !r ? 1 : 0);
 }
 
 static void
@@ -1036,7 +1206,7 @@ exec_sts16(MSIM_AVR *mcu, const uint32_t inst)
 }
 
 static void
-exec_ret(MSIM_AVR *mcu)
+exec_ret(MSIM_AVR *mcu, const uint32_t inst)
 {
 	SKIP_CYCLES(mcu, 1, mcu->pc_bits > 16 ? 4 : 3);
 
@@ -1070,10 +1240,11 @@ exec_ori_sbr(MSIM_AVR *mcu, const uint32_t inst)
 }
 
 static void
-exec_sbi_cbi(MSIM_AVR *mcu, const uint32_t inst, uint8_t set_bit)
+exec_sbi_cbi(MSIM_AVR *mcu, const uint32_t inst)
 {
 	/* SBI – Set Bit in I/O Register
 	 * CBI – Clear Bit in I/O Register */
+	const uint8_t set_bit = (inst & 0x0200) ? 1 : 0;
 	uint8_t reg, b;
 
 	if (!mcu->reduced_core && !mcu->xmega) {
@@ -1090,10 +1261,11 @@ exec_sbi_cbi(MSIM_AVR *mcu, const uint32_t inst, uint8_t set_bit)
 }
 
 static void
-exec_sbis_sbic(MSIM_AVR *mcu, const uint32_t inst, uint8_t set_bit)
+exec_sbis_sbic(MSIM_AVR *mcu, const uint32_t inst)
 {
 	/* SBIS – Skip if Bit in I/O Register is Set
 	 * SBIC – Skip if Bit in I/O Register is Cleared */
+	const uint8_t set_bit = (inst & 0x0200) ? 1 : 0;
 	const uint8_t reg = (uint8_t)(((inst&0x00F8)>>3)+0x20);
 	const uint8_t b = inst & 0x07;
 	const uint32_t ni = (uint32_t) PM(mcu->pc + 1);
@@ -1120,17 +1292,18 @@ exec_sbis_sbic(MSIM_AVR *mcu, const uint32_t inst, uint8_t set_bit)
 		}
 	}
 
-	mcu->read_io[0] = reg;
+	READ_IO(reg);
 	mcu->pc += pc_delta;
 }
 
 static void
-exec_push_pop(MSIM_AVR *mcu, const uint32_t inst, uint8_t push)
+exec_push_pop(MSIM_AVR *mcu, const uint32_t inst)
 {
 	/*
 	 * PUSH – Push Register to Stack
 	 * POP – Pop Register from Stack
 	 */
+	const uint8_t push = (inst & 0x0200) ? 1 : 0;
 	uint8_t reg;
 
 	reg = (inst >> 4) & 0x1F;
@@ -1225,7 +1398,7 @@ exec_ld(MSIM_AVR *mcu, const uint32_t inst,
 			SKIP_CYCLES(mcu, 1, 1);
 		}
 		mcu->dm[regd] = mcu->dm[addr];
-		mcu->read_io[0] = addr;
+		READ_IO(addr);
 		break;
 	case 0x01:	/*	Rd ← (X), X ← X+1	X: Post incremented */
 		if (!mcu->xmega) {
@@ -1236,7 +1409,7 @@ exec_ld(MSIM_AVR *mcu, const uint32_t inst,
 			/* Do not skip any cycles */;
 		}
 		mcu->dm[regd] = mcu->dm[addr];
-		mcu->read_io[0] = addr;
+		READ_IO(addr);
 		addr++;
 		*addr_low = (uint8_t) (addr & 0xFF);
 		*addr_high = (uint8_t) (addr >> 8);
@@ -1255,7 +1428,7 @@ exec_ld(MSIM_AVR *mcu, const uint32_t inst,
 		*addr_low = (uint8_t) (addr & 0xFF);
 		*addr_high = (uint8_t) (addr >> 8);
 		mcu->dm[regd] = mcu->dm[addr];
-		mcu->read_io[0] = addr;
+		READ_IO(addr);
 		break;
 	}
 
@@ -1285,7 +1458,7 @@ exec_ld_ydisp(MSIM_AVR *mcu, const uint32_t i)
 	disp = (uint8_t)((i & 0x07) | ((i & 0x0C00)>>7) | ((i & 0x2000)>>8));
 
 	mcu->dm[regd] = mcu->dm[addr + disp];
-	mcu->read_io[0] = addr + disp;
+	READ_IO(addr + disp);
 
 	mcu->pc++;
 }
@@ -1317,7 +1490,7 @@ exec_ld_zdisp(MSIM_AVR *mcu, const uint32_t inst)
 	                 ((inst & 0x2000) >> 8));
 
 	mcu->dm[regd] = mcu->dm[addr + disp];
-	mcu->read_io[0] = addr + disp;
+	READ_IO(addr + disp);
 
 	mcu->pc++;
 }
@@ -1327,25 +1500,16 @@ exec_sbci(MSIM_AVR *mcu, const uint32_t inst)
 {
 	/* SBCI – Subtract Immediate with Carry */
 	uint8_t rd, rd_addr, c, r;
-	int buf;
 
 	rd_addr = (uint8_t)(((inst & 0xF0) >> 4) + 16);
 	c = (uint8_t)(((inst & 0xF00) >> 4) | (inst & 0x0F));
 
 	rd = mcu->dm[rd_addr];
-	r = (uint8_t)(mcu->dm[rd_addr] - c - SR(mcu, SR_CARRY));
+	r = (uint8_t)(mcu->dm[rd_addr] - c - read_flag(mcu, SR_CARRY));
 	mcu->dm[rd_addr] = r;
 	mcu->pc++;
 
-	buf = (~rd & c) | (c & r) | (r & ~rd);
-	UPDSR(mcu, SR_CARRY, (buf >> 7) & 1);
-	UPDSR(mcu, SR_HCARRY, (buf >> 3) & 1);
-	UPDSR(mcu, SR_NEG, (r >> 7) & 1);
-	UPDSR(mcu, SR_TCOF, (((rd & ~c & ~r) | (~rd & c & r)) >> 7) & 1);
-	UPDSR(mcu, SR_SIGN, SR(mcu, SR_NEG) ^ SR(mcu, SR_TCOF));
-	if (r != 0U) {
-		UPDSR(mcu, SR_ZERO, 0);
-	}
+	lazy_sub(mcu, rd, c, r, (r != 0U) ? 0 : read_flag(mcu, SR_ZERO));
 }
 
 static void
@@ -1493,19 +1657,11 @@ exec_sub(MSIM_AVR *mcu, const uint32_t inst)
 	const uint8_t rd = DM(rda);
 	const uint8_t rr = DM(rra);
 	const uint8_t r = rd - rr;
-	int buf;
 
 	DM(rda) = r;
 
 	mcu->pc++;
-	buf = (~rd & rr) | (rr & r) | (r & ~rd);
-
-	UPDSR(mcu, SR_CARRY, (buf >> 7) &1);
-	UPDSR(mcu, SR_ZERO, !r ? 1 : 0);
-	UPDSR(mcu, SR_NEG, (r >> 7) &1);
-	UPDSR(mcu, SR_TCOF, (((rd & ~rr & ~r) | (~rd & rr & r)) >> 7) &1);
-	UPDSR(mcu, SR_SIGN, SR(mcu, SR_NEG) ^ SR(mcu, SR_TCOF));
-	UPDSR(mcu, SR_HCARRY, (buf>>3) &1);
+	lazy_sub(mcu, rd, rr, r, !r ? 1 : 0);
 }
 
 static void
@@ -1515,20 +1671,12 @@ exec_subi(MSIM_AVR *mcu, const uint32_t inst)
 	const uint8_t rda = ((uint8_t)((inst & 0xF0) >> 4)) + 16;
 	const uint8_t c = (uint8_t)(((inst & 0xF00) >> 4) | (inst & 0xF));
 	const uint8_t rd = DM(rda);
-	int buf = rd - c;
-	const uint8_t r = (uint8_t) buf;
+	const uint8_t r = (uint8_t)(rd - c);
 
 	DM(rda) = r;
 
 	mcu->pc++;
-	buf = (~rd & c) | (c & r) | (r & ~rd);
-
-	UPDSR(mcu, SR_CARRY, (buf >> 7) & 1);
-	UPDSR(mcu, SR_HCARRY, (buf >> 3) & 1);
-	UPDSR(mcu, SR_NEG, (r >> 7) & 1);
-	UPDSR(mcu, SR_TCOF, (((rd & ~c & ~r) | (~rd & c & r)) >> 7) & 1);
-	UPDSR(mcu, SR_SIGN, SR(mcu, SR_NEG) ^ SR(mcu, SR_TCOF));
-	UPDSR(mcu, SR_ZERO, !r ? 1 : 0);
+	lazy_sub(mcu, rd, c, r, !r ? 1 : 0);
 }
 
 static void
@@ -1536,25 +1684,16 @@ exec_sbc(MSIM_AVR *mcu, const uint32_t inst)
 {
 	/* SBC – Subtract with Carry */
 	uint8_t rda, rra, rd, rr, r;
-	int buf;
 
 	rda = (uint8_t)((inst>>4)&0x1F);
 	rra = (uint8_t)(((inst>>5)&0x10)|(inst&0xF));
 	rd = mcu->dm[rda];
 	rr = mcu->dm[rra];
-	r = (uint8_t)(DM(rda)-DM(rra)-SR(mcu, SR_CARRY));
+	r = (uint8_t)(DM(rda)-DM(rra)-read_flag(mcu, SR_CARRY));
 	mcu->dm[rda] = r;
 	mcu->pc++;
-	buf = (~rd & rr) | (rr & r) | (r & ~rd);
 
-	UPDSR(mcu, SR_CARRY, (buf>>7)&1);
-	if (r != 0) {
-		UPDSR(mcu, SR_ZERO, 0);
-	}
-	UPDSR(mcu, SR_NEG, (r>>7)&1);
-	UPDSR(mcu, SR_TCOF, (((rd & ~rr & ~r) | (~rd & rr & r)) >> 7) & 1);
-	UPDSR(mcu, SR_SIGN, SR(mcu, SR_NEG) ^ SR(mcu, SR_TCOF));
-	UPDSR(mcu, SR_HCARRY, (buf>>3)&1);
+	lazy_sub(mcu, rd, rr, r, (r != 0) ? 0 : read_flag(mcu, SR_ZERO));
 }
 
 static void
@@ -1697,7 +1836,7 @@ static void
 exec_brbc(MSIM_AVR *mcu, const uint32_t inst)
 {
 	/* BRBC – Branch if Bit in SREG is Cleared */
-	uint8_t cond = (*mcu->sreg >> (inst & 0x07))&1;
+	uint8_t cond = read_flag(mcu, (uint8_t)(inst & 0x07));
 	int c = (inst>>3)&0x7F;
 
 	if (c > 63) {
@@ -1715,7 +1854,7 @@ static void
 exec_brbs(MSIM_AVR *mcu, const uint32_t inst)
 {
 	/* BRBS – Branch if Bit in SREG is Set */
-	uint8_t cond = (*mcu->sreg >> (inst & 0x07))&1;
+	uint8_t cond = read_flag(mcu, (uint8_t)(inst & 0x07));
 	int c = (inst >> 3)&0x7F;
 
 	if (c > 63) {
@@ -1730,11 +1869,20 @@ exec_brbs(MSIM_AVR *mcu, const uint32_t inst)
 }
 
 static void
-exec_break(MSIM_AVR *mcu)
+exec_break(MSIM_AVR *mcu, const uint32_t inst)
 {
 	/* BREAK – Break (the AVR CPU is set in the Stopped Mode). */
 	mcu->state = AVR_STOPPED;
-	mcu->read_from_mpm = 1;
+	mcu->pc++;
+}
+
+static void
+exec_sleep(MSIM_AVR *mcu, const uint32_t inst)
+{
+	/* SLEEP - Sleep (the AVR CPU is set in a sleep mode defined by
+	 * the MCU control register). */
+	MSIM_AVR_Sleep(mcu);
+	mcu->pc++;
 }
 
 static void
@@ -2005,7 +2153,7 @@ exec_call(MSIM_AVR *mcu, const uint32_t inst_msb)
 }
 
 static void
-exec_clc(MSIM_AVR *mcu)
+exec_clc(MSIM_AVR *mcu, const uint32_t inst)
 {
 	/* CLC – Clear Carry Flag */
 	UPDSR(mcu, SR_CARRY, 0);
@@ -2013,7 +2161,7 @@ exec_clc(MSIM_AVR *mcu)
 }
 
 static void
-exec_sec(MSIM_AVR *mcu)
+exec_sec(MSIM_AVR *mcu, const uint32_t inst)
 {
 	/* SEC – Set Carry Flag */
 	UPDSR(mcu, SR_CARRY, 1);
@@ -2021,7 +2169,7 @@ exec_sec(MSIM_AVR *mcu)
 }
 
 static void
-exec_clh(MSIM_AVR *mcu)
+exec_clh(MSIM_AVR *mcu, const uint32_t inst)
 {
 	/* CLH – Clear Half Carry Flag */
 	UPDSR(mcu, SR_HCARRY, 0);
@@ -2029,7 +2177,7 @@ exec_clh(MSIM_AVR *mcu)
 }
 
 static void
-exec_seh(MSIM_AVR *mcu)
+exec_seh(MSIM_AVR *mcu, const uint32_t inst)
 {
 	/* SEH – Set Half Carry Flag */
 	UPDSR(mcu, SR_HCARRY, 1);
@@ -2037,7 +2185,7 @@ exec_seh(MSIM_AVR *mcu)
 }
 
 static void
-exec_cli(MSIM_AVR *mcu)
+exec_cli(MSIM_AVR *mcu, const uint32_t inst)
 {
 	/* CLI - Clear Global Interrupt Flag */
 	UPDSR(mcu, SR_GLOBINT, 0);
@@ -2045,7 +2193,7 @@ exec_cli(MSIM_AVR *mcu)
 }
 
 static void
-exec_sei(MSIM_AVR *mcu)
+exec_sei(MSIM_AVR *mcu, const uint32_t inst)
 {
 	/* SEI – Set Global Interrupt Flag */
 	UPDSR(mcu, SR_GLOBINT, 1);
@@ -2053,7 +2201,7 @@ exec_sei(MSIM_AVR *mcu)
 }
 
 static void
-exec_cln(MSIM_AVR *mcu)
+exec_cln(MSIM_AVR *mcu, const uint32_t inst)
 {
 	/* CLN – Clear Negative Flag */
 	UPDSR(mcu, SR_NEG, 0);
@@ -2061,7 +2209,7 @@ exec_cln(MSIM_AVR *mcu)
 }
 
 static void
-exec_sen(MSIM_AVR *mcu)
+exec_sen(MSIM_AVR *mcu, const uint32_t inst)
 {
 	/* SEN – Set Negative Flag */
 	UPDSR(mcu, SR_NEG, 1);
@@ -2069,7 +2217,7 @@ exec_sen(MSIM_AVR *mcu)
 }
 
 static void
-exec_cls(MSIM_AVR *mcu)
+exec_cls(MSIM_AVR *mcu, const uint32_t inst)
 {
 	/* CLS – Clear Signed Flag */
 	UPDSR(mcu, SR_SIGN, 0);
@@ -2077,7 +2225,7 @@ exec_cls(MSIM_AVR *mcu)
 }
 
 static void
-exec_ses(MSIM_AVR *mcu)
+exec_ses(MSIM_AVR *mcu, const uint32_t inst)
 {
 	/* SES – Set Signed Flag */
 	UPDSR(mcu, SR_SIGN, 1);
@@ -2085,7 +2233,7 @@ exec_ses(MSIM_AVR *mcu)
 }
 
 static void
-exec_clt(MSIM_AVR *mcu)
+exec_clt(MSIM_AVR *mcu, const uint32_t inst)
 {
 	/* CLT – Clear T Flag */
 	UPDSR(mcu, SR_TBIT, 0);
@@ -2093,7 +2241,7 @@ exec_clt(MSIM_AVR *mcu)
 }
 
 static void
-exec_set(MSIM_AVR *mcu)
+exec_set(MSIM_AVR *mcu, const uint32_t inst)
 {
 	/* SET – Set T Flag */
 	UPDSR(mcu, SR_TBIT, 1);
@@ -2101,7 +2249,7 @@ exec_set(MSIM_AVR *mcu)
 }
 
 static void
-exec_clv(MSIM_AVR *mcu)
+exec_clv(MSIM_AVR *mcu, const uint32_t inst)
 {
 	/* CLV – Clear Overflow Flag */
 	UPDSR(mcu, SR_TCOF, 0);
@@ -2109,7 +2257,7 @@ exec_clv(MSIM_AVR *mcu)
 }
 
 static void
-exec_sev(MSIM_AVR *mcu)
+exec_sev(MSIM_AVR *mcu, const uint32_t inst)
 {
 	/* SEV – Set Overflow Flag */
 	UPDSR(mcu, SR_TCOF, 1);
@@ -2117,7 +2265,7 @@ exec_sev(MSIM_AVR *mcu)
 }
 
 static void
-exec_clz(MSIM_AVR *mcu)
+exec_clz(MSIM_AVR *mcu, const uint32_t inst)
 {
 	/* CLZ – Clear Zero Flag */
 	UPDSR(mcu, SR_ZERO, 0);
@@ -2125,7 +2273,7 @@ exec_clz(MSIM_AVR *mcu)
 }
 
 static void
-exec_sez(MSIM_AVR *mcu)
+exec_sez(MSIM_AVR *mcu, const uint32_t inst)
 {
 	/* SEZ – Set Zero Flag */
 	UPDSR(mcu, SR_ZERO, 1);
@@ -2244,7 +2392,7 @@ exec_fmulsu(MSIM_AVR *mcu, const uint32_t inst)
 }
 
 static void
-exec_icall(MSIM_AVR *mcu)
+exec_icall(MSIM_AVR *mcu, const uint32_t inst)
 {
 	if (mcu->xmega) {
 		SKIP_CYCLES(mcu, 1, mcu->pc_bits > 16 ? 2 : 1);
@@ -2266,7 +2414,7 @@ exec_icall(MSIM_AVR *mcu)
 }
 
 static void
-exec_ijmp(MSIM_AVR *mcu)
+exec_ijmp(MSIM_AVR *mcu, const uint32_t inst)
 {
 	SKIP_CYCLES(mcu, 1, 1);
 
@@ -2325,7 +2473,7 @@ exec_lac(MSIM_AVR *mcu, const uint32_t inst)
 	WRITE_DS(rd_addr, DM(z));
 	WRITE_DS(z, DM(z) & (uint8_t)(~rd));
 	mcu->pc++;
-	mcu->read_io[0] = z;
+	READ_IO(z);
 }
 
 static void
@@ -2346,7 +2494,7 @@ exec_las(MSIM_AVR *mcu, const uint32_t inst)
 	WRITE_DS(rd_addr, DM(z));
 	WRITE_DS(z, DM(z) | (uint8_t)rd);
 	mcu->pc++;
-	mcu->read_io[0] = z;
+	READ_IO(z);
 }
 
 static void
@@ -2367,7 +2515,7 @@ exec_lat(MSIM_AVR *mcu, const uint32_t inst)
 	WRITE_DS(rd_addr, DM(z));
 	WRITE_DS(z, DM(z) ^ rd);
 	mcu->pc++;
-	mcu->read_io[0] = z;
+	READ_IO(z);
 }
 
 static void
@@ -2385,7 +2533,7 @@ exec_lds(MSIM_AVR *mcu, const uint32_t inst)
 	}
 
 	DM(rd_addr) = DM(addr);
-	mcu->read_io[0] = addr;
+	READ_IO(addr);
 	mcu->pc += 2;
 }
 
@@ -2399,7 +2547,7 @@ exec_lds16(MSIM_AVR *mcu, const uint32_t inst)
 	                  ((inst>>5)&0x30) | (inst&0x0F));
 	rd_addr = (uint16_t)(((inst>>4)&0x0F) + 16);
 	mcu->dm[rd_addr] = mcu->dm[addr];
-	mcu->read_io[0] = addr;
+	READ_IO(addr);
 
 	mcu->pc++;
 }
@@ -2418,7 +2566,8 @@ exec_lpm(MSIM_AVR *mcu, const uint32_t inst)
 	 */
 	const uint32_t z = ((DM(REG_ZH) << 8) &0xFF00) | (DM(REG_ZL) &0xFF);
 	const uint8_t bs = (z & 1) ? 8 : 0; /* byte selector (MSB or LSB) */
-	const uint8_t b = (PM(z >> 1) >> bs) & 0xFF;
+	/* Address is wrapped around the PM as it's done by the hardware */
+	const uint8_t b = (PM((z >> 1) & (mcu->flashend >> 1)) >> bs) & 0xFF;
 
 	if (inst == 0x95C8) {
 		DM(0) = b;
@@ -2491,7 +2640,7 @@ exec_sbrs(MSIM_AVR *mcu, const uint32_t inst)
 }
 
 static void
-exec_eicall(MSIM_AVR *mcu)
+exec_eicall(MSIM_AVR *mcu, const uint32_t inst)
 {
 	/* EICALL - Extended Indirect Call to Subroutine */
 	uint8_t zh, zl, eind;
@@ -2532,7 +2681,7 @@ exec_eicall(MSIM_AVR *mcu)
 }
 
 static void
-exec_eijmp(MSIM_AVR *mcu)
+exec_eijmp(MSIM_AVR *mcu, const uint32_t inst)
 {
 	/* EIJMP - Extended Indirect Jump */
 	uint8_t zh, zl, eind;
@@ -2575,7 +2724,7 @@ exec_xch(MSIM_AVR *mcu, const uint32_t inst)
 	WRITE_DS(z, DM(rd_addr));
 	WRITE_DS(rd_addr, v);
 	mcu->pc++;
-	mcu->read_io[0] = z;
+	READ_IO(z);
 }
 
 static void
@@ -2601,7 +2750,7 @@ exec_ror(MSIM_AVR *mcu, const uint32_t inst)
 }
 
 static void
-exec_reti(MSIM_AVR *mcu)
+exec_reti(MSIM_AVR *mcu, const uint32_t inst)
 {
 	SKIP_CYCLES(mcu, 1, mcu->pc_bits > 16 ? 4 : 3);
 
@@ -2776,7 +2925,8 @@ exec_elpm(MSIM_AVR *mcu, const uint32_t inst)
 	                    (uint64_t) (DM(REG_ZH) << 8) |
 	                    (uint64_t) (DM(REG_ZL)));
 	const uint8_t bs = (z & 1) ? 8 : 0; /* byte selector (MSB or LSB) */
-	const uint8_t b = (PM(z >> 1) >> bs) & 0xFF;
+	/* Address is wrapped around the PM as it's done by the hardware */
+	const uint8_t b = (PM((z >> 1) & (mcu->flashend >> 1)) >> bs) & 0xFF;
 
 	if (inst == 0x95D8) {
 		DM(0) = b;
@@ -2811,6 +2961,7 @@ exec_spm(MSIM_AVR *mcu, const uint32_t inst)
 	struct MSIM_AVRConf cnf;
 	uint8_t zl, zh, ez, c;
 	uint64_t z;
+	uint32_t w, pw;
 	uint8_t err = 0;
 
 	if (mcu->spmcsr == NULL) {
@@ -2827,12 +2978,26 @@ exec_spm(MSIM_AVR *mcu, const uint32_t inst)
 		               (zl&0xFF));
 		c = *mcu->spmcsr & 0x7;
 
+		/* Z-pointer addresses bytes, PM is indexed by words */
+		w = (uint32_t)(z >> 1);
+		pw = mcu->spm_pagesize >> 1;
+		if ((w + pw) > ((mcu->flashend >> 1) + 1)) {
+			snprintf(LOG, LOGSZ, "SPM address is out of program "
+			         "memory: 0x%06" PRIX64, z);
+			MSIM_LOG_ERROR(LOG);
+			c = 0;
+		}
+
 		if (c == 0x3) {			/* erase PM page */
-			memset(&mcu->pm[z], 0xFF, mcu->spm_pagesize);
+			for (uint32_t i = 0; i < pw; i++) {
+				mcu->pm[w + i] = 0xFFFF;
+			}
+			MSIM_AVR_FlushDecoded(mcu, w, pw);
 		} else if (c == 0x1) {		/* fill the buffer */
-			memcpy(&mcu->pmp[z], &mcu->dm[0], 2);
+			memcpy(&mcu->pmp[w], &mcu->dm[0], 2);
 		} else if (c == 0x5) {		/* write a page */
-			memcpy(&mcu->pm[z], &mcu->pmp[z], mcu->spm_pagesize);
+			memcpy(&mcu->pm[w], &mcu->pmp[w], mcu->spm_pagesize);
+			MSIM_AVR_FlushDecoded(mcu, w, pw);
 		}
 		mcu->pc++;
 
@@ -2858,7 +3023,7 @@ exec_spm(MSIM_AVR *mcu, const uint32_t inst)
 }
 
 static void
-exec_wdr(MSIM_AVR *mcu)
+exec_wdr(MSIM_AVR *mcu, const uint32_t inst)
 {
 	/* WDR - Watchdog Timer Reset */
 //	mcu->wdt.sys_ticks = 0;
@@ -0,0 +1,94 @@
+/*
+ * This file is part of MCUSim, an XSPICE library with microcontrollers.
+ *
+ * Copyright (C) 2017-2019 MCUSim Developers, see AUTHORS.txt for contributors.
+ *
+ * MCUSim is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MCUSim is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Build-time generator of the instruction decoder table. It maps each of
+ * the 16-bit opcodes to an index of the instruction handler according to
+ * the encodings described in avr_decoder.def.
+ */
+#include <stdio.h>
+#include <stdint.h>
+
+#define TBL_ROW			8	/* Table entries per line */
+
+/* Encoding of the instruction. */
+struct inst_enc {
+	const char *op;			/* Index of the handler */
+	uint16_t mask;			/* Bits of the opcode to match */
+	uint16_t val;			/* Value of the masked opcode */
+};
+
+#define AVR_INST(op, mask, val)	{ #op, mask, val },
+
+static const struct inst_enc encs[] = {
+#include "avr_decoder.def"
+};
+
+#define ENCS_NUM		(sizeof encs / sizeof encs[0])
+
+int
+main(int argc, char *argv[])
+{
+	FILE *f;
+	const char *op;
+	uint32_t i, j;
+	int rc = 0;
+
+	do {
+		if (argc != 2) {
+			fprintf(stderr, "usage: %s <output file>\n", argv[0]);
+			rc = 1;
+			break;
+		}
+
+		f = fopen(argv[1], "w");
+		if (f == NULL) {
+			fprintf(stderr, "failed to open file: %s\n", argv[1]);
+			rc = 1;
+			break;
+		}
+
+		fprintf(f, "/* Generated from avr_decoder.def, do not edit. */\n");
+		fprintf(f, "static const uint8_t decode_tbl[65536] = {\n");
+		for (i = 0; i <= UINT16_MAX; i++) {
+			op = "OP_UNKNOWN";
+			for (j = 0; j < ENCS_NUM; j++) {
+				if ((i & encs[j].mask) == encs[j].val) {
+					op = encs[j].op;
+					break;
+				}
+			}
+
+			if ((i % TBL_ROW) == 0U) {
+				fprintf(f, "\t");
+			}
+			fprintf(f, "%s,", op);
+			fprintf(f, ((i % TBL_ROW) == (TBL_ROW - 1U)) ? "\n" : " ");
+		}
+		fprintf(f, "};\n");
+
+		if (fclose(f) != 0) {
+			fprintf(stderr, "failed to write file: %s\n", argv[1]);
+			rc = 1;
+			break;
+		}
+	} while (0);
+
+	return rc;
+}
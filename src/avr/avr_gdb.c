@@ -38,12 +38,13 @@
 #endif
 
 #define AVRSIM_RSP_PROTOCOL		"tcp"
-#define BREAK_LOW			0x98
-#define BREAK_HIGH			0x95
-#define BREAK				((BREAK_HIGH<<8)|BREAK_LOW)
 #define GDB_BUF_MAX			(16*1024)
 #define REG_BUF_MAX			32
 
+/* Snapshots of the MCU to execute it in reverse from */
+#define RSP_HIST_SNAPS			64		/* Snapshots, max */
+#define RSP_HIST_CYCLES			(1U << 20)	/* Cycles between */
+
 /* Match point type */
 enum mp_type {
 	BP_SOFTWARE	= 0,		/* Software break point */
@@ -53,55 +54,67 @@ enum mp_type {
 	WP_ACCESS	= 4		/* Watch point (to access memory) */
 };
 
-struct rsp_state {
+typedef struct rsp_buf {
+	char data[GDB_BUF_MAX];
+	unsigned long len;
+} rsp_buf;
+
+/* GDB RSP state of the MCU instance */
+struct MSIM_AVR_RSP {
 	char client_waiting;
-	struct MSIM_AVR *mcu;		/* MCU instance */
 	int proto_num;
 	int fserv;			/* FD for incoming connections */
 	int fcli;			/* FD for talking to GDB client */
 	int sigval;			/* GDB signal for any exception */
 	unsigned long start_addr;	/* Start of last run */
-};
+	rsp_buf buf;			/* Packet received from GDB */
+	uint8_t mem[GDB_BUF_MAX];	/* Memory to be written */
 
-typedef struct rsp_buf {
-	char data[GDB_BUF_MAX];
-	unsigned long len;
-} rsp_buf;
-
-static struct rsp_state rsp;
+	MSIM_AVR_Snap hist[RSP_HIST_SNAPS]; /* Snapshots (ring buffer) */
+	uint32_t hist_first;		/* Oldest snapshot */
+	uint32_t hist_num;		/* # of snapshots taken */
+	uint64_t hist_next;		/* Cycle to take a snapshot at */
+};
 static const char hexchars[] = "0123456789ABCDEF";
 
-static void		rsp_close_server(void);
-static void		rsp_close_client(void);
+static void		rsp_close_server(MSIM_AVR *mcu);
+static void		rsp_close_client(MSIM_AVR *mcu);
 static void		rsp_server_request(MSIM_AVR *mcu);
 static void		rsp_client_request(MSIM_AVR *mcu);
-static rsp_buf 	*get_packet(void);
-static int		get_rsp_char(void);
+static rsp_buf 	*get_packet(MSIM_AVR *mcu);
+static int		get_rsp_char(MSIM_AVR *mcu);
 static void		put_packet(MSIM_AVR *mcu, rsp_buf *buf);
-static void		put_rsp_char(char c);
+static void		put_rsp_char(MSIM_AVR *mcu, char c);
 static void		put_str_packet(MSIM_AVR *mcu, const char *str);
 static void		rsp_report_exception(MSIM_AVR *mcu);
-static void		rsp_continue(rsp_buf *buf);
+static void		rsp_continue(MSIM_AVR *mcu, rsp_buf *buf);
 static void		rsp_query(MSIM_AVR *mcu, rsp_buf *buf);
 static void		rsp_vpkt(MSIM_AVR *mcu, rsp_buf *buf);
-static void		rsp_restart(void);
+static void		rsp_restart(MSIM_AVR *mcu);
 static void		rsp_read_all_regs(MSIM_AVR *mcu);
 static void		rsp_write_all_regs(MSIM_AVR *mcu, rsp_buf *buf);
 static void		rsp_read_mem(MSIM_AVR *mcu, rsp_buf *buf);
 static void		rsp_write_mem(MSIM_AVR *mcu, rsp_buf *buf);
 static void		rsp_write_mem_bin(MSIM_AVR *mcu, rsp_buf *buf);
-static void		rsp_step(rsp_buf *buf);
+static void		rsp_step(MSIM_AVR *mcu, rsp_buf *buf);
+static void		rsp_reverse(MSIM_AVR *mcu, rsp_buf *buf);
 static void		rsp_insert_matchpoint(MSIM_AVR *mcu, rsp_buf *buf);
 static void		rsp_remove_matchpoint(MSIM_AVR *mcu, rsp_buf *buf);
 static unsigned long	rsp_unescape(char *data, unsigned long len);
 static void		rsp_read_reg(MSIM_AVR *mcu, rsp_buf *buf);
 static void		rsp_write_reg(MSIM_AVR *mcu, rsp_buf *buf);
 
+static MSIM_AVR_Snap	*hist_snap(MSIM_AVR *mcu, uint32_t i);
+static const char	*no_replay(MSIM_AVR *mcu);
+static int		replay(MSIM_AVR *mcu, uint32_t i, uint64_t tick,
+			       uint64_t *prev, uint64_t *bp);
+
 static int		hex(int c);
 static unsigned long	hex2reg(char *buf, const unsigned long dign);
 
-static size_t		read_reg(int n, char *buf, size_t buf_len);
-static void		write_reg(int n, char *buf);
+static size_t		read_reg(MSIM_AVR *mcu, int n, char *buf,
+			         size_t buf_len);
+static void		write_reg(MSIM_AVR *mcu, int n, char *buf);
 
 void
 MSIM_AVR_RSPInit(struct MSIM_AVR *mcu, uint16_t portn)
@@ -111,15 +124,26 @@ MSIM_AVR_RSPInit(struct MSIM_AVR *mcu, uint16_t portn)
 	struct sockaddr_in sock_addr;	/* Socket address */
 	int optval;			/* Socket options */
 	int flags; 			/* Socket flags */
+	struct MSIM_AVR_RSP *rsp;	/* GDB RSP state */
+
+	/* GDB RSP state is kept with the MCU instance */
+	mcu->rsp = MSIM_ARENA_Alloc(&mcu->arena, sizeof *mcu->rsp);
+	if (mcu->rsp == NULL) {
+		MSIM_LOG_ERROR("failed to allocate memory for GDB RSP");
+		return;
+	}
+	rsp = mcu->rsp;
 
 	/* Reset GDB RSP state */
-	rsp.client_waiting = 0;		/* GDB client is not waiting */
-	rsp.mcu = mcu;			/* MCU instance */
-	rsp.proto_num = -1;		/* i.e. invalid */
-	rsp.fserv = -1;			/* i.e. invalid */
-	rsp.fcli = -1;			/* i.e. invalid */
-	rsp.sigval = 0;			/* No exceptions */
-	rsp.start_addr = mcu->intr.reset_pc;	/* Reset PC by default */
+	rsp->client_waiting = 0;	/* GDB client is not waiting */
+	rsp->proto_num = -1;		/* i.e. invalid */
+	rsp->fserv = -1;		/* i.e. invalid */
+	rsp->fcli = -1;			/* i.e. invalid */
+	rsp->sigval = 0;		/* No exceptions */
+	rsp->start_addr = mcu->intr.reset_pc;	/* Reset PC by default */
+	rsp->hist_first = 0;		/* No snapshots */
+	rsp->hist_num = 0;
+	rsp->hist_next = 0;
 
 	protocol = getprotobyname(AVRSIM_RSP_PROTOCOL);
 	if (protocol == NULL) {
@@ -130,7 +154,7 @@ MSIM_AVR_RSPInit(struct MSIM_AVR *mcu, uint16_t portn)
 		return;
 	}
 
-	rsp.proto_num = protocol->p_proto;
+	rsp->proto_num = protocol->p_proto;
 
 	if (portn <= IPPORT_RESERVED) {
 		snprintf(LOG, LOGSZ, "Could not use a reserved port: %d, "
@@ -141,8 +165,8 @@ MSIM_AVR_RSPInit(struct MSIM_AVR *mcu, uint16_t portn)
 	}
 
 	/* Create a socket using AVRSim RSP protocol */
-	rsp.fserv = socket(PF_INET, SOCK_STREAM, protocol->p_proto);
-	if (rsp.fserv < 0) {
+	rsp->fserv = socket(PF_INET, SOCK_STREAM, protocol->p_proto);
+	if (rsp->fserv < 0) {
 		snprintf(LOG, LOGSZ, "RSP could not create server socket: %s",
 		         strerror(errno));
 		MSIM_LOG_ERROR(LOG);
@@ -152,34 +176,34 @@ MSIM_AVR_RSPInit(struct MSIM_AVR *mcu, uint16_t portn)
 
 	/* Set socket to reuse its address */
 	optval = 1;
-	if (setsockopt(rsp.fserv, SOL_SOCKET, SO_REUSEADDR, &optval,
+	if (setsockopt(rsp->fserv, SOL_SOCKET, SO_REUSEADDR, &optval,
 	                sizeof optval) < 0) {
 		snprintf(LOG, LOGSZ, "Could not setup socket to reuse its "
-		         "address %d: %s", rsp.fserv, strerror(errno));
+		         "address %d: %s", rsp->fserv, strerror(errno));
 		MSIM_LOG_ERROR(LOG);
 
-		rsp_close_server();
+		rsp_close_server(mcu);
 		return;
 	}
 
 	/* Server should be non-blocking */
-	flags = fcntl(rsp.fserv, F_GETFL);
+	flags = fcntl(rsp->fserv, F_GETFL);
 	if (flags < 0) {
 		snprintf(LOG, LOGSZ, "Unable to get flags for RSP server "
-		         "socket %d: %s", rsp.fserv, strerror(errno));
+		         "socket %d: %s", rsp->fserv, strerror(errno));
 		MSIM_LOG_ERROR(LOG);
 
-		rsp_close_server();
+		rsp_close_server(mcu);
 		return;
 	}
 	flags |= O_NONBLOCK;
-	if (fcntl(rsp.fserv, F_SETFL, flags) < 0) {
+	if (fcntl(rsp->fserv, F_SETFL, flags) < 0) {
 		snprintf(LOG, LOGSZ, "Unable to set flags for RSP server "
 		         "socket %d to 0x%08X: %s",
-		         rsp.fserv, flags, strerror(errno));
+		         rsp->fserv, flags, strerror(errno));
 		MSIM_LOG_ERROR(LOG);
 
-		rsp_close_server();
+		rsp_close_server(mcu);
 		return;
 	}
 
@@ -190,7 +214,7 @@ MSIM_AVR_RSPInit(struct MSIM_AVR *mcu, uint16_t portn)
 		         "by localhost name: %s", strerror(errno));
 		MSIM_LOG_ERROR(LOG);
 
-		rsp_close_server();
+		rsp_close_server(mcu);
 		return;
 	}
 
@@ -199,13 +223,13 @@ MSIM_AVR_RSPInit(struct MSIM_AVR *mcu, uint16_t portn)
 	sock_addr.sin_family = (unsigned char)host->h_addrtype;
 	sock_addr.sin_port = htons(portn);
 
-	if (bind(rsp.fserv, (struct sockaddr *)&sock_addr,
+	if (bind(rsp->fserv, (struct sockaddr *)&sock_addr,
 	                sizeof sock_addr) < 0) {
 		snprintf(LOG, LOGSZ, "Unable to bind RSP server socket %d to "
-		         "port %d: %s", rsp.fserv, portn, strerror(errno));
+		         "port %d: %s", rsp->fserv, portn, strerror(errno));
 		MSIM_LOG_ERROR(LOG);
 
-		rsp_close_server();
+		rsp_close_server(mcu);
 		return;
 	}
 
@@ -213,12 +237,12 @@ MSIM_AVR_RSPInit(struct MSIM_AVR *mcu, uint16_t portn)
 	 * Listen to the incoming connections from GDB clients (do not allow
 	 * more than 1 client to be connected simultaneously!)
 	 */
-	if (listen(rsp.fserv, 1) < 0) {
+	if (listen(rsp->fserv, 1) < 0) {
 		snprintf(LOG, LOGSZ, "Unable to backlog on RSP server socket "
-		         "%d to %d: %s", rsp.fserv, 1, strerror(errno));
+		         "%d to %d: %s", rsp->fserv, 1, strerror(errno));
 		MSIM_LOG_ERROR(LOG);
 
-		rsp_close_server();
+		rsp_close_server(mcu);
 		return;
 	}
 }
@@ -226,17 +250,64 @@ MSIM_AVR_RSPInit(struct MSIM_AVR *mcu, uint16_t portn)
 void
 MSIM_AVR_RSPClose(struct MSIM_AVR *mcu)
 {
-	rsp_close_client();
-	rsp_close_server();
+	struct MSIM_AVR_RSP *rsp = mcu->rsp;
+
+	if (rsp == NULL) {
+		return;
+	}
+	rsp_close_client(mcu);
+	rsp_close_server(mcu);
+
+	for (uint32_t i = 0; i < RSP_HIST_SNAPS; i++) {
+		MSIM_AVR_SnapFree(&rsp->hist[i]);
+	}
+	rsp->hist_num = 0;
+	mcu->rsp = NULL;
+}
+
+uint64_t
+MSIM_AVR_RSPRecord(struct MSIM_AVR *mcu)
+{
+	struct MSIM_AVR_RSP *rsp = mcu->rsp;
+	uint32_t i;
+
+	/* There is no GDB to execute the MCU in reverse or the MCU can't
+	 * be replayed */
+	if ((rsp == NULL) || (no_replay(mcu) != NULL)) {
+		return UINT64_MAX;
+	}
+
+	if ((rsp->hist_num == 0U) || (mcu->tick >= rsp->hist_next)) {
+		/* The oldest snapshot is replaced once the buffer is full */
+		if (rsp->hist_num < RSP_HIST_SNAPS) {
+			i = (rsp->hist_first + rsp->hist_num) % RSP_HIST_SNAPS;
+			rsp->hist_num++;
+		} else {
+			i = rsp->hist_first;
+			rsp->hist_first = (rsp->hist_first + 1) %
+			                  RSP_HIST_SNAPS;
+		}
+
+		if (MSIM_AVR_Snapshot(mcu, &rsp->hist[i]) != 0) {
+			MSIM_LOG_WARN("MCU can't be executed in reverse "
+			              "beyond this cycle");
+			rsp->hist_first = i;
+			rsp->hist_num = 0;
+		}
+		rsp->hist_next = mcu->tick + RSP_HIST_CYCLES;
+	}
+
+	return rsp->hist_next - mcu->tick;
 }
 
 int
 MSIM_AVR_RSPHandle(struct MSIM_AVR *mcu)
 {
+	struct MSIM_AVR_RSP *rsp = mcu->rsp;
 	struct pollfd fds[2];
 
 	/* Give up if no RSP server port (this should not happen) */
-	if (rsp.fserv == -1) {
+	if ((rsp == NULL) || (rsp->fserv == -1)) {
 		MSIM_LOG_ERROR("No open RSP server port");
 
 		return -1;
@@ -246,9 +317,9 @@ MSIM_AVR_RSPHandle(struct MSIM_AVR *mcu)
 	 * If there is no RSP client, poll the server socket
 	 * until we get one.
 	 */
-	while (rsp.fcli == -1) {
+	while (rsp->fcli == -1) {
 		/* Poll for a client of RSP server socket */
-		fds[0].fd = rsp.fserv;
+		fds[0].fd = rsp->fserv;
 		fds[0].events = POLLIN;
 
 		switch (poll(fds, 1, -1)) {
@@ -263,8 +334,8 @@ MSIM_AVR_RSPHandle(struct MSIM_AVR *mcu)
 			         strerror(errno));
 			MSIM_LOG_ERROR(LOG);
 
-			rsp_close_client();
-			rsp_close_server();
+			rsp_close_client(mcu);
+			rsp_close_server(mcu);
 			return -1;
 		case 0:
 			/* Timeout. This should not happen. */
@@ -274,15 +345,15 @@ MSIM_AVR_RSPHandle(struct MSIM_AVR *mcu)
 		default:
 			if (POLLIN == (fds[0].revents & POLLIN)) {
 				rsp_server_request(mcu);
-				rsp.client_waiting = 0;
+				rsp->client_waiting = 0;
 			} else {
 				snprintf(LOG, LOGSZ, "RSP server received "
 				         "flags 0x%08X: closing server "
 				         "connection", fds[0].revents);
 				MSIM_LOG_ERROR(LOG);
 
-				rsp_close_client();
-				rsp_close_server();
+				rsp_close_client(mcu);
+				rsp_close_server(mcu);
 				return -1;
 			}
 			break;
@@ -290,13 +361,13 @@ MSIM_AVR_RSPHandle(struct MSIM_AVR *mcu)
 	}
 
 	/* Response with signal 5 (TRAP exception) any time */
-	if (rsp.client_waiting) {
+	if (rsp->client_waiting) {
 		put_str_packet(mcu, "S05");
-		rsp.client_waiting = 0;
+		rsp->client_waiting = 0;
 	}
 
 	/* Poll the RSP client socket for a message from GDB */
-	fds[0].fd = rsp.fcli;
+	fds[0].fd = rsp->fcli;
 	fds[0].events = POLLIN;
 
 	/* Poll is always blocking. We have to wait. */
@@ -310,8 +381,8 @@ MSIM_AVR_RSPHandle(struct MSIM_AVR *mcu)
 		         "server connection: %s", strerror(errno));
 		MSIM_LOG_ERROR(LOG);
 
-		rsp_close_client();
-		rsp_close_server();
+		rsp_close_client(mcu);
+		rsp_close_server(mcu);
 		return -1;
 	case 0:
 		/* Timeout. This should not happen. */
@@ -332,7 +403,7 @@ MSIM_AVR_RSPHandle(struct MSIM_AVR *mcu)
 			         fds[0].revents);
 			MSIM_LOG_WARN(LOG);
 
-			rsp_close_client();
+			rsp_close_client(mcu);
 		}
 		break;
 	}
@@ -340,32 +411,37 @@ MSIM_AVR_RSPHandle(struct MSIM_AVR *mcu)
 }
 
 static void
-rsp_close_server(void)
+rsp_close_server(MSIM_AVR *mcu)
 {
-	if (rsp.fserv != -1) {
-		close(rsp.fserv);
-		rsp.fserv = -1;
+	struct MSIM_AVR_RSP *rsp = mcu->rsp;
+
+	if (rsp->fserv != -1) {
+		close(rsp->fserv);
+		rsp->fserv = -1;
 	}
 }
 
 static void
-rsp_close_client(void)
+rsp_close_client(MSIM_AVR *mcu)
 {
-	if (rsp.fcli != -1) {
-		close(rsp.fcli);
-		rsp.fcli = -1;
+	struct MSIM_AVR_RSP *rsp = mcu->rsp;
+
+	if (rsp->fcli != -1) {
+		close(rsp->fcli);
+		rsp->fcli = -1;
 	}
 }
 
 static void
 rsp_server_request(struct MSIM_AVR *mcu)
 {
+	struct MSIM_AVR_RSP *rsp = mcu->rsp;
 	struct sockaddr_in sock_addr;	/* The socket address */
 	socklen_t len;			/* Size of the socket address */
 	int fd, flags, optval;
 
 	len = sizeof sock_addr;
-	fd = accept(rsp.fserv, (struct sockaddr *)&sock_addr, &len);
+	fd = accept(rsp->fserv, (struct sockaddr *)&sock_addr, &len);
 
 	if (fd < 0) {
 		if (errno == EWOULDBLOCK || errno == EAGAIN) {
@@ -376,13 +452,13 @@ rsp_server_request(struct MSIM_AVR *mcu)
 		         "closing connection: %s", strerror(errno));
 		MSIM_LOG_ERROR(LOG);
 
-		rsp_close_client();
-		rsp_close_server();
+		rsp_close_client(mcu);
+		rsp_close_server(mcu);
 		return;
 	}
 
 	/* Close a new incoming client connection if there is one already */
-	if (rsp.fcli != -1) {
+	if (rsp->fcli != -1) {
 		snprintf(LOG, LOGSZ, "additional RSP client request refused");
 		MSIM_LOG_ERROR(LOG);
 
@@ -417,7 +493,7 @@ rsp_server_request(struct MSIM_AVR *mcu)
 	 */
 	optval = 0;
 	len = sizeof optval;
-	if (setsockopt(fd, rsp.proto_num, TCP_NODELAY, &optval, len) < 0) {
+	if (setsockopt(fd, rsp->proto_num, TCP_NODELAY, &optval, len) < 0) {
 		snprintf(LOG, LOGSZ, "unable to switch off Nagel's algorithm "
 		         "for RSP client socket %d: %s\n", fd, strerror(errno));
 		MSIM_LOG_ERROR(LOG);
@@ -427,7 +503,7 @@ rsp_server_request(struct MSIM_AVR *mcu)
 	}
 
 	/* We have a new client socket */
-	rsp.fcli = fd;
+	rsp->fcli = fd;
 }
 
 static void
@@ -435,18 +511,18 @@ rsp_client_request(struct MSIM_AVR *mcu)
 {
 	struct rsp_buf *buf;
 
-	buf = get_packet();
+	buf = get_packet(mcu);
 
 	/* NULL means we hit EOF or link closed for some other reason */
 	if (buf == NULL) {
-		rsp_close_client();
+		rsp_close_client(mcu);
 		return;
 	}
 
 	/* Process a limited GDB commands while MCU running */
-	if (rsp.mcu->state == AVR_RUNNING) {
+	if (mcu->state == AVR_RUNNING) {
 		if (buf->data[0] == 0x03) {
-			rsp.mcu->state = AVR_STOPPED;
+			mcu->state = AVR_STOPPED;
 		} else {
 			put_str_packet(mcu, "O6154677274656e20746f73206f7470"
 			               "7064650a0d");
@@ -470,22 +546,26 @@ rsp_client_request(struct MSIM_AVR *mcu)
 		/* Report why MCU halted */
 		rsp_report_exception(mcu);
 		return;
+	case 'b':
+		/* Reverse step or continue */
+		rsp_reverse(mcu, buf);
+		return;
 	case 'c':
 		/* Continue */
-		rsp_continue(buf);
+		rsp_continue(mcu, buf);
 		return;
 	case 'C':
 		/*
 		 * Continue with signal.
 		 * Ignore signal at the moment and continue as usual.
 		 */
-		rsp_continue(buf);
+		rsp_continue(mcu, buf);
 		return;
 	case 'D':
 		/* Detach GDB */
 		put_str_packet(mcu, "OK");
 
-		rsp_close_client();
+		rsp_close_client(mcu);
 		return;
 	case 'g':
 		rsp_read_all_regs(mcu);
@@ -501,7 +581,7 @@ rsp_client_request(struct MSIM_AVR *mcu)
 		return;
 	case 'k':
 		/* Kill request. Terminate simulation. */
-		rsp.mcu->state = AVR_MSIM_STOP;
+		mcu->state = AVR_MSIM_STOP;
 		return;
 	case 'm':
 		/* Read memory (symbolic) */
@@ -523,14 +603,14 @@ rsp_client_request(struct MSIM_AVR *mcu)
 		return;
 	case 'R':
 		/* Restart the MCU program */
-		rsp_restart();
+		rsp_restart(mcu);
 		return;
 	case 's':
-		rsp_step(buf);
+		rsp_step(mcu, buf);
 		return;
 	case 'S':
 		/* Ignore signal and perform a step as usual */
-		rsp_step(buf);
+		rsp_step(mcu, buf);
 		return;
 	case 'v':
 		/* One of execution control packets */
@@ -573,7 +653,7 @@ rsp_read_reg(MSIM_AVR *mcu, rsp_buf *buf)
 		put_str_packet(mcu, "E01");
 	} else {
 		val[0] = 0;
-		if (!read_reg((int)regn, val, REG_BUF_MAX)) {
+		if (!read_reg(mcu, (int)regn, val, REG_BUF_MAX)) {
 			snprintf(LOG, LOGSZ, "Unknown register %" PRIu32
 			         ", empty response will be returned", regn);
 			MSIM_LOG_ERROR(LOG);
@@ -599,7 +679,7 @@ rsp_write_reg(MSIM_AVR *mcu, rsp_buf *buf)
 
 		put_str_packet(mcu, "E01");
 	} else {
-		write_reg((int)regn, val);
+		write_reg(mcu, (int)regn, val);
 
 		put_str_packet(mcu, "OK");
 	}
@@ -611,8 +691,6 @@ rsp_insert_matchpoint(struct MSIM_AVR *mcu, struct rsp_buf *buf)
 	enum mp_type type;
 	unsigned long addr;
 	int len, vals;
-	unsigned char llsb, lmsb, hlsb, hmsb;
-	unsigned short inst;
 
 	vals = sscanf(buf->data, "Z%1d,%lx,%1d", (int *)&type, &addr, &len);
 	if (vals != 3) {
@@ -639,32 +717,15 @@ rsp_insert_matchpoint(struct MSIM_AVR *mcu, struct rsp_buf *buf)
 		 * this minimal implementation. Insertion of a breakpoint at
 		 * the same location twice won't make any change.
 		 */
-		llsb = (unsigned char) mcu->pm[addr];
-		lmsb = (unsigned char) mcu->pm[addr+1];
-		inst = (unsigned short) (llsb | (lmsb << 8));
-
-		if (inst == BREAK) {
-			snprintf(LOG, LOGSZ, "BREAK is already at 0x%8lX, "
-			         "ignoring", addr);
-			MSIM_LOG_WARN(LOG);
+		if (MSIM_AVR_SetBreak(mcu, (uint32_t)(addr >> 1)) != 0) {
+			snprintf(LOG, LOGSZ, "RSP matchpoint address 0x%8lX "
+			         "is out of program memory", addr);
+			MSIM_LOG_ERROR(LOG);
 
-			put_str_packet(mcu, "OK");
+			put_str_packet(mcu, "E01");
 			return;
 		}
 
-		mcu->pm[addr] = BREAK_LOW;
-		mcu->pm[addr+1] = BREAK_HIGH;
-		mcu->mpm[addr] = llsb;
-		mcu->mpm[addr+1] = lmsb;
-		if (MSIM_AVR_Is32(inst)) {
-			hlsb = (unsigned char) mcu->pm[addr+2];
-			hmsb = (unsigned char) mcu->pm[addr+3];
-			mcu->pm[addr+2] = 0;
-			mcu->pm[addr+3] = 0;
-			mcu->mpm[addr+2] = hlsb;
-			mcu->mpm[addr+3] = hmsb;
-		}
-
 		put_str_packet(mcu, "OK");
 		break;
 	default:
@@ -683,8 +744,6 @@ rsp_remove_matchpoint(MSIM_AVR *mcu, rsp_buf *buf)
 	enum mp_type type;
 	unsigned long addr;
 	int len, vals;
-	unsigned char llsb, lmsb, hlsb, hmsb;
-	unsigned short inst;
 
 	vals = sscanf(buf->data, "z%1d,%lx,%1d", (int *)&type, &addr, &len);
 	if (vals != 3) {
@@ -711,31 +770,15 @@ rsp_remove_matchpoint(MSIM_AVR *mcu, rsp_buf *buf)
 		 * this minimal implementation. Double check if breakpoint
 		 * exists at the given address.
 		 */
-		llsb = (unsigned char) mcu->pm[addr];
-		lmsb = (unsigned char) mcu->pm[addr+1];
-		inst = (unsigned short) (llsb | (lmsb << 8));
-		if (inst != BREAK) {
-			snprintf(LOG, LOGSZ, "there is no BREAK at 0x%8lX "
-			         "address, ignoring", addr);
+		if (MSIM_AVR_ClearBreak(mcu, (uint32_t)(addr >> 1)) != 0) {
+			snprintf(LOG, LOGSZ, "there is no breakpoint at "
+			         "0x%8lX address, ignoring", addr);
 			MSIM_LOG_ERROR(LOG);
 
 			put_str_packet(mcu, "E01");
 			return;
 		}
 
-		llsb = (unsigned char) mcu->mpm[addr];
-		lmsb = (unsigned char) mcu->mpm[addr+1];
-		mcu->pm[addr] = llsb;
-		mcu->pm[addr+1] = lmsb;
-
-		inst = (unsigned short) (llsb | (lmsb << 8));
-		if (MSIM_AVR_Is32(inst)) {
-			hlsb = (unsigned char) mcu->mpm[addr+2];
-			hmsb = (unsigned char) mcu->mpm[addr+3];
-			mcu->pm[addr+2] = hlsb;
-			mcu->pm[addr+3] = hmsb;
-		}
-
 		put_str_packet(mcu, "OK");
 		break;
 	default:
@@ -749,9 +792,9 @@ rsp_remove_matchpoint(MSIM_AVR *mcu, rsp_buf *buf)
 }
 
 static struct rsp_buf *
-get_packet(void)
+get_packet(MSIM_AVR *mcu)
 {
-	static struct rsp_buf buf;
+	struct rsp_buf *buf = &mcu->rsp->buf;
 	uint8_t checksum;
 	uint64_t count;			/* Index into the buffer */
 	int8_t ch;			/* Current character */
@@ -760,7 +803,7 @@ get_packet(void)
 	while (1) {
 		/* Wait around for the start character ('$'). Ignore
 		 * all other characters. */
-		ch = (char)get_rsp_char();
+		ch = (char)get_rsp_char(mcu);
 		while (ch != '$') {
 			if (ch == -1) {
 				return  NULL;
@@ -769,18 +812,18 @@ get_packet(void)
 			/* 0x03 is a special case, an out-of-band break when
 			 * running */
 			if (ch == 0x03) {
-				buf.data[0] = ch;
-				buf.len = 1;
-				return &buf;
+				buf->data[0] = ch;
+				buf->len = 1;
+				return buf;
 			}
-			ch = (char)get_rsp_char();
+			ch = (char)get_rsp_char(mcu);
 		}
 
 		/* Read until a '#' or end of buffer is found */
 		checksum = 0;
 		count = 0;
 		while (count < GDB_BUF_MAX-1) {
-			ch = (char)get_rsp_char();
+			ch = (char)get_rsp_char(mcu);
 
 			/* Check for connection failure */
 			if (ch == -1) {
@@ -802,7 +845,7 @@ get_packet(void)
 			}
 			/* Update checksum and add the char to the buffer. */
 			checksum = (uint8_t)(checksum + (uint8_t)ch);
-			buf.data[count] = (char)ch;
+			buf->data[count] = (char)ch;
 			count++;
 		}
 
@@ -810,8 +853,8 @@ get_packet(void)
 		 * Mark the end of the buffer with EOS - it's convenient
 		 * for non-binary data to be valid strings.
 		 */
-		buf.data[count] = 0;
-		buf.len = count;
+		buf->data[count] = 0;
+		buf->len = count;
 
 		/*
 		 * If we have a valid end of packet char, validate
@@ -820,14 +863,14 @@ get_packet(void)
 		if (ch == '#') {
 			uint8_t xmitcsum;
 
-			ch = (char)get_rsp_char();
+			ch = (char)get_rsp_char(mcu);
 			if (ch == -1) {
 				return NULL;
 			}
 
 			xmitcsum = (unsigned char)(hex(ch)<<4);
 
-			ch = (char)get_rsp_char();
+			ch = (char)get_rsp_char(mcu);
 			if (ch == -1) {
 				return  NULL;
 			}
@@ -844,9 +887,9 @@ get_packet(void)
 				        "checksum: Computed 0x%02X, "
 				        "received 0x%02X\n",
 				        checksum, xmitcsum);
-				put_rsp_char('-');
+				put_rsp_char(mcu, '-');
 			} else {
-				put_rsp_char('+');
+				put_rsp_char(mcu, '+');
 				break;
 			}
 		} else {
@@ -855,16 +898,17 @@ get_packet(void)
 		}
 	}
 
-	return &buf;
+	return buf;
 }
 
 static int
-get_rsp_char(void)
+get_rsp_char(MSIM_AVR *mcu)
 {
+	struct MSIM_AVR_RSP *rsp = mcu->rsp;
 	unsigned char c;
 	ssize_t bytes;
 
-	if (rsp.fcli == -1) {
+	if (rsp->fcli == -1) {
 		fprintf(stderr, "Attempt to read from unopened RSP "
 		        "client: Ignored\n");
 		return  -1;
@@ -875,7 +919,7 @@ get_rsp_char(void)
 	 * catastrophic failure.
 	 */
 	while (1) {
-		bytes = read(rsp.fcli, &c, sizeof c);
+		bytes = read(rsp->fcli, &c, sizeof c);
 
 		if (bytes == sizeof c) {
 			return c&0xFF;
@@ -890,19 +934,21 @@ get_rsp_char(void)
 			fprintf(stderr, "Failed to read from RSP client: "
 			        "Closing client connection: %s\n",
 			        strerror(errno));
-			rsp_close_client();
+			rsp_close_client(mcu);
 			return -1;
 		} else {
-			rsp_close_client();
+			rsp_close_client(mcu);
 			return -1;
 		}
 	}
 }
 
 static void
-put_rsp_char(char c)
+put_rsp_char(MSIM_AVR *mcu, char c)
 {
-	if (rsp.fcli == -1) {
+	struct MSIM_AVR_RSP *rsp = mcu->rsp;
+
+	if (rsp->fcli == -1) {
 		fprintf(stderr, "Attempt to write '%c' to unopened RSP "
 		        "client: Ignored\n", c);
 		return;
@@ -913,7 +959,7 @@ put_rsp_char(char c)
 	 * catastrophic failure.
 	 */
 	while (1) {
-		switch (write(rsp.fcli, &c, sizeof c)) {
+		switch (write(rsp->fcli, &c, sizeof c)) {
 		case -1:
 			/* Error: only allow interrupts or would block */
 			if (errno == EAGAIN || errno == EINTR) {
@@ -923,7 +969,7 @@ put_rsp_char(char c)
 			fprintf(stderr, "Failed to write to RSP client: "
 			        "Closing client connection: %s\n",
 			        strerror(errno));
-			rsp_close_client();
+			rsp_close_client(mcu);
 			return;
 		case 0:
 			break;		/* Nothing written! Try again */
@@ -1001,7 +1047,7 @@ put_packet(MSIM_AVR *mcu, rsp_buf *buf)
 	do {
 		uint8_t checksum = 0;
 
-		put_rsp_char('$');		/* Start of the packet */
+		put_rsp_char(mcu, '$');	/* Start of the packet */
 
 		/* Body of the packet */
 		for (count = 0; count < buf->len; count++) {
@@ -1011,19 +1057,19 @@ put_packet(MSIM_AVR *mcu, rsp_buf *buf)
 			                ('*' == c) || ('}' == c)) {
 				c ^= 0x20;
 				checksum = (uint8_t)(checksum + (uint8_t)'}');
-				put_rsp_char('}');
+				put_rsp_char(mcu, '}');
 			}
 			checksum = (uint8_t)(checksum + (uint8_t)c);
-			put_rsp_char(c);
+			put_rsp_char(mcu, c);
 		}
 
-		put_rsp_char ('#');		/* End char */
+		put_rsp_char(mcu, '#');	/* End char */
 		/* Computed checksum */
-		put_rsp_char(hexchars[checksum >> 4]);
-		put_rsp_char(hexchars[checksum % 16]);
+		put_rsp_char(mcu, hexchars[checksum >> 4]);
+		put_rsp_char(mcu, hexchars[checksum % 16]);
 
 		/* Check for ack of connection failure */
-		ch = get_rsp_char();
+		ch = get_rsp_char(mcu);
 		if (ch == -1) {
 			return;			/* Fail the put silently. */
 		}
@@ -1033,12 +1079,13 @@ put_packet(MSIM_AVR *mcu, rsp_buf *buf)
 static void
 rsp_report_exception(MSIM_AVR *mcu)
 {
+	struct MSIM_AVR_RSP *rsp = mcu->rsp;
 	struct rsp_buf buf;
 
 	/* Construct a signal received packet */
 	buf.data[0] = 'S';
-	buf.data[1] = hexchars[rsp.sigval >> 4];
-	buf.data[2] = hexchars[rsp.sigval % 16];
+	buf.data[1] = hexchars[rsp->sigval >> 4];
+	buf.data[2] = hexchars[rsp->sigval % 16];
 	buf.data[3] = 0;
 	buf.len = strlen(buf.data);
 
@@ -1046,15 +1093,16 @@ rsp_report_exception(MSIM_AVR *mcu)
 }
 
 static void
-rsp_continue(struct rsp_buf *buf)
+rsp_continue(MSIM_AVR *mcu, rsp_buf *buf)
 {
+	struct MSIM_AVR_RSP *rsp = mcu->rsp;
 	uint32_t addr;
 
 	if (sscanf(buf->data, "c%" SCNx32, &addr) == 1) {
-		rsp.mcu->pc = (addr >> 1);
+		mcu->pc = (addr >> 1);
 	}
-	rsp.mcu->state = AVR_RUNNING;
-	rsp.client_waiting = 1;
+	mcu->state = AVR_RUNNING;
+	rsp->client_waiting = 1;
 }
 
 static void
@@ -1082,7 +1130,8 @@ rsp_query(MSIM_AVR *mcu, rsp_buf *buf)
 		 */
 		char reply[GDB_BUF_MAX];
 
-		snprintf(reply, GDB_BUF_MAX, "PacketSize=%X", GDB_BUF_MAX);
+		snprintf(reply, GDB_BUF_MAX, "PacketSize=%X;ReverseStep+;"
+		         "ReverseContinue+", GDB_BUF_MAX);
 		put_str_packet(mcu, reply);
 	} else if (!strncmp("qSymbol:", buf->data, strlen("qSymbol:"))) {
 		/*
@@ -1143,11 +1192,11 @@ rsp_vpkt(MSIM_AVR *mcu, rsp_buf *buf)
 		 * "vRun" should behave as though it has just stopped.
 		 * We use signal 5 (TRAP).
 		 */
-		rsp_restart();
+		rsp_restart(mcu);
 		put_str_packet(mcu, "S05");
 	} else if (!strncmp("vKill;", buf->data, strlen("vKill;"))) {
 		/* Restart MCU in stopped state on kill request */
-		rsp_restart();
+		rsp_restart(mcu);
 		put_str_packet(mcu, "OK");
 	} else {
 		fprintf(stderr, "Unknown RSP 'v' packet type %s: ignored\n",
@@ -1158,37 +1207,37 @@ rsp_vpkt(MSIM_AVR *mcu, rsp_buf *buf)
 }
 
 static void
-rsp_restart(void)
+rsp_restart(MSIM_AVR *mcu)
 {
-	rsp.mcu->pc = rsp.mcu->intr.reset_pc;
-	rsp.mcu->state = AVR_STOPPED;
+	mcu->pc = mcu->intr.reset_pc;
+	mcu->state = AVR_STOPPED;
 }
 
 static size_t
-read_reg(int n, char *buf, size_t blen)
+read_reg(MSIM_AVR *mcu, int n, char *buf, size_t blen)
 {
 	/*
 	 * This function reads registers in order required to reply to
 	 * GDB client. Remember that N is not an index in this case!
 	 */
 	if (n >= 0 && n <= 31) {	/* GPR0..31 */
-		snprintf(buf, blen, "%02X", rsp.mcu->dm[n]);
+		snprintf(buf, blen, "%02X", mcu->dm[n]);
 
 		return strlen(buf);
 	}
 
 	switch (n) {
 	case 32:			/* SREG */
-		snprintf(buf, blen, "%02X", *rsp.mcu->sreg);
+		snprintf(buf, blen, "%02X", *mcu->sreg);
 		break;
 	case 33:			/* SPH and SPL */
-		snprintf(buf, blen, "%02X%02X", *rsp.mcu->spl, *rsp.mcu->sph);
+		snprintf(buf, blen, "%02X%02X", *mcu->spl, *mcu->sph);
 		break;
 	case 34:			/* PC */
 		snprintf(buf, blen, "%02X%02X%02X00",
-		         (unsigned char)((rsp.mcu->pc << 1) & 0xFF),
-		         (unsigned char)(((rsp.mcu->pc << 1) >> 8) & 0xFF),
-		         (unsigned char)(((rsp.mcu->pc << 1) >> 16) & 0xFF));
+		         (unsigned char)((mcu->pc << 1) & 0xFF),
+		         (unsigned char)(((mcu->pc << 1) >> 8) & 0xFF),
+		         (unsigned char)(((mcu->pc << 1) >> 16) & 0xFF));
 		break;
 	}
 
@@ -1196,26 +1245,26 @@ read_reg(int n, char *buf, size_t blen)
 }
 
 static void
-write_reg(int n, char *buf)
+write_reg(MSIM_AVR *mcu, int n, char *buf)
 {
 	unsigned long v;
 
 	if (n >= 0 && n <= 31) {	/* GPR0..31 */
-		rsp.mcu->dm[n] = (unsigned char)hex2reg(buf, 2);
+		mcu->dm[n] = (unsigned char)hex2reg(buf, 2);
 		return;
 	}
 
 	switch (n) {
 	case 32:			/* SREG */
-		*rsp.mcu->sreg = (unsigned char)hex2reg(buf, 2);
+		*mcu->sreg = (unsigned char)hex2reg(buf, 2);
 		break;
 	case 33:			/* SPH and SPL */
 		v = hex2reg(buf, 4);
-		*rsp.mcu->sph = (unsigned char)(v&0xFF);
-		*rsp.mcu->spl = (unsigned char)((v>>8)&0xFF);
+		*mcu->sph = (unsigned char)(v&0xFF);
+		*mcu->spl = (unsigned char)((v>>8)&0xFF);
 		break;
 	case 34:			/* PC */
-		rsp.mcu->pc = (uint32_t) (hex2reg(buf, 8) >> 1);
+		mcu->pc = (uint32_t) (hex2reg(buf, 8) >> 1);
 		break;
 	}
 	return;
@@ -1230,7 +1279,7 @@ rsp_read_all_regs(MSIM_AVR *mcu)
 
 	rep = reply;
 	for (i = 0; i < 35; i++) {
-		rep += read_reg(i, rep, GDB_BUF_MAX);
+		rep += read_reg(mcu, i, rep, GDB_BUF_MAX);
 	}
 	*rep = 0;
 
@@ -1246,7 +1295,7 @@ rsp_write_all_regs(MSIM_AVR *mcu, rsp_buf *buf)
 	off = 0;
 	for (n = 0; n < 35; n++) {
 		if (n <= 31) { /* General purpose regs 0..31 */
-			rsp.mcu->dm[n] = (unsigned char)
+			mcu->dm[n] = (unsigned char)
 			                 hex2reg(buf->data+off, 2);
 			off += 2;
 			continue;
@@ -1254,18 +1303,18 @@ rsp_write_all_regs(MSIM_AVR *mcu, rsp_buf *buf)
 
 		switch (n) {
 		case 32: /* SREG */
-			*rsp.mcu->sreg = (unsigned char)
+			*mcu->sreg = (unsigned char)
 			                 hex2reg(buf->data+off, 2);
 			off += 2;
 			break;
 		case 33: /* SPH and SPL */
 			v = hex2reg(buf->data+off, 4);
 			off += 4;
-			*rsp.mcu->sph = (unsigned char)(v&0xFF);
-			*rsp.mcu->spl = (unsigned char)((v>>8)&0xFF);
+			*mcu->sph = (unsigned char)(v&0xFF);
+			*mcu->spl = (unsigned char)((v>>8)&0xFF);
 			break;
 		case 34: /* PC */
-			rsp.mcu->pc = (uint32_t)(hex2reg(buf->data+off, 8) >> 1);
+			mcu->pc = (uint32_t)(hex2reg(buf->data+off, 8) >> 1);
 			off += 8;
 			break;
 		}
@@ -1303,8 +1352,12 @@ rsp_read_mem(MSIM_AVR *mcu, rsp_buf *buf)
 	}
 
 	/* Find a memory to read from */
-	if (addr < rsp.mcu->flashend) {
-		pm = rsp.mcu->pm + (addr >> 1);
+	if (addr < mcu->flashend) {
+		/* Stay within the program memory */
+		if (len > (mcu->flashend + 1 - addr)) {
+			len = mcu->flashend + 1 - addr;
+		}
+		pm = mcu->pm + (addr >> 1);
 
 		/* Prepare bytes of the progmem */
 		for (i = 0; i < len; i += 2) {
@@ -1315,14 +1368,14 @@ rsp_read_mem(MSIM_AVR *mcu, rsp_buf *buf)
 		}
 		src = &tmp_buf[0];
 	} else if ((addr >= 0x800000) &&
-	                ((addr-0x800000) <= rsp.mcu->ramend)) {
-		src = rsp.mcu->dm + addr - 0x800000;
-	} else if (addr == (0x800000 + rsp.mcu->ramend+1) && len == 2) {
+	                ((addr-0x800000) <= mcu->ramend)) {
+		src = mcu->dm + addr - 0x800000;
+	} else if (addr == (0x800000 + mcu->ramend+1) && len == 2) {
 		put_str_packet(mcu, "0000");
 		return;
-	} else if (addr >= 0x810000 && (addr-0x810000) <= rsp.mcu->e2end) {
+	} else if (addr >= 0x810000 && (addr-0x810000) <= mcu->e2end) {
 		/* There should be a pointer to EEPROM */
-		//src = rsp.mcu->ee + addr - 0x810000;
+		//src = mcu->ee + addr - 0x810000;
 		put_str_packet(mcu, "E01");
 		return;
 	} else {
@@ -1351,7 +1404,7 @@ rsp_read_mem(MSIM_AVR *mcu, rsp_buf *buf)
 static void
 rsp_write_mem(MSIM_AVR *mcu, rsp_buf *buf)
 {
-	static uint8_t tmpbuf[GDB_BUF_MAX];
+	uint8_t *tmpbuf = mcu->rsp->mem;
 	uint64_t addr, datlen;
 	uint32_t len;
 	char *symdat;
@@ -1395,20 +1448,26 @@ rsp_write_mem(MSIM_AVR *mcu, rsp_buf *buf)
 	}
 
 	/* Find a memory to write to */
-	if (addr < rsp.mcu->flashend) {
-		pm = rsp.mcu->pm + (addr >> 1);
+	if (addr < mcu->flashend) {
+		/* Stay within the program memory */
+		if (len > (mcu->flashend + 1 - addr)) {
+			len = (uint32_t)(mcu->flashend + 1 - addr);
+		}
+		pm = mcu->pm + (addr >> 1);
 
 		for (uint32_t i = 0; i < (len >> 1); i++) {
 			pm[i] = (uint16_t)(
 			                ((tmpbuf[(i << 1) + 1] << 8) & 0xFF00) |
 			                (tmpbuf[(i << 1)] &0xFF));
 		}
+		MSIM_AVR_FlushDecoded(mcu, (uint32_t)(addr >> 1),
+		                      (uint32_t)(len >> 1));
 	} else if ((addr >= 0x800000) &&
-	                ((addr-0x800000) <= rsp.mcu->ramend)) {
-		dest = rsp.mcu->dm + addr - 0x800000;
-	} else if (addr >= 0x810000 && (addr-0x810000) <= rsp.mcu->e2end) {
+	                ((addr-0x800000) <= mcu->ramend)) {
+		dest = mcu->dm + addr - 0x800000;
+	} else if (addr >= 0x810000 && (addr-0x810000) <= mcu->e2end) {
 		/* There should be a pointer to EEPROM */
-		/*dest = rsp.mcu->ee + addr - 0x810000;*/
+		/*dest = mcu->ee + addr - 0x810000;*/
 		put_str_packet(mcu, "E01");
 		return;
 	} else {
@@ -1422,6 +1481,10 @@ rsp_write_mem(MSIM_AVR *mcu, rsp_buf *buf)
 
 	if (dest != NULL) {
 		memcpy(dest, tmpbuf, len);
+		/* Interrupt flags, ports or timers may have been changed */
+		mcu->intr.poll = 1;
+		mcu->io_sync = 1;
+		MSIM_AVR_TMRWake(mcu);
 	}
 
 	put_str_packet(mcu, "OK");
@@ -1464,20 +1527,26 @@ rsp_write_mem_bin(MSIM_AVR *mcu, rsp_buf *buf)
 	}
 
 	/* Find a memory to write to */
-	if (addr < rsp.mcu->flashend) {
-		pm = rsp.mcu->pm + (addr >> 1);
+	if (addr < mcu->flashend) {
+		/* Stay within the program memory */
+		if (len > (mcu->flashend + 1 - addr)) {
+			len = mcu->flashend + 1 - addr;
+		}
+		pm = mcu->pm + (addr >> 1);
 
 		for (uint32_t i = 0; i < (len >> 1); i++) {
 			pm[i] = (uint16_t)(
 			                ((bindat[(i << 1) + 1] << 8) & 0xFF00) |
 			                (bindat[(i << 1)] &0xFF));
 		}
+		MSIM_AVR_FlushDecoded(mcu, (uint32_t)(addr >> 1),
+		                      (uint32_t)(len >> 1));
 	} else if ((addr >= 0x800000) &&
-	                ((addr-0x800000) <= rsp.mcu->ramend)) {
-		dest = rsp.mcu->dm + addr - 0x800000;
-	} else if (addr >= 0x810000 && (addr-0x810000) <= rsp.mcu->e2end) {
+	                ((addr-0x800000) <= mcu->ramend)) {
+		dest = mcu->dm + addr - 0x800000;
+	} else if (addr >= 0x810000 && (addr-0x810000) <= mcu->e2end) {
 		/* There should be a pointer to EEPROM */
-		/*dest = rsp.mcu->ee + addr - 0x810000;*/
+		/*dest = mcu->ee + addr - 0x810000;*/
 		put_str_packet(mcu, "E01");
 		return;
 	} else {
@@ -1491,6 +1560,10 @@ rsp_write_mem_bin(MSIM_AVR *mcu, rsp_buf *buf)
 
 	if (dest != NULL) {
 		memcpy(dest, bindat, len);
+		/* Interrupt flags, ports or timers may have been changed */
+		mcu->intr.poll = 1;
+		mcu->io_sync = 1;
+		MSIM_AVR_TMRWake(mcu);
 	}
 
 	put_str_packet(mcu, "OK");
@@ -1526,8 +1599,159 @@ rsp_unescape(char *data, unsigned long len)
 }
 
 static void
-rsp_step(struct rsp_buf *buf)
+rsp_step(MSIM_AVR *mcu, rsp_buf *buf)
+{
+	struct MSIM_AVR_RSP *rsp = mcu->rsp;
+
+	mcu->state = AVR_MSIM_STEP;
+	rsp->client_waiting = 1;
+}
+
+/*
+ * MCU is executed in reverse by restoring the latest snapshot taken before
+ * the current cycle and replaying it forward: to the previous instruction
+ * (bs) or the latest instruction at a breakpoint (bc).
+ */
+static void
+rsp_reverse(MSIM_AVR *mcu, rsp_buf *buf)
+{
+	struct MSIM_AVR_RSP *rsp = mcu->rsp;
+	const uint64_t tick = mcu->tick;
+	const char *reply = "S05";
+	const char *why;
+	uint64_t end = tick;
+	uint64_t prev, bp;
+	uint32_t i;
+	int rc = 0;
+
+	if ((buf->data[1] != 's') && (buf->data[1] != 'c')) {
+		put_str_packet(mcu, "");
+		return;
+	}
+
+	why = no_replay(mcu);
+	if (why != NULL) {
+		snprintf(LOG, LOGSZ, "MCU can't be executed in reverse: %s",
+		         why);
+		MSIM_LOG_ERROR(LOG);
+		put_str_packet(mcu, "E01");
+		return;
+	}
+
+	/* Latest snapshot before the current cycle */
+	i = rsp->hist_num;
+	while ((i > 0U) && (hist_snap(mcu, i - 1)->state->tick >= tick)) {
+		i--;
+	}
+	if (i == 0U) {
+		put_str_packet(mcu, "T05replaylog:begin;");
+		return;
+	}
+	i--;
+
+	if (buf->data[1] == 's') {
+		rc = replay(mcu, i, tick, &prev, &bp);
+		rc = (rc == 0) ? replay(mcu, i, prev, &prev, &bp) : rc;
+	} else {
+		/* Snapshots are replayed back to the first one until there
+		 * is a breakpoint reached */
+		while (rc == 0) {
+			bp = UINT64_MAX;
+			rc = replay(mcu, i, end, &prev, &bp);
+			if ((rc == 0) && (bp != UINT64_MAX)) {
+				rc = replay(mcu, i, bp, &prev, &bp);
+				break;
+			}
+			if (i == 0U) {
+				rc = (rc == 0) ?
+				     replay(mcu, 0, 0, &prev, &bp) : rc;
+				reply = "T05replaylog:begin;";
+				break;
+			}
+			end = hist_snap(mcu, i)->state->tick;
+			i--;
+		}
+	}
+
+	/* Snapshots after the current cycle are taken again */
+	rsp->hist_num = i + 1;
+	rsp->hist_next = hist_snap(mcu, i)->state->tick + RSP_HIST_CYCLES;
+
+	/* Instruction at a breakpoint is executed once the MCU is resumed */
+	mcu->bp_hit = (uint8_t)(BP(mcu->pc) ? 1 : 0);
+	mcu->state = AVR_STOPPED;
+	rsp->sigval = 5;
+
+	put_str_packet(mcu, (rc == 0) ? reply : "E01");
+}
+
+/* Returns a snapshot by its index (from the oldest one). */
+static MSIM_AVR_Snap *
+hist_snap(MSIM_AVR *mcu, uint32_t i)
+{
+	struct MSIM_AVR_RSP *rsp = mcu->rsp;
+
+	return &rsp->hist[(rsp->hist_first + i) % RSP_HIST_SNAPS];
+}
+
+/*
+ * Returns the reason why the MCU can't be replayed from a snapshot or NULL.
+ * State of Lua models and data received from PTY aren't a part of the
+ * snapshot, so the replayed MCU would diverge from the original one.
+ */
+static const char *
+no_replay(MSIM_AVR *mcu)
+{
+	if (MSIM_AVR_LUAModels(mcu) > 0U) {
+		return "Lua models are loaded";
+	}
+	if ((mcu->pty != NULL) && (mcu->pty->master_fd >= 0)) {
+		return "USART is connected to PTY";
+	}
+	return NULL;
+}
+
+/*
+ * Restores the given snapshot and replays the MCU up to the given cycle.
+ * Cycles of the last instruction and the latest instruction at a breakpoint
+ * before the given cycle are returned. Breakpoints and BREAK instructions
+ * don't stop the MCU and VCD frames aren't dumped while it's replayed.
+ */
+static int
+replay(MSIM_AVR *mcu, uint32_t i, uint64_t tick, uint64_t *prev,
+       uint64_t *bp)
 {
-	rsp.mcu->state = AVR_MSIM_STEP;
-	rsp.client_waiting = 1;
+	FILE *dump = mcu->vcd->dump;
+	const uint32_t bp_num = mcu->bp_num;
+	int rc;
+
+	rc = MSIM_AVR_Restore(mcu, hist_snap(mcu, i));
+	if ((rc == 0) && ((mcu->state == AVR_STOPPED) ||
+	                  (mcu->state == AVR_MSIM_STEP) ||
+	                  (mcu->state == AVR_MSIM_STEPOVER))) {
+		mcu->state = AVR_RUNNING;
+	}
+
+	*prev = mcu->tick;
+	mcu->vcd->dump = NULL;
+	while ((rc == 0) && (mcu->tick < tick)) {
+		/* Multi-cycle instruction may be left incomplete */
+		if (mcu->ic_left == 0U) {
+			*prev = mcu->tick;
+			*bp = BP(mcu->pc) ? mcu->tick : *bp;
+		}
+
+		mcu->bp_num = 0;
+		rc = MSIM_AVR_SimRun(mcu, 1, 1);
+		mcu->bp_num = bp_num;
+
+		/* MCU stopped by BREAK isn't clocked, it was resumed by
+		 * the debugger to get further */
+		if ((rc == 0) && (mcu->state == AVR_STOPPED)) {
+			mcu->state = AVR_RUNNING;
+		}
+	}
+	mcu->vcd->dump = dump;
+
+	return rc;
 }
@@ -23,6 +23,7 @@
 
 #include "mcusim/mcusim.h"
 #include "mcusim/log.h"
+#include "mcusim/avr/sim/lua.h"
 #include "mcusim/avr/sim/private/macro.h"
 #include "mcusim/avr/sim/private/io_macro.h"
 
@@ -41,6 +42,13 @@ MSIM_AVR_IOSyncPinx(struct MSIM_AVR *mcu)
 {
 	MSIM_AVR_IOPort *p;
 	uint32_t portx, ddrx, pinx;
+	uint8_t sync = 0;
+
+	/* Nothing to do until registers of the ports are written (Lua
+	 * models write them directly) */
+	if ((mcu->io_sync == 0U) && (MSIM_AVR_LUAModels(mcu) == 0U)) {
+		return 0;
+	}
 
 	for (uint32_t i = 0; i < ARRSZ(mcu->ioports); i++) {
 		/* I/O port to work with */
@@ -56,6 +64,9 @@ MSIM_AVR_IOSyncPinx(struct MSIM_AVR *mcu)
 		if (p->pending == 1U) {
 			IOBIT_WR(mcu, &p->pin, p->ppin);
 			p->pending = 0;
+
+			/* Input capture pin of a timer may be changed */
+			MSIM_AVR_TMRWake(mcu);
 		}
 
 		/* Read PORTx, DDRx and PINx values */
@@ -65,8 +76,68 @@ MSIM_AVR_IOSyncPinx(struct MSIM_AVR *mcu)
 
 		/* Calculate a pending PINx value */
 		p->ppin = (uint8_t)((pinx & ~ddrx) | (portx & ddrx));
-		p->pending = 1;
+		if (p->ppin != pinx) {
+			p->pending = 1;
+			sync = 1;
+		}
 	}
 
+	/* PINx written above doesn't need to be synchronized again */
+	mcu->io_sync = sync;
+
 	return 0;
 }
+
+/* Register of the I/O port is written. */
+static void
+write_port(struct MSIM_AVR *mcu, uint32_t reg, uint8_t old)
+{
+	(void)reg;
+	(void)old;
+
+	mcu->io_sync = 1;
+}
+
+/*
+ * Watches PORTx, DDRx and PINx registers of the I/O ports in order to
+ * synchronize pins only after these registers are written.
+ */
+int
+MSIM_AVR_IOWatchPorts(struct MSIM_AVR *mcu)
+{
+	MSIM_AVR_IOPort *p;
+	uint32_t regs[3];
+	int rc = 0;
+
+	for (uint32_t i = 0; (rc == 0) && (i < ARRSZ(mcu->ioports)); i++) {
+		p = &mcu->ioports[i];
+		if (IS_IONOBYTE(p->port) || IS_IONOBYTE(p->ddr) ||
+		                IS_IONOBYTE(p->pin)) {
+			break;
+		}
+
+		regs[0] = p->port.reg;
+		regs[1] = p->ddr.reg;
+		regs[2] = p->pin.reg;
+		for (uint32_t k = 0; k < ARRSZ(regs); k++) {
+			if (!IS_IO(mcu, regs[k])) {
+				continue;
+			}
+			if ((mcu->ioregs[regs[k]].write != NULL) &&
+			                (mcu->ioregs[regs[k]].write != write_port)) {
+				snprintf(LOG, LOGSZ, "I/O register 0x%02" PRIX32
+				         " of the port is watched already",
+				         regs[k]);
+				MSIM_LOG_FATAL(LOG);
+				rc = -1;
+				break;
+			}
+			mcu->ioregs[regs[k]].write = write_port;
+		}
+	}
+
+	/* Pins are synchronized with the reset values at least once */
+	mcu->io_sync = 1;
+
+	return rc;
+}
@@ -0,0 +1,672 @@
+/*
+ * This file is part of MCUSim, an XSPICE library with microcontrollers.
+ *
+ * Copyright (C) 2017-2019 MCUSim Developers, see AUTHORS.txt for contributors.
+ *
+ * MCUSim is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MCUSim is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _POSIX_C_SOURCE 200112L
+#ifndef _DEFAULT_SOURCE
+#define _DEFAULT_SOURCE		/* MAP_ANONYMOUS isn't a part of POSIX */
+#endif
+
+/*
+ * Translation of the hot blocks to native code (JIT engine).
+ *
+ * Blocks are the loops executed while peripherals idle (see run_block).
+ * Instructions of a block are interpreted here the way the threaded engine
+ * does it, and the addresses the block is entered at (a jump back or an
+ * exit of a trace) are counted in the pre-decoded program memory. Once an
+ * address is hot, the straight sequence of the instructions which may be
+ * executed within a block is translated from it to a trace of x86-64 code.
+ *
+ * Simple instructions (LDI, MOV, MOVW and RJMP) are translated to native
+ * code and the other ones to calls of their handlers. Trace jumps to its
+ * instruction if the program counter is the next or the target one, and
+ * exits otherwise. An instruction which may access I/O is never a part of
+ * a trace, so it's performed by the simulation loop with the side effects
+ * of WRITE_DS and peripherals catch up with the cycles of the block before
+ * that.
+ *
+ * Traces are dropped once the program memory is modified (SPM, GDB, etc.,
+ * see MSIM_AVR_FlushDecoded) and the modified code is interpreted until it
+ * is hot again. Blocks aren't run here while breakpoints are set.
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#if defined(WITH_POSIX) && defined(__x86_64__)
+#include <sys/mman.h>
+#define JIT_X86_64		1
+#endif
+
+#include "mcusim/mcusim.h"
+#include "mcusim/log.h"
+#include "mcusim/avr/sim/private/macro.h"
+
+#ifndef MAP_ANONYMOUS
+#define MAP_ANONYMOUS		MAP_ANON
+#endif
+
+#define JIT_HOT			32	/* Entries to translate a block */
+#define JIT_MAXINSTS		64	/* Instructions of a trace, max */
+#define JIT_INSTSZ		128	/* Bytes of code per instruction */
+#define JIT_CACHESZ		(1024U * 1024U)	/* Bytes of code, max */
+#define JIT_NONE		UINT32_MAX	/* Trace can't be translated */
+#define JIT_EXIT		JIT_MAXINSTS	/* Index of the trace exit */
+
+/* Trace of native code. It returns a number of the cycles performed and
+ * exits before an instruction once the cycles exceed the limit or the
+ * program counter reaches the stop address. */
+typedef uint32_t (*jit_trace)(struct MSIM_AVR *mcu, uint32_t limit,
+                              uint32_t stop_pc);
+
+/* Code cache of the MCU. */
+typedef struct MSIM_AVR_JIT {
+	uint8_t *code;			/* Native code of the traces */
+	uint32_t used;			/* Bytes of the code used */
+	uint32_t *entry;		/* Trace offset + 1 by PM address */
+	uint32_t pm_size;		/* PM size, in 16-bits words */
+	uint32_t lo;			/* First PM word translated */
+	uint32_t hi;			/* Last PM word translated + 1 */
+} MSIM_AVR_JIT;
+
+static MSIM_AVR_JIT	*get_jit(struct MSIM_AVR *mcu);
+static void		drop_all(MSIM_AVR_JIT *jit);
+static jit_trace	find_trace(struct MSIM_AVR *mcu, MSIM_AVR_JIT *jit,
+			           uint32_t pc);
+static uint32_t		translate(struct MSIM_AVR *mcu, MSIM_AVR_JIT *jit,
+			          uint32_t pc);
+
+#ifdef JIT_X86_64
+/* Instruction of a trace. */
+typedef struct jit_inst {
+	MSIM_AVR_InstFunc exec;		/* Handler of the instruction */
+	uint32_t pc;			/* Address of the instruction */
+	uint32_t next;			/* Next instruction or JIT_NONE */
+	uint32_t jump;			/* Target instruction or JIT_NONE */
+	uint16_t inst;			/* Opcode (first 16-bit word) */
+	uint8_t sync;			/* SREG should be synced before */
+} jit_inst;
+
+/* Native code of a trace being translated. */
+typedef struct jit_buf {
+	uint8_t *code;			/* Code of the trace */
+	uint32_t len;			/* Length of the code */
+	uint32_t label[JIT_EXIT + 1];	/* Offsets of the instructions */
+	uint32_t fix[JIT_MAXINSTS * 6];	/* Jumps to be resolved */
+	uint32_t fix_to[JIT_MAXINSTS * 6];
+	uint32_t fix_num;
+} jit_buf;
+
+static uint32_t		scan(struct MSIM_AVR *mcu, uint32_t pc,
+			     jit_inst *ti);
+static void		emit_inst(jit_buf *b, const jit_inst *ti,
+			          uint32_t num, uint32_t i);
+static int		emit_native(jit_buf *b, const jit_inst *t,
+			            uint32_t *pc);
+static uint32_t		find_inst(const jit_inst *ti, uint32_t num,
+			          uint32_t pc);
+static void		put_code(jit_buf *b, const uint8_t *code,
+			         uint32_t len);
+static void		put8(jit_buf *b, uint32_t v);
+static void		put32(jit_buf *b, uint32_t v);
+static void		put64(jit_buf *b, uint64_t v);
+static void		put_mcu(jit_buf *b, uint32_t op, uint32_t reg,
+			        size_t off);
+static void		put_jump(jit_buf *b, uint8_t cc, uint32_t to);
+
+/* Trace starts with: push rbx, r12, r13, r14; sub rsp, 8 (stack is aligned
+ * to call handlers); mov rbx, rdi (MCU); mov r12d, esi (limit of cycles);
+ * mov r14d, edx (stop address); xor r13d, r13d (cycles performed). */
+static const uint8_t prologue[] = {
+	0x53, 0x41, 0x54, 0x41, 0x55, 0x41, 0x56, 0x48, 0x83, 0xEC, 0x08,
+	0x48, 0x89, 0xFB, 0x41, 0x89, 0xF4, 0x41, 0x89, 0xD6,
+	0x45, 0x31, 0xED
+};
+
+/* Trace exits with: mov eax, r13d; add rsp, 8; pop r14, r13, r12, rbx;
+ * ret */
+static const uint8_t epilogue[] = {
+	0x44, 0x89, 0xE8, 0x48, 0x83, 0xC4, 0x08,
+	0x41, 0x5E, 0x41, 0x5D, 0x41, 0x5C, 0x5B, 0xC3
+};
+#endif
+
+/* Checks whether blocks are translated to native code on this platform. */
+int
+MSIM_AVR_JITAvail(void)
+{
+#ifdef JIT_X86_64
+	return 1;
+#else
+	return 0;
+#endif
+}
+
+/*
+ * Executes instructions of a block (see MSIM_AVR_StepBlock) by the traces
+ * of native code or interprets them until they're hot. Returns a number
+ * of the cycles performed.
+ */
+uint32_t
+MSIM_AVR_JITRun(struct MSIM_AVR *mcu, uint32_t cycles, uint32_t stop_pc)
+{
+	MSIM_AVR_JIT *jit = get_jit(mcu);
+	MSIM_AVR_InstFunc exec;
+	jit_trace trace;
+	uint32_t n = 0;
+	uint32_t prev;
+	uint16_t inst;
+	uint8_t sync;
+	uint8_t head = 1;
+
+	while (((cycles - n) >= MSIM_AVR_BLOCK_MAXCYCLES) &&
+	                (mcu->pc != stop_pc)) {
+		/* Block is entered at the first instruction, by a jump
+		 * back or by an exit of a trace */
+		trace = (head != 0U) ? find_trace(mcu, jit, mcu->pc) : NULL;
+		if (trace != NULL) {
+			n += trace(mcu, cycles - n - MSIM_AVR_BLOCK_MAXCYCLES,
+			           stop_pc);
+			continue;
+		}
+
+		exec = MSIM_AVR_BlockInst(mcu, mcu->pc, &inst, &sync);
+		if (exec == NULL) {
+			break;
+		}
+		if ((sync != 0U) && (mcu->lsr.pend != 0U)) {
+			MSIM_AVR_SyncSREG(mcu);
+		}
+
+		prev = mcu->pc;
+		mcu->block_cycles = 1;
+		exec(mcu, inst);
+		n += mcu->block_cycles;
+		head = (uint8_t)((mcu->pc <= prev) ? 1 : 0);
+	}
+
+	return n;
+}
+
+/* Drops traces of the program memory in the given range (in 16-bits
+ * words). It's called once the program memory is modified. */
+void
+MSIM_AVR_JITFlush(struct MSIM_AVR *mcu, uint32_t addr, uint32_t words)
+{
+	MSIM_AVR_JIT *jit = mcu->jit;
+
+	if ((jit != NULL) && (addr < jit->hi) && ((addr + words) > jit->lo)) {
+		drop_all(jit);
+	}
+}
+
+/* Releases the code cache of the MCU. */
+void
+MSIM_AVR_JITFree(struct MSIM_AVR *mcu)
+{
+	MSIM_AVR_JIT *jit = mcu->jit;
+
+	if (jit != NULL) {
+#ifdef JIT_X86_64
+		munmap(jit->code, JIT_CACHESZ);
+#endif
+		free(jit->entry);
+		free(jit);
+		mcu->jit = NULL;
+	}
+}
+
+/* Returns the code cache of the MCU, it's allocated on the first use. */
+static MSIM_AVR_JIT *
+get_jit(struct MSIM_AVR *mcu)
+{
+	MSIM_AVR_JIT *jit = mcu->jit;
+
+	do {
+		if (jit != NULL) {
+			break;
+		}
+		jit = calloc(1, sizeof *jit);
+		if (jit == NULL) {
+			break;
+		}
+		jit->entry = calloc(mcu->pm_size, sizeof *jit->entry);
+		jit->pm_size = mcu->pm_size;
+#ifdef JIT_X86_64
+		jit->code = mmap(NULL, JIT_CACHESZ, PROT_READ | PROT_WRITE,
+		                 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		jit->code = (jit->code == MAP_FAILED) ? NULL : jit->code;
+		if (jit->code == NULL) {
+			free(jit->entry);
+			jit->entry = NULL;
+		}
+#endif
+		if (jit->entry == NULL) {
+			MSIM_LOG_ERROR("failed to allocate memory for JIT, "
+			               "threaded engine is used");
+			mcu->engine = AVR_THREADED_ENGINE;
+			free(jit);
+			jit = NULL;
+			break;
+		}
+		drop_all(jit);
+		mcu->jit = jit;
+	} while (0);
+
+	return jit;
+}
+
+static void
+drop_all(MSIM_AVR_JIT *jit)
+{
+	memset(jit->entry, 0, jit->pm_size * sizeof *jit->entry);
+	jit->used = 0;
+	jit->lo = UINT32_MAX;
+	jit->hi = 0;
+}
+
+/*
+ * Returns a trace which starts at the given address. Entries of the
+ * address are counted until it's hot and the trace is translated then.
+ */
+static jit_trace
+find_trace(struct MSIM_AVR *mcu, MSIM_AVR_JIT *jit, uint32_t pc)
+{
+	MSIM_AVR_Inst *ci;
+	jit_trace trace = NULL;
+	uint8_t *code;
+	uint32_t e;
+
+	do {
+		if ((jit == NULL) || (pc >= jit->pm_size)) {
+			break;
+		}
+
+		e = jit->entry[pc];
+		if (e == 0U) {
+			ci = &mcu->dpm[pc];
+			if (ci->hits < JIT_HOT) {
+				ci->hits++;
+				break;
+			}
+			e = translate(mcu, jit, pc);
+			jit->entry[pc] = e;
+			jit->lo = (pc < jit->lo) ? pc : jit->lo;
+			jit->hi = (pc >= jit->hi) ? (pc + 1) : jit->hi;
+		}
+		if (e == JIT_NONE) {
+			break;
+		}
+
+		/* Code is converted the way dlsym() results are */
+		code = &jit->code[e - 1U];
+		memcpy(&trace, &code, sizeof trace);
+	} while (0);
+
+	return trace;
+}
+
+#ifdef JIT_X86_64
+/*
+ * Translates instructions from the given address to a trace in the code
+ * cache. Returns the offset of the trace + 1 or JIT_NONE.
+ */
+static uint32_t
+translate(struct MSIM_AVR *mcu, MSIM_AVR_JIT *jit, uint32_t pc)
+{
+	jit_inst ti[JIT_MAXINSTS];
+	jit_buf *b;
+	uint32_t num, off = JIT_NONE;
+
+	num = scan(mcu, pc, ti);
+	b = malloc(sizeof *b);
+	do {
+		if ((num == 0U) || (b == NULL)) {
+			break;
+		}
+		if ((jit->used + (num + 1U) * JIT_INSTSZ) > JIT_CACHESZ) {
+			drop_all(jit);
+		}
+		if (mprotect(jit->code, JIT_CACHESZ,
+		                PROT_READ | PROT_WRITE) != 0) {
+			break;
+		}
+
+		b->code = &jit->code[jit->used];
+		b->len = 0;
+		b->fix_num = 0;
+
+		put_code(b, prologue, (uint32_t)sizeof prologue);
+		for (uint32_t i = 0; i < num; i++) {
+			emit_inst(b, ti, num, i);
+		}
+
+		b->label[JIT_EXIT] = b->len;
+		put_code(b, epilogue, (uint32_t)sizeof epilogue);
+
+		/* Jumps are resolved once the labels are known */
+		for (uint32_t i = 0; i < b->fix_num; i++) {
+			const uint32_t at = b->fix[i];
+			const uint32_t rel = b->label[b->fix_to[i]] -
+			                     (at + 4U);
+
+			for (uint32_t j = 0; j < 4U; j++) {
+				b->code[at + j] = (uint8_t)(rel >> (j * 8U));
+			}
+		}
+
+		off = jit->used + 1U;
+		jit->used += (b->len + 15U) & ~15U;
+		jit->lo = (pc < jit->lo) ? pc : jit->lo;
+		jit->hi = ((ti[num - 1U].pc + 3U) > jit->hi) ?
+		          (ti[num - 1U].pc + 3U) : jit->hi;
+	} while (0);
+
+	if (mprotect(jit->code, JIT_CACHESZ, PROT_READ | PROT_EXEC) != 0) {
+		MSIM_LOG_ERROR("failed to protect code of JIT");
+		off = JIT_NONE;
+	}
+	free(b);
+
+	return off;
+}
+
+/*
+ * Collects instructions of a trace from the given address until an
+ * instruction which can't be executed within a block or an unconditional
+ * jump. Next and target addresses of the instructions are found also.
+ */
+static uint32_t
+scan(struct MSIM_AVR *mcu, uint32_t pc, jit_inst *ti)
+{
+	jit_inst *t;
+	uint32_t num = 0;
+	int32_t k;
+
+	while (num < JIT_MAXINSTS) {
+		t = &ti[num];
+		t->exec = MSIM_AVR_BlockInst(mcu, pc, &t->inst, &t->sync);
+		if (t->exec == NULL) {
+			break;
+		}
+		num++;
+
+		t->pc = pc;
+		t->next = pc + (MSIM_AVR_Is32(t->inst) ? 2U : 1U);
+		t->jump = JIT_NONE;
+
+		if ((t->inst & 0xF000U) == 0xC000U) {
+			/* RJMP */
+			k = (int32_t)(t->inst & 0x0FFFU);
+			k = (k >= 2048) ? (k - 4096) : k;
+			t->jump = (uint32_t)((int32_t)pc + k + 1);
+			t->next = JIT_NONE;
+		} else if ((t->inst & 0xF800U) == 0xF000U) {
+			/* BRBS, BRBC */
+			k = (int32_t)((t->inst >> 3) & 0x7FU);
+			k = (k >= 64) ? (k - 128) : k;
+			t->jump = (uint32_t)((int32_t)pc + k + 1);
+		} else if (((t->inst & 0xFC00U) == 0x1000U) ||
+		                ((t->inst & 0xFC08U) == 0xFC00U)) {
+			/* CPSE, SBRC, SBRS */
+			t->jump = pc + (MSIM_AVR_Is32(PM(pc + 1)) ? 3U : 2U);
+		} else if ((t->inst & 0xFE0EU) == 0x940CU) {
+			/* JMP */
+			t->jump = ((((uint32_t)t->inst >> 3) & 0x3EU) |
+			           (t->inst & 1U)) << 16;
+			t->jump |= PM(pc + 1);
+			t->next = JIT_NONE;
+		} else if ((t->inst & 0xFFEFU) == 0x9409U) {
+			/* IJMP, EIJMP */
+			t->next = JIT_NONE;
+		} else {
+			/* Next instruction only */
+		}
+
+		/* Target is out of the program memory */
+		t->jump = (t->jump < mcu->pm_size) ? t->jump : JIT_NONE;
+
+		if (t->next == JIT_NONE) {
+			break;
+		}
+		pc = t->next;
+	}
+
+	return num;
+}
+
+/*
+ * Translates an instruction of the trace. Cycles left and the stop address
+ * are checked before the instruction, the next instruction of the trace is
+ * jumped to after it (or the trace exits).
+ */
+static void
+emit_inst(jit_buf *b, const jit_inst *ti, uint32_t num, uint32_t i)
+{
+	const jit_inst *t = &ti[i];
+	const uint32_t next = ((i + 1U) < num) ? ti[i + 1U].pc : JIT_NONE;
+	uint32_t pc, to;
+
+	b->label[i] = b->len;
+
+	/* cmp r13d, r12d; ja exit */
+	put8(b, 0x45);
+	put8(b, 0x39);
+	put8(b, 0xE5);
+	put_jump(b, 0x87, JIT_EXIT);
+	/* cmp r14d, pc; je exit */
+	put8(b, 0x41);
+	put8(b, 0x81);
+	put8(b, 0xFE);
+	put32(b, t->pc);
+	put_jump(b, 0x84, JIT_EXIT);
+
+	if (emit_native(b, t, &pc) != 0) {
+		/* Program counter is known already */
+		to = find_inst(ti, num, pc);
+		if ((pc != next) || (to == JIT_NONE)) {
+			put_jump(b, 0, (to != JIT_NONE) ? to : JIT_EXIT);
+		}
+		return;
+	}
+
+	if (t->sync != 0U) {
+		/* cmp byte [rbx+pend], 0; je +15;
+		 * mov rdi, rbx; mov rax, MSIM_AVR_SyncSREG; call rax */
+		put_mcu(b, 0x80, 7, offsetof(struct MSIM_AVR, lsr.pend));
+		put8(b, 0x00);
+		put8(b, 0x74);
+		put8(b, 0x0F);
+		put8(b, 0x48);
+		put8(b, 0x89);
+		put8(b, 0xDF);
+		put8(b, 0x48);
+		put8(b, 0xB8);
+		put64(b, (uint64_t)(uintptr_t)MSIM_AVR_SyncSREG);
+		put8(b, 0xFF);
+		put8(b, 0xD0);
+	}
+
+	/* mov dword [rbx+block_cycles], 1 */
+	put_mcu(b, 0xC7, 0, offsetof(struct MSIM_AVR, block_cycles));
+	put32(b, 1);
+	/* mov rdi, rbx; mov esi, inst; mov rax, handler; call rax */
+	put8(b, 0x48);
+	put8(b, 0x89);
+	put8(b, 0xDF);
+	put8(b, 0xBE);
+	put32(b, t->inst);
+	put8(b, 0x48);
+	put8(b, 0xB8);
+	put64(b, (uint64_t)(uintptr_t)t->exec);
+	put8(b, 0xFF);
+	put8(b, 0xD0);
+	/* add r13d, [rbx+block_cycles] */
+	put8(b, 0x44);
+	put_mcu(b, 0x03, 5, offsetof(struct MSIM_AVR, block_cycles));
+	/* mov eax, [rbx+pc] */
+	put_mcu(b, 0x8B, 0, offsetof(struct MSIM_AVR, pc));
+
+	/* cmp eax, target; je target */
+	to = find_inst(ti, num, t->jump);
+	if ((t->jump != JIT_NONE) && (to != JIT_NONE)) {
+		put8(b, 0x3D);
+		put32(b, t->jump);
+		put_jump(b, 0x84, to);
+	}
+	/* cmp eax, next; jne exit */
+	if ((t->next != JIT_NONE) && (t->next == next)) {
+		put8(b, 0x3D);
+		put32(b, next);
+		put_jump(b, 0x85, JIT_EXIT);
+	} else {
+		put_jump(b, 0, JIT_EXIT);
+	}
+}
+
+/*
+ * Translates an instruction which accesses the general purpose registers
+ * only to native code. Returns 0 if the instruction should be performed by
+ * its handler.
+ */
+static int
+emit_native(jit_buf *b, const jit_inst *t, uint32_t *pc)
+{
+	const size_t dm = offsetof(struct MSIM_AVR, dm);
+	const uint32_t inst = t->inst;
+	uint32_t cycles = 1;
+	uint32_t rd, rr;
+
+	if ((inst & 0xF000U) == 0xE000U) {
+		/* LDI: mov byte [rbx+rd], K */
+		rd = 0x10U + ((inst >> 4) & 0x0FU);
+		put_mcu(b, 0xC6, 0, dm + rd);
+		put8(b, (inst & 0x0FU) | ((inst >> 4) & 0xF0U));
+		*pc = t->next;
+	} else if ((inst & 0xFC00U) == 0x2C00U) {
+		/* MOV: movzx eax, byte [rbx+rr]; mov [rbx+rd], al */
+		rr = ((inst & 0x200U) >> 5) | (inst & 0x0FU);
+		rd = (inst & 0x1F0U) >> 4;
+		put8(b, 0x0F);
+		put_mcu(b, 0xB6, 0, dm + rr);
+		put_mcu(b, 0x88, 0, dm + rd);
+		*pc = t->next;
+	} else if ((inst & 0xFF00U) == 0x0100U) {
+		/* MOVW: movzx eax, word [rbx+rr]; mov [rbx+rd], ax */
+		rr = (inst & 0x0FU) << 1;
+		rd = ((inst >> 4) & 0x0FU) << 1;
+		put8(b, 0x0F);
+		put_mcu(b, 0xB7, 0, dm + rr);
+		put8(b, 0x66);
+		put_mcu(b, 0x89, 0, dm + rd);
+		*pc = t->next;
+	} else if (((inst & 0xF000U) == 0xC000U) && (t->jump != JIT_NONE)) {
+		/* RJMP */
+		cycles = 2;
+		*pc = t->jump;
+	} else {
+		return 0;
+	}
+
+	/* mov dword [rbx+pc], pc; add r13d, cycles */
+	put_mcu(b, 0xC7, 0, offsetof(struct MSIM_AVR, pc));
+	put32(b, *pc);
+	put8(b, 0x41);
+	put8(b, 0x83);
+	put8(b, 0xC5);
+	put8(b, cycles);
+
+	return 1;
+}
+
+/* Returns index of the instruction of the trace or JIT_NONE. */
+static uint32_t
+find_inst(const jit_inst *ti, uint32_t num, uint32_t pc)
+{
+	for (uint32_t i = 0; i < num; i++) {
+		if (ti[i].pc == pc) {
+			return i;
+		}
+	}
+	return JIT_NONE;
+}
+
+static void
+put_code(jit_buf *b, const uint8_t *code, uint32_t len)
+{
+	memcpy(&b->code[b->len], code, len);
+	b->len += len;
+}
+
+static void
+put8(jit_buf *b, uint32_t v)
+{
+	b->code[b->len++] = (uint8_t)v;
+}
+
+static void
+put32(jit_buf *b, uint32_t v)
+{
+	for (uint32_t i = 0; i < 4U; i++) {
+		put8(b, v >> (i * 8U));
+	}
+}
+
+static void
+put64(jit_buf *b, uint64_t v)
+{
+	put32(b, (uint32_t)v);
+	put32(b, (uint32_t)(v >> 32));
+}
+
+/* Puts an opcode with [rbx+disp32] operand, i.e. a field of the MCU. */
+static void
+put_mcu(jit_buf *b, uint32_t op, uint32_t reg, size_t off)
+{
+	put8(b, op);
+	put8(b, 0x83U | ((reg & 7U) << 3));
+	put32(b, (uint32_t)off);
+}
+
+/* Puts a jump (condition code or 0) to the instruction of the trace. */
+static void
+put_jump(jit_buf *b, uint8_t cc, uint32_t to)
+{
+	if (cc == 0U) {
+		put8(b, 0xE9);
+	} else {
+		put8(b, 0x0F);
+		put8(b, cc);
+	}
+	b->fix[b->fix_num] = b->len;
+	b->fix_to[b->fix_num] = to;
+	b->fix_num++;
+	put32(b, 0);
+}
+#else
+static uint32_t
+translate(struct MSIM_AVR *mcu, MSIM_AVR_JIT *jit, uint32_t pc)
+{
+	/* Blocks are interpreted */
+	(void)mcu;
+	(void)jit;
+	(void)pc;
+	return JIT_NONE;
+}
+#endif
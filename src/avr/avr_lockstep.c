@@ -0,0 +1,323 @@
+/*
+ * This file is part of MCUSim, an XSPICE library with microcontrollers.
+ *
+ * Copyright (C) 2017-2019 MCUSim Developers, see AUTHORS.txt for contributors.
+ *
+ * MCUSim is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MCUSim is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Lockstep execution of two MCU instances with different engines.
+ *
+ * Reference instance is run cycle by cycle, the tested one is run as fast
+ * as it can be (blocks, skipped loops, etc.) or by instructions. Instances
+ * aren't compared after each instruction. They're compared after each run
+ * of N instructions or cycles and snapshots of both of them are taken
+ * while they're equal. Instances are restored from the snapshots and the
+ * run is halved to find the divergent instruction once they differ.
+ */
+#include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
+
+#include "mcusim/mcusim.h"
+#include "mcusim/log.h"
+#include "mcusim/avr/sim/snapshot.h"
+#include "mcusim/avr/sim/lockstep.h"
+
+static int	take_snaps(struct MSIM_AVR *ref, struct MSIM_AVR *test,
+		           struct MSIM_AVR_Snap *snaps);
+static uint64_t	run(struct MSIM_AVR *ref, struct MSIM_AVR *test,
+		    enum MSIM_AVR_LockstepMode mode, uint64_t len,
+		    uint64_t *inst, int *rc_ref, int *rc_test);
+static int	step_inst(struct MSIM_AVR *mcu);
+static int	locate(struct MSIM_AVR *ref, struct MSIM_AVR *test,
+		       struct MSIM_AVR_Snap *snaps,
+		       enum MSIM_AVR_LockstepMode mode, uint64_t from,
+		       uint64_t len, struct MSIM_AVR_Diverge *div);
+static uint32_t	compare(struct MSIM_AVR *ref, struct MSIM_AVR *test,
+		        int rc_ref, int rc_test,
+		        struct MSIM_AVR_Diverge *div);
+static void	add_val(struct MSIM_AVR_Diverge *div,
+		        enum MSIM_AVR_DivergeLoc loc, uint32_t addr,
+		        uint64_t ref, uint64_t test);
+static void	set_inst(struct MSIM_AVR *mcu, uint64_t inst,
+		         struct MSIM_AVR_Diverge *div);
+
+int
+MSIM_AVR_Lockstep(struct MSIM_AVR *ref, struct MSIM_AVR *test,
+                  enum MSIM_AVR_LockstepMode mode, uint64_t insts,
+                  uint32_t every, struct MSIM_AVR_Diverge *div)
+{
+	struct MSIM_AVR_Snap snaps[2];
+	uint64_t inst = 0, from, len, n;
+	int rc_ref, rc_test;
+	int rc = 0;
+
+	memset(snaps, 0, sizeof snaps);
+	memset(div, 0, sizeof *div);
+	every = (every > 0U) ? every : 1U;
+
+	do {
+		if ((ref->pm_size != test->pm_size) ||
+		                (ref->dm_size != test->dm_size)) {
+			MSIM_LOG_ERROR("MCUs to be run in lockstep should be "
+			               "of the same model");
+			rc = -1;
+			break;
+		}
+		if (take_snaps(ref, test, snaps) != 0) {
+			rc = -1;
+			break;
+		}
+
+		while (inst < insts) {
+			len = every;
+			if ((mode == AVR_LOCKSTEP_INST) &&
+			                ((insts - inst) < len)) {
+				len = insts - inst;
+			}
+
+			from = inst;
+			set_inst(ref, inst, div);
+			n = run(ref, test, mode, len, &inst, &rc_ref,
+			        &rc_test);
+
+			if (compare(ref, test, rc_ref, rc_test, div) > 0U) {
+				div->run = n;
+				rc = (n > 1U) ?
+				     locate(ref, test, snaps, mode, from, len,
+				            div) :
+				     1;
+				break;
+			}
+			if ((rc_ref != 0) || (n == 0U)) {
+				/* Both MCUs are stopped in the same state */
+				break;
+			}
+
+			if (take_snaps(ref, test, snaps) != 0) {
+				rc = -1;
+				break;
+			}
+		}
+	} while (0);
+
+	MSIM_AVR_SnapFree(&snaps[0]);
+	MSIM_AVR_SnapFree(&snaps[1]);
+
+	return rc;
+}
+
+static int
+take_snaps(struct MSIM_AVR *ref, struct MSIM_AVR *test,
+           struct MSIM_AVR_Snap *snaps)
+{
+	int rc = MSIM_AVR_Snapshot(ref, &snaps[0]);
+
+	if (rc == 0) {
+		rc = MSIM_AVR_Snapshot(test, &snaps[1]);
+	}
+	return rc;
+}
+
+/*
+ * Runs the tested MCU for the given number of instructions (cycles in run
+ * mode) and the reference MCU until it catches up with the cycles of the
+ * tested one. Returns a number of the instructions (cycles) performed by
+ * the tested MCU.
+ */
+static uint64_t
+run(struct MSIM_AVR *ref, struct MSIM_AVR *test,
+    enum MSIM_AVR_LockstepMode mode, uint64_t len, uint64_t *inst,
+    int *rc_ref, int *rc_test)
+{
+	const uint64_t tick = test->tick;
+	uint64_t n = 0, t;
+
+	*rc_ref = 0;
+	*rc_test = 0;
+
+	if (mode == AVR_LOCKSTEP_INST) {
+		while ((n < len) && (*rc_ref == 0) && (*rc_test == 0)) {
+			*rc_ref = step_inst(ref);
+			*rc_test = MSIM_AVR_SimInst(test, 1, NULL);
+			(*inst)++;
+			n++;
+		}
+		return n;
+	}
+
+	*rc_test = MSIM_AVR_SimRun(test, 1, len);
+	n = test->tick - tick;
+
+	/* Reference MCU is stepped once more to get the same result if
+	 * the tested one is stopped. It may stop counting cycles also. */
+	do {
+		t = ref->tick;
+		if ((t > test->tick) ||
+		                ((t == test->tick) && (*rc_test == 0))) {
+			break;
+		}
+		*rc_ref = step_inst(ref);
+		(*inst)++;
+	} while ((*rc_ref == 0) && (ref->tick != t));
+
+	return n;
+}
+
+/* Performs an instruction of the reference MCU cycle by cycle. */
+static int
+step_inst(struct MSIM_AVR *mcu)
+{
+	int rc;
+
+	do {
+		rc = MSIM_AVR_SimStep(mcu, 1);
+	} while ((rc == 0) && (mcu->ic_left > 0U));
+
+	return rc;
+}
+
+/*
+ * Restores both MCUs from the snapshots taken before the divergent run of
+ * the given length and halves it to find the divergent instruction. First
+ * half of the run is skipped if MCUs don't diverge within it. The shortest
+ * divergent run is reported if the divergence isn't reproduced by a single
+ * instruction.
+ */
+static int
+locate(struct MSIM_AVR *ref, struct MSIM_AVR *test,
+       struct MSIM_AVR_Snap *snaps, enum MSIM_AVR_LockstepMode mode,
+       uint64_t from, uint64_t len, struct MSIM_AVR_Diverge *div)
+{
+	struct MSIM_AVR_Diverge found = *div;
+	uint64_t inst, half, n;
+	uint8_t diverged = 0;
+	int rc_ref, rc_test;
+	int rc = 1;
+
+	while ((len > 0U) && (found.run > 1U)) {
+		if ((MSIM_AVR_Restore(ref, &snaps[0]) != 0) ||
+		                (MSIM_AVR_Restore(test, &snaps[1]) != 0)) {
+			rc = -1;
+			break;
+		}
+
+		inst = from;
+		half = (len > 1U) ? (len / 2U) : 1U;
+		set_inst(ref, inst, div);
+		n = run(ref, test, mode, half, &inst, &rc_ref, &rc_test);
+
+		if (compare(ref, test, rc_ref, rc_test, div) > 0U) {
+			div->run = n;
+			found = *div;
+			diverged = 1;
+			len = (half < len) ? half : 0U;
+		} else if ((rc_ref != 0) || (n == 0U)) {
+			break;
+		} else if (take_snaps(ref, test, snaps) != 0) {
+			rc = -1;
+			break;
+		} else {
+			from = inst;
+			len = (n < len) ? (len - n) : 0U;
+		}
+	}
+
+	if ((rc > 0) && (diverged == 0U)) {
+		MSIM_LOG_WARN("divergence of MCUs isn't reproduced from the "
+		              "snapshots, external models may affect them");
+	}
+	*div = found;
+
+	return rc;
+}
+
+/* Compares states of the MCUs and returns a number of differences. */
+static uint32_t
+compare(struct MSIM_AVR *ref, struct MSIM_AVR *test, int rc_ref,
+        int rc_test, struct MSIM_AVR_Diverge *div)
+{
+	const uint8_t *rdm = ref->dm;
+	const uint8_t *tdm = test->dm;
+	const uint16_t *rpm = ref->pm;
+	const uint16_t *tpm = test->pm;
+
+	div->vals_num = 0;
+
+	if (ref->pc != test->pc) {
+		add_val(div, AVR_DIVERGE_PC, 0, ref->pc, test->pc);
+	}
+	if (ref->tick != test->tick) {
+		add_val(div, AVR_DIVERGE_TICK, 0, ref->tick, test->tick);
+	}
+	if (ref->state != test->state) {
+		add_val(div, AVR_DIVERGE_STATE, 0, (uint64_t)ref->state,
+		        (uint64_t)test->state);
+	}
+	if (rc_ref != rc_test) {
+		add_val(div, AVR_DIVERGE_RESULT, 0, (uint64_t)rc_ref,
+		        (uint64_t)rc_test);
+	}
+
+	/* Registers, I/O registers (SREG, SP, etc.) and SRAM */
+	if (memcmp(rdm, tdm, ref->dm_size) != 0) {
+		for (uint32_t i = 0; i < ref->dm_size; i++) {
+			if (rdm[i] != tdm[i]) {
+				add_val(div, AVR_DIVERGE_DM, i, rdm[i],
+				        tdm[i]);
+			}
+		}
+	}
+
+	/* Program memory may be written by SPM */
+	if (memcmp(rpm, tpm, ref->pm_size * sizeof *rpm) != 0) {
+		for (uint32_t i = 0; i < ref->pm_size; i++) {
+			if (rpm[i] != tpm[i]) {
+				add_val(div, AVR_DIVERGE_PM, i, rpm[i],
+				        tpm[i]);
+			}
+		}
+	}
+
+	return div->vals_num;
+}
+
+static void
+add_val(struct MSIM_AVR_Diverge *div, enum MSIM_AVR_DivergeLoc loc,
+        uint32_t addr, uint64_t ref, uint64_t test)
+{
+	MSIM_AVR_DivergeVal *v;
+
+	if (div->vals_num < MSIM_AVR_DIVERGE_LOCS) {
+		v = &div->vals[div->vals_num++];
+		v->loc = loc;
+		v->addr = addr;
+		v->ref = ref;
+		v->test = test;
+	}
+}
+
+/* Instruction to be executed by the reference MCU. */
+static void
+set_inst(struct MSIM_AVR *mcu, uint64_t inst, struct MSIM_AVR_Diverge *div)
+{
+	div->inst = inst;
+	div->pc = mcu->pc;
+	div->tick = mcu->tick;
+	div->opcode[0] = (mcu->pc < mcu->pm_size) ? mcu->pm[mcu->pc] : 0;
+	div->opcode[1] = ((mcu->pc + 1U) < mcu->pm_size) ?
+	                 mcu->pm[mcu->pc + 1U] : 0;
+}
@@ -24,6 +24,7 @@
  * This file provides basic functions to load, run and unload these models.
  */
 #include <stdint.h>
+#include <stdlib.h>
 
 #include "mcusim/mcusim.h"
 #include "mcusim/log.h"
@@ -33,19 +34,31 @@
 #include "lualib.h"
 #include "lauxlib.h"
 
-static lua_State *lua_states[MSIM_AVR_LUAMODELS];
-static uint64_t models_num;
+static void	push_param(lua_State *l, const MSIM_AVR_LUAParam *p);
 
 int
-MSIM_AVR_LUALoadModel(struct MSIM_AVR *mcu, char *model)
+MSIM_AVR_LUALoadModel(struct MSIM_AVR *mcu, char *model,
+                      const MSIM_AVR_LUAParam *params, uint32_t params_num)
 {
+	const uint32_t i = mcu->lua_num;
+	lua_State **lua_states = mcu->lua;
 	uint8_t err = 0;
-	uint64_t i = models_num;
+
+	if (i >= MSIM_AVR_LUAMODELS) {
+		snprintf(LOG, LOGSZ, "cannot load model: %s, reason: too "
+		         "many models", model);
+		MSIM_LOG_ERROR(LOG);
+		return 1;
+	}
 
 	/* Initialize Lua */
 	lua_states[i] = luaL_newstate();
 	/* Load various Lua libraries */
 	luaL_openlibs(lua_states[i]);
+	/* Parameters are available while the model is being loaded */
+	for (uint32_t j = 0; j < params_num; j++) {
+		push_param(lua_states[i], &params[j]);
+	}
 
 	/* Load peripheral */
 	if (luaL_loadfile(lua_states[i], model) ||
@@ -55,7 +68,7 @@ MSIM_AVR_LUALoadModel(struct MSIM_AVR *mcu, char *model)
 		MSIM_LOG_ERROR(LOG);
 		err = 1;
 	} else {
-		models_num++;
+		mcu->lua_num++;
 		/* Register MCUSim API functions */
 		lua_pushcfunction(lua_states[i], MSIM_LUAF_AVRIOBit);
 		lua_setglobal(lua_states[i], "AVR_IOBit");
@@ -87,7 +100,8 @@ MSIM_AVR_LUALoadModel(struct MSIM_AVR *mcu, char *model)
 
 		/* Add registers available for the current MCU model to
 		 * the Lua state. */
-		for (uint32_t j = 0; j < MSIM_AVR_DMSZ; j++) {
+		for (uint32_t j = 0; j < (mcu->regs_num +
+		                          mcu->ioregs_num); j++) {
 			if (mcu->ioregs[j].off < 0) {
 				continue;
 			}
@@ -133,21 +147,53 @@ MSIM_AVR_LUALoadModel(struct MSIM_AVR *mcu, char *model)
 	return err;
 }
 
+/* Sets a global variable to the value of the parameter (a number if the
+ * value can be parsed as a number, a string otherwise). */
+static void
+push_param(lua_State *l, const MSIM_AVR_LUAParam *p)
+{
+	char *end;
+	long long ival;
+	double dval;
+
+	ival = strtoll(p->val, &end, 0);
+	if ((end != p->val) && (*end == 0)) {
+		lua_pushinteger(l, (lua_Integer)ival);
+	} else {
+		dval = strtod(p->val, &end);
+		if ((end != p->val) && (*end == 0)) {
+			lua_pushnumber(l, (lua_Number)dval);
+		} else {
+			lua_pushstring(l, p->val);
+		}
+	}
+	lua_setglobal(l, p->name);
+}
+
 void
-MSIM_AVR_LUACleanModels(void)
+MSIM_AVR_LUACleanModels(struct MSIM_AVR *mcu)
 {
-	for (uint64_t i = 0; i < models_num; i++) {
-		if (lua_states[i] != NULL) {
-			lua_close(lua_states[i]);
+	for (uint32_t i = 0; i < mcu->lua_num; i++) {
+		if (mcu->lua[i] != NULL) {
+			lua_close(mcu->lua[i]);
+			mcu->lua[i] = NULL;
 		}
 	}
-	models_num = 0;
+	mcu->lua_num = 0;
+}
+
+uint32_t
+MSIM_AVR_LUAModels(struct MSIM_AVR *mcu)
+{
+	return mcu->lua_num;
 }
 
 void
 MSIM_AVR_LUATickModels(struct MSIM_AVR *mcu)
 {
-	for (uint32_t i = 0; i < models_num; i++) {
+	lua_State **lua_states = mcu->lua;
+
+	for (uint32_t i = 0; i < mcu->lua_num; i++) {
 		if (lua_states[i] == NULL) {
 			break;
 		}
@@ -64,7 +64,7 @@ MSIM_LUAF_AVRRegBit(lua_State *L)
 
 	/* Model is trying to read something else. */
 	if (reg >= mcu->regs_num) {
-		snprintf(mcu->log, sizeof mcu->log, "lua model is reading "
+		snprintf(mcu->log, MSIM_AVR_LOGSZ, "lua model is reading "
 		         "bit of unknown register: %u", reg);
 		MSIM_LOG_ERROR(mcu->log);
 		lua_pushnil(L);
@@ -72,7 +72,7 @@ MSIM_LUAF_AVRRegBit(lua_State *L)
 	}
 	/* Model is trying to read unknown bit. */
 	if (bit >= 8) {
-		snprintf(mcu->log, sizeof mcu->log, "lua model is reading "
+		snprintf(mcu->log, MSIM_AVR_LOGSZ, "lua model is reading "
 		         "unknown bit of a register: %u", bit);
 		MSIM_LOG_ERROR(mcu->log);
 		lua_pushnil(L);
@@ -93,7 +93,7 @@ MSIM_LUAF_AVRIOBit(lua_State *L)
 	if ((mcu->ioregs_num == 0) ||
 	                (io_reg >= (mcu->sfr_off+mcu->ioregs_num)) ||
 	                (io_reg < mcu->sfr_off)) {
-		snprintf(mcu->log, sizeof mcu->log, "lua model is reading "
+		snprintf(mcu->log, MSIM_AVR_LOGSZ, "lua model is reading "
 		         "bit of unknown I/O register: %u", io_reg);
 		MSIM_LOG_ERROR(mcu->log);
 		lua_pushnil(L);
@@ -101,7 +101,7 @@ MSIM_LUAF_AVRIOBit(lua_State *L)
 	}
 	/* Model is trying to read unknown bit. */
 	if (bit >= 8) {
-		snprintf(mcu->log, sizeof mcu->log, "lua model is reading "
+		snprintf(mcu->log, MSIM_AVR_LOGSZ, "lua model is reading "
 		         "unknown bit: %u", bit);
 		MSIM_LOG_ERROR(mcu->log);
 		lua_pushnil(L);
@@ -119,7 +119,7 @@ MSIM_LUAF_AVRReadReg(lua_State *L)
 
 	/* Model is trying to read something else. */
 	if (reg >= mcu->regs_num) {
-		snprintf(mcu->log, sizeof mcu->log, "lua model is reading "
+		snprintf(mcu->log, MSIM_AVR_LOGSZ, "lua model is reading "
 		         "unknown register: %u", reg);
 		MSIM_LOG_ERROR(mcu->log);
 		lua_pushnil(L);
@@ -183,14 +183,14 @@ MSIM_LUAF_AVRSetRegBit(lua_State *L)
 
 	/* Model is trying to write something else. */
 	if (reg >= mcu->regs_num) {
-		snprintf(mcu->log, sizeof mcu->log, "lua model is writing "
+		snprintf(mcu->log, MSIM_AVR_LOGSZ, "lua model is writing "
 		         "bit of unknown register: %u", reg);
 		MSIM_LOG_ERROR(mcu->log);
 		return 0;
 	}
 	/* Model is trying to write unknown bit. */
 	if (bit >= 8) {
-		snprintf(mcu->log, sizeof mcu->log, "lua model is writing "
+		snprintf(mcu->log, MSIM_AVR_LOGSZ, "lua model is writing "
 		         "unknown bit of a register: %u", bit);
 		MSIM_LOG_ERROR(mcu->log);
 		return 0;
@@ -215,14 +215,14 @@ MSIM_LUAF_AVRSetIOBit(lua_State *L)
 	if ((mcu->ioregs_num == 0) ||
 	                (io_reg >= (mcu->sfr_off+mcu->ioregs_num)) ||
 	                (io_reg < mcu->sfr_off)) {
-		snprintf(mcu->log, sizeof mcu->log, "lua model is writing "
+		snprintf(mcu->log, MSIM_AVR_LOGSZ, "lua model is writing "
 		         "bit of unknown I/O register: %u", io_reg);
 		MSIM_LOG_ERROR(mcu->log);
 		return 0;
 	}
 	/* Model is trying to write unknown bit. */
 	if (bit >= 8) {
-		snprintf(mcu->log, sizeof mcu->log, "lua model is writing "
+		snprintf(mcu->log, MSIM_AVR_LOGSZ, "lua model is writing "
 		         "unknown bit: %u", bit);
 		MSIM_LOG_ERROR(mcu->log);
 		return 0;
@@ -244,7 +244,7 @@ MSIM_LUAF_AVRWriteReg(lua_State *L)
 
 	/* Model is trying to write something else. */
 	if (reg >= mcu->regs_num) {
-		snprintf(mcu->log, sizeof mcu->log, "lua model is writing "
+		snprintf(mcu->log, MSIM_AVR_LOGSZ, "lua model is writing "
 		         "unknown register: %u", reg);
 		MSIM_LOG_ERROR(mcu->log);
 		return 0;
@@ -264,7 +264,7 @@ MSIM_LUAF_AVRWriteIO(lua_State *L)
 	if ((mcu->ioregs_num == 0) ||
 	                (io_reg >= (mcu->sfr_off+mcu->ioregs_num)) ||
 	                (io_reg < mcu->sfr_off)) {
-		snprintf(mcu->log, sizeof mcu->log, "lua model is writing "
+		snprintf(mcu->log, MSIM_AVR_LOGSZ, "lua model is writing "
 		         "unknown I/O register: %u", io_reg);
 		MSIM_LOG_ERROR(mcu->log);
 		return 0;
@@ -26,5 +26,5 @@
 int
 MSIM_M328Init(struct MSIM_AVR *mcu, struct MSIM_InitArgs *args)
 {
-	return mcu_init(&ORIG_M328, mcu, args);
+	return mcu_init(&ORIG_M328, NULL, 0, mcu, args);
 }
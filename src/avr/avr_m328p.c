@@ -36,37 +36,11 @@
 #define A_CHAN			79
 #define B_CHAN			80
 
-/* Initial PORTD and PIND values and to track PD4(T0) and PD5(T1). */
-static uint8_t init_portd;
-static uint8_t init_pind;
-
-static void update_watched(struct MSIM_AVR *mcu);
-
 int
 MSIM_M328PInit(struct MSIM_AVR *mcu, struct MSIM_InitArgs *args)
 {
-	int r = mcu_init(&ORIG_M328P, mcu, args);
-
-	if (r == 0) {
-		update_watched(mcu);
-	}
-	return r;
-}
-
-int
-MSIM_M328PUpdate(struct MSIM_AVR *mcu, struct MSIM_AVRConf *cnf)
-{
-	/* Update watched values after all of the peripherals. */
-	update_watched(mcu);
-
-	return 0;
-}
-
-static void
-update_watched(struct MSIM_AVR *mcu)
-{
-	init_portd = DM(PORTD);
-	init_pind = DM(PIND);
+	return mcu_init(&ORIG_M328P, TIMERS_M328P, ARRSZ(TIMERS_M328P),
+	                mcu, args);
 }
 
 int
@@ -79,7 +53,7 @@ MSIM_M328PSetFuse(struct MSIM_AVR *mcu, struct MSIM_AVRConf *cnf)
 
 	err = 0;
 	if (fuse_n > 2U) {
-		snprintf(mcu->log, sizeof mcu->log, "fuse #%u is not "
+		snprintf(mcu->log, MSIM_AVR_LOGSZ, "fuse #%u is not "
 		         "supported by %s", fuse_n, mcu->name);
 		MSIM_LOG_ERROR(mcu->log);
 		err = 1;
@@ -95,7 +69,7 @@ MSIM_M328PSetFuse(struct MSIM_AVR *mcu, struct MSIM_AVRConf *cnf)
 			if (cksel == 0U) {
 				mcu->clk_source = AVR_EXT_CLK;
 			} else if (cksel == 1U) {
-				snprintf(mcu->log, sizeof mcu->log,
+				snprintf(mcu->log, MSIM_AVR_LOGSZ,
 				         "CKSEL = %" PRIu8 ", is  "
 				         "reserved on ", cksel);
 				MSIM_LOG_ERROR(mcu->log);
@@ -122,7 +96,7 @@ MSIM_M328PSetFuse(struct MSIM_AVR *mcu, struct MSIM_AVRConf *cnf)
 					break;
 				default:
 					/* Should not happen! */
-					snprintf(mcu->log, sizeof mcu->log,
+					snprintf(mcu->log, MSIM_AVR_LOGSZ,
 					         "CKSEL = %" PRIu8 ", but it "
 					         "should be within [4,5] "
 					         "inclusively", cksel);
@@ -156,7 +130,7 @@ MSIM_M328PSetFuse(struct MSIM_AVR *mcu, struct MSIM_AVRConf *cnf)
 					break;
 				default:
 					/* Should not happen! */
-					snprintf(mcu->log, sizeof mcu->log,
+					snprintf(mcu->log, MSIM_AVR_LOGSZ,
 					         "CKSEL = %" PRIu8 ", but it "
 					         "should be 8, 11, 13 or 14"
 					         "to select a correct frequency"
@@ -195,7 +169,7 @@ MSIM_M328PSetFuse(struct MSIM_AVR *mcu, struct MSIM_AVRConf *cnf)
 				break;
 			default:
 				/* Should not happen! */
-				snprintf(mcu->log, sizeof mcu->log,
+				snprintf(mcu->log, MSIM_AVR_LOGSZ,
 				         "BOOTSZ1:0 = %" PRIu8 ", but it "
 				         "should be in [0,3] "
 				         "inclusively", bootsz);
@@ -40,33 +40,32 @@
 #define A_CHAN			79
 #define B_CHAN			80
 
-static uint8_t init_portd;	/* PORTD (buffer) */
-static uint8_t init_pind;	/* PIND (buffer) */
-static uint8_t init_portb;	/* PORTB (buffer) */
-static uint8_t init_pinb;	/* PINB (buffer) */
-
-static uint8_t ucsra_buf;	/* USART Control and Status A (buffer) */
-static uint8_t ucsrc_buf;	/* USART Control and Status C (buffer) */
-static uint8_t ubrrh_buf;	/* USART Baud Rate High (buffer) */
-static uint8_t ubrrl_buf;	/* USART Baud Rate Low (buffer) */
-static uint8_t udr_buf;		/* USART Data Register */
+/* USART exchanges data via a pseudo-terminal or with another MCU */
+#if defined(MSIM_POSIX) && defined(MSIM_POSIX_PTY)
+#define USART_CONNECTED(mcu)	1
+#else
+#define USART_CONNECTED(mcu)	((mcu)->usart_link != NULL)
+#endif
 
-static uint8_t spmcr_buf;	/* SPM Control Register */
-static uint8_t spmen_cycles = 0; /* Clean SPMEN bit in this number of cycles */
-static uint8_t spmen_clear = 0;	/* Flag to clear SPMEN in # of cycles */
+static void update_ubrr(struct MSIM_AVR *mcu);
+static void tick_spm(struct MSIM_AVR *mcu);
 
-static void update_watched(struct MSIM_AVR *mcu);
+static void write_ubrr(struct MSIM_AVR *mcu, uint32_t reg, uint8_t old);
+static void write_udr(struct MSIM_AVR *mcu, uint32_t reg, uint8_t old);
+static void read_udr(struct MSIM_AVR *mcu, uint32_t reg, uint8_t old);
+static void write_spmcr(struct MSIM_AVR *mcu, uint32_t reg, uint8_t old);
 
 static void tick_usart(struct MSIM_AVR *mcu);
-#if defined(MSIM_POSIX) && defined(MSIM_POSIX_PTY)
-	static void usart_transmit(struct MSIM_AVR *mcu);
-	static void usart_receive(struct MSIM_AVR *mcu);
-#endif
+static void usart_transmit(struct MSIM_AVR *mcu);
+static void usart_receive(struct MSIM_AVR *mcu);
+static int usart_write(struct MSIM_AVR *mcu, uint8_t *buf, uint32_t len);
+static int usart_read(struct MSIM_AVR *mcu, uint8_t *buf, uint32_t len);
 
 int
 MSIM_M8AInit(struct MSIM_AVR *mcu, struct MSIM_InitArgs *args)
 {
-	int rc = mcu_init(&ORIG_M8A, mcu, args);
+	int rc = mcu_init(&ORIG_M8A, TIMERS_M8A, ARRSZ(TIMERS_M8A), mcu,
+	                  args);
 	int r;
 
 	do {
@@ -83,25 +82,30 @@ MSIM_M8AInit(struct MSIM_AVR *mcu, struct MSIM_InitArgs *args)
 		DM(UCSRA) = 0x20;
 		DM(UCSRC) = 0x82;
 
-		/* Keep previous value of SPMCR */
+		/* Peripherals are notified when firmware accesses their
+		 * registers */
+		mcu->ioregs[UBRRL].write = write_ubrr;
+		mcu->ioregs[UBRRH].write = write_ubrr;
+		mcu->ioregs[UDR].write = write_udr;
+		mcu->ioregs[UDR].read = read_udr;
 		if (mcu->spmcsr != NULL) {
-			spmcr_buf = *mcu->spmcsr;
+			mcu->ioregs[SPMCR].write = write_spmcr;
 		}
 
-		update_watched(mcu);
+		update_ubrr(mcu);
 
 		/* Set USART registers */
-		ubrrh_buf = 0;
+		mcu->usart.ubrrh_buf = 0;
 
 		/* Create a pseudo-terminal for this MCU */
-		mcu->pty.master_fd = -1;
-		mcu->pty.slave_fd = -1;
-		mcu->pty.slave_name[0] = 0;
+		mcu->pty->master_fd = -1;
+		mcu->pty->slave_fd = -1;
+		mcu->pty->slave_name[0] = 0;
 
-		r = MSIM_PTY_Open(&mcu->pty);
+		r = (args->pty != 0U) ? MSIM_PTY_Open(mcu->pty) : 1;
 		if (r == 0) {
-			snprintf(mcu->log, sizeof mcu->log, "USART is "
-			         "available via: %s", mcu->pty.slave_name);
+			snprintf(mcu->log, MSIM_AVR_LOGSZ, "USART is "
+			         "available via: %s", mcu->pty->slave_name);
 			MSIM_LOG_INFO(mcu->log);
 		}
 	} while (0);
@@ -114,12 +118,52 @@ MSIM_M8AUpdate(struct MSIM_AVR *mcu, struct MSIM_AVRConf *cnf)
 {
 	tick_usart(mcu);
 
-	/* Update watched values after all of the peripherals. */
-	update_watched(mcu);
+	/* Update baud rate registers after all of the peripherals. */
+	if (mcu->usart.ubrr_writ == 1U) {
+		update_ubrr(mcu);
+		mcu->usart.ubrr_writ = 0;
+	}
+	tick_spm(mcu);
 
 	return 0;
 }
 
+/* USART counts down its Rx and Tx clocks, SPMEN bit may be waiting to be
+ * cleared, baud rate may be waiting to be loaded. Nothing else happens
+ * unless registers are written. */
+uint32_t
+MSIM_M8AIdle(struct MSIM_AVR *mcu, uint32_t cycles)
+{
+	uint32_t rx_ticks = mcu->usart.rx_ticks;
+	uint32_t tx_ticks = mcu->usart.tx_ticks;
+	uint32_t idle = cycles;
+
+	if ((mcu->spmen_clear == 1U) || (mcu->usart.ubrr_writ == 1U) ||
+	                (tx_ticks == 0U)) {
+		idle = 0;
+	} else {
+		idle = ((tx_ticks-1U) < idle) ? (tx_ticks-1U) : idle;
+	}
+
+	if (rx_ticks > 0U) {
+		idle = ((rx_ticks-1U) < idle) ? (rx_ticks-1U) : idle;
+	} else if (((DM(UCSRB)>>RXEN)&1) == 1U) {
+		idle = 0;
+	}
+
+	return idle;
+}
+
+uint32_t
+MSIM_M8ASkip(struct MSIM_AVR *mcu, uint32_t cycles)
+{
+	mcu->usart.tx_ticks -= cycles;
+	if (mcu->usart.rx_ticks > 0U) {
+		mcu->usart.rx_ticks -= cycles;
+	}
+	return cycles;
+}
+
 int
 MSIM_M8AResetSPM(struct MSIM_AVR *mcu, struct MSIM_AVRConf *cnf)
 {
@@ -128,53 +172,80 @@ MSIM_M8AResetSPM(struct MSIM_AVR *mcu, struct MSIM_AVRConf *cnf)
 		                           (uint8_t)(~(1<<SPMEN)));
 		/* Generate SPM_RDY interrupt */
 		if ((*mcu->spmcsr>>SPMIE)&1U) {
-			mcu->intr.irq[SPM_RDY_vect_num-1] = 1;
+			mcu->intr.irq |= MSIM_AVR_IRQ(SPM_RDY_vect_num-1);
 		}
 	}
 	return 0;
 }
 
 static void
-update_watched(struct MSIM_AVR *mcu)
+update_ubrr(struct MSIM_AVR *mcu)
 {
-	init_portd = DM(PORTD);
-	init_pind = DM(PIND);
-	init_portb = DM(PORTB);
-	init_pinb = DM(PINB);
-
 	/* NOTE: The UBRRH register shares the same I/O location as the
 	 * UCSRC Register (24.10. Accessing UBRRH/UCSRC Registers). It means
 	 * that URSEL (MSB bit) should be checked additionally to understand
 	 * which register should be updated */
 	if (((DM(UBRRH)>>URSEL)&1) == 0) {
-		ubrrh_buf = DM(UBRRH);
+		mcu->usart.ubrrh_buf = DM(UBRRH);
 	} else {
-		ucsrc_buf = DM(UCSRC);
+		mcu->usart.ucsrc_buf = DM(UCSRC);
 	}
-	ubrrl_buf = DM(UBRRL);
-	ucsra_buf = DM(UCSRA);
-	udr_buf = DM(UDR);
+	mcu->usart.ubrrl_buf = DM(UBRRL);
+}
 
-	/* Update SPMCR value and reset SPMEN bit if necessary */
-	if (mcu->spmcsr != NULL) {
-		if (spmen_clear == 1U) {
-			if (spmen_cycles == 0U) {
-				(*mcu->spmcsr) = (uint8_t)((*mcu->spmcsr) &
-				                           (uint8_t)(~(1<<SPMEN)));
-				spmen_clear = 0;
-				/* Generate SPM_RDY interrupt */
-				if ((*mcu->spmcsr>>SPMIE)&1U) {
-					mcu->intr.irq[SPM_RDY_vect_num-1] = 1;
-				}
-			} else {
-				spmen_cycles--;
+static void
+tick_spm(struct MSIM_AVR *mcu)
+{
+	/* Reset SPMEN bit if necessary */
+	if (mcu->spmen_clear == 1U) {
+		if (mcu->spmen_cycles == 0U) {
+			(*mcu->spmcsr) = (uint8_t)((*mcu->spmcsr) &
+			                           (uint8_t)(~(1<<SPMEN)));
+			mcu->spmen_clear = 0;
+			/* Generate SPM_RDY interrupt */
+			if ((*mcu->spmcsr>>SPMIE)&1U) {
+				mcu->intr.irq |=
+				        MSIM_AVR_IRQ(SPM_RDY_vect_num-1);
 			}
+		} else {
+			mcu->spmen_cycles--;
 		}
-		if (IS_RISE(spmcr_buf, *mcu->spmcsr, SPMEN)) {
-			spmen_cycles = 4;
-			spmen_clear = 1;
-		}
-		spmcr_buf = *mcu->spmcsr;
+	}
+}
+
+static void
+write_ubrr(struct MSIM_AVR *mcu, uint32_t reg, uint8_t old)
+{
+	/* Baud rate is loaded by USART on the next cycle */
+	mcu->usart.ubrr_writ = 1;
+}
+
+static void
+write_udr(struct MSIM_AVR *mcu, uint32_t reg, uint8_t old)
+{
+	/* UDR has been written with UDRE flag set. It means that the Transmit
+	 * Data Buffer Register (TXB) is a destination for data stored in the
+	 * UDR Register location. */
+	if (IS_SET(DM(UCSRA), UDRE) == 1U) {
+		mcu->usart.txb = DM(UDR);
+		/* Clear UDRE flag */
+		DM(UCSRA) = (uint8_t)(DM(UCSRA)&(uint8_t)(~(1<<UDRE)));
+	}
+}
+
+static void
+read_udr(struct MSIM_AVR *mcu, uint32_t reg, uint8_t old)
+{
+	DM(UCSRA) = (uint8_t)(DM(UCSRA)&(uint8_t)(~(1<<RXC)));
+}
+
+static void
+write_spmcr(struct MSIM_AVR *mcu, uint32_t reg, uint8_t old)
+{
+	/* SPMEN is cleared in four cycles counted from the next one */
+	if (IS_RISE(old, DM(reg), SPMEN)) {
+		mcu->spmen_cycles = 5;
+		mcu->spmen_clear = 1;
 	}
 }
 
@@ -193,9 +264,10 @@ tick_usart(struct MSIM_AVR *mcu)
 	uint32_t *baud = &mcu->usart.baud;
 	uint32_t *rx_presc = &mcu->usart.rx_presc;
 	uint32_t *tx_presc = &mcu->usart.tx_presc;
+	const uint8_t ubrrh_buf = mcu->usart.ubrrh_buf;
 	uint8_t mult = 1;
 
-	if ((ubrrl_buf != DM(UBRRL)) || (*tx_ticks == 0U)) {
+	if ((mcu->usart.ubrrl_buf != DM(UBRRL)) || (*tx_ticks == 0U)) {
 		/* Load a new baud rate value */
 		if (((DM(UBRRH)>>UMSEL)&1) == 0U) {
 			/* There is a UBRRH value stored in data memory after
@@ -234,28 +306,15 @@ tick_usart(struct MSIM_AVR *mcu)
 		*tx_ticks = *tx_presc;
 	}
 
-	/* UDR has been written with UDRE flag set. It means that the Transmit
-	 * Data Buffer Register (TXB) is a destination for data stored in the
-	 * UDR Register location. */
-	if ((IS_WRIT(mcu, UDR)) && (IS_SET(DM(UCSRA), UDRE) == 1U)) {
-		mcu->usart.txb = DM(UDR);
-		/* Clear UDRE flag */
-		DM(UCSRA) = (uint8_t)(DM(UCSRA)&(uint8_t)(~(1<<UDRE)));
-	}
-
-	if (IS_READ(mcu, UDR)) {
-		DM(UCSRA) = (uint8_t)(DM(UCSRA)&(uint8_t)(~(1<<RXC)));
-	}
-
 	/* Count-down Rx ticks */
 	if (*rx_ticks > 0) {
 		(*rx_ticks)--;
 	}
 	if ((*rx_ticks == 0U) && (((DM(UCSRB)>>RXEN)&1) == 1U)) {
 		/* Generate Rx clock */
-#if defined(MSIM_POSIX) && defined(MSIM_POSIX_PTY)
-		usart_receive(mcu);
-#endif
+		if (USART_CONNECTED(mcu)) {
+			usart_receive(mcu);
+		}
 		*rx_ticks = *rx_presc;
 	} else {
 		/* USART Rx inactive, do nothing */
@@ -267,23 +326,22 @@ tick_usart(struct MSIM_AVR *mcu)
 	}
 	if ((*tx_ticks == 0U) && (((DM(UCSRB)>>TXEN)&1) == 1U)) {
 		/* Generate Tx clock */
-#if defined(MSIM_POSIX) && defined(MSIM_POSIX_PTY)
-		usart_transmit(mcu);
-#endif
+		if (USART_CONNECTED(mcu)) {
+			usart_transmit(mcu);
+		}
 	} else {
 		/* USART Tx inactive, do nothing */
 	}
 }
 
-#if defined(MSIM_POSIX) && defined(MSIM_POSIX_PTY)
 static void
 usart_transmit(struct MSIM_AVR *mcu)
 {
 	uint8_t buf[2];
 	uint32_t buf_len = 1;
+	const uint8_t ucsrc_buf = mcu->usart.ucsrc_buf;
 	uint8_t ucsz;
 	uint8_t err = 0;
-	int written;
 
 	/* Find how many bits to transmit */
 	if (((DM(UBRRH)>>UMSEL)&1) == 0U) {
@@ -322,7 +380,7 @@ usart_transmit(struct MSIM_AVR *mcu)
 		buf_len = 2;
 		break;
 	default:
-		snprintf(mcu->log, sizeof mcu->log, "these bits to select "
+		snprintf(mcu->log, MSIM_AVR_LOGSZ, "these bits to select "
 		         "USART character size are reserved: UCSZ=0x%" PRIX8,
 		         ucsz);
 		MSIM_LOG_ERROR(mcu->log);
@@ -331,16 +389,10 @@ usart_transmit(struct MSIM_AVR *mcu)
 	}
 
 	if ((err == 0) && (IS_CLEAR(DM(UCSRA), UDRE) == 1)) {
-		if (mcu->pty.master_fd >= 0) {
-			written = MSIM_PTY_Write(&mcu->pty, buf, buf_len);
-			if (written != (int)buf_len) {
-				snprintf(mcu->log, sizeof mcu->log, "failed "
-				         "to feed PTY master with USART data, "
-				         "slave=%s", mcu->pty.slave_name);
-				MSIM_LOG_ERROR(mcu->log);
-			}
+		/* Data stays in the buffer until it can be sent */
+		if (usart_write(mcu, buf, buf_len) == 0) {
 #ifdef DEBUG
-			snprintf(mcu->log, sizeof mcu->log, "USART -> 0x%02"
+			snprintf(mcu->log, MSIM_AVR_LOGSZ, "USART -> 0x%02"
 			         PRIX8 ", pc=0x%06" PRIX32, buf[0], mcu->pc);
 			MSIM_LOG_DEBUG(mcu->log);
 #endif
@@ -348,9 +400,6 @@ usart_transmit(struct MSIM_AVR *mcu)
 			DM(UCSRA) |= (1<<UDRE);
 			/* Should TXC be cleared here? */
 			DM(UCSRA) |= (1<<TXC);
-		} else {
-			MSIM_LOG_DEBUG("cannot feed PTY master with USART "
-			               "data: master_fd < 0");
 		}
 	}
 }
@@ -361,6 +410,7 @@ usart_receive(struct MSIM_AVR *mcu)
 	uint8_t buf[2];
 	uint32_t buf_len = 1;
 	uint32_t mask;
+	const uint8_t ucsrc_buf = mcu->usart.ucsrc_buf;
 	uint8_t ucsz;
 	uint8_t err = 0;
 	int recv;
@@ -400,7 +450,7 @@ usart_receive(struct MSIM_AVR *mcu)
 		buf_len = 2;
 		break;
 	default:
-		snprintf(mcu->log, sizeof mcu->log, "these bits to select "
+		snprintf(mcu->log, MSIM_AVR_LOGSZ, "these bits to select "
 		         "USART character size are reserved: UCSZ=0x%" PRIX8,
 		         ucsz);
 		MSIM_LOG_ERROR(mcu->log);
@@ -409,33 +459,96 @@ usart_receive(struct MSIM_AVR *mcu)
 	}
 
 	if ((err == 0) && (IS_CLEAR(DM(UCSRA), RXC) == 1)) {
-		if (mcu->pty.master_fd >= 0) {
-			recv = MSIM_PTY_Read(&mcu->pty, buf, buf_len);
+		recv = usart_read(mcu, buf, buf_len);
 
-			if (recv == (int)buf_len) {
+		if (recv == (int)buf_len) {
 #ifdef DEBUG
-				snprintf(mcu->log, sizeof mcu->log, "USART <- "
-				         "0x%02" PRIX8 ", mask 0x%02" PRIX32,
-				         buf[0], mask);
-				MSIM_LOG_DEBUG(mcu->log);
+			snprintf(mcu->log, MSIM_AVR_LOGSZ, "USART <- "
+			         "0x%02" PRIX8 ", mask 0x%02" PRIX32,
+			         buf[0], mask);
+			MSIM_LOG_DEBUG(mcu->log);
 #endif
-				DM(UDR) = 0;
-				DM(UDR) = (uint8_t)(DM(UDR) |
-				                    (uint8_t)(buf[0]&mask));
-				DM(UCSRB) = (uint8_t)(DM(UCSRB) &
-				                      (uint8_t)(~(1<<TXB8)));
-				if ((buf_len == 2U) && ((buf[1]&1) == 1U)) {
-					DM(UCSRB) |= (1<<TXB8);
-				}
-				DM(UCSRA) |= (1<<RXC);
+			DM(UDR) = 0;
+			DM(UDR) = (uint8_t)(DM(UDR) | (uint8_t)(buf[0]&mask));
+			DM(UCSRB) = (uint8_t)(DM(UCSRB) &
+			                      (uint8_t)(~(1<<TXB8)));
+			if ((buf_len == 2U) && ((buf[1]&1) == 1U)) {
+				DM(UCSRB) |= (1<<TXB8);
+			}
+			DM(UCSRA) |= (1<<RXC);
+		}
+	}
+}
+
+/*
+ * Sends USART data to another MCU or a pseudo-terminal. Returns 0 if data
+ * has been sent, 1 if it should be sent later and -1 if there is no
+ * connection.
+ */
+static int
+usart_write(struct MSIM_AVR *mcu, uint8_t *buf, uint32_t len)
+{
+	struct MSIM_AVR_USARTLink *link = mcu->usart_link;
+	int rc = -1;
+
+	if (link != NULL) {
+		/* Another MCU takes data once it's paused */
+		if ((link->tx_len + len) <= MSIM_AVR_USARTLINK_BUFSZ) {
+			memcpy(&link->tx[link->tx_len], buf, len);
+			link->tx_len += len;
+			rc = 0;
+		} else {
+			rc = 1;
+		}
+	} else {
+#if defined(MSIM_POSIX) && defined(MSIM_POSIX_PTY)
+		if (mcu->pty->master_fd >= 0) {
+			if (MSIM_PTY_Write(mcu->pty, buf, len) != (int)len) {
+				snprintf(mcu->log, MSIM_AVR_LOGSZ, "failed "
+				         "to feed PTY master with USART data, "
+				         "slave=%s", mcu->pty->slave_name);
+				MSIM_LOG_ERROR(mcu->log);
 			}
+			rc = 0;
+		} else {
+			MSIM_LOG_DEBUG("cannot feed PTY master with USART "
+			               "data: master_fd < 0");
+		}
+#endif
+	}
+	return rc;
+}
+
+/*
+ * Receives USART data from another MCU or a pseudo-terminal. Returns
+ * a length of the received data (data isn't taken partially from another
+ * MCU) or -1 if there is no connection.
+ */
+static int
+usart_read(struct MSIM_AVR *mcu, uint8_t *buf, uint32_t len)
+{
+	struct MSIM_AVR_USARTLink *link = mcu->usart_link;
+	int rc = -1;
+
+	if (link != NULL) {
+		rc = 0;
+		if ((link->rx_len - link->rx_pos) >= len) {
+			memcpy(buf, &link->rx[link->rx_pos], len);
+			link->rx_pos += len;
+			rc = (int)len;
+		}
+	} else {
+#if defined(MSIM_POSIX) && defined(MSIM_POSIX_PTY)
+		if (mcu->pty->master_fd >= 0) {
+			rc = MSIM_PTY_Read(mcu->pty, buf, len);
 		} else {
 			MSIM_LOG_DEBUG("cannot read USART data from PTY "
 			               "master: master_fd < 0");
 		}
+#endif
 	}
+	return rc;
 }
-#endif /* defined(MSIM_POSIX) && defined(MSIM_POSIX_PTY) */
 
 int
 MSIM_M8ASetFuse(struct MSIM_AVR *mcu, struct MSIM_AVRConf *cnf)
@@ -447,7 +560,7 @@ MSIM_M8ASetFuse(struct MSIM_AVR *mcu, struct MSIM_AVRConf *cnf)
 
 	ret = 0;
 	if (fuse_n > 1U) {
-		snprintf(mcu->log, sizeof mcu->log, "fuse #%u is not "
+		snprintf(mcu->log, MSIM_AVR_LOGSZ, "fuse #%u is not "
 		         "supported by %s", fuse_n, mcu->name);
 		MSIM_LOG_ERROR(mcu->log);
 		ret = 1;
@@ -480,7 +593,7 @@ MSIM_M8ASetFuse(struct MSIM_AVR *mcu, struct MSIM_AVRConf *cnf)
 					break;
 				default:
 					/* Shouldn't happen! */
-					snprintf(mcu->log, sizeof mcu->log,
+					snprintf(mcu->log, MSIM_AVR_LOGSZ,
 					         "CKSEL = %" PRIu8 ", but it "
 					         "should be within [1,4] "
 					         "inclusively", cksel);
@@ -508,7 +621,7 @@ MSIM_M8ASetFuse(struct MSIM_AVR *mcu, struct MSIM_AVRConf *cnf)
 					break;
 				default:
 					/* Shouldn't happen! */
-					snprintf(mcu->log, sizeof mcu->log,
+					snprintf(mcu->log, MSIM_AVR_LOGSZ,
 					         "CKSEL = %" PRIu8 ", but it "
 					         "should be within [5,8] "
 					         "inclusively", cksel);
@@ -536,7 +649,7 @@ MSIM_M8ASetFuse(struct MSIM_AVR *mcu, struct MSIM_AVRConf *cnf)
 					mcu->freq = 8000000;
 					break;
 				default:
-					snprintf(mcu->log, sizeof mcu->log,
+					snprintf(mcu->log, MSIM_AVR_LOGSZ,
 					         "(CKSEL>>1) = %" PRIu8 ", "
 					         "but it should be within "
 					         "[5,7] inclusively", cksel);
@@ -549,7 +662,7 @@ MSIM_M8ASetFuse(struct MSIM_AVR *mcu, struct MSIM_AVRConf *cnf)
 				}
 			} else {
 				/* Shouldn't happen! */
-				snprintf(mcu->log, sizeof mcu->log, "CKSEL = %"
+				snprintf(mcu->log, MSIM_AVR_LOGSZ, "CKSEL = %"
 				         PRIu8 ", but it should be within "
 				         "[0,15] inclusively", cksel);
 				MSIM_LOG_ERROR(mcu->log);
@@ -581,7 +694,7 @@ MSIM_M8ASetFuse(struct MSIM_AVR *mcu, struct MSIM_AVRConf *cnf)
 				break;
 			default:
 				/* Shouldn't happen! */
-				snprintf(mcu->log, sizeof mcu->log, "BOOTSZ = "
+				snprintf(mcu->log, MSIM_AVR_LOGSZ, "BOOTSZ = "
 				         "%" PRIu8 ", but it should be within "
 				         "[0,3] inclusively", bootsz);
 				MSIM_LOG_ERROR(mcu->log);
@@ -609,7 +722,7 @@ MSIM_M8ASetFuse(struct MSIM_AVR *mcu, struct MSIM_AVRConf *cnf)
 				mcu->freq = 8000000;	/* max 8 MHz */
 				break;
 			default:
-				snprintf(mcu->log, sizeof mcu->log, "CKSEL = %"
+				snprintf(mcu->log, MSIM_AVR_LOGSZ, "CKSEL = %"
 				         PRIu8 ", but it should be within "
 				         "[5,7] inclusively", cksel);
 				MSIM_LOG_ERROR(mcu->log);
@@ -621,7 +734,7 @@ MSIM_M8ASetFuse(struct MSIM_AVR *mcu, struct MSIM_AVRConf *cnf)
 
 			break;
 		default:			/* Should not happen */
-			snprintf(mcu->log, sizeof mcu->log, "Unknown fuse = %"
+			snprintf(mcu->log, MSIM_AVR_LOGSZ, "Unknown fuse = %"
 			         PRIu32 ", %s will not be modified",
 			         fuse_n, mcu->name);
 			MSIM_LOG_ERROR(mcu->log);
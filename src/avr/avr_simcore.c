@@ -47,21 +47,56 @@
 #define IS_MCU_ACTIVE(mcu) 	(((mcu)->state == AVR_RUNNING) ||	\
                                  ((mcu)->state == AVR_MSIM_STEP))
 
+/* CPU doesn't execute instructions in sleep mode, but the time goes on */
+#define IS_MCU_ASLEEP(mcu)	((mcu)->state == AVR_SLEEPING)
+#define IS_MCU_CLOCKED(mcu)	(IS_MCU_ACTIVE(mcu) || IS_MCU_ASLEEP(mcu))
+
+/* I/O clock (timers, USART, etc.) is only running in idle sleep mode */
+#define IS_IO_CLOCKED(mcu)	(IS_MCU_ACTIVE(mcu) ||			\
+                                 (IS_MCU_ASLEEP(mcu) &&			\
+                                  ((mcu)->sleep_mode == AVR_SLEEP_IDLE)))
+
+/* Limits of a loop to poll registers which can be fast-forwarded */
+#define LOOP_MAXWORDS		16	/* Instructions, in 16-bit words */
+#define LOOP_MAXCYCLES		64	/* Cycles per iteration */
+#define BLOCK_MINCYCLES		16	/* Cycles to start a block from */
+
+/* Cycles to check for a checkpoint requested by signal after */
+#define CKPT_POLLCYCLES		(1U << 20)
+
 typedef int (*init_func)(MSIM_AVR *mcu, MSIM_InitArgs *args);
 
 /* Function to process interrupt request according to the order */
 static int	pass_irqs(struct MSIM_AVR *);
 static int	handle_irq(struct MSIM_AVR *);
+static uint32_t	irq_first(uint64_t);
+static void	write_irq(struct MSIM_AVR *, uint32_t, uint8_t);
+static int	watch_irq(struct MSIM_AVR *, struct MSIM_AVR_INTVec *);
+static int	watch_irqs(struct MSIM_AVR *);
+
+/* Functions to perform a cycle and update peripherals around it */
+static int	exec_cycle(MSIM_AVR *);
+static int	sim_run(MSIM_AVR *, uint8_t, uint64_t, uint32_t, uint8_t);
+static uint64_t	skip_loop(MSIM_AVR *, uint32_t, uint64_t);
+static uint64_t	run_block(MSIM_AVR *, uint32_t, uint64_t, uint32_t);
+static uint64_t	skip_sleep(MSIM_AVR *, uint64_t);
+static void	skip_cycles(MSIM_AVR *, uint32_t);
+static uint32_t	idle_cycles(MSIM_AVR *, uint32_t);
+static void	cycle_begin(MSIM_AVR *);
+static void	cycle_end(MSIM_AVR *);
+static uint64_t	ckpt_cycles(MSIM_AVR *);
+static void	ckpt_write(MSIM_AVR *);
 
 /* Function to setup AVR instance. */
 static int	set_fuse(MSIM_AVR *, uint32_t, uint8_t);
 static int	set_lock(MSIM_AVR *, uint8_t);
 static void	print_config(MSIM_AVR *);
 static int	load_mem8(MSIM_AVR *, const char *, uint8_t *, const char *);
-static int	load_mem16(MSIM_AVR *, const char *, uint16_t *, const char *);
+static int	load_mem16(MSIM_AVR *, const char *, uint16_t *, uint32_t,
+                          const char *);
 static int	setup_avr(MSIM_AVR *, const char *,
                           uint8_t *, uint32_t, uint8_t *, uint32_t,
-                          uint8_t *, const char *);
+                          const char *, uint8_t);
 
 /* Init function per AVR chip */
 struct init_func_info {
@@ -88,7 +123,8 @@ static struct init_func_info init_funcs[] = {
 int
 MSIM_AVR_Simulate(struct MSIM_AVR *mcu, uint8_t ft)
 {
-	const struct MSIM_AVR_VCD *vcd = &mcu->vcd;
+	const struct MSIM_AVR_VCD *vcd = mcu->vcd;
+	uint64_t cycles, rec;
 	int rc = 0;
 
 	if (vcd->regs[0].i >= 0) {
@@ -108,11 +144,19 @@ MSIM_AVR_Simulate(struct MSIM_AVR *mcu, uint8_t ft)
 
 	/* Main simulation loop. */
 	while (1) {
-		rc = MSIM_AVR_SimStep(mcu, ft);
+		cycles = ckpt_cycles(mcu);
+		if (ft == 0U) {
+			/* Snapshots to execute the MCU in reverse */
+			rec = MSIM_AVR_RSPRecord(mcu);
+			cycles = (rec < cycles) ? rec : cycles;
+		}
+
+		rc = MSIM_AVR_SimRun(mcu, ft, cycles);
 		if (rc != 0) {
 			rc = (rc == 2) ? 0 : rc;
 			break;
 		}
+		ckpt_write(mcu);
 	}
 
 	/* We may need to close a previously initialized VCD dump. */
@@ -125,10 +169,6 @@ MSIM_AVR_Simulate(struct MSIM_AVR *mcu, uint8_t ft)
 int
 MSIM_AVR_SimStep(MSIM_AVR *mcu, uint8_t ft)
 {
-	uint64_t *tick = &mcu->tick;
-	uint8_t *tovf = &mcu->tovf;
-	struct MSIM_AVR_VCD *vcd = &mcu->vcd;
-	struct MSIM_AVRConf cnf;
 	int rc = 0;
 
 	do {
@@ -155,43 +195,490 @@ MSIM_AVR_SimStep(MSIM_AVR *mcu, uint8_t ft)
 		}
 
 		/* Wait for request from GDB in MCU stopped mode */
-		if (!ft && !mcu->ic_left &&
-		                (mcu->state == AVR_STOPPED) &&
-		                MSIM_AVR_RSPHandle(mcu)) {
-			snprintf(LOG, LOGSZ, "handling message from GDB RSP "
-			         "client failed: pc=0x%06" PRIx32, mcu->pc);
-			MSIM_LOG_FATAL(LOG);
+		if (!ft && !mcu->ic_left && (mcu->state == AVR_STOPPED)) {
+			MSIM_AVR_SyncSREG(mcu);
+			if (MSIM_AVR_RSPHandle(mcu)) {
+				snprintf(LOG, LOGSZ, "handling message from "
+				         "GDB RSP client failed: pc=0x%06"
+				         PRIx32, mcu->pc);
+				MSIM_LOG_FATAL(LOG);
 
-			rc = 1;
+				rc = 1;
+				break;
+			}
+		}
+
+		/* Perform a cycle (or the whole instruction) */
+		rc = exec_cycle(mcu);
+	} while (0);
+
+	/* SREG can be read by a caller */
+	MSIM_AVR_SyncSREG(mcu);
+
+	return rc;
+}
+
+/*
+ * Performs a single instruction, i.e. all of the cycles required to
+ * complete it, and returns a number of these cycles.
+ *
+ * Instruction is decoded and executed once. Peripherals are updated
+ * within the same call for each of the intermediate cycles, so the
+ * instruction is still completed _after all_ of its cycles (as it is
+ * with MSIM_AVR_SimStep).
+ */
+int
+MSIM_AVR_SimInst(MSIM_AVR *mcu, uint8_t ft, uint32_t *cycles)
+{
+	const uint64_t tick = mcu->tick;
+	int rc = 0;
+
+	mcu->whole_inst = 1;
+	if ((mcu->state == AVR_RUNNING) && (mcu->ic_left == 0U) &&
+	                (mcu->engine != AVR_DECODER_ENGINE) &&
+	                (MSIM_AVR_StepThreaded(mcu, 1, UINT32_MAX) > 0U)) {
+		/* Instruction is started by the threaded engine */
+		MSIM_AVR_SyncSREG(mcu);
+	} else {
+		/* Instruction can be started by MSIM_AVR_SimStep */
+		rc = MSIM_AVR_SimStep(mcu, ft);
+	}
+	while ((rc == 0) && (mcu->ic_left > 0U)) {
+		/* Multi-cycle instructions which count their cycles on
+		 * their own (CALL) are completed here */
+		rc = MSIM_AVR_SimStep(mcu, ft);
+	}
+	mcu->whole_inst = 0;
+
+	if (cycles != NULL) {
+		*cycles = (uint32_t)(mcu->tick - tick);
+	}
+	return rc;
+}
+
+/*
+ * Performs at least the given number of cycles (the last instruction is
+ * always completed). Returns the same codes as MSIM_AVR_SimStep does.
+ */
+int
+MSIM_AVR_SimRun(MSIM_AVR *mcu, uint8_t ft, uint64_t cycles)
+{
+	return sim_run(mcu, ft, cycles, 0, 0);
+}
+
+/*
+ * Performs instructions until the program counter reaches the given
+ * address (in 16-bits words) or the given number of cycles passed.
+ * At least one instruction is performed.
+ */
+int
+MSIM_AVR_SimRunTo(MSIM_AVR *mcu, uint8_t ft, uint64_t cycles, uint32_t pc)
+{
+	return sim_run(mcu, ft, cycles, pc, 1);
+}
+
+static int
+sim_run(MSIM_AVR *mcu, uint8_t ft, uint64_t cycles, uint32_t pc,
+        uint8_t to_pc)
+{
+	uint64_t left = cycles;
+	uint64_t tick, n;
+	uint32_t prev_pc;
+	int rc = 0;
+
+	while (left > 0U) {
+		tick = mcu->tick;
+
+		if ((mcu->state == AVR_RUNNING) && (mcu->ic_left == 0U) &&
+		                (mcu->engine != AVR_DECODER_ENGINE) &&
+		                (MSIM_AVR_StepThreaded(mcu, left, to_pc ? pc :
+		                                UINT32_MAX) > 0U)) {
+			/*
+			 * Instructions are chained by the threaded engine
+			 * while peripherals are updated on each cycle. It
+			 * stops at an instruction which is performed by the
+			 * paths below (breakpoint, unknown instruction, etc.)
+			 */
+		} else if ((mcu->state == AVR_RUNNING) &&
+		                (mcu->ic_left == 0U)) {
+			/*
+			 * Fast path: MCU is running and there is no
+			 * instruction in progress, i.e. there is no need to
+			 * check for the stop/testfail states or requests
+			 * from GDB. Instruction which changes the state
+			 * (break, sleep, etc.) drops us to the slow path.
+			 */
+			prev_pc = mcu->pc;
+			mcu->whole_inst = 1;
+			rc = exec_cycle(mcu);
+			mcu->whole_inst = 0;
+
+			/* Idle loop may be skipped at once, other loops
+			 * are executed in a block while peripherals idle */
+			n = mcu->tick - tick;
+			if ((rc == 0) && (n < left) &&
+			                (skip_loop(mcu, prev_pc, left - n) == 0U)) {
+				run_block(mcu, prev_pc, left - n,
+				          to_pc ? pc : UINT32_MAX);
+			}
+		} else if (IS_MCU_ASLEEP(mcu) && (mcu->ic_left == 0U) &&
+		                (skip_sleep(mcu, left) > 0U)) {
+			/* Sleeping MCU is waiting for the next event */
+		} else {
+			rc = MSIM_AVR_SimInst(mcu, ft, NULL);
+		}
+		if (rc != 0) {
 			break;
 		}
 
-		/* Update timers */
-		if (IS_MCU_ACTIVE(mcu)) {
-			MSIM_AVR_TMRUpdate(mcu);
+		/* MCU may not count cycles while it is stopped */
+		n = mcu->tick - tick;
+		n = (n > 0U) ? n : 1U;
+		left = (n < left) ? (left - n) : 0U;
+
+		if (to_pc && (mcu->pc == pc)) {
+			break;
 		}
+	}
 
-		/*
-		 * Tick MCU periferals.
-		 *
-		 * NOTE: It is important to tick MCU peripherals before
-		 * updating Lua models. One of the reasons is an accessing
-		 * mechanism of the registers which share the same I/O
-		 * location (UBRRH/UCSRC of ATmega8A for example).
-		 */
-		if ((mcu->tick_perf != NULL) && IS_MCU_ACTIVE(mcu)) {
-			mcu->tick_perf(mcu, &cnf);
+	/* SREG can be read by a caller */
+	MSIM_AVR_SyncSREG(mcu);
+
+	return rc;
+}
+
+/* Cycles to run until the checkpoint is written. */
+static uint64_t
+ckpt_cycles(MSIM_AVR *mcu)
+{
+	uint64_t cycles = UINT64_MAX;
+
+	if (mcu->ckpt_file[0] != 0) {
+		/* Signal may request a checkpoint at any time */
+		cycles = CKPT_POLLCYCLES;
+		if ((mcu->ckpt_tick > mcu->tick) &&
+		                ((mcu->ckpt_tick - mcu->tick) < cycles)) {
+			cycles = mcu->ckpt_tick - mcu->tick;
 		}
+	}
 
-		/* Tick peripherals written in Lua */
-		if (IS_MCU_ACTIVE(mcu)) {
-			MSIM_AVR_LUATickModels(mcu);
+	return cycles;
+}
+
+/* Writes the checkpoint once its cycle is reached or it's requested. */
+static void
+ckpt_write(MSIM_AVR *mcu)
+{
+	uint8_t at_tick;
+
+	if (mcu->ckpt_file[0] == 0) {
+		return;
+	}
+	at_tick = ((mcu->ckpt_tick > 0U) && (mcu->tick >= mcu->ckpt_tick)) ?
+	          1 : 0;
+
+	if ((at_tick != 0U) || (mcu->ckpt_req != 0)) {
+		mcu->ckpt_tick = at_tick ? 0 : mcu->ckpt_tick;
+		mcu->ckpt_req = 0;
+		MSIM_AVR_SaveCheckpoint(mcu, mcu->ckpt_file);
+	}
+}
+
+/*
+ * Fast-forwards a short loop which polls registers (rjmp .-2, waiting for
+ * a flag, etc.) in case neither the loop nor peripherals are going to change
+ * anything during the next cycles. Returns a number of the skipped cycles.
+ *
+ * Loop is detected by a jump back from the given instruction. It can be
+ * skipped if the whole iteration has been performed within the loop and
+ * the general purpose and I/O registers are the same as they were at the
+ * beginning of this iteration.
+ */
+static uint64_t
+skip_loop(MSIM_AVR *mcu, uint32_t pc, uint64_t cycles)
+{
+	MSIM_AVR_Loop *loop = &mcu->loop;
+	uint32_t regs = mcu->regs_num + mcu->ioregs_num;
+	uint64_t len, n = 0;
+
+	do {
+		if ((mcu->pc > pc) || ((pc - mcu->pc) >= LOOP_MAXWORDS)) {
+			/* Program left the loop (or an IRQ is served) */
+			if ((mcu->pc < loop->head) || (mcu->pc > loop->tail)) {
+				loop->head = UINT32_MAX;
+				loop->poll = 0;
+			}
+			break;
+		}
+		if (regs > ARRSZ(loop->regs)) {
+			break;
 		}
 
-		/* Dump registers to VCD */
-		if (vcd->dump && !(*tovf) && IS_MCU_ACTIVE(mcu)) {
-			MSIM_AVR_VCDDumpFrame(mcu, *tick);
+		/* Jump back to a new loop */
+		if ((loop->head != mcu->pc) || (loop->tail != pc)) {
+			loop->head = mcu->pc;
+			loop->tail = pc;
+			loop->poll = (uint8_t)MSIM_AVR_IsPollLoop(mcu, mcu->pc,
+			                                          pc);
+			loop->tick = mcu->tick;
+			memcpy(loop->regs, mcu->dm, regs);
+			loop->lsr = mcu->lsr;
+			break;
+		}
+		if (loop->poll == 0U) {
+			break;
+		}
+
+		/* Iteration of the loop has changed registers (or flags of
+		 * SREG which aren't written yet) */
+		len = mcu->tick - loop->tick;
+		loop->tick = mcu->tick;
+		if ((memcmp(loop->regs, mcu->dm, regs) != 0) ||
+		                (memcmp(&loop->lsr, &mcu->lsr,
+		                        sizeof loop->lsr) != 0)) {
+			memcpy(loop->regs, mcu->dm, regs);
+			loop->lsr = mcu->lsr;
+			break;
 		}
+		if ((len == 0U) || (len > LOOP_MAXCYCLES)) {
+			break;
+		}
+
+		/* Skip whole iterations while peripherals are idle */
+		cycles = (cycles < UINT32_MAX) ? cycles : UINT32_MAX;
+		n = idle_cycles(mcu, (uint32_t)cycles);
+		n = (n / len) * len;
+		if (n > 0U) {
+			skip_cycles(mcu, (uint32_t)n);
+			loop->tick = mcu->tick;
+		}
+	} while (0);
+
+	return n;
+}
+
+/*
+ * Executes instructions of a loop (entered by a jump back from the given
+ * instruction) in a block while peripherals are idle. Instructions of the
+ * block don't access peripherals, so the cycles are only counted for them
+ * afterwards. Returns a number of the cycles performed.
+ */
+static uint64_t
+run_block(MSIM_AVR *mcu, uint32_t pc, uint64_t cycles, uint32_t stop_pc)
+{
+	uint32_t n = 0;
+
+	do {
+		if (mcu->pc > pc) {
+			break;
+		}
+
+		/* Loop which polls registers is skipped by skip_loop */
+		if ((mcu->loop.head == mcu->pc) && (mcu->loop.poll != 0U)) {
+			break;
+		}
+
+		/* Registers are dumped to VCD on each cycle */
+		if (mcu->vcd->dump != NULL) {
+			break;
+		}
+
+		cycles = (cycles < UINT32_MAX) ? cycles : UINT32_MAX;
+		n = idle_cycles(mcu, (uint32_t)cycles);
+		if (n < BLOCK_MINCYCLES) {
+			n = 0;
+			break;
+		}
+
+		n = MSIM_AVR_StepBlock(mcu, n, stop_pc);
+		if (n > 0U) {
+			skip_cycles(mcu, n);
+			mcu->intr.exec_main = 0;
+		}
+	} while (0);
+
+	return n;
+}
+
+/*
+ * Fast-forwards sleeping MCU to the next event which may wake it up.
+ * Returns a number of the skipped cycles.
+ */
+static uint64_t
+skip_sleep(MSIM_AVR *mcu, uint64_t cycles)
+{
+	uint32_t n = (cycles < UINT32_MAX) ? (uint32_t)cycles : UINT32_MAX;
+
+	n = idle_cycles(mcu, n);
+	if (n > 0U) {
+		skip_cycles(mcu, n);
+	}
+
+	return n;
+}
+
+/*
+ * Skips the given number of cycles, i.e. only counts them for the clocked
+ * peripherals. It is supposed that nothing is going to happen during
+ * these cycles (see idle_cycles).
+ */
+static void
+skip_cycles(MSIM_AVR *mcu, uint32_t cycles)
+{
+	if (IS_IO_CLOCKED(mcu)) {
+		MSIM_AVR_TMRSkip(mcu, cycles);
+		if (mcu->skip_perf != NULL) {
+			mcu->skip_perf(mcu, cycles);
+		}
+	}
+	mcu->tick += cycles;
+}
+
+/*
+ * Returns a number of cycles (up to the given one) during which neither
+ * peripherals nor IRQs are going to change anything.
+ */
+static uint32_t
+idle_cycles(MSIM_AVR *mcu, uint32_t cycles)
+{
+	uint32_t n = cycles;
+	uint32_t idle;
+
+	do {
+		/* Models written in Lua are ticked on each cycle */
+		if (MSIM_AVR_LUAModels(mcu) > 0U) {
+			n = 0;
+			break;
+		}
+
+		/* Pending IRQ is going to be served */
+		if ((mcu->intr.irq != 0U) && READ_SREG(mcu, SR_GLOBINT)) {
+			n = 0;
+			break;
+		}
+		/* Interrupt flags should be passed first */
+		if (mcu->intr.poll != 0U) {
+			n = 0;
+			break;
+		}
+
+		if ((TICKS_MAX - mcu->tick) < n) {
+			n = (uint32_t)(TICKS_MAX - mcu->tick);
+		}
+
+		/* Peripherals don't count anything without I/O clock */
+		if (!IS_IO_CLOCKED(mcu)) {
+			break;
+		}
+		if ((mcu->tick_perf != NULL) && ((mcu->idle_perf == NULL) ||
+		                                 (mcu->skip_perf == NULL))) {
+			n = 0;
+			break;
+		}
+
+		idle = MSIM_AVR_TMRIdle(mcu);
+		n = (idle < n) ? idle : n;
+		if ((n > 0U) && (mcu->idle_perf != NULL)) {
+			n = mcu->idle_perf(mcu, n);
+		}
+	} while (0);
+
+	return n;
+}
+
+/*
+ * Performs intermediate cycles of a multi-cycle instruction. It is called
+ * from the decoder when the instruction is going to be completed within
+ * a single step.
+ */
+void
+MSIM_AVR_SimCycles(MSIM_AVR *mcu)
+{
+	/* Cycles are only counted within a block (see run_block) */
+	if (mcu->in_block != 0U) {
+		mcu->block_cycles += mcu->ic_left;
+		mcu->ic_left = 0;
+		return;
+	}
+
+	while (mcu->ic_left > 0U) {
+		cycle_end(mcu);
+		cycle_begin(mcu);
+
+		mcu->ic_left--;
+	}
+}
+
+/*
+ * Updates peripherals before an instruction chained by the threaded engine
+ * (see MSIM_AVR_StepThreaded), i.e. does what exec_cycle does before the
+ * instruction is executed.
+ */
+void
+MSIM_AVR_SimInstBegin(MSIM_AVR *mcu)
+{
+	cycle_begin(mcu);
+
+#ifdef DEBUG
+	for (uint32_t i = ARRSZ(mcu->last_pc) - 1; i > 0; i--) {
+		mcu->last_pc[i] = mcu->last_pc[i-1];
+	}
+	mcu->last_pc[0] = mcu->pc;
+#endif
+}
+
+/* Updates pins, serves IRQs and counts the last cycle of an instruction
+ * chained by the threaded engine. */
+void
+MSIM_AVR_SimInstEnd(MSIM_AVR *mcu)
+{
+	cycle_end(mcu);
+}
+
+/*
+ * Skips an idle loop or executes a loop in a block once the instruction at
+ * the given address has jumped back (see skip_loop and run_block). It is
+ * called by the threaded engine after each instruction the same way the
+ * fast path of sim_run does. Returns a number of the cycles performed.
+ */
+uint64_t
+MSIM_AVR_SimLoop(MSIM_AVR *mcu, uint32_t pc, uint64_t cycles,
+                 uint32_t stop_pc)
+{
+	uint64_t n;
+
+	n = skip_loop(mcu, pc, cycles);
+	if (n == 0U) {
+		n = run_block(mcu, pc, cycles, stop_pc);
+	}
+	return n;
+}
+
+/*
+ * Performs a cycle of the MCU, i.e. updates peripherals, executes (a part
+ * of) the instruction and serves IRQs. The whole instruction is executed
+ * here if the "whole_inst" flag is set.
+ */
+static int
+exec_cycle(MSIM_AVR *mcu)
+{
+	int rc = 0;
+
+	do {
+		/* Stop before the instruction at a breakpoint, it's
+		 * executed once the MCU is resumed */
+		if ((mcu->ic_left == 0U) && IS_MCU_ACTIVE(mcu) &&
+		                BP(mcu->pc)) {
+			if (mcu->bp_hit == 0U) {
+				mcu->bp_hit = 1;
+				mcu->state = AVR_STOPPED;
+				break;
+			}
+			mcu->bp_hit = 0;
+		}
+
+		/* Update peripherals before the instruction */
+		cycle_begin(mcu);
 
 		/* Test scope of a program counter */
 		if (mcu->pc > (mcu->flashend>>1)) {
@@ -248,7 +735,7 @@ MSIM_AVR_SimStep(MSIM_AVR *mcu, uint8_t ft)
 		 * finish it.
 		 */
 		if ((mcu->ic_left || IS_MCU_ACTIVE(mcu)) && MSIM_AVR_Step(mcu)) {
-			snprintf(mcu->log, sizeof mcu->log, "decoding "
+			snprintf(mcu->log, MSIM_AVR_LOGSZ, "decoding "
 			         "instruction failed: pc=0x%06" PRIx32,
 			         mcu->pc);
 			MSIM_LOG_FATAL(mcu->log);
@@ -257,56 +744,101 @@ MSIM_AVR_SimStep(MSIM_AVR *mcu, uint8_t ft)
 			break;
 		}
 
-		if (mcu->ic_left || IS_MCU_ACTIVE(mcu)) {
-			MSIM_AVR_IOSyncPinx(mcu);
-		}
+		/* Update pins, serve IRQs and count the cycle */
+		cycle_end(mcu);
+	} while (0);
 
-		/*
-		 * Provide and handle IRQs.
-		 *
-		 * It's important to understand an interrupt may occur during
-		 * execution of a multi-cycle instruction. This instruction
-		 * is completed before the interrupt is served (according to
-		 * the multiple AVR datasheets).
-		 *
-		 * It means that we may provide IRQs, but will have to wait
-		 * required number of cycles to serve them.
-		 */
-		pass_irqs(mcu);
-		if (READ_SREG(mcu, SR_GLOBINT) && (!mcu->ic_left) &&
-		                (!mcu->intr.exec_main) && IS_MCU_ACTIVE(mcu)) {
-			handle_irq(mcu);
-		}
+	return rc;
+}
 
-		/*
-		 * All cycles of a single instruction from a main program
-		 * have to be performed.
-		 */
-		if (mcu->ic_left == 0) {
-			mcu->intr.exec_main = 0;
-		}
+/* Updates peripherals at the beginning of a cycle. */
+static void
+cycle_begin(MSIM_AVR *mcu)
+{
+	struct MSIM_AVR_VCD *vcd = mcu->vcd;
+	struct MSIM_AVRConf cnf;
 
-		/*
-		 * Increment cycles or print a warning message in case of
-		 * the maximum amount of cycles reached (extremely unlikely
-		 * if a compiler supports 'uint64_t').
-		 */
-		if (IS_MCU_ACTIVE(mcu)) {
-			if ((*tick) < TICKS_MAX) {
-				(*tick)++;
-			} else {
-				*tovf = 1;
-				MSIM_LOG_WARN("maximum cycles logged!");
-			}
-		}
+	/* Update timers */
+	if (IS_IO_CLOCKED(mcu)) {
+		MSIM_AVR_TMRUpdate(mcu);
+	}
 
-		/* Halt MCU after a single step performed */
-		if (!mcu->ic_left && mcu->state == AVR_MSIM_STEP) {
-			mcu->state = AVR_STOPPED;
+	/*
+	 * Tick MCU periferals.
+	 *
+	 * NOTE: It is important to tick MCU peripherals before
+	 * updating Lua models. One of the reasons is an accessing
+	 * mechanism of the registers which share the same I/O
+	 * location (UBRRH/UCSRC of ATmega8A for example).
+	 */
+	if ((mcu->tick_perf != NULL) && IS_IO_CLOCKED(mcu)) {
+		mcu->tick_perf(mcu, &cnf);
+	}
+
+	/* Tick peripherals written in Lua */
+	if (IS_MCU_CLOCKED(mcu) && (MSIM_AVR_LUAModels(mcu) > 0U)) {
+		MSIM_AVR_SyncSREG(mcu);
+		MSIM_AVR_LUATickModels(mcu);
+	}
+
+	/* Dump registers to VCD */
+	if (vcd->dump && !mcu->tovf && IS_MCU_CLOCKED(mcu)) {
+		MSIM_AVR_SyncSREG(mcu);
+		MSIM_AVR_VCDDumpFrame(mcu, mcu->tick);
+	}
+}
+
+/* Updates pins, provides IRQs and counts a cycle at the end of it. */
+static void
+cycle_end(MSIM_AVR *mcu)
+{
+	if (mcu->ic_left || IS_MCU_CLOCKED(mcu)) {
+		MSIM_AVR_IOSyncPinx(mcu);
+	}
+
+	/*
+	 * Provide and handle IRQs.
+	 *
+	 * It's important to understand an interrupt may occur during
+	 * execution of a multi-cycle instruction. This instruction
+	 * is completed before the interrupt is served (according to
+	 * the multiple AVR datasheets).
+	 *
+	 * It means that we may provide IRQs, but will have to wait
+	 * required number of cycles to serve them.
+	 */
+	pass_irqs(mcu);
+	if (READ_SREG(mcu, SR_GLOBINT) && (!mcu->ic_left) &&
+	                (!mcu->intr.exec_main) && IS_MCU_CLOCKED(mcu)) {
+		handle_irq(mcu);
+	}
+
+	/*
+	 * All cycles of a single instruction from a main program
+	 * have to be performed.
+	 */
+	if (mcu->ic_left == 0) {
+		mcu->intr.exec_main = 0;
+	}
+
+	/*
+	 * Increment cycles or print a warning message in case of
+	 * the maximum amount of cycles reached (extremely unlikely
+	 * if a compiler supports 'uint64_t').
+	 */
+	if (IS_MCU_CLOCKED(mcu)) {
+		if (mcu->tick < TICKS_MAX) {
+			mcu->tick++;
+		} else {
+			mcu->tovf = 1;
+			MSIM_LOG_WARN("maximum cycles logged!");
 		}
-	} while (0);
+	}
 
-	return rc;
+	/* Halt MCU after a single step performed */
+	if (!mcu->ic_left && mcu->state == AVR_MSIM_STEP) {
+		mcu->state = AVR_STOPPED;
+	}
 }
 
 /*
@@ -316,8 +848,8 @@ MSIM_AVR_SimStep(MSIM_AVR *mcu, uint8_t ft)
 int
 MSIM_AVR_Init(MSIM_AVR *mcu, MSIM_CFG *conf)
 {
-	struct MSIM_AVR_VCD *vcd = &mcu->vcd;
-	const uint32_t dflen = ARRSZ(vcd->dump_file);
+	struct MSIM_AVR_VCD *vcd;
+	uint32_t dflen;
 	uint32_t dump_regs;
 	uint8_t stop_reading = 0;
 	FILE *fp = NULL;
@@ -325,6 +857,20 @@ MSIM_AVR_Init(MSIM_AVR *mcu, MSIM_CFG *conf)
 	int rc = 0;
 
 	do {
+		/* Memories of the MCU are allocated from its own arena
+		 * once the model is known */
+		memset(&mcu->arena, 0, sizeof mcu->arena);
+		mcu->rsp = NULL;
+		mcu->jit = NULL;
+		mcu->lua_num = 0;
+		mcu->usart_link = NULL;
+		mcu->log = MSIM_ARENA_Alloc(&mcu->arena, MSIM_AVR_LOGSZ);
+		if (mcu->log == NULL) {
+			MSIM_LOG_FATAL("failed to allocate memory for MCU");
+			rc = 1;
+			break;
+		}
+
 		/* Try to open a firmware file */
 		if (conf->reset_flash == 1U) {
 			/* Firmware file has the priority. */
@@ -397,7 +943,8 @@ MSIM_AVR_Init(MSIM_AVR *mcu, MSIM_CFG *conf)
 		mcu->intr.trap_at_isr = conf->trap_at_isr;
 		if (setup_avr(mcu, conf->mcu, NULL,
 		                MSIM_AVR_PMSZ, NULL,
-		                MSIM_AVR_DMSZ, NULL, frm_file) != 0) {
+		                MSIM_AVR_DMSZ, frm_file,
+		                conf->usart_pty) != 0) {
 			snprintf(LOG, LOGSZ, "%s can't be initialized",
 			         conf->mcu);
 			MSIM_LOG_FATAL(LOG);
@@ -407,11 +954,14 @@ MSIM_AVR_Init(MSIM_AVR *mcu, MSIM_CFG *conf)
 		}
 
 		/* Select registers to be dumped */
+		vcd = mcu->vcd;
+		dflen = ARRSZ(vcd->dump_file);
 		dump_regs = 0;
 		strncpy(vcd->dump_file, conf->vcd_file, dflen - 1);
 
 		for (uint32_t i = 0; i < conf->dump_regs_num; i++) {
-			for (uint32_t j = 0; j < MSIM_AVR_DMSZ; j++) {
+			for (uint32_t j = 0; j < (mcu->regs_num +
+			                          mcu->ioregs_num); j++) {
 				char *bit, *pos;
 				size_t len;
 				int bitn, cr, bit_cr;
@@ -477,48 +1027,45 @@ MSIM_AVR_Init(MSIM_AVR *mcu, MSIM_CFG *conf)
 			}
 		}
 
-		/* Apply memory modifications */
-		if (conf->has_lockbits == 1) {
-			set_lock(mcu, conf->mcu_lockbits);
-		}
-		if (conf->has_efuse == 1) {
-			set_fuse(mcu, FUSE_EXT, conf->mcu_efuse);
-		}
-		if (conf->has_hfuse == 1) {
-			set_fuse(mcu, FUSE_HIGH, conf->mcu_hfuse);
-		}
-		if (conf->has_lfuse == 1) {
-			set_fuse(mcu, FUSE_LOW, conf->mcu_lfuse);
-		}
+		/* Apply lock bits, fuses and clock frequency */
+		MSIM_AVR_Configure(mcu, conf);
 
-		/* Try to set required frequency */
-		if (conf->mcu_freq > mcu->freq) {
-			snprintf(LOG, LOGSZ, "clock frequency %" PRIu64 ".%"
-			         PRIu64 " kHz is above maximum %lu.%lu kHz",
-			         conf->mcu_freq/1000U, conf->mcu_freq%1000U,
-			         mcu->freq/1000UL, mcu->freq%1000UL);
-			MSIM_LOG_WARN(LOG);
-		} else if (conf->mcu_freq > 0U) {
-			mcu->freq = (uint32_t)conf->mcu_freq;
-		} else {
-			snprintf(LOG, LOGSZ, "clock frequency %" PRIu64 ".%"
-			         PRIu64 " kHz cannot be selected as clock "
-			         "source",
-			         conf->mcu_freq/1000U, conf->mcu_freq%1000U);
-			MSIM_LOG_WARN(LOG);
+		/* Select an engine to execute instructions */
+		mcu->engine = conf->engine;
+		if ((mcu->engine == AVR_JIT_ENGINE) &&
+		                (MSIM_AVR_JITAvail() == 0)) {
+			MSIM_LOG_WARN("JIT isn't supported on this platform, "
+			              "blocks are interpreted");
 		}
 
+		/* Checkpoint to be written during the simulation */
+		memcpy(mcu->ckpt_file, conf->ckpt_file,
+		       sizeof mcu->ckpt_file);
+		mcu->ckpt_file[sizeof mcu->ckpt_file - 1] = 0;
+		mcu->ckpt_tick = conf->ckpt_tick;
+		mcu->ckpt_req = 0;
+
 		/* Print MCU configuration */
 		print_config(mcu);
 
 		/* Load Lua peripherals if it is required */
 		for (uint32_t k = 0; k < conf->lua_models_num; k++) {
 			char *lua_model = &conf->lua_models[k][0];
-			if (MSIM_AVR_LUALoadModel(mcu, lua_model)) {
+			if (MSIM_AVR_LUALoadModel(mcu, lua_model,
+			                          conf->lua_params,
+			                          conf->lua_params_num)) {
 				MSIM_LOG_FATAL("loading Lua model failed");
 			}
 		}
 
+		/* Resume a simulation from the checkpoint */
+		if ((conf->resume_file[0] != 0) &&
+		                (MSIM_AVR_LoadCheckpoint(mcu,
+		                                conf->resume_file) != 0)) {
+			rc = 1;
+			break;
+		}
+
 		/* Do we have registers to dump? */
 		if (vcd->regs[0].i >= 0) {
 			rc = MSIM_AVR_VCDOpen(mcu);
@@ -541,11 +1088,70 @@ MSIM_AVR_Init(MSIM_AVR *mcu, MSIM_CFG *conf)
 	return rc;
 }
 
+/*
+ * Applies lock bits, fuses and clock frequency of the configuration to
+ * the initialized MCU. Fuses may select another clock source, reset
+ * address, etc., so the MCU shouldn't be run before.
+ */
+void
+MSIM_AVR_Configure(MSIM_AVR *mcu, MSIM_CFG *conf)
+{
+	/* Apply memory modifications */
+	if (conf->has_lockbits == 1) {
+		set_lock(mcu, conf->mcu_lockbits);
+	}
+	if (conf->has_efuse == 1) {
+		set_fuse(mcu, FUSE_EXT, conf->mcu_efuse);
+	}
+	if (conf->has_hfuse == 1) {
+		set_fuse(mcu, FUSE_HIGH, conf->mcu_hfuse);
+	}
+	if (conf->has_lfuse == 1) {
+		set_fuse(mcu, FUSE_LOW, conf->mcu_lfuse);
+	}
+
+	/* Try to set required frequency */
+	if (conf->mcu_freq > mcu->freq) {
+		snprintf(LOG, LOGSZ, "clock frequency %" PRIu64 ".%"
+		         PRIu64 " kHz is above maximum %lu.%lu kHz",
+		         conf->mcu_freq/1000U, conf->mcu_freq%1000U,
+		         mcu->freq/1000UL, mcu->freq%1000UL);
+		MSIM_LOG_WARN(LOG);
+	} else if (conf->mcu_freq > 0U) {
+		mcu->freq = (uint32_t)conf->mcu_freq;
+	} else {
+		snprintf(LOG, LOGSZ, "clock frequency %" PRIu64 ".%"
+		         PRIu64 " kHz cannot be selected as clock "
+		         "source",
+		         conf->mcu_freq/1000U, conf->mcu_freq%1000U);
+		MSIM_LOG_WARN(LOG);
+	}
+}
+
+/* Releases memories of the MCU allocated by MSIM_AVR_Init. */
+void
+MSIM_AVR_Free(MSIM_AVR *mcu)
+{
+	MSIM_AVR_JITFree(mcu);
+	MSIM_ARENA_Free(&mcu->arena);
+	mcu->log = NULL;
+	mcu->pm = NULL;
+	mcu->pmp = NULL;
+	mcu->bp = NULL;
+	mcu->pm_dirty = NULL;
+	mcu->bp_num = 0;
+	mcu->dpm = NULL;
+	mcu->ioregs = NULL;
+	mcu->vcd = NULL;
+	mcu->pty = NULL;
+	mcu->rsp = NULL;
+}
+
 static int
 setup_avr(struct MSIM_AVR *mcu, const char *mcu_name,
           uint8_t *pm, uint32_t pm_size,
-          uint8_t *dm, uint32_t dm_size,
-          uint8_t *mpm, const char *progfile)
+          uint8_t *dm, uint32_t dm_size, const char *progfile,
+          uint8_t pty)
 {
 	unsigned int i;
 	char mcu_found = 0;
@@ -556,6 +1162,7 @@ setup_avr(struct MSIM_AVR *mcu, const char *mcu_name,
 	args.dm = dm;
 	args.pmsz = pm_size;
 	args.dmsz = dm_size;
+	args.pty = pty;
 
 	for (i = 0; i < sizeof(init_funcs)/sizeof(init_funcs[0]); i++) {
 		if (!strcmp(init_funcs[i].partno, mcu_name)) {
@@ -574,12 +1181,25 @@ setup_avr(struct MSIM_AVR *mcu, const char *mcu_name,
 		return -1;
 	}
 
+	/* Interrupt flags are passed once they're changed */
+	if (watch_irqs(mcu) != 0) {
+		return -1;
+	}
+	/* Pins are synchronized once the ports are written */
+	if (MSIM_AVR_IOWatchPorts(mcu) != 0) {
+		return -1;
+	}
+	/* Idle timers are woken up once their registers are written */
+	if (MSIM_AVR_TMRWatch(mcu) != 0) {
+		return -1;
+	}
+
 	if (MSIM_AVR_LoadProgMem(mcu, progfile)) {
 		MSIM_LOG_FATAL("program memory can't be loaded from a file");
 		return -1;
 	}
 	mcu->state = AVR_STOPPED;
-	mcu->read_from_mpm = 0;
+	mcu->bp_hit = 0;
 
 	return 0;
 }
@@ -587,22 +1207,21 @@ setup_avr(struct MSIM_AVR *mcu, const char *mcu_name,
 static int
 handle_irq(struct MSIM_AVR *mcu)
 {
-	unsigned int i;
+	uint32_t i;
 	int ret;
 
-	/* Let's try to find IRQ with the highest priority:
-	 * i == 0		highest priority
-	 * i == AVR_IRQ_NUM-1	lowest priority */
-	for (i = 0; i < MSIM_AVR_IRQNUM; i++) {
-		if (mcu->intr.irq[i] > 0) {
-			break;
-		}
-	}
-
 	ret = 0;
-	if (i != MSIM_AVR_IRQNUM) {
+	if (mcu->intr.irq != 0U) {
+		/* IRQ with the highest priority is the lowest bit set */
+		i = irq_first(mcu->intr.irq);
+
 		/* Clear selected IRQ */
-		mcu->intr.irq[i] = 0;
+		mcu->intr.irq &= ~MSIM_AVR_IRQ(i);
+
+		/* Wake up MCU to serve the interrupt */
+		if (mcu->state == AVR_SLEEPING) {
+			mcu->state = AVR_RUNNING;
+		}
 
 		/* Disable interrupts globally.
 		 * It is not applicable for the AVR XMEGA cores. */
@@ -639,12 +1258,15 @@ pass_irqs(struct MSIM_AVR *mcu)
 	uint32_t en, rai;
 	int rc = 0;
 
+	/* Flags and enable bits of the interrupts are checked only if they
+	 * may have been changed (Lua models write I/O registers directly). */
+	if ((mcu->intr.poll == 0U) && (MSIM_AVR_LUAModels(mcu) == 0U)) {
+		return rc;
+	}
+
 	/* Pass interrupts of the timers */
-	for (uint32_t i = 0; i < MSIM_AVR_MAXTMRS; i++) {
+	for (uint32_t i = 0; i < mcu->timers_num; i++) {
 		tmr = &mcu->timers[i];
-		if (IS_IONOBITA(tmr->tcnt)) {
-			break;
-		}
 
 		/* Timer's owm interrupts */
 		struct MSIM_AVR_INTVec *vec[] = { &tmr->iv_ovf, &tmr->iv_ic };
@@ -656,7 +1278,7 @@ pass_irqs(struct MSIM_AVR *mcu)
 			en = IOBIT_RD(mcu, &vec[k]->enable);
 			rai = IOBIT_RD(mcu, &vec[k]->raised);
 			if ((en == 1U) && (rai == 1U)) {
-				mcu->intr.irq[vec[k]->vector] = 1;
+				mcu->intr.irq |= MSIM_AVR_IRQ(vec[k]->vector);
 				IOBIT_WR(mcu, &vec[k]->raised, 0);
 			}
 		}
@@ -674,11 +1296,102 @@ pass_irqs(struct MSIM_AVR *mcu)
 			en = IOBIT_RD(mcu, &comp->iv.enable);
 			rai = IOBIT_RD(mcu, &comp->iv.raised);
 			if ((en == 1U) && (rai == 1U)) {
-				mcu->intr.irq[comp->iv.vector] = 1;
+				mcu->intr.irq |= MSIM_AVR_IRQ(comp->iv.vector);
 				IOBIT_WR(mcu, &comp->iv.raised, 0);
 			}
 		}
 	}
+	mcu->intr.poll = 0;
+
+	return rc;
+}
+
+/* Returns index of the lowest bit set, mask shouldn't be zero. */
+static uint32_t
+irq_first(uint64_t mask)
+{
+#if defined(__GNUC__) || defined(__clang__)
+	return (uint32_t)__builtin_ctzll(mask);
+#else
+	uint32_t i = 0;
+
+	while ((mask & 1U) == 0U) {
+		mask >>= 1;
+		i++;
+	}
+	return i;
+#endif
+}
+
+/* Interrupt flag or enable bit is in the written I/O register. */
+static void
+write_irq(struct MSIM_AVR *mcu, uint32_t reg, uint8_t old)
+{
+	(void)reg;
+	(void)old;
+
+	/* Interrupt bits share registers with the timers (TIMSK, TIFR) */
+	mcu->intr.poll = 1;
+	MSIM_AVR_TMRWake(mcu);
+}
+
+/* Watches I/O registers with flag and enable bit of the interrupt. */
+static int
+watch_irq(struct MSIM_AVR *mcu, struct MSIM_AVR_INTVec *iv)
+{
+	const uint32_t regs[] = { iv->enable.reg, iv->raised.reg };
+	int rc = 0;
+
+	for (uint32_t i = 0; i < ARRSZ(regs); i++) {
+		if (!IS_IO(mcu, regs[i])) {
+			continue;
+		}
+		if ((mcu->ioregs[regs[i]].write != NULL) &&
+		                (mcu->ioregs[regs[i]].write != write_irq)) {
+			snprintf(LOG, LOGSZ, "I/O register 0x%02" PRIX32
+			         " with interrupt flags is watched already",
+			         regs[i]);
+			MSIM_LOG_FATAL(LOG);
+			rc = -1;
+			break;
+		}
+		mcu->ioregs[regs[i]].write = write_irq;
+	}
+
+	return rc;
+}
+
+/* Watches I/O registers with flags and enable bits of the interrupts
+ * passed by pass_irqs. */
+static int
+watch_irqs(struct MSIM_AVR *mcu)
+{
+	struct MSIM_AVR_TMR *tmr;
+	struct MSIM_AVR_TMR_COMP *comp;
+	int rc = 0;
+
+	for (uint32_t i = 0; (rc == 0) && (i < mcu->timers_num); i++) {
+		tmr = &mcu->timers[i];
+
+		struct MSIM_AVR_INTVec *vec[] = { &tmr->iv_ovf, &tmr->iv_ic };
+		for (uint32_t k = 0; (rc == 0) && (k < ARRSZ(vec)); k++) {
+			if (IS_NOINTV(vec[k])) {
+				break;
+			}
+			rc = watch_irq(mcu, vec[k]);
+		}
+
+		for (uint32_t k = 0; (rc == 0) && (k < ARRSZ(tmr->comp)); k++) {
+			comp = &tmr->comp[k];
+			if (IS_NOCOMP(comp) || IS_NOINTV(&comp->iv)) {
+				break;
+			}
+			rc = watch_irq(mcu, &comp->iv);
+		}
+	}
+
+	/* Flags may be raised already */
+	mcu->intr.poll = 1;
 
 	return rc;
 }
@@ -758,6 +1471,74 @@ print_config(struct MSIM_AVR *m)
 	snprintf(m->log, LOGSZ, "bootloader: 0x%06" PRIX64 "-0x%06"
 	         PRIX64, blsstart, blsend);
 	MSIM_LOG_INFO(m->log);
+
+	snprintf(m->log, LOGSZ, "engine: %s",
+	         (m->engine == AVR_JIT_ENGINE) ? "jit" :
+	         (m->engine == AVR_THREADED_ENGINE) ? "threaded" : "decoder");
+	MSIM_LOG_INFO(m->log);
+}
+
+/*
+ * Puts MCU into the sleep mode selected by the firmware, if the sleep is
+ * enabled. MCU doesn't sleep while it's stepped by a debugger.
+ */
+void
+MSIM_AVR_Sleep(MSIM_AVR *mcu)
+{
+	uint32_t sm;
+
+	if (!IS_IONOBIT(mcu->se) && (IOBIT_RD(mcu, &mcu->se) == 1U) &&
+	                (mcu->state == AVR_RUNNING)) {
+		sm = IOBIT_RDA(mcu, mcu->sm, ARRSZ(mcu->sm));
+		mcu->sleep_mode = (enum MSIM_AVR_SleepMode)sm;
+		mcu->state = AVR_SLEEPING;
+	}
+}
+
+/*
+ * Sets a breakpoint at the given address of the program memory (in 16-bits
+ * words). MCU is stopped before the instruction at this address.
+ */
+int
+MSIM_AVR_SetBreak(MSIM_AVR *mcu, uint32_t pc)
+{
+	int rc = 0;
+
+	if (pc > (mcu->flashend >> 1)) {
+		rc = -1;
+	} else if (!BP(pc)) {
+		mcu->bp[pc >> 3] = (uint8_t)(mcu->bp[pc >> 3] |
+		                             (1U << (pc & 7U)));
+		mcu->bp_num++;
+
+		/* Loop to be fast-forwarded may include the breakpoint */
+		mcu->loop.head = UINT32_MAX;
+		mcu->loop.poll = 0;
+	}
+
+	return rc;
+}
+
+/*
+ * Clears a breakpoint at the given address (in 16-bits words). Returns 1 if
+ * there is no breakpoint at this address.
+ */
+int
+MSIM_AVR_ClearBreak(MSIM_AVR *mcu, uint32_t pc)
+{
+	int rc = 0;
+
+	if (pc > (mcu->flashend >> 1)) {
+		rc = -1;
+	} else if (!BP(pc)) {
+		rc = 1;
+	} else {
+		mcu->bp[pc >> 3] = (uint8_t)(mcu->bp[pc >> 3] &
+		                             ~(1U << (pc & 7U)));
+		mcu->bp_num--;
+	}
+
+	return rc;
 }
 
 /* Pushes a value to the head of MCU stack. */
@@ -800,7 +1581,13 @@ MSIM_AVR_PrintParts(void)
 int
 MSIM_AVR_LoadProgMem(MSIM_AVR *mcu, const char *f)
 {
-	return load_mem16(mcu, f, mcu->pm, "progmem");
+	const uint32_t pmsz = (mcu->flashend - mcu->flashstart + 1) >> 1;
+	const int rc = load_mem16(mcu, f, mcu->pm, pmsz, "progmem");
+
+	/* Instructions should be decoded again */
+	MSIM_AVR_FlushDecoded(mcu, 0, mcu->pm_size);
+
+	return rc;
 }
 
 /* Populates AVR data memory from the Intel HEX file. */
@@ -884,7 +1671,8 @@ load_mem8(MSIM_AVR *mcu, const char *f, uint8_t *mem, const char *memtype)
 }
 
 static int
-load_mem16(MSIM_AVR *mcu, const char *f, uint16_t *mem, const char *memtype)
+load_mem16(MSIM_AVR *mcu, const char *f, uint16_t *mem, uint32_t memsz,
+           const char *memtype)
 {
 	FILE *fp = NULL;
 	IHexRecord r, mr;
@@ -903,6 +1691,15 @@ load_mem16(MSIM_AVR *mcu, const char *f, uint16_t *mem, const char *memtype)
 		switch (r.type) {
 		case IHEX_TYPE_00:
 			/* Data record */
+			if (((r.address >> 1) + ((r.dataLen + 1U) >> 1)) >
+			                memsz) {
+				snprintf(LOG, LOGSZ, "%s record at 0x%04X is "
+				         "out of memory", memtype, r.address);
+				MSIM_LOG_ERROR(LOG);
+
+				fclose(fp);
+				return 1;
+			}
 			addr = mem + (r.address >> 1);
 			for (uint32_t j = 0; j < r.dataLen; j += 2) {
 				addr[j >> 1] = (uint16_t) (
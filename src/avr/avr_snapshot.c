@@ -0,0 +1,605 @@
+/*
+ * This file is part of MCUSim, an XSPICE library with microcontrollers.
+ *
+ * Copyright (C) 2017-2019 MCUSim Developers, see AUTHORS.txt for contributors.
+ *
+ * MCUSim is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MCUSim is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _POSIX_C_SOURCE 200112L
+
+/* Snapshots of the AVR MCU state to restore it quickly and checkpoints to
+ * resume a simulation from. */
+#include <stdio.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#ifdef WITH_POSIX
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "mcusim/mcusim.h"
+#include "mcusim/log.h"
+#include "mcusim/avr/sim/snapshot.h"
+#include "mcusim/avr/sim/private/macro.h"
+
+#define CKPT_MAGIC		"MSIMCKPT"
+
+/* Members of the MCU state written to the checkpoint. Their offsets and
+ * sizes are hashed to the fingerprint of the state layout, so checkpoint
+ * written by a build with another layout of the state is rejected. */
+#define CKPT_LAYOUT(X)							\
+	X(MSIM_AVR, name) X(MSIM_AVR, log) X(MSIM_AVR, signature)	\
+	X(MSIM_AVR, xmega) X(MSIM_AVR, reduced_core)			\
+	X(MSIM_AVR, tick) X(MSIM_AVR, tovf) X(MSIM_AVR, flashstart)	\
+	X(MSIM_AVR, flashend) X(MSIM_AVR, ramstart)			\
+	X(MSIM_AVR, ramend) X(MSIM_AVR, ramsize) X(MSIM_AVR, e2start)	\
+	X(MSIM_AVR, e2end) X(MSIM_AVR, e2size)				\
+	X(MSIM_AVR, e2pagesize) X(MSIM_AVR, lockbits)			\
+	X(MSIM_AVR, fuse) X(MSIM_AVR, spm_pagesize)			\
+	X(MSIM_AVR, spmcsr) X(MSIM_AVR, spmen_cycles)			\
+	X(MSIM_AVR, spmen_clear) X(MSIM_AVR, se) X(MSIM_AVR, sm)	\
+	X(MSIM_AVR, freq) X(MSIM_AVR, pc) X(MSIM_AVR, pc_bits)		\
+	X(MSIM_AVR, ic_left) X(MSIM_AVR, mci) X(MSIM_AVR, whole_inst)	\
+	X(MSIM_AVR, in_block) X(MSIM_AVR, block_cycles)			\
+	X(MSIM_AVR, sreg) X(MSIM_AVR, lsr) X(MSIM_AVR, sph)		\
+	X(MSIM_AVR, spl) X(MSIM_AVR, eind) X(MSIM_AVR, rampz)		\
+	X(MSIM_AVR, rampy) X(MSIM_AVR, rampx) X(MSIM_AVR, rampd)	\
+	X(MSIM_AVR, pm) X(MSIM_AVR, pmp) X(MSIM_AVR, dpm)		\
+	X(MSIM_AVR, pm_size) X(MSIM_AVR, pm_dirty)			\
+	X(MSIM_AVR, snap_id) X(MSIM_AVR, snap_seq) X(MSIM_AVR, bp)	\
+	X(MSIM_AVR, bp_num) X(MSIM_AVR, bp_hit) X(MSIM_AVR, dm)		\
+	X(MSIM_AVR, dm_size) X(MSIM_AVR, sfr_off)			\
+	X(MSIM_AVR, regs_num) X(MSIM_AVR, ioregs_num)			\
+	X(MSIM_AVR, set_fusef) X(MSIM_AVR, set_lockf)			\
+	X(MSIM_AVR, tick_perf) X(MSIM_AVR, idle_perf)			\
+	X(MSIM_AVR, skip_perf) X(MSIM_AVR, pass_irqs)			\
+	X(MSIM_AVR, reset_spm) X(MSIM_AVR, state)			\
+	X(MSIM_AVR, sleep_mode) X(MSIM_AVR, clk_source)			\
+	X(MSIM_AVR, bls) X(MSIM_AVR, intr) X(MSIM_AVR, wdt)		\
+	X(MSIM_AVR, vcd) X(MSIM_AVR, usart) X(MSIM_AVR, pty)		\
+	X(MSIM_AVR, loop) X(MSIM_AVR, ioregs) X(MSIM_AVR, ioports)	\
+	X(MSIM_AVR, io_sync) X(MSIM_AVR, timers)			\
+	X(MSIM_AVR, timers_num) X(MSIM_AVR, arena)			\
+	X(MSIM_AVR_LazySR, pend) X(MSIM_AVR_LazySR, rd)			\
+	X(MSIM_AVR_LazySR, rr) X(MSIM_AVR_LazySR, r)			\
+	X(MSIM_AVR_LazySR, z)						\
+	X(MSIM_AVR_Loop, head) X(MSIM_AVR_Loop, tail)			\
+	X(MSIM_AVR_Loop, tick) X(MSIM_AVR_Loop, poll)			\
+	X(MSIM_AVR_Loop, regs) X(MSIM_AVR_Loop, lsr)			\
+	X(MSIM_AVR_BLD, start) X(MSIM_AVR_BLD, end)			\
+	X(MSIM_AVR_BLD, size)						\
+	X(MSIM_AVR_INT, reset_pc) X(MSIM_AVR_INT, ivt)			\
+	X(MSIM_AVR_INT, irq) X(MSIM_AVR_INT, poll)			\
+	X(MSIM_AVR_INT, exec_main) X(MSIM_AVR_INT, trap_at_isr)		\
+	X(MSIM_AVR_WDT, wdton) X(MSIM_AVR_WDT, wde)			\
+	X(MSIM_AVR_WDT, wdie) X(MSIM_AVR_WDT, ce)			\
+	X(MSIM_AVR_WDT, oscf) X(MSIM_AVR_WDT, oscp)			\
+	X(MSIM_AVR_WDT, scnt) X(MSIM_AVR_WDT, wdp)			\
+	X(MSIM_AVR_WDT, wdp_op) X(MSIM_AVR_WDT, wdpval)			\
+	X(MSIM_AVR_WDT, iv_tout) X(MSIM_AVR_WDT, iv_sysr)		\
+	X(MSIM_AVR_USART, baud) X(MSIM_AVR_USART, txb)			\
+	X(MSIM_AVR_USART, rx_ticks) X(MSIM_AVR_USART, tx_ticks)		\
+	X(MSIM_AVR_USART, rx_presc) X(MSIM_AVR_USART, tx_presc)		\
+	X(MSIM_AVR_USART, ucsrc_buf) X(MSIM_AVR_USART, ubrrh_buf)	\
+	X(MSIM_AVR_USART, ubrrl_buf) X(MSIM_AVR_USART, ubrr_writ)	\
+	X(MSIM_AVR_IOPort, port) X(MSIM_AVR_IOPort, ddr)		\
+	X(MSIM_AVR_IOPort, pin) X(MSIM_AVR_IOPort, pending)		\
+	X(MSIM_AVR_IOPort, ppin)					\
+	X(MSIM_AVR_IOBit, reg) X(MSIM_AVR_IOBit, mask)			\
+	X(MSIM_AVR_IOBit, bit) X(MSIM_AVR_IOBit, mbits)			\
+	X(MSIM_AVR_INTVec, enable) X(MSIM_AVR_INTVec, raised)		\
+	X(MSIM_AVR_INTVec, vector) X(MSIM_AVR_INTVec, pending)		\
+	X(MSIM_AVR_TMR, tcnt) X(MSIM_AVR_TMR, disabled)			\
+	X(MSIM_AVR_TMR, scnt) X(MSIM_AVR_TMR, cnt_dir)			\
+	X(MSIM_AVR_TMR, size) X(MSIM_AVR_TMR, cs)			\
+	X(MSIM_AVR_TMR, cs_div) X(MSIM_AVR_TMR, presc)			\
+	X(MSIM_AVR_TMR, ec_pin) X(MSIM_AVR_TMR, ec_vold)		\
+	X(MSIM_AVR_TMR, ec_flags) X(MSIM_AVR_TMR, wgm)			\
+	X(MSIM_AVR_TMR, wgm_op) X(MSIM_AVR_TMR, wgmval)			\
+	X(MSIM_AVR_TMR, wgmi) X(MSIM_AVR_TMR, icr)			\
+	X(MSIM_AVR_TMR, icp) X(MSIM_AVR_TMR, ices)			\
+	X(MSIM_AVR_TMR, icpval) X(MSIM_AVR_TMR, iv_ovf)			\
+	X(MSIM_AVR_TMR, iv_ic) X(MSIM_AVR_TMR, comp)			\
+	X(MSIM_AVR_TMR, idle)						\
+	X(MSIM_AVR_TMR_WGM, kind) X(MSIM_AVR_TMR_WGM, size)		\
+	X(MSIM_AVR_TMR_WGM, top) X(MSIM_AVR_TMR_WGM, bottom)		\
+	X(MSIM_AVR_TMR_WGM, updocr_at) X(MSIM_AVR_TMR_WGM, settov_at)	\
+	X(MSIM_AVR_TMR_WGM, rtop) X(MSIM_AVR_TMR_WGM, rtop_buf)		\
+	X(MSIM_AVR_TMR_COMP, ocr) X(MSIM_AVR_TMR_COMP, pin)		\
+	X(MSIM_AVR_TMR_COMP, ddp) X(MSIM_AVR_TMR_COMP, ocr_buf)		\
+	X(MSIM_AVR_TMR_COMP, com) X(MSIM_AVR_TMR_COMP, com_op)		\
+	X(MSIM_AVR_TMR_COMP, iv)
+
+#define CKPT_MEMBER(type, m)						\
+	h = hash_member(h, offsetof(type, m), sizeof(((type *)0)->m));
+
+/* Header of the checkpoint file. It's followed by the MSIM_AVR structure,
+ * timers, program memory and page buffer of the program memory. */
+struct ckpt_hdr {
+	char magic[8];			/* CKPT_MAGIC */
+	uint32_t version;		/* MSIM_AVR_CKPT_VERSION */
+	uint32_t state_size;		/* Size of MSIM_AVR, in bytes */
+	uint32_t pm_size;		/* Size of PM, in 16-bits words */
+	uint32_t timers_num;		/* # of timers */
+	uint64_t layout;		/* Fingerprint of the state layout */
+	uint64_t tick;			/* Cycle the checkpoint is written at */
+	char name[20];			/* Name of the MCU */
+};
+
+static uint64_t	ckpt_layout(void);
+static uint64_t	hash_member(uint64_t h, size_t off, size_t size);
+static uint32_t	dirty_size(struct MSIM_AVR *mcu);
+static void	relink(struct MSIM_AVR *s, const struct MSIM_AVR *mcu);
+static void	*map_file(const char *file, size_t *size);
+static void	unmap_file(void *map, size_t size);
+static void	restore_pm(struct MSIM_AVR *mcu, const uint16_t *pm,
+		           uint8_t full);
+static void	restore_state(struct MSIM_AVR *mcu, const struct MSIM_AVR *s,
+		              const struct MSIM_AVR_TMR *timers);
+static void	copy_state(struct MSIM_AVR *mcu, const struct MSIM_AVR *s,
+		           size_t from, size_t to);
+
+int
+MSIM_AVR_Snapshot(struct MSIM_AVR *mcu, struct MSIM_AVR_Snap *snap)
+{
+	int rc = 0;
+
+	do {
+		if (snap->state == NULL) {
+			snap->state = malloc(sizeof *snap->state);
+		}
+		if ((snap->pm != NULL) && (snap->pm_size != mcu->pm_size)) {
+			free(snap->pm);
+			snap->pm = NULL;
+		}
+		if (snap->pm == NULL) {
+			snap->pm = malloc(mcu->pm_size * sizeof *snap->pm);
+			snap->pm_size = mcu->pm_size;
+		}
+		if ((snap->timers != NULL) &&
+		                (snap->timers_num != mcu->timers_num)) {
+			free(snap->timers);
+			snap->timers = NULL;
+		}
+		if (snap->timers == NULL) {
+			/* MCU may have no timers, malloc(0) may fail */
+			snap->timers = malloc((mcu->timers_num + 1U) *
+			                      sizeof *snap->timers);
+			snap->timers_num = mcu->timers_num;
+		}
+		if ((snap->state == NULL) || (snap->pm == NULL) ||
+		                (snap->timers == NULL)) {
+			MSIM_LOG_ERROR("failed to allocate memory for "
+			               "snapshot");
+			rc = 1;
+			break;
+		}
+
+		/* Modifications of PM are tracked since this snapshot */
+		mcu->snap_seq++;
+		mcu->snap_id = mcu->snap_seq;
+		memset(mcu->pm_dirty, 0, dirty_size(mcu));
+
+		*snap->state = *mcu;
+		memcpy(snap->pm, mcu->pm, mcu->pm_size * sizeof *mcu->pm);
+		memcpy(snap->timers, mcu->timers,
+		       mcu->timers_num * sizeof *mcu->timers);
+		snap->mcu = mcu;
+		snap->id = mcu->snap_id;
+	} while (0);
+
+	return rc;
+}
+
+int
+MSIM_AVR_Restore(struct MSIM_AVR *mcu, struct MSIM_AVR_Snap *snap)
+{
+	int rc = 0;
+
+	do {
+		if ((snap->mcu != mcu) || (snap->state == NULL) ||
+		                (snap->pm_size != mcu->pm_size) ||
+		                (snap->timers_num != mcu->timers_num)) {
+			snprintf(LOG, LOGSZ, "snapshot can't be restored "
+			         "to this MCU");
+			MSIM_LOG_ERROR(LOG);
+			rc = 1;
+			break;
+		}
+
+		/* Whole PM is copied if there was another snapshot after
+		 * this one */
+		restore_pm(mcu, snap->pm, (snap->id != mcu->snap_id) ? 1 : 0);
+		restore_state(mcu, snap->state, snap->timers);
+		mcu->snap_id = snap->id;
+	} while (0);
+
+	return rc;
+}
+
+int
+MSIM_AVR_SaveCheckpoint(struct MSIM_AVR *mcu, const char *file)
+{
+	const size_t pm_bytes = mcu->pm_size * sizeof *mcu->pm;
+	const size_t tmr_bytes = mcu->timers_num * sizeof *mcu->timers;
+	struct ckpt_hdr hdr;
+	FILE *f;
+	size_t n;
+	int rc = 0;
+
+	do {
+		f = fopen(file, "wb");
+		if (f == NULL) {
+			snprintf(LOG, LOGSZ, "failed to open checkpoint: %s",
+			         file);
+			MSIM_LOG_ERROR(LOG);
+			rc = 1;
+			break;
+		}
+
+		memset(&hdr, 0, sizeof hdr);
+		memcpy(hdr.magic, CKPT_MAGIC, sizeof hdr.magic);
+		hdr.version = MSIM_AVR_CKPT_VERSION;
+		hdr.state_size = (uint32_t)sizeof *mcu;
+		hdr.pm_size = mcu->pm_size;
+		hdr.timers_num = mcu->timers_num;
+		hdr.layout = ckpt_layout();
+		hdr.tick = mcu->tick;
+		memcpy(hdr.name, mcu->name, sizeof hdr.name);
+
+		n = fwrite(&hdr, sizeof hdr, 1, f);
+		n += fwrite(mcu, sizeof *mcu, 1, f);
+		n += (tmr_bytes > 0U) ? fwrite(mcu->timers, tmr_bytes, 1, f) :
+		     1U;
+		n += fwrite(mcu->pm, pm_bytes, 1, f);
+		n += fwrite(mcu->pmp, pm_bytes, 1, f);
+		if ((fclose(f) != 0) || (n != 5U)) {
+			snprintf(LOG, LOGSZ, "failed to write checkpoint: %s",
+			         file);
+			MSIM_LOG_ERROR(LOG);
+			rc = 1;
+			break;
+		}
+
+		snprintf(LOG, LOGSZ, "checkpoint at %" PRIu64 " cycle: %s",
+		         mcu->tick, file);
+		MSIM_LOG_INFO(LOG);
+	} while (0);
+
+	return rc;
+}
+
+int
+MSIM_AVR_LoadCheckpoint(struct MSIM_AVR *mcu, const char *file)
+{
+	const size_t pm_bytes = mcu->pm_size * sizeof *mcu->pm;
+	const size_t tmr_bytes = mcu->timers_num * sizeof *mcu->timers;
+	const struct ckpt_hdr *hdr;
+	const uint8_t *data;
+	struct MSIM_AVR *s = NULL;
+	struct MSIM_AVR_TMR *t = NULL;
+	size_t size = 0;
+	void *map;
+	int rc = 0;
+
+	map = map_file(file, &size);
+	do {
+		if (map == NULL) {
+			snprintf(LOG, LOGSZ, "failed to open checkpoint: %s",
+			         file);
+			MSIM_LOG_ERROR(LOG);
+			rc = 1;
+			break;
+		}
+		hdr = map;
+		data = (const uint8_t *)map + sizeof *hdr;
+
+		if ((size < sizeof *hdr) ||
+		                (memcmp(hdr->magic, CKPT_MAGIC,
+		                        sizeof hdr->magic) != 0) ||
+		                (hdr->version != MSIM_AVR_CKPT_VERSION)) {
+			snprintf(LOG, LOGSZ, "not a checkpoint of version %d: "
+			         "%s", MSIM_AVR_CKPT_VERSION, file);
+			MSIM_LOG_ERROR(LOG);
+			rc = 1;
+			break;
+		}
+		if ((hdr->state_size != sizeof *mcu) ||
+		                (hdr->layout != ckpt_layout())) {
+			snprintf(LOG, LOGSZ, "checkpoint is written with "
+			         "another layout of the MCU state: %s", file);
+			MSIM_LOG_ERROR(LOG);
+			rc = 1;
+			break;
+		}
+		if ((hdr->pm_size != mcu->pm_size) ||
+		                (hdr->timers_num != mcu->timers_num) ||
+		                (strncmp(hdr->name, mcu->name,
+		                         sizeof hdr->name) != 0) ||
+		                (size != (sizeof *hdr + sizeof *mcu +
+		                          tmr_bytes + 2 * pm_bytes))) {
+			snprintf(LOG, LOGSZ, "checkpoint doesn't match %s: %s",
+			         mcu->name, file);
+			MSIM_LOG_ERROR(LOG);
+			rc = 1;
+			break;
+		}
+
+		s = malloc(sizeof *s);
+		t = malloc(tmr_bytes + sizeof *t);
+		if ((s == NULL) || (t == NULL)) {
+			MSIM_LOG_ERROR("failed to allocate memory for "
+			               "checkpoint");
+			rc = 1;
+			break;
+		}
+		memcpy(s, data, sizeof *s);
+		data += sizeof *s;
+		memcpy(t, data, tmr_bytes);
+		data += tmr_bytes;
+		relink(s, mcu);
+
+		/* Current WGM is selected again on the next update of
+		 * a timer */
+		for (uint32_t i = 0; i < mcu->timers_num; i++) {
+			t[i].wgmval = mcu->timers[i].wgmval;
+		}
+
+		restore_pm(mcu, (const uint16_t *)data, 1);
+		memcpy(mcu->pmp, data + pm_bytes, pm_bytes);
+		restore_state(mcu, s, t);
+
+		/* PM may differ from any of the snapshots taken */
+		mcu->snap_id = 0;
+
+		snprintf(LOG, LOGSZ, "resumed at %" PRIu64 " cycle: %s",
+		         mcu->tick, file);
+		MSIM_LOG_INFO(LOG);
+	} while (0);
+
+	free(s);
+	free(t);
+	unmap_file(map, size);
+
+	return rc;
+}
+
+void
+MSIM_AVR_SnapFree(struct MSIM_AVR_Snap *snap)
+{
+	free(snap->state);
+	free(snap->pm);
+	free(snap->timers);
+	snap->state = NULL;
+	snap->pm = NULL;
+	snap->timers = NULL;
+	snap->mcu = NULL;
+	snap->pm_size = 0;
+	snap->timers_num = 0;
+}
+
+void
+MSIM_AVR_SnapTouch(struct MSIM_AVR *mcu, uint32_t addr, uint32_t words)
+{
+	uint32_t last;
+
+	if ((words == 0U) || (addr >= mcu->pm_size)) {
+		return;
+	}
+	last = ((words < (mcu->pm_size - addr)) ? (addr + words) :
+	        mcu->pm_size) - 1;
+
+	for (uint32_t p = addr / MSIM_AVR_SNAP_PAGESZ;
+	                p <= (last / MSIM_AVR_SNAP_PAGESZ); p++) {
+		mcu->pm_dirty[p >> 3] = (uint8_t)(mcu->pm_dirty[p >> 3] |
+		                                  (1U << (p & 7U)));
+	}
+}
+
+/* Returns a fingerprint of the layout of the MCU state (see CKPT_LAYOUT). */
+static uint64_t
+ckpt_layout(void)
+{
+	uint64_t h = 14695981039346656037ULL;
+
+	CKPT_LAYOUT(CKPT_MEMBER)
+#ifdef DEBUG
+	CKPT_MEMBER(MSIM_AVR, last_pc)
+#endif
+	h = hash_member(h, sizeof(MSIM_AVR), sizeof(MSIM_AVR_TMR));
+
+	return h;
+}
+
+/* Adds an offset and size of a member to the FNV-1a hash. */
+static uint64_t
+hash_member(uint64_t h, size_t off, size_t size)
+{
+	const uint64_t v[] = { off, size };
+
+	for (uint32_t i = 0; i < ARRSZ(v); i++) {
+		for (uint32_t b = 0; b < 64; b += 8) {
+			h ^= (v[i] >> b) & 0xFFU;
+			h *= 1099511628211ULL;
+		}
+	}
+
+	return h;
+}
+
+/* Returns size of the bitmap of modified PM pages, in bytes. */
+static uint32_t
+dirty_size(struct MSIM_AVR *mcu)
+{
+	const uint32_t pages = (mcu->pm_size + MSIM_AVR_SNAP_PAGESZ - 1) /
+	                       MSIM_AVR_SNAP_PAGESZ;
+
+	return (pages + 7) >> 3;
+}
+
+/* Copies pages of PM modified since the latest snapshot (or all of them)
+ * back to the MCU. */
+static void
+restore_pm(struct MSIM_AVR *mcu, const uint16_t *pm, uint8_t full)
+{
+	const uint32_t pages = (mcu->pm_size + MSIM_AVR_SNAP_PAGESZ - 1) /
+	                       MSIM_AVR_SNAP_PAGESZ;
+	uint32_t addr, words;
+
+	for (uint32_t p = 0; p < pages; p++) {
+		if ((full == 0U) && (((mcu->pm_dirty[p >> 3] >> (p & 7U)) &
+		                      1U) == 0U)) {
+			continue;
+		}
+		addr = p * MSIM_AVR_SNAP_PAGESZ;
+		words = mcu->pm_size - addr;
+		words = (words < MSIM_AVR_SNAP_PAGESZ) ? words :
+		        MSIM_AVR_SNAP_PAGESZ;
+		memcpy(&mcu->pm[addr], &pm[addr], words * sizeof *mcu->pm);
+		MSIM_AVR_FlushDecoded(mcu, addr, words);
+	}
+	memset(mcu->pm_dirty, 0, dirty_size(mcu));
+}
+
+/* Copies the MCU state back. Details of the instance past the arena aren't
+ * a part of the state, so they're kept. */
+static void
+restore_state(struct MSIM_AVR *mcu, const struct MSIM_AVR *s,
+              const struct MSIM_AVR_TMR *timers)
+{
+	const size_t dm_off = offsetof(struct MSIM_AVR, dm);
+	uint32_t bp_num = mcu->bp_num;
+	uint32_t snap_seq = mcu->snap_seq;
+
+	/* Used part of the data memory only */
+	copy_state(mcu, s, 0, dm_off);
+	copy_state(mcu, s, dm_off, dm_off + mcu->ramend + 1);
+	copy_state(mcu, s, dm_off + sizeof mcu->dm,
+	           offsetof(struct MSIM_AVR, arena));
+	memcpy(mcu->timers, timers, mcu->timers_num * sizeof *mcu->timers);
+
+	mcu->bp_num = bp_num;
+	mcu->snap_seq = snap_seq;
+}
+
+/* Replaces pointers of the state read from a checkpoint with the ones of
+ * the MCU instance. Details of the instance which are configured rather
+ * than simulated are also taken from the MCU. */
+static void
+relink(struct MSIM_AVR *s, const struct MSIM_AVR *mcu)
+{
+	s->log = mcu->log;
+	s->spmcsr = mcu->spmcsr;
+	s->sreg = mcu->sreg;
+	s->sph = mcu->sph;
+	s->spl = mcu->spl;
+	s->eind = mcu->eind;
+	s->rampz = mcu->rampz;
+	s->rampy = mcu->rampy;
+	s->rampx = mcu->rampx;
+	s->rampd = mcu->rampd;
+	s->pm = mcu->pm;
+	s->pmp = mcu->pmp;
+	s->dpm = mcu->dpm;
+	s->pm_dirty = mcu->pm_dirty;
+	s->bp = mcu->bp;
+	s->set_fusef = mcu->set_fusef;
+	s->set_lockf = mcu->set_lockf;
+	s->tick_perf = mcu->tick_perf;
+	s->idle_perf = mcu->idle_perf;
+	s->skip_perf = mcu->skip_perf;
+	s->pass_irqs = mcu->pass_irqs;
+	s->reset_spm = mcu->reset_spm;
+	s->intr.trap_at_isr = mcu->intr.trap_at_isr;
+	s->vcd = mcu->vcd;
+	s->pty = mcu->pty;
+	s->ioregs = mcu->ioregs;
+	s->timers = mcu->timers;
+}
+
+#ifdef WITH_POSIX
+/* Maps a file to memory to be read. */
+static void *
+map_file(const char *file, size_t *size)
+{
+	struct stat st;
+	void *map = NULL;
+	int fd;
+
+	fd = open(file, O_RDONLY);
+	if (fd >= 0) {
+		if ((fstat(fd, &st) == 0) && (st.st_size > 0)) {
+			*size = (size_t)st.st_size;
+			map = mmap(NULL, *size, PROT_READ, MAP_PRIVATE, fd, 0);
+			map = (map == MAP_FAILED) ? NULL : map;
+		}
+		close(fd);
+	}
+
+	return map;
+}
+
+static void
+unmap_file(void *map, size_t size)
+{
+	if (map != NULL) {
+		munmap(map, size);
+	}
+}
+#else
+/* Reads the whole file to memory. */
+static void *
+map_file(const char *file, size_t *size)
+{
+	FILE *f = fopen(file, "rb");
+	void *map = NULL;
+	long len;
+
+	if (f != NULL) {
+		if ((fseek(f, 0, SEEK_END) == 0) && ((len = ftell(f)) > 0) &&
+		                (fseek(f, 0, SEEK_SET) == 0)) {
+			*size = (size_t)len;
+			map = malloc(*size);
+		}
+		if ((map != NULL) && (fread(map, *size, 1, f) != 1U)) {
+			free(map);
+			map = NULL;
+		}
+		fclose(f);
+	}
+
+	return map;
+}
+
+static void
+unmap_file(void *map, size_t size)
+{
+	(void)size;
+	free(map);
+}
+#endif /* WITH_POSIX */
+
+/* Copies a part of the MCU state between the given offsets. */
+static void
+copy_state(struct MSIM_AVR *mcu, const struct MSIM_AVR *s,
+           size_t from, size_t to)
+{
+	memcpy((uint8_t *)mcu + from, (const uint8_t *)s + from, to - from);
+}
@@ -18,12 +18,14 @@
  */
 
 /* A model-independent AVR timer. */
+#include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
 #include <string.h>
 #include <inttypes.h>
 
 #include "mcusim/mcusim.h"
+#include "mcusim/log.h"
 #include "mcusim/avr/sim/timer.h"
 #include "mcusim/avr/sim/private/macro.h"
 #include "mcusim/avr/sim/private/io_macro.h"
@@ -45,7 +47,12 @@
 	.settov_at = UPD_ATBOTTOM,					\
 };
 
+/* Timer is stopped, nothing happens until its registers are written */
+#define IDLE_STOPPED		UINT32_MAX
+
 static int	update_timer(MSIM_AVR *, MSIM_AVR_TMR *);
+static void	write_tmr(MSIM_AVR *, uint32_t, uint8_t);
+static int	watch_reg(MSIM_AVR *, MSIM_AVR_IOBit *, uint32_t);
 static void	mode_nonpwm_pwm(MSIM_AVR *, MSIM_AVR_TMR *);
 static void	update_ocr_buffers(MSIM_AVR *, MSIM_AVR_TMR *);
 static int	update_ocr_buffer(MSIM_AVR *, MSIM_AVR_TMR *, uint32_t);
@@ -64,13 +71,9 @@ MSIM_AVR_TMRUpdate(struct MSIM_AVR *mcu)
 {
 	int rc = 0;
 
-	for (uint32_t i = 0; i < MSIM_AVR_MAXTMRS; i++) {
+	for (uint32_t i = 0; i < mcu->timers_num; i++) {
 		MSIM_AVR_TMR *tmr = &mcu->timers[i];
 
-		if (IS_IONOBITA(tmr->tcnt)) {
-			break;
-		}
-
 		rc = update_timer(mcu, tmr);
 		if (rc != 0) {
 			break;
@@ -80,14 +83,77 @@ MSIM_AVR_TMRUpdate(struct MSIM_AVR *mcu)
 	return rc;
 }
 
+/* Returns a number of the timers available in the MCU. */
+uint32_t
+MSIM_AVR_TMRNum(struct MSIM_AVR *mcu)
+{
+	return mcu->timers_num;
+}
+
+/*
+ * Returns a number of cycles during which none of the timers does anything
+ * observable (overflow, compare match, counting, etc.), unless their
+ * registers are written.
+ */
+uint32_t
+MSIM_AVR_TMRIdle(struct MSIM_AVR *mcu)
+{
+	uint32_t idle = IDLE_STOPPED;
+
+	for (uint32_t i = 0; i < mcu->timers_num; i++) {
+		MSIM_AVR_TMR *tmr = &mcu->timers[i];
+
+		if (IS_IONOBITA(tmr->cs)) {
+			continue;
+		}
+		idle = (tmr->idle < idle) ? tmr->idle : idle;
+	}
+
+	return idle;
+}
+
+/*
+ * Skips the given number of cycles of the idle timers. It shouldn't be
+ * more than a number of cycles reported by MSIM_AVR_TMRIdle().
+ */
+void
+MSIM_AVR_TMRSkip(struct MSIM_AVR *mcu, uint32_t cycles)
+{
+	for (uint32_t i = 0; i < mcu->timers_num; i++) {
+		MSIM_AVR_TMR *tmr = &mcu->timers[i];
+
+		if (IS_IONOBITA(tmr->cs) || (tmr->idle == IDLE_STOPPED)) {
+			continue;
+		}
+		tmr->idle -= cycles;
+		tmr->scnt += cycles;
+	}
+}
+
 static int
 update_timer(struct MSIM_AVR *mcu, struct MSIM_AVR_TMR *tmr)
 {
 	struct MSIM_AVR_TMR_WGM wgm8 = FAKE_WGM8;
 	struct MSIM_AVR_TMR_WGM wgm16 = FAKE_WGM16;
 	uint32_t wgm, dis;
+	uint32_t idle = 0;
 	int rc = 0;
 
+	/*
+	 * Nothing observable happens on this cycle if the timer is idle
+	 * (waiting for the next prescaled clock or stopped) and none of
+	 * its registers has been written (see write_tmr). Lua models
+	 * write the registers directly.
+	 */
+	if ((tmr->idle > 0U) && (MSIM_AVR_LUAModels(mcu) == 0U)) {
+		if (tmr->idle != IDLE_STOPPED) {
+			tmr->idle--;
+			tmr->scnt++;
+		}
+		return rc;
+	}
+	tmr->idle = 0;
+
 	do {
 		/* Timer can be undefined... */
 		if (IS_IONOBITA(tmr->cs)) {
@@ -104,6 +170,7 @@ update_timer(struct MSIM_AVR *mcu, struct MSIM_AVR_TMR *tmr)
 				update_ocr_buffers(mcu, tmr);
 				update_wgm_buffers(mcu, tmr);
 				int_reset_pending(mcu, tmr);
+				idle = IDLE_STOPPED;
 				break;
 			}
 		}
@@ -120,6 +187,7 @@ update_timer(struct MSIM_AVR *mcu, struct MSIM_AVR_TMR *tmr)
 			update_ocr_buffers(mcu, tmr);
 			update_wgm_buffers(mcu, tmr);
 			int_reset_pending(mcu, tmr);
+			idle = IDLE_STOPPED;
 			break;
 		} else {
 			tmr->presc = 1<<(tmr->cs_div[cs]);
@@ -147,6 +215,14 @@ update_timer(struct MSIM_AVR *mcu, struct MSIM_AVR_TMR *tmr)
 		case WGM_PCPWM:
 		case WGM_PFCPWM:
 			mode_nonpwm_pwm(mcu, tmr);
+
+			/*
+			 * Cycles before the one to raise pending interrupts
+			 * are used to count system clock only.
+			 */
+			if ((tmr->presc > 2U) && (tmr->scnt < (tmr->presc-2U))) {
+				idle = tmr->presc - 2U - tmr->scnt;
+			}
 			break;
 		default:
 			break;
@@ -156,6 +232,100 @@ update_timer(struct MSIM_AVR *mcu, struct MSIM_AVR_TMR *tmr)
 	/* "Old" value of the Input Capture pin should be updated anyway. */
 	update_icp_value(mcu, tmr);
 
+	/* Timer is woken up earlier if any of its registers is written */
+	tmr->idle = idle;
+
+	return rc;
+}
+
+/*
+ * Wakes the timers up, i.e. they're updated on the next cycle. It should
+ * be called each time a register which may affect them is changed
+ * (written by firmware, GDB, changed input capture pin, etc.).
+ */
+void
+MSIM_AVR_TMRWake(struct MSIM_AVR *mcu)
+{
+	for (uint32_t i = 0; i < mcu->timers_num; i++) {
+		mcu->timers[i].idle = 0;
+	}
+}
+
+/*
+ * Watches I/O registers which may affect the timers (clock source,
+ * waveform generation mode, counter, output compare, etc.) in order to
+ * wake them up once these registers are written.
+ */
+int
+MSIM_AVR_TMRWatch(struct MSIM_AVR *mcu)
+{
+	MSIM_AVR_TMR *tmr;
+	struct MSIM_AVR_TMR_WGM *wgm;
+	struct MSIM_AVR_TMR_COMP *comp;
+	int rc = 0;
+
+	for (uint32_t i = 0; (rc == 0) && (i < mcu->timers_num); i++) {
+		tmr = &mcu->timers[i];
+
+		rc |= watch_reg(mcu, &tmr->disabled, 1);
+		rc |= watch_reg(mcu, tmr->cs, ARRSZ(tmr->cs));
+		rc |= watch_reg(mcu, tmr->wgm, ARRSZ(tmr->wgm));
+		rc |= watch_reg(mcu, tmr->tcnt, ARRSZ(tmr->tcnt));
+		for (uint32_t k = 0; k < ARRSZ(tmr->comp); k++) {
+			comp = &tmr->comp[k];
+			if (IS_NOCOMP(comp)) {
+				break;
+			}
+			rc |= watch_reg(mcu, comp->ocr, ARRSZ(comp->ocr));
+		}
+		for (uint32_t k = 0; k < ARRSZ(tmr->wgm_op); k++) {
+			wgm = &tmr->wgm_op[k];
+			if (IS_NOWGM(wgm)) {
+				break;
+			}
+			rc |= watch_reg(mcu, wgm->rtop, ARRSZ(wgm->rtop));
+		}
+	}
+
+	return rc;
+}
+
+/* Register of a timer is written. */
+static void
+write_tmr(struct MSIM_AVR *mcu, uint32_t reg, uint8_t old)
+{
+	(void)reg;
+	(void)old;
+
+	MSIM_AVR_TMRWake(mcu);
+}
+
+/* Installs the timers' hook for registers of the I/O bits. */
+static int
+watch_reg(struct MSIM_AVR *mcu, struct MSIM_AVR_IOBit *bit, uint32_t len)
+{
+	uint32_t reg;
+	int rc = 0;
+
+	for (uint32_t i = 0; i < len; i++) {
+		if (IS_IONOBIT(bit[i])) {
+			break;
+		}
+		reg = bit[i].reg;
+		if (!IS_IO(mcu, reg)) {
+			continue;
+		}
+		if ((mcu->ioregs[reg].write != NULL) &&
+		                (mcu->ioregs[reg].write != write_tmr)) {
+			snprintf(LOG, LOGSZ, "I/O register 0x%02" PRIX32
+			         " of the timer is watched already", reg);
+			MSIM_LOG_FATAL(LOG);
+			rc = -1;
+			break;
+		}
+		mcu->ioregs[reg].write = write_tmr;
+	}
+
 	return rc;
 }
 
@@ -18,6 +18,8 @@
  */
 
 /* Save samples of the AVR I/O registers to the VCD file. */
+#define _POSIX_C_SOURCE 200112L
+
 #include <stdint.h>
 #include <time.h>
 #include <inttypes.h>
@@ -38,11 +40,14 @@ MSIM_AVR_VCDOpen(struct MSIM_AVR *mcu)
 {
 	time_t timer;
 	struct tm *tm_info;
+#ifdef WITH_POSIX
+	struct tm tm_buf;
+#endif
 	uint32_t regs = MSIM_AVR_VCD_REGS;
 	uint8_t rh, rl, rv;
 	char buf[32];
 
-	struct MSIM_AVR_VCD *vcd = &mcu->vcd;
+	struct MSIM_AVR_VCD *vcd = mcu->vcd;
 	struct MSIM_AVR_VCDReg *reg;
 	FILE *f = NULL;
 
@@ -54,7 +59,12 @@ MSIM_AVR_VCDOpen(struct MSIM_AVR *mcu)
 	}
 
 	time(&timer);
+#ifdef WITH_POSIX
+	/* MCUs may be simulated by several threads */
+	tm_info = localtime_r(&timer, &tm_buf);
+#else
 	tm_info = localtime(&timer);
+#endif
 	strftime(buf, sizeof buf, "%Y-%m-%dT%H:%M:%S", tm_info);
 
 	/* Printing VCD header */
@@ -127,8 +137,8 @@ MSIM_AVR_VCDClose(struct MSIM_AVR *mcu)
 	int rc = 0;
 
 	/* Close dump file. */
-	if (mcu->vcd.dump != NULL) {
-		rc = fclose(mcu->vcd.dump);
+	if (mcu->vcd->dump != NULL) {
+		rc = fclose(mcu->vcd->dump);
 	}
 	return rc;
 }
@@ -142,7 +152,7 @@ MSIM_AVR_VCDDumpFrame(struct MSIM_AVR *mcu, uint64_t tick)
 	uint8_t rh, rl;
 	char buf[32];
 
-	struct MSIM_AVR_VCD *vcd = &mcu->vcd;
+	struct MSIM_AVR_VCD *vcd = mcu->vcd;
 	struct MSIM_AVR_VCDReg *reg;
 	FILE *f = vcd->dump;
 
@@ -0,0 +1,84 @@
+/*
+ * This file is part of MCUSim, an XSPICE library with microcontrollers.
+ *
+ * Copyright (C) 2017-2019 MCUSim Developers, see AUTHORS.txt for contributors.
+ *
+ * MCUSim is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MCUSim is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* Implementation of an arena to allocate memory blocks from. */
+#include <stdint.h>
+#include <stdlib.h>
+#include "mcusim/arena.h"
+
+/* Chunk of memory which blocks are allocated from. */
+struct MSIM_ArenaChunk {
+	struct MSIM_ArenaChunk *next;	/* Previous chunk of the arena */
+	size_t size;			/* Size of the data, in bytes */
+	size_t used;			/* Bytes given away already */
+	unsigned char data[];		/* Memory to allocate blocks from */
+};
+
+void *
+MSIM_ARENA_Alloc(struct MSIM_ARENA *a, size_t size)
+{
+	struct MSIM_ArenaChunk *c = a->head;
+	uintptr_t p;
+	size_t pad = 0;
+	size_t csz;
+
+	if (c != NULL) {
+		p = (uintptr_t)&c->data[c->used];
+		pad = (size_t)((MSIM_ARENA_ALIGN -
+		                (p % MSIM_ARENA_ALIGN)) % MSIM_ARENA_ALIGN);
+	}
+
+	/* Start a new chunk if the block doesn't fit */
+	if ((c == NULL) || ((c->size - c->used) < (size + pad))) {
+		csz = size + MSIM_ARENA_ALIGN;
+		csz = (csz < MSIM_ARENA_CHUNKSZ) ? MSIM_ARENA_CHUNKSZ : csz;
+
+		c = calloc(1, sizeof *c + csz);
+		if (c == NULL) {
+			return NULL;
+		}
+		c->size = csz;
+		c->next = a->head;
+		a->head = c;
+
+		p = (uintptr_t)&c->data[0];
+		pad = (size_t)((MSIM_ARENA_ALIGN -
+		                (p % MSIM_ARENA_ALIGN)) % MSIM_ARENA_ALIGN);
+	}
+
+	c->used += pad;
+	p = (uintptr_t)&c->data[c->used];
+	c->used += size;
+
+	return (void *)p;
+}
+
+void
+MSIM_ARENA_Free(struct MSIM_ARENA *a)
+{
+	struct MSIM_ArenaChunk *c = a->head;
+	struct MSIM_ArenaChunk *next;
+
+	while (c != NULL) {
+		next = c->next;
+		free(c);
+		c = next;
+	}
+	a->head = NULL;
+}
@@ -0,0 +1,477 @@
+/*
+ * This file is part of MCUSim, an XSPICE library with microcontrollers.
+ *
+ * Copyright (C) 2017-2019 MCUSim Developers, see AUTHORS.txt for contributors.
+ *
+ * MCUSim is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MCUSim is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Batch runner of the firmware tests. Simulations listed in a manifest are
+ * run by a pool of threads within a single process and a summary of them
+ * is printed in CSV format.
+ *
+ * Each non-empty line of the manifest (except the ones started with '#')
+ * describes a simulation to be run in the firmware test mode:
+ *
+ *	<config file> [<firmware file> [<Lua model> ...]]
+ *
+ * Firmware file replaces the configured one and Lua models are loaded in
+ * addition to the configured ones. Relative paths are resolved from the
+ * working directory of the runner.
+ */
+#define _POSIX_C_SOURCE 200112L
+#define _XOPEN_SOURCE 600
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "mcusim/mcusim.h"
+#include "mcusim/getopt.h"
+#include "mcusim/config.h"
+
+#define LINESZ			(64*1024)	/* Manifest line, max */
+
+/* Command line options */
+#define CLI_OPTIONS		":j:o:v"
+#define VERSION_OPT		7576
+#define PRINT_USAGE_OPT		7580
+
+/* Result of a simulation */
+enum job_result {
+	JOB_PASSED	= 0,		/* MCU stopped (AVR_MSIM_STOP) */
+	JOB_FAILED	= 1,		/* Test failed (AVR_MSIM_TESTFAIL) */
+	JOB_ERROR	= 2		/* Simulation couldn't be run */
+};
+
+/* Simulation listed in the manifest */
+struct job {
+	char *conf;			/* Config file */
+	char *args;			/* Firmware and Lua models */
+	uint32_t line;			/* Line of the manifest */
+	enum job_result result;		/* Result of the simulation */
+	uint64_t cycles;		/* Cycles simulated */
+	double wall;			/* Wall time, in seconds */
+};
+
+/* Simulations to be taken by the threads */
+struct pool {
+	struct job *jobs;
+	uint32_t jobs_num;
+	uint32_t next;			/* Next job to be taken */
+	pthread_mutex_t mutex;		/* Lock before taking a job */
+};
+
+/* Long command line options */
+static struct MSIM_OPT_Option longopts[] = {
+	{ "version", MSIM_OPT_NO_ARGUMENT, NULL, VERSION_OPT },
+	{ "help", MSIM_OPT_NO_ARGUMENT, NULL, PRINT_USAGE_OPT },
+};
+
+static const char *result_names[] = { "passed", "failed", "error" };
+
+static struct pool pool;
+
+static void	print_usage(void);
+static void	print_short_usage(void);
+static int	read_manifest(const char *file);
+static void	*worker(void *arg);
+static void	run_job(struct MSIM_AVR *mcu, struct MSIM_CFG *cfg,
+		        struct job *job);
+static double	wall_time(void);
+
+int
+main(int argc, char *argv[])
+{
+	pthread_t *threads = NULL;
+	uint32_t threads_num = 0, started = 0, failed = 0;
+	unsigned long val;
+	char *summary = NULL, *end;
+	FILE *out = stdout;
+	char msg[128];
+	int c, rc = 0;
+
+	/* Summary is the output, not the details of simulations */
+	MSIM_LOG_SetLevel(MSIM_LOG_LVLWARNING);
+
+	/* Read command line arguments */
+	c = MSIM_OPT_Getopt_long(argc, argv, CLI_OPTIONS, longopts, NULL);
+	while (c != -1) {
+		switch (c) {
+		case ':':		/* Missing operand */
+		case '?':		/* Unknown option */
+			MSIM_CFG_OptError(c);
+			return 1;
+		case 'j':
+			val = strtoul(MSIM_OPT_optarg, &end, 10);
+			if ((*end != 0) || (val == 0U) || (val > 1024U)) {
+				snprintf(msg, sizeof msg, "invalid number "
+				         "of threads: %s", MSIM_OPT_optarg);
+				MSIM_LOG_FATAL(msg);
+				return 1;
+			}
+			threads_num = (uint32_t)val;
+			break;
+		case 'o':
+			summary = MSIM_OPT_optarg;
+			break;
+		case 'v':
+			MSIM_LOG_SetLevel(MSIM_LOG_LVLINFO);
+			break;
+		case VERSION_OPT:
+			print_short_usage();
+			return 2;
+		case PRINT_USAGE_OPT:
+			print_usage();
+			return 2;
+		default:
+			MSIM_CFG_OptError(c);
+			break;
+		}
+		c = MSIM_OPT_Getopt_long(argc, argv, CLI_OPTIONS,
+		                         longopts, NULL);
+	}
+	if (MSIM_OPT_optind != (argc - 1)) {
+		print_short_usage();
+		return 1;
+	}
+
+	do {
+		rc = read_manifest(argv[MSIM_OPT_optind]);
+		if (rc != 0) {
+			break;
+		}
+		if (summary != NULL) {
+			out = fopen(summary, "w");
+			if (out == NULL) {
+				snprintf(msg, sizeof msg, "can't write "
+				         "summary: %s", summary);
+				MSIM_LOG_FATAL(msg);
+				rc = 1;
+				break;
+			}
+		}
+
+		/* Thread per online CPU by default */
+		if (threads_num == 0U) {
+			const long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+			threads_num = (cpus > 0) ? (uint32_t)cpus : 1U;
+		}
+		if (threads_num > pool.jobs_num) {
+			threads_num = (pool.jobs_num > 0U) ? pool.jobs_num : 1U;
+		}
+
+		threads = malloc(threads_num * sizeof *threads);
+		if (threads == NULL) {
+			MSIM_LOG_FATAL("failed to allocate memory for "
+			               "threads");
+			rc = 1;
+			break;
+		}
+
+		/* Threads take the next job once their job is done */
+		pthread_mutex_init(&pool.mutex, NULL);
+		for (started = 0; started < threads_num; started++) {
+			if (pthread_create(&threads[started], NULL, worker,
+			                   NULL) != 0) {
+				break;
+			}
+		}
+		if (started == 0U) {
+			MSIM_LOG_FATAL("failed to start threads");
+			rc = 1;
+		}
+		for (uint32_t i = 0; i < started; i++) {
+			pthread_join(threads[i], NULL);
+		}
+		pthread_mutex_destroy(&pool.mutex);
+		if (rc != 0) {
+			break;
+		}
+
+		/* Jobs are reported in order of the manifest */
+		fprintf(out, "line,config,result,cycles,wall_s\n");
+		for (uint32_t i = 0; i < pool.jobs_num; i++) {
+			const struct job *job = &pool.jobs[i];
+
+			fprintf(out, "%" PRIu32 ",%s,%s,%" PRIu64 ",%.3f\n",
+			        job->line, job->conf,
+			        result_names[job->result], job->cycles,
+			        job->wall);
+			failed += (job->result != JOB_PASSED) ? 1U : 0U;
+		}
+
+		snprintf(msg, sizeof msg, "%" PRIu32 " of %" PRIu32 " jobs "
+		         "failed, %" PRIu32 " threads", failed, pool.jobs_num,
+		         started);
+		MSIM_LOG_INFO(msg);
+		rc = (failed > 0U) ? 1 : 0;
+	} while (0);
+
+	if ((out != stdout) && (out != NULL)) {
+		fclose(out);
+	}
+	for (uint32_t i = 0; i < pool.jobs_num; i++) {
+		free(pool.jobs[i].conf);
+	}
+	free(pool.jobs);
+	free(threads);
+
+	return rc;
+}
+
+/* Reads the jobs from the manifest file. */
+static int
+read_manifest(const char *file)
+{
+	struct job *jobs;
+	uint32_t cap = 0, line = 0;
+	size_t len;
+	char msg[1024];
+	char *buf, *s, *e;
+	FILE *f;
+	int rc = 0;
+
+	buf = malloc(LINESZ);
+	f = fopen(file, "r");
+	do {
+		if ((buf == NULL) || (f == NULL)) {
+			snprintf(msg, sizeof msg, "can't read manifest: %s",
+			         file);
+			MSIM_LOG_FATAL(msg);
+			rc = 1;
+			break;
+		}
+
+		while (fgets(buf, LINESZ, f) != NULL) {
+			line++;
+			len = strlen(buf);
+			if ((len > 0U) && (buf[len - 1] == '\n')) {
+				buf[--len] = 0;
+			} else if (!feof(f)) {
+				snprintf(msg, sizeof msg, "line %" PRIu32 " of "
+				         "manifest is too long", line);
+				MSIM_LOG_FATAL(msg);
+				rc = 1;
+				break;
+			}
+
+			/* Skip empty lines and comments */
+			s = buf + strspn(buf, " \t\r");
+			if ((*s == 0) || (*s == '#')) {
+				continue;
+			}
+
+			if (pool.jobs_num == cap) {
+				cap = (cap > 0U) ? (cap * 2U) : 64U;
+				jobs = realloc(pool.jobs, cap * sizeof *jobs);
+				if (jobs == NULL) {
+					rc = 1;
+					break;
+				}
+				pool.jobs = jobs;
+			}
+
+			/* Config file is followed by the rest of the job */
+			len = strlen(s) + 1;
+			memset(&pool.jobs[pool.jobs_num], 0, sizeof *jobs);
+			pool.jobs[pool.jobs_num].conf = malloc(len);
+			if (pool.jobs[pool.jobs_num].conf == NULL) {
+				rc = 1;
+				break;
+			}
+			memcpy(pool.jobs[pool.jobs_num].conf, s, len);
+
+			e = pool.jobs[pool.jobs_num].conf;
+			e += strcspn(e, " \t\r");
+			if (*e != 0) {
+				*e++ = 0;
+			}
+			pool.jobs[pool.jobs_num].args = e;
+			pool.jobs[pool.jobs_num].line = line;
+			pool.jobs[pool.jobs_num].result = JOB_ERROR;
+			pool.jobs_num++;
+		}
+		if (rc != 0) {
+			break;
+		}
+
+		if (pool.jobs_num == 0U) {
+			snprintf(msg, sizeof msg, "no jobs in manifest: %s",
+			         file);
+			MSIM_LOG_WARN(msg);
+		}
+	} while (0);
+
+	if (f != NULL) {
+		fclose(f);
+	}
+	free(buf);
+
+	return rc;
+}
+
+/* Runs the jobs until there are no more of them. */
+static void *
+worker(void *arg)
+{
+	struct MSIM_AVR *mcu = malloc(sizeof *mcu);
+	struct MSIM_CFG *cfg = malloc(sizeof *cfg);
+	struct job *job;
+
+	while ((mcu != NULL) && (cfg != NULL)) {
+		pthread_mutex_lock(&pool.mutex);
+		job = (pool.next < pool.jobs_num) ? &pool.jobs[pool.next++] :
+		      NULL;
+		pthread_mutex_unlock(&pool.mutex);
+
+		if (job == NULL) {
+			break;
+		}
+		run_job(mcu, cfg, job);
+	}
+	if ((mcu == NULL) || (cfg == NULL)) {
+		MSIM_LOG_ERROR("failed to allocate memory for MCU");
+	}
+
+	free(mcu);
+	free(cfg);
+	return NULL;
+}
+
+/* Simulates the MCU of the job from scratch. */
+static void
+run_job(struct MSIM_AVR *mcu, struct MSIM_CFG *cfg, struct job *job)
+{
+	const double start = wall_time();
+	const char *args = job->args;
+	char msg[MSIM_CFG_TOKSZ + 128];
+	char tok[MSIM_CFG_TOKSZ];
+	FILE *f;
+	int rc = 0, tr;
+
+	/* MCU and its config aren't shared by the jobs */
+	memset(mcu, 0, sizeof *mcu);
+	memset(cfg, 0, sizeof *cfg);
+	cfg->rsp_port = MSIM_CFG_RSP_PORT;
+
+	do {
+		/* Config is read from the working directory if there is
+		 * no such file, it isn't the job */
+		f = fopen(job->conf, "r");
+		if (f == NULL) {
+			snprintf(msg, sizeof msg, "line %" PRIu32 ": failed "
+			         "to open config: %s", job->line, job->conf);
+			MSIM_LOG_ERROR(msg);
+			rc = 1;
+			break;
+		}
+		fclose(f);
+
+		rc = MSIM_CFG_Read(cfg, job->conf);
+		if (rc != 0) {
+			break;
+		}
+
+		/* Firmware and Lua models of the job */
+		for (uint32_t k = 0; (tr = MSIM_CFG_NextToken(&args, tok,
+	                                          sizeof tok)) == 0; k++) {
+			if (k == 0U) {
+				memcpy(cfg->firmware_file, tok, sizeof tok);
+				cfg->has_firmware_file = 1;
+				cfg->reset_flash = 1;
+			} else if (cfg->lua_models_num < MSIM_AVR_LUAMODELS) {
+				memcpy(cfg->lua_models[cfg->lua_models_num++],
+				       tok, sizeof tok);
+			} else {
+				tr = -1;
+				break;
+			}
+		}
+		if (tr < 0) {
+			snprintf(msg, sizeof msg, "line %" PRIu32 ": too "
+			         "long path or too many Lua models", job->line);
+			MSIM_LOG_ERROR(msg);
+			rc = 1;
+			break;
+		}
+
+		/* There is no debugger to wait for, jobs run at the same
+		 * time shouldn't write the same VCD file and nothing reads
+		 * their pseudo-terminals */
+		cfg->firmware_test = 1;
+		cfg->dump_regs_num = 0;
+		cfg->usart_pty = 0;
+
+		rc = MSIM_AVR_Init(mcu, cfg);
+		if (rc != 0) {
+			break;
+		}
+
+		rc = MSIM_AVR_Simulate(mcu, 1);
+		if (rc == 0) {
+			job->result = JOB_PASSED;
+		} else if (mcu->state == AVR_MSIM_TESTFAIL) {
+			job->result = JOB_FAILED;
+		} else {
+			/* Simulation error, not a result of the test */
+		}
+		job->cycles = mcu->tick;
+	} while (0);
+
+	if (mcu->pty != NULL) {
+		MSIM_PTY_Close(mcu->pty);
+	}
+	MSIM_AVR_LUACleanModels(mcu);
+	MSIM_AVR_Free(mcu);
+	job->wall = wall_time() - start;
+}
+
+/* Returns a monotonic time, in seconds. */
+static double
+wall_time(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + ((double)ts.tv_nsec / 1e9);
+}
+
+static void
+print_short_usage(void)
+{
+	printf("Usage: mcusim-batch --help\n");
+}
+
+static void
+print_usage(void)
+{
+	/* Print usage and options */
+	printf("Usage: mcusim-batch [options] <manifest>\n"
+	       "Options:\n"
+	       "  -j <threads>         Run jobs with this number of threads\n"
+	       "                       (online CPUs by default).\n"
+	       "  -o <summary_file>    Write summary to this file.\n"
+	       "  -v                   Print details of the simulations.\n"
+	       "  --help               Print this message.\n"
+	       "  --version            Print version.\n"
+	       "Each line of the manifest is a job:\n"
+	       "  <config_file> [<firmware_file> [<lua_model> ...]]\n");
+}
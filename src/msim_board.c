@@ -0,0 +1,810 @@
+/*
+ * This file is part of MCUSim, an XSPICE library with microcontrollers.
+ *
+ * Copyright (C) 2017-2019 MCUSim Developers, see AUTHORS.txt for contributors.
+ *
+ * MCUSim is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MCUSim is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Simulator of a board with several MCUs connected to each other. Each MCU
+ * is simulated by its own thread in the firmware test mode.
+ *
+ * MCUs are simulated in quanta of time: all of them are advanced by
+ * a quantum in parallel and data is exchanged between them while all of
+ * them are paused. Data sent within a quantum is received within the next
+ * one, i.e. a quantum should be shorter than a delay of the connection.
+ * It's bounded by a time to transmit a frame by the connected USARTs.
+ *
+ * Board file lists the MCUs and connections between them:
+ *
+ *	mcu <name> <config file>
+ *	usart <name> <name>
+ *	pin <name> <Pxn> <name> <Pxn>
+ *	quantum <nanoseconds>
+ *
+ * Pin of the first MCU drives pin of the second one while the first pin is
+ * configured as output and the second one as input. Relative paths are
+ * resolved from the working directory of the simulator.
+ */
+#define _POSIX_C_SOURCE 200112L
+#define _XOPEN_SOURCE 600
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <pthread.h>
+
+#include "mcusim/mcusim.h"
+#include "mcusim/getopt.h"
+#include "mcusim/config.h"
+
+#define LINESZ			8192		/* Board file line, max */
+#define NAMESZ			64		/* Name of the MCU, max */
+#define BOARD_MCUS		16		/* MCUs of the board, max */
+#define BOARD_PINS		128		/* Connected pins, max */
+#define QUANTUM_DEF		1000ULL		/* Quantum by default, ns */
+#define QUANTUM_MAX		1000000000ULL	/* Quantum, max (ns) */
+#define NS			1000000000ULL	/* Nanoseconds in a second */
+
+/* Command line options */
+#define CLI_OPTIONS		":t:"
+#define VERSION_OPT		7576
+#define PRINT_USAGE_OPT		7580
+
+/* Pin of the I/O port (offsets of the registers in data space) */
+struct pin {
+	uint32_t port;
+	uint32_t ddr;
+	uint32_t pin;
+	uint8_t bit;
+};
+
+/* Pin of the MCU connected to the pin of another MCU */
+struct pin_link {
+	uint32_t src;			/* MCU to drive the pin */
+	uint32_t dst;			/* MCU to read the pin */
+	char src_name[8];		/* Name of the pin, Pxn */
+	char dst_name[8];
+	struct pin src_pin;
+	struct pin dst_pin;
+};
+
+/* MCU of the board */
+struct board_mcu {
+	char name[NAMESZ];
+	char *conf;			/* Config file */
+	struct MSIM_AVR *mcu;
+	struct MSIM_CFG *cfg;
+	uint32_t usart;			/* MCU connected to USART */
+	struct MSIM_AVR_USARTLink link;	/* Data of the connected USART */
+	uint64_t target;		/* Tick to simulate the MCU until */
+	uint64_t frac;			/* Fraction of the tick, ns*Hz */
+	int rc;				/* Result of the simulation */
+	uint8_t done;			/* MCU stopped or test failed */
+	uint8_t inited;			/* MCU is initialized */
+	pthread_t thread;
+};
+
+/* MCUs of the board and the barrier to synchronize them */
+struct board {
+	struct board_mcu mcus[BOARD_MCUS];
+	uint32_t mcus_num;
+	struct pin_link pins[BOARD_PINS];
+	uint32_t pins_num;
+	uint64_t quantum;		/* Quantum of time, ns */
+
+	pthread_mutex_t mutex;		/* Lock before accessing fields below */
+	pthread_cond_t start;		/* Quantum is started */
+	pthread_cond_t end;		/* MCUs finished the quantum */
+	uint64_t quantum_n;		/* Number of the current quantum */
+	uint32_t running;		/* MCUs within the quantum */
+	uint8_t stop;			/* Threads should exit */
+};
+
+/* Long command line options */
+static struct MSIM_OPT_Option longopts[] = {
+	{ "version", MSIM_OPT_NO_ARGUMENT, NULL, VERSION_OPT },
+	{ "help", MSIM_OPT_NO_ARGUMENT, NULL, PRINT_USAGE_OPT },
+};
+
+static struct board board;
+
+static void	print_usage(void);
+static void	print_short_usage(void);
+static int	read_board(const char *file);
+static int	read_line(const char *line, uint32_t n);
+static int	find_mcu(const char *name);
+static int	init_mcu(struct board_mcu *m);
+static int	init_pins(void);
+static int	find_pin(struct MSIM_AVR *mcu, const char *name,
+		         struct pin *pin);
+static int	find_reg(struct MSIM_AVR *mcu, const char *name,
+		         uint32_t *reg);
+static int	simulate(uint64_t limit);
+static void	*mcu_thread(void *arg);
+static uint64_t	quantum_len(void);
+static void	exchange(void);
+static void	move_usart(struct MSIM_AVR_USARTLink *tx,
+		           struct MSIM_AVR_USARTLink *rx);
+static void	drive_pin(struct pin_link *l);
+
+int
+main(int argc, char *argv[])
+{
+	struct board_mcu *m;
+	uint64_t limit = 0;
+	uint32_t started = 0;
+	unsigned long long val;
+	char *end;
+	char msg[256];
+	int c, rc = 0;
+
+	/* Read command line arguments */
+	c = MSIM_OPT_Getopt_long(argc, argv, CLI_OPTIONS, longopts, NULL);
+	while (c != -1) {
+		switch (c) {
+		case ':':		/* Missing operand */
+		case '?':		/* Unknown option */
+			MSIM_CFG_OptError(c);
+			return 1;
+		case 't':
+			val = strtoull(MSIM_OPT_optarg, &end, 10);
+			if ((*end != 0) || (val == 0U)) {
+				snprintf(msg, sizeof msg, "invalid time to "
+				         "simulate: %s", MSIM_OPT_optarg);
+				MSIM_LOG_FATAL(msg);
+				return 1;
+			}
+			limit = (uint64_t)val;
+			break;
+		case VERSION_OPT:
+			print_short_usage();
+			return 2;
+		case PRINT_USAGE_OPT:
+			print_usage();
+			return 2;
+		default:
+			MSIM_CFG_OptError(c);
+			break;
+		}
+		c = MSIM_OPT_Getopt_long(argc, argv, CLI_OPTIONS,
+		                         longopts, NULL);
+	}
+	if (MSIM_OPT_optind != (argc - 1)) {
+		print_short_usage();
+		return 1;
+	}
+
+	pthread_mutex_init(&board.mutex, NULL);
+	pthread_cond_init(&board.start, NULL);
+	pthread_cond_init(&board.end, NULL);
+	board.quantum = QUANTUM_DEF;
+
+	do {
+		rc = read_board(argv[MSIM_OPT_optind]);
+		if (rc != 0) {
+			break;
+		}
+
+		for (uint32_t i = 0; i < board.mcus_num; i++) {
+			rc = init_mcu(&board.mcus[i]);
+			if (rc != 0) {
+				break;
+			}
+		}
+		if (rc != 0) {
+			break;
+		}
+		rc = init_pins();
+		if (rc != 0) {
+			break;
+		}
+
+		/* Thread per MCU */
+		for (started = 0; started < board.mcus_num; started++) {
+			m = &board.mcus[started];
+			if (pthread_create(&m->thread, NULL, mcu_thread,
+			                   m) != 0) {
+				MSIM_LOG_FATAL("failed to start thread");
+				rc = 1;
+				break;
+			}
+		}
+		if (rc == 0) {
+			rc = simulate(limit);
+		}
+
+		/* Threads exit once the quantum is finished */
+		pthread_mutex_lock(&board.mutex);
+		board.stop = 1;
+		pthread_cond_broadcast(&board.start);
+		pthread_mutex_unlock(&board.mutex);
+		for (uint32_t i = 0; i < started; i++) {
+			pthread_join(board.mcus[i].thread, NULL);
+		}
+	} while (0);
+
+	for (uint32_t i = 0; i < board.mcus_num; i++) {
+		m = &board.mcus[i];
+		if (m->inited == 1U) {
+			snprintf(msg, sizeof msg, "%s: %s, tick=%" PRIu64,
+			         m->name, (m->rc == 2) ? "stopped" :
+			         (m->rc != 0) ? "failed" : "running",
+			         m->mcu->tick);
+			MSIM_LOG_INFO(msg);
+
+			MSIM_AVR_VCDClose(m->mcu);
+			if (m->mcu->pty != NULL) {
+				MSIM_PTY_Close(m->mcu->pty);
+			}
+			MSIM_AVR_LUACleanModels(m->mcu);
+			MSIM_AVR_Free(m->mcu);
+		}
+		free(m->mcu);
+		free(m->cfg);
+		free(m->conf);
+	}
+	pthread_cond_destroy(&board.end);
+	pthread_cond_destroy(&board.start);
+	pthread_mutex_destroy(&board.mutex);
+
+	return rc;
+}
+
+/* Reads MCUs and connections of the board. */
+static int
+read_board(const char *file)
+{
+	uint32_t n = 0;
+	size_t len;
+	char msg[MSIM_CFG_TOKSZ + 128];
+	char *buf;
+	FILE *f;
+	int rc = 0;
+
+	buf = malloc(LINESZ);
+	f = fopen(file, "r");
+	do {
+		if ((buf == NULL) || (f == NULL)) {
+			snprintf(msg, sizeof msg, "can't read board: %s",
+			         file);
+			MSIM_LOG_FATAL(msg);
+			rc = 1;
+			break;
+		}
+
+		while ((rc == 0) && (fgets(buf, LINESZ, f) != NULL)) {
+			n++;
+			len = strlen(buf);
+			if ((len > 0U) && (buf[len - 1] == '\n')) {
+				buf[--len] = 0;
+			} else if (!feof(f)) {
+				snprintf(msg, sizeof msg, "line %" PRIu32 " of "
+				         "board is too long", n);
+				MSIM_LOG_FATAL(msg);
+				rc = 1;
+				break;
+			}
+			rc = read_line(buf, n);
+		}
+		if (rc != 0) {
+			break;
+		}
+
+		if (board.mcus_num == 0U) {
+			snprintf(msg, sizeof msg, "no MCUs on board: %s",
+			         file);
+			MSIM_LOG_FATAL(msg);
+			rc = 1;
+		}
+	} while (0);
+
+	if (f != NULL) {
+		fclose(f);
+	}
+	free(buf);
+
+	return rc;
+}
+
+/* Reads a line of the board file. */
+static int
+read_line(const char *line, uint32_t n)
+{
+	char tok[5][MSIM_CFG_TOKSZ];
+	char msg[MSIM_CFG_TOKSZ + 128];
+	struct board_mcu *m;
+	struct pin_link *l;
+	uint32_t toks = 0;
+	unsigned long long val;
+	char *end;
+	int a, b, tr, rc = 0;
+
+	/* Skip empty lines and comments */
+	line += strspn(line, " \t\r");
+	if ((*line == 0) || (*line == '#')) {
+		return 0;
+	}
+
+	while ((tr = MSIM_CFG_NextToken(&line, tok[toks % 5],
+	                                 MSIM_CFG_TOKSZ)) == 0) {
+		toks++;
+	}
+
+	do {
+		if ((tr < 0) || (toks > 5U)) {
+			snprintf(msg, sizeof msg, "line %" PRIu32 ": too "
+			         "long token or too many of them", n);
+			MSIM_LOG_FATAL(msg);
+			rc = 1;
+			break;
+		}
+
+		if ((strcmp(tok[0], "mcu") == 0) && (toks == 3U)) {
+			if ((strlen(tok[1]) >= NAMESZ) ||
+			                (find_mcu(tok[1]) >= 0) ||
+			                (board.mcus_num == BOARD_MCUS)) {
+				snprintf(msg, sizeof msg, "line %" PRIu32 ": "
+				         "too long or duplicate name, or too "
+				         "many MCUs: %s", n, tok[1]);
+				MSIM_LOG_FATAL(msg);
+				rc = 1;
+				break;
+			}
+			m = &board.mcus[board.mcus_num];
+			memcpy(m->name, tok[1], strlen(tok[1]) + 1);
+			m->conf = malloc(strlen(tok[2]) + 1);
+			if (m->conf == NULL) {
+				rc = 1;
+				break;
+			}
+			memcpy(m->conf, tok[2], strlen(tok[2]) + 1);
+			m->usart = UINT32_MAX;
+			board.mcus_num++;
+		} else if ((strcmp(tok[0], "usart") == 0) && (toks == 3U)) {
+			a = find_mcu(tok[1]);
+			b = find_mcu(tok[2]);
+			if ((a < 0) || (b < 0) || (a == b) ||
+			                (board.mcus[a].usart != UINT32_MAX) ||
+			                (board.mcus[b].usart != UINT32_MAX)) {
+				snprintf(msg, sizeof msg, "line %" PRIu32 ": "
+				         "USART can be connected to a single "
+				         "USART of another MCU", n);
+				MSIM_LOG_FATAL(msg);
+				rc = 1;
+				break;
+			}
+			board.mcus[a].usart = (uint32_t)b;
+			board.mcus[b].usart = (uint32_t)a;
+		} else if ((strcmp(tok[0], "pin") == 0) && (toks == 5U)) {
+			a = find_mcu(tok[1]);
+			b = find_mcu(tok[3]);
+			if ((a < 0) || (b < 0) || (strlen(tok[2]) >= 8U) ||
+			                (strlen(tok[4]) >= 8U) ||
+			                (board.pins_num == BOARD_PINS)) {
+				snprintf(msg, sizeof msg, "line %" PRIu32 ": "
+				         "unknown MCU, invalid pin or too many "
+				         "pins", n);
+				MSIM_LOG_FATAL(msg);
+				rc = 1;
+				break;
+			}
+			l = &board.pins[board.pins_num++];
+			l->src = (uint32_t)a;
+			l->dst = (uint32_t)b;
+			memcpy(l->src_name, tok[2], strlen(tok[2]) + 1);
+			memcpy(l->dst_name, tok[4], strlen(tok[4]) + 1);
+		} else if ((strcmp(tok[0], "quantum") == 0) && (toks == 2U)) {
+			val = strtoull(tok[1], &end, 10);
+			if ((*end != 0) || (val == 0U) ||
+			                (val > QUANTUM_MAX)) {
+				snprintf(msg, sizeof msg, "line %" PRIu32 ": "
+				         "quantum should be 1..%llu ns", n,
+				         QUANTUM_MAX);
+				MSIM_LOG_FATAL(msg);
+				rc = 1;
+				break;
+			}
+			board.quantum = (uint64_t)val;
+		} else {
+			snprintf(msg, sizeof msg, "line %" PRIu32 ": unknown "
+			         "line of the board: %s", n, tok[0]);
+			MSIM_LOG_FATAL(msg);
+			rc = 1;
+			break;
+		}
+	} while (0);
+
+	return rc;
+}
+
+/* Returns an index of the MCU with the given name or -1. */
+static int
+find_mcu(const char *name)
+{
+	for (uint32_t i = 0; i < board.mcus_num; i++) {
+		if (strcmp(board.mcus[i].name, name) == 0) {
+			return (int)i;
+		}
+	}
+	return -1;
+}
+
+/* Initializes the MCU from its config file. */
+static int
+init_mcu(struct board_mcu *m)
+{
+	const struct MSIM_AVR_VCD *vcd;
+	char msg[MSIM_CFG_TOKSZ + 128];
+	FILE *f;
+	int rc = 0;
+
+	do {
+		m->mcu = malloc(sizeof *m->mcu);
+		m->cfg = malloc(sizeof *m->cfg);
+		if ((m->mcu == NULL) || (m->cfg == NULL)) {
+			MSIM_LOG_FATAL("failed to allocate memory for MCU");
+			rc = 1;
+			break;
+		}
+		memset(m->mcu, 0, sizeof *m->mcu);
+		memset(m->cfg, 0, sizeof *m->cfg);
+		m->cfg->rsp_port = MSIM_CFG_RSP_PORT;
+
+		/* Config isn't read from the working directory if there
+		 * is no such file */
+		f = fopen(m->conf, "r");
+		if (f == NULL) {
+			snprintf(msg, sizeof msg, "%s: failed to open config: "
+			         "%s", m->name, m->conf);
+			MSIM_LOG_FATAL(msg);
+			rc = 1;
+			break;
+		}
+		fclose(f);
+
+		rc = MSIM_CFG_Read(m->cfg, m->conf);
+		if (rc != 0) {
+			break;
+		}
+
+		/* There is no debugger to wait for */
+		m->cfg->firmware_test = 1;
+
+		rc = MSIM_AVR_Init(m->mcu, m->cfg);
+		if (rc != 0) {
+			snprintf(msg, sizeof msg, "%s: failed to initialize "
+			         "MCU", m->name);
+			MSIM_LOG_FATAL(msg);
+			break;
+		}
+		m->inited = 1;
+		m->mcu->state = AVR_RUNNING;
+
+		/* USART is connected to another MCU */
+		if (m->usart != UINT32_MAX) {
+			m->mcu->usart_link = &m->link;
+		}
+
+		vcd = m->mcu->vcd;
+		if (vcd->regs[0].i >= 0) {
+			rc = MSIM_AVR_VCDOpen(m->mcu);
+			if (rc != 0) {
+				snprintf(msg, sizeof msg, "%s: can't open VCD "
+				         "file: '%s'", m->name, vcd->dump_file);
+				MSIM_LOG_FATAL(msg);
+				break;
+			}
+		}
+	} while (0);
+
+	return rc;
+}
+
+/* Finds registers of the connected pins. */
+static int
+init_pins(void)
+{
+	struct pin_link *l;
+	char msg[256];
+	int rc = 0;
+
+	for (uint32_t i = 0; i < board.pins_num; i++) {
+		l = &board.pins[i];
+		if (find_pin(board.mcus[l->src].mcu, l->src_name,
+		                &l->src_pin) != 0) {
+			snprintf(msg, sizeof msg, "%s: no such pin: %s",
+			         board.mcus[l->src].name, l->src_name);
+			MSIM_LOG_FATAL(msg);
+			rc = 1;
+			break;
+		}
+		if (find_pin(board.mcus[l->dst].mcu, l->dst_name,
+		                &l->dst_pin) != 0) {
+			snprintf(msg, sizeof msg, "%s: no such pin: %s",
+			         board.mcus[l->dst].name, l->dst_name);
+			MSIM_LOG_FATAL(msg);
+			rc = 1;
+			break;
+		}
+	}
+	return rc;
+}
+
+/* Finds PORTx, DDRx and PINx registers of the pin named as Pxn. */
+static int
+find_pin(struct MSIM_AVR *mcu, const char *name, struct pin *pin)
+{
+	char reg[16];
+	int rc = 0;
+
+	do {
+		if ((strlen(name) != 3U) || (name[0] != 'P') ||
+		                (name[1] < 'A') || (name[1] > 'L') ||
+		                (name[2] < '0') || (name[2] > '7')) {
+			rc = 1;
+			break;
+		}
+		pin->bit = (uint8_t)(name[2] - '0');
+
+		snprintf(reg, sizeof reg, "PORT%c", name[1]);
+		rc = find_reg(mcu, reg, &pin->port);
+		if (rc != 0) {
+			break;
+		}
+		snprintf(reg, sizeof reg, "DDR%c", name[1]);
+		rc = find_reg(mcu, reg, &pin->ddr);
+		if (rc != 0) {
+			break;
+		}
+		snprintf(reg, sizeof reg, "PIN%c", name[1]);
+		rc = find_reg(mcu, reg, &pin->pin);
+	} while (0);
+
+	return rc;
+}
+
+/* Finds an offset of the I/O register in data space by its name. */
+static int
+find_reg(struct MSIM_AVR *mcu, const char *name, uint32_t *reg)
+{
+	for (uint32_t i = 0; i < (mcu->regs_num + mcu->ioregs_num); i++) {
+		if ((mcu->ioregs[i].off >= 0) &&
+		                (strcmp(mcu->ioregs[i].name, name) == 0)) {
+			*reg = (uint32_t)mcu->ioregs[i].off;
+			return 0;
+		}
+	}
+	return 1;
+}
+
+/*
+ * Simulates MCUs of the board quantum by quantum until all of them are
+ * stopped, test of any of them failed or time is over (if it's limited).
+ */
+static int
+simulate(uint64_t limit)
+{
+	struct board_mcu *m;
+	uint64_t t = 0, q, ns;
+	uint32_t done;
+	char msg[256];
+	int rc = 0;
+
+	while (1) {
+		q = quantum_len();
+		if ((limit > 0U) && ((limit - t) < q)) {
+			q = limit - t;
+		}
+		t += q;
+
+		/* Ticks of the quantum depend on the current frequency */
+		for (uint32_t i = 0; i < board.mcus_num; i++) {
+			m = &board.mcus[i];
+			ns = q * m->mcu->freq + m->frac;
+			m->target += ns / NS;
+			m->frac = ns % NS;
+		}
+
+		/* MCUs are simulated in parallel */
+		pthread_mutex_lock(&board.mutex);
+		board.running = board.mcus_num;
+		board.quantum_n++;
+		pthread_cond_broadcast(&board.start);
+		while (board.running > 0U) {
+			pthread_cond_wait(&board.end, &board.mutex);
+		}
+		pthread_mutex_unlock(&board.mutex);
+
+		/* Data is exchanged while MCUs are paused */
+		exchange();
+
+		done = 0;
+		for (uint32_t i = 0; i < board.mcus_num; i++) {
+			m = &board.mcus[i];
+			if ((m->rc != 0) && (m->rc != 2)) {
+				snprintf(msg, sizeof msg, "%s: simulation "
+				         "failed, time=%" PRIu64 "ns", m->name,
+				         t);
+				MSIM_LOG_ERROR(msg);
+				rc = 1;
+			}
+			done += m->done;
+		}
+		if ((rc != 0) || (done == board.mcus_num) ||
+		                ((limit > 0U) && (t >= limit))) {
+			break;
+		}
+	}
+
+	return rc;
+}
+
+/* Simulates the MCU within each of the quanta. */
+static void *
+mcu_thread(void *arg)
+{
+	struct board_mcu *m = (struct board_mcu *)arg;
+	struct MSIM_AVR *mcu = m->mcu;
+	uint64_t n = 0;
+
+	pthread_mutex_lock(&board.mutex);
+	while (1) {
+		while ((board.stop == 0U) && (board.quantum_n == n)) {
+			pthread_cond_wait(&board.start, &board.mutex);
+		}
+		if (board.stop == 1U) {
+			break;
+		}
+		n = board.quantum_n;
+		pthread_mutex_unlock(&board.mutex);
+
+		/* Last instruction of the previous quantum may be
+		 * completed after the target tick */
+		if ((m->done == 0U) && (m->target > mcu->tick)) {
+			m->rc = MSIM_AVR_SimRun(mcu, 1, m->target - mcu->tick);
+			m->done = (m->rc != 0) ? 1 : 0;
+		}
+
+		pthread_mutex_lock(&board.mutex);
+		board.running--;
+		if (board.running == 0U) {
+			pthread_cond_signal(&board.end);
+		}
+	}
+	pthread_mutex_unlock(&board.mutex);
+
+	return NULL;
+}
+
+/*
+ * Returns a length of the next quantum. Data sent by USART within
+ * a quantum is received within the next one, so the quantum shouldn't be
+ * longer than a Tx clock of the connected USARTs.
+ */
+static uint64_t
+quantum_len(void)
+{
+	const struct MSIM_AVR *mcu;
+	uint64_t q = board.quantum, tx;
+
+	for (uint32_t i = 0; i < board.mcus_num; i++) {
+		mcu = board.mcus[i].mcu;
+		if ((board.mcus[i].usart == UINT32_MAX) ||
+		                (mcu->usart.tx_presc == 0U) ||
+		                (mcu->freq == 0U)) {
+			continue;
+		}
+		tx = (uint64_t)mcu->usart.tx_presc * NS / mcu->freq;
+		q = (tx < q) ? tx : q;
+	}
+	return (q > 0U) ? q : 1U;
+}
+
+/* Moves data between the connected MCUs. */
+static void
+exchange(void)
+{
+	struct board_mcu *m;
+
+	for (uint32_t i = 0; i < board.mcus_num; i++) {
+		m = &board.mcus[i];
+		if (m->usart != UINT32_MAX) {
+			move_usart(&m->link, &board.mcus[m->usart].link);
+		}
+	}
+	for (uint32_t i = 0; i < board.pins_num; i++) {
+		drive_pin(&board.pins[i]);
+	}
+}
+
+/* Moves data sent by USART to the Rx buffer of the connected USART. */
+static void
+move_usart(struct MSIM_AVR_USARTLink *tx, struct MSIM_AVR_USARTLink *rx)
+{
+	uint32_t len;
+
+	/* Data received already is dropped */
+	rx->rx_len -= rx->rx_pos;
+	memmove(rx->rx, &rx->rx[rx->rx_pos], rx->rx_len);
+	rx->rx_pos = 0;
+
+	/* Data which doesn't fit stays in the Tx buffer */
+	len = MSIM_AVR_USARTLINK_BUFSZ - rx->rx_len;
+	len = (tx->tx_len < len) ? tx->tx_len : len;
+	memcpy(&rx->rx[rx->rx_len], tx->tx, len);
+	rx->rx_len += len;
+
+	tx->tx_len -= len;
+	memmove(tx->tx, &tx->tx[len], tx->tx_len);
+}
+
+/* Output pin of the MCU drives input pin of another MCU. */
+static void
+drive_pin(struct pin_link *l)
+{
+	struct MSIM_AVR *src = board.mcus[l->src].mcu;
+	struct MSIM_AVR *dst = board.mcus[l->dst].mcu;
+	const struct pin *sp = &l->src_pin;
+	const struct pin *dp = &l->dst_pin;
+	const uint8_t bit = (uint8_t)(1U << dp->bit);
+	const uint32_t ports = sizeof dst->ioports / sizeof dst->ioports[0];
+	MSIM_AVR_IOPort *p;
+	uint8_t v;
+
+	if ((((src->dm[sp->ddr] >> sp->bit) & 1U) == 0U) ||
+	                ((dst->dm[dp->ddr] & bit) != 0U)) {
+		return;
+	}
+	v = (uint8_t)((src->dm[sp->port] >> sp->bit) & 1U);
+
+	if (v == 1U) {
+		dst->dm[dp->pin] |= bit;
+	} else {
+		dst->dm[dp->pin] = (uint8_t)(dst->dm[dp->pin] & ~bit);
+	}
+
+	/* PINx may be waiting to be synchronized with PORTx */
+	for (uint32_t i = 0; i < ports; i++) {
+		p = &dst->ioports[i];
+		if ((p->pending == 1U) && (p->pin.reg == dp->pin)) {
+			p->ppin = (uint8_t)((p->ppin & ~bit) |
+			                    (dst->dm[dp->pin] & bit));
+		}
+	}
+}
+
+static void
+print_short_usage(void)
+{
+	printf("Usage: mcusim-board --help\n");
+}
+
+static void
+print_usage(void)
+{
+	/* Print usage and options */
+	printf("Usage: mcusim-board [options] <board_file>\n"
+	       "Options:\n"
+	       "  -t <nanoseconds>     Stop simulation after this time.\n"
+	       "  --help               Print this message.\n"
+	       "  --version            Print version.\n"
+	       "Each line of the board file is one of:\n"
+	       "  mcu <name> <config_file>\n"
+	       "  usart <name> <name>\n"
+	       "  pin <name> <Pxn> <name> <Pxn>\n"
+	       "  quantum <nanoseconds>\n");
+}
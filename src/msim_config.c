@@ -19,15 +19,21 @@
 
 /* Functions to parse and save MCUSim configuration. */
 #include <stdio.h>
+#include <stdlib.h>
+#include <ctype.h>
 #include <inttypes.h>
 #include <string.h>
 
 #include "mcusim/mcusim.h"
+#include "mcusim/getopt.h"
 #include "mcusim/avr/sim/private/macro.h"
 
 /* Configuration file from the current working directory */
 #define CFG_FILE		"mcusim.conf"
 
+/* File to write results of the parameter sweep to */
+#define SWEEP_FILE		"sweep.csv"
+
 /* Compare string with a string literal */
 #define CMPL(s, l, len) (strncmp((s), (l), ARRSZ(l) < (len) ? ARRSZ(l) : (len)))
 
@@ -37,6 +43,12 @@ static int	read_lines(MSIM_CFG *cfg, char *buf, uint32_t len, FILE *file,
 static int	read_line(MSIM_CFG *cfg, char *parm, char *val, uint32_t plen,
                           uint32_t vlen);
 static void	parse_bool(char *buf, uint32_t len, uint8_t *val);
+static int	parse_byte(const char *val, uint8_t *b);
+static int	check_value(const char *opt, const char *val);
+static int	set_param(MSIM_CFG *cfg, const char *name, const char *val);
+static uint64_t	sweep_value(const char *sweep, uint64_t n, char *opt,
+                            char *name, char *val, uint32_t vlen);
+static uint64_t	sweep_index(MSIM_CFG *cfg, uint32_t sweep, uint64_t run);
 
 /*
  * Read a configuration file.
@@ -105,6 +117,16 @@ read_file(MSIM_CFG *cfg, const char *cf)
 		cfg->has_firmware_file = 0;
 		cfg->firmware_test = 0;
 		cfg->reset_flash = 1;
+		cfg->usart_pty = 1;
+		cfg->engine = AVR_DECODER_ENGINE;
+		cfg->ckpt_file[0] = 0;
+		cfg->ckpt_tick = 0;
+		cfg->resume_file[0] = 0;
+		cfg->has_warm_pc = 0;
+		cfg->scenarios_num = 0;
+		cfg->lua_params_num = 0;
+		cfg->sweeps_num = 0;
+		memcpy(cfg->sweep_file, SWEEP_FILE, sizeof SWEEP_FILE);
 
 		rc = read_lines(cfg, buf, buflen, f, cf);
 	}
@@ -144,6 +166,49 @@ MSIM_CFG_PrintVersion(void)
 	return 0;
 }
 
+/* Copies the next whitespace-separated token of the string. Returns 1 if
+ * there are no more tokens or -1 if the token is too long. */
+int
+MSIM_CFG_NextToken(const char **str, char *tok, uint32_t len)
+{
+	const char *s = *str + strspn(*str, " \t\r");
+	const size_t n = strcspn(s, " \t\r");
+
+	if (n == 0U) {
+		return 1;
+	}
+	if (n >= len) {
+		return -1;
+	}
+	memcpy(tok, s, n);
+	tok[n] = 0;
+	*str = s + n;
+
+	return 0;
+}
+
+/* Reports an option of the command line which can't be handled (as it's
+ * returned by MSIM_OPT_Getopt_long): missing operand or unknown option. */
+void
+MSIM_CFG_OptError(int c)
+{
+	char msg[128];
+
+	if (c == ':') {
+		snprintf(msg, sizeof msg, "-%c requires operand",
+		         MSIM_OPT_optopt);
+	} else {
+		snprintf(msg, sizeof msg, "unknown option: -%c",
+		         MSIM_OPT_optopt);
+	}
+
+	if ((c == ':') || (c == '?')) {
+		MSIM_LOG_FATAL(msg);
+	} else {
+		MSIM_LOG_WARN(msg);
+	}
+}
+
 static int
 read_lines(struct MSIM_CFG *cfg, char *buf, uint32_t buflen,
            FILE *file, const char *filename)
@@ -153,6 +218,8 @@ read_lines(struct MSIM_CFG *cfg, char *buf, uint32_t buflen,
 	char parm[len];
 	char val[len];
 	char *str;
+	size_t end;
+	int off = 0;
 	int rc = 0;
 
 	while (1) {
@@ -177,15 +244,25 @@ read_lines(struct MSIM_CFG *cfg, char *buf, uint32_t buflen,
 		}
 
 		/* Try to parse a configuration line. */
-		rc = sscanf(buf, "%4095s %4095s", parm, val);
+		rc = sscanf(buf, "%4095s %n%4095s", parm, &off, val);
 		if (rc != 2) {
 			snprintf(buf, buflen, "incorrect format of line #%"
 			         PRIu32 " from %s", line, filename);
 			MSIM_LOG_DEBUG(buf);
 			continue;
 		} else {
-			/* Line is correct */
-			rc = read_line(cfg, parm, val, len, len);
+			/* Line is correct, some options take several
+			 * values from the rest of it */
+			end = strlen(buf);
+			while ((end > (size_t)off) && ((buf[end-1] == '\n') ||
+			                (buf[end-1] == '\r') ||
+			                (buf[end-1] == ' ') ||
+			                (buf[end-1] == '\t'))) {
+				end--;
+			}
+			buf[end] = 0;
+			rc = read_line(cfg, parm, &buf[off], len,
+			               buflen - (uint32_t)off);
 			if (rc != 0) {
 				snprintf(buf, buflen, "cannot read option at "
 				         "line #%" PRIu32 " from %s",
@@ -218,29 +295,25 @@ read_line(struct MSIM_CFG *cfg, char *parm, char *val,
 			rc = 2;
 		}
 	} else if (CMPL(parm, "mcu_lockbits", plen) == 0) {
-		cmp_rc = sscanf(val, "0x%" SCNx8, &cfg->mcu_lockbits);
-		if (cmp_rc == 1) {
+		if (parse_byte(val, &cfg->mcu_lockbits) == 0) {
 			cfg->has_lockbits = 1;
 		} else {
 			rc = 2;
 		}
 	} else if (CMPL(parm, "mcu_efuse", plen) == 0) {
-		cmp_rc = sscanf(val, "0x%" SCNx8, &cfg->mcu_efuse);
-		if (cmp_rc == 1) {
+		if (parse_byte(val, &cfg->mcu_efuse) == 0) {
 			cfg->has_efuse = 1;
 		} else {
 			rc = 2;
 		}
 	} else if (CMPL(parm, "mcu_hfuse", plen) == 0) {
-		cmp_rc = sscanf(val, "0x%" SCNx8, &cfg->mcu_hfuse);
-		if (cmp_rc == 1) {
+		if (parse_byte(val, &cfg->mcu_hfuse) == 0) {
 			cfg->has_hfuse = 1;
 		} else {
 			rc = 2;
 		}
 	} else if (CMPL(parm, "mcu_lfuse", plen) == 0) {
-		cmp_rc = sscanf(val, "0x%" SCNx8, &cfg->mcu_lfuse);
-		if (cmp_rc == 1) {
+		if (parse_byte(val, &cfg->mcu_lfuse) == 0) {
 			cfg->has_lfuse = 1;
 		} else {
 			rc = 2;
@@ -300,6 +373,94 @@ read_line(struct MSIM_CFG *cfg, char *parm, char *val,
 		} else {
 			rc = 2;
 		}
+	} else if (CMPL(parm, "engine", plen) == 0) {
+		cmp_rc = sscanf(val, "%4095s", buf);
+		if (cmp_rc != 1) {
+			rc = 2;
+		} else if (CMPL(buf, "decoder", buflen) == 0) {
+			cfg->engine = AVR_DECODER_ENGINE;
+		} else if (CMPL(buf, "threaded", buflen) == 0) {
+			cfg->engine = AVR_THREADED_ENGINE;
+		} else if (CMPL(buf, "jit", buflen) == 0) {
+			cfg->engine = AVR_JIT_ENGINE;
+		} else {
+			snprintf(buf, buflen, "unknown engine %s", val);
+			MSIM_LOG_ERROR(buf);
+			rc = 2;
+		}
+	} else if (CMPL(parm, "checkpoint_file", plen) == 0) {
+		cmp_rc = sscanf(val, "%4095s", &cfg->ckpt_file[0]);
+		if (cmp_rc != 1) {
+			rc = 2;
+		}
+	} else if (CMPL(parm, "checkpoint_tick", plen) == 0) {
+		cmp_rc = sscanf(val, "%" SCNu64, &cfg->ckpt_tick);
+		if (cmp_rc != 1) {
+			rc = 2;
+		}
+	} else if (CMPL(parm, "resume_file", plen) == 0) {
+		cmp_rc = sscanf(val, "%4095s", &cfg->resume_file[0]);
+		if (cmp_rc != 1) {
+			rc = 2;
+		}
+	} else if (CMPL(parm, "warm_pc", plen) == 0) {
+		cmp_rc = sscanf(val, "0x%" SCNx32, &cfg->warm_pc);
+		if (cmp_rc == 1) {
+			cfg->has_warm_pc = 1;
+		} else {
+			rc = 2;
+		}
+	} else if (CMPL(parm, "scenario", plen) == 0) {
+		if (cfg->scenarios_num >= MSIM_CFG_SCENARIOS) {
+			MSIM_LOG_ERROR("too many scenarios");
+			rc = 2;
+		} else {
+			cmp_rc = sscanf(val, "%4095s",
+			                &cfg->scenarios[cfg->scenarios_num][0]);
+			if (cmp_rc == 1) {
+				cfg->scenarios_num++;
+			} else {
+				rc = 2;
+			}
+		}
+	} else if (CMPL(parm, "lua_param", plen) == 0) {
+		char name[64];
+
+		cmp_rc = sscanf(val, "%63s %4095s", name, buf);
+		if (cmp_rc == 2) {
+			rc = set_param(cfg, name, buf);
+		} else {
+			rc = 2;
+		}
+	} else if (CMPL(parm, "sweep", plen) == 0) {
+		char opt[64], name[64];
+
+		if (cfg->sweeps_num >= MSIM_CFG_SWEEPS) {
+			MSIM_LOG_ERROR("too many options to sweep");
+			rc = 2;
+		} else if ((strlen(val) >= sizeof cfg->sweeps[0]) ||
+		                (sweep_value(val, 0, opt, name, buf,
+		                             buflen) == 0U)) {
+			snprintf(buf, buflen, "incorrect sweep: %s", val);
+			MSIM_LOG_ERROR(buf);
+			rc = 2;
+		} else {
+			memcpy(cfg->sweeps[cfg->sweeps_num], val,
+			       strlen(val) + 1);
+			cfg->sweeps_num++;
+		}
+	} else if (CMPL(parm, "sweep_file", plen) == 0) {
+		cmp_rc = sscanf(val, "%4095s", &cfg->sweep_file[0]);
+		if (cmp_rc != 1) {
+			rc = 2;
+		}
+	} else if (CMPL(parm, "usart_pty", plen) == 0) {
+		cmp_rc = sscanf(val, "%4095s", buf);
+		if (cmp_rc == 1) {
+			parse_bool(buf, buflen, &cfg->usart_pty);
+		} else {
+			rc = 2;
+		}
 	} else if (CMPL(parm, "trap_at_isr", plen) == 0) {
 		cmp_rc = sscanf(val, "%4095s", buf);
 		if (cmp_rc == 1) {
@@ -326,3 +487,252 @@ parse_bool(char *buf, uint32_t len, uint8_t *val)
 		*val = 1;
 	}
 }
+
+/* Parses a byte of the fuses or lock bits, "0x" followed by hex digits. */
+static int
+parse_byte(const char *val, uint8_t *b)
+{
+	unsigned long v;
+	char *end;
+
+	if ((val[0] != '0') || ((val[1] != 'x') && (val[1] != 'X')) ||
+	                (isxdigit((unsigned char)val[2]) == 0)) {
+		return 1;
+	}
+	v = strtoul(&val[2], &end, 16);
+	if (((*end != 0) && (isspace((unsigned char)*end) == 0)) ||
+	                (v > 0xFFU)) {
+		return 1;
+	}
+	*b = (uint8_t)v;
+
+	return 0;
+}
+
+/* Sets a parameter of the Lua models or replaces its value. */
+static int
+set_param(MSIM_CFG *cfg, const char *name, const char *val)
+{
+	MSIM_AVR_LUAParam *p = NULL;
+	int rc = 0;
+
+	for (uint32_t i = 0; i < cfg->lua_params_num; i++) {
+		if (strcmp(cfg->lua_params[i].name, name) == 0) {
+			p = &cfg->lua_params[i];
+			break;
+		}
+	}
+	if ((p == NULL) && (cfg->lua_params_num < MSIM_AVR_LUAPARAMS)) {
+		p = &cfg->lua_params[cfg->lua_params_num++];
+	}
+
+	if (p == NULL) {
+		MSIM_LOG_ERROR("too many parameters of Lua models");
+		rc = 2;
+	} else if (strlen(val) >= sizeof p->val) {
+		MSIM_LOG_ERROR("value of Lua model parameter is too long");
+		rc = 2;
+	} else {
+		memcpy(p->name, name, sizeof p->name);
+		memcpy(p->val, val, strlen(val) + 1);
+	}
+
+	return rc;
+}
+
+/*
+ * Parses the sweep line "<option> [name] <values...>". Values are separated
+ * by spaces, each of them is either a single value or a range of values
+ * "first..last[:step]". Returns the number of values (0 if the line is
+ * incorrect) and prints the n-th value if there is such one.
+ */
+static uint64_t
+sweep_value(const char *sweep, uint64_t n, char *opt, char *name,
+            char *val, uint32_t vlen)
+{
+	char tok[256];
+	char *end;
+	uint64_t first, last, step, num = 0, count;
+	uint8_t byte, hex;
+	int off, rc;
+
+	name[0] = 0;
+	rc = sscanf(sweep, "%63s %n", opt, &off);
+	if ((rc != 1) || ((strcmp(opt, "mcu_freq") != 0) &&
+	                (strcmp(opt, "mcu_lockbits") != 0) &&
+	                (strcmp(opt, "mcu_efuse") != 0) &&
+	                (strcmp(opt, "mcu_hfuse") != 0) &&
+	                (strcmp(opt, "mcu_lfuse") != 0) &&
+	                (strcmp(opt, "lua_param") != 0))) {
+		return 0;
+	}
+	sweep += off;
+	if (strcmp(opt, "lua_param") == 0) {
+		rc = sscanf(sweep, "%63s %n", name, &off);
+		if (rc != 1) {
+			return 0;
+		}
+		sweep += off;
+	}
+
+	/* Fuses and lock bits are bytes */
+	byte = ((strcmp(opt, "mcu_freq") != 0) && (name[0] == 0)) ? 1 : 0;
+
+	while (sscanf(sweep, "%255s %n", tok, &off) == 1) {
+		sweep += off;
+
+		first = strtoull(tok, &end, 0);
+		if ((end == tok) || (end[0] != '.') || (end[1] != '.')) {
+			/* Single value */
+			if (check_value(opt, tok) != 0) {
+				return 0;
+			}
+			if (n == num) {
+				snprintf(val, vlen, "%s", tok);
+			}
+			num++;
+			continue;
+		}
+		last = strtoull(&end[2], &end, 0);
+		step = 1;
+		if (end[0] == ':') {
+			step = strtoull(&end[1], &end, 0);
+		}
+		if ((end[0] != 0) || (step == 0U) || (last < first)) {
+			return 0;
+		}
+		if ((byte != 0U) && (last > 0xFFU)) {
+			return 0;
+		}
+
+		count = (last - first) / step + 1U;
+		if ((count == 0U) || (count > UINT32_MAX) ||
+		                (num > UINT32_MAX)) {
+			return 0;
+		}
+		/* Values of the Lua model parameters are printed the same
+		 * way as the range is given */
+		hex = ((name[0] != 0) && (tok[0] == '0') &&
+		       ((tok[1] == 'x') || (tok[1] == 'X'))) ? 1 : byte;
+		if ((n >= num) && (n < (num + count))) {
+			first += (n - num) * step;
+			if (hex != 0U) {
+				snprintf(val, vlen, "0x%02" PRIX64, first);
+			} else {
+				snprintf(val, vlen, "%" PRIu64, first);
+			}
+		}
+		num += count;
+	}
+
+	return num;
+}
+
+/* Checks a single value of the swept option the same way it's read from
+ * the config file. */
+static int
+check_value(const char *opt, const char *val)
+{
+	char *end;
+	uint8_t b;
+	int rc = 0;
+
+	if (strcmp(opt, "mcu_freq") == 0) {
+		strtoull(val, &end, 10);
+		rc = ((end == val) || (*end != 0)) ? 1 : 0;
+	} else if (strcmp(opt, "lua_param") != 0) {
+		rc = parse_byte(val, &b);
+	} else {
+		/* Parameters of the Lua models are strings */
+	}
+
+	return rc;
+}
+
+/* Index of the value of the swept option for the given run. Options are
+ * swept as nested loops, the last one is the innermost. */
+static uint64_t
+sweep_index(MSIM_CFG *cfg, uint32_t sweep, uint64_t run)
+{
+	char opt[64], name[64], val[256];
+	uint64_t num = 1;
+
+	for (uint32_t i = cfg->sweeps_num; i > 0U; i--) {
+		num = sweep_value(cfg->sweeps[i-1U], UINT64_MAX, opt, name,
+		                  val, sizeof val);
+		if ((i - 1U) == sweep) {
+			break;
+		}
+		run /= num;
+	}
+
+	return run % num;
+}
+
+/* Number of runs to sweep all combinations of the option values (0 if
+ * there are too many of them). */
+uint64_t
+MSIM_CFG_SweepRuns(MSIM_CFG *cfg)
+{
+	char opt[64], name[64], val[256];
+	uint64_t runs = 1, num;
+
+	for (uint32_t i = 0; i < cfg->sweeps_num; i++) {
+		num = sweep_value(cfg->sweeps[i], UINT64_MAX, opt, name,
+		                  val, sizeof val);
+		if (runs > (UINT32_MAX / num)) {
+			runs = 0;
+			break;
+		}
+		runs *= num;
+	}
+
+	return runs;
+}
+
+/* Prints the name of the swept option (or Lua model parameter) and its
+ * value for the given run. */
+int
+MSIM_CFG_SweepValue(MSIM_CFG *cfg, uint32_t sweep, uint64_t run,
+                    char *key, uint32_t klen, char *val, uint32_t vlen)
+{
+	char opt[64], name[64];
+	uint64_t i;
+
+	if (sweep >= cfg->sweeps_num) {
+		return 1;
+	}
+	i = sweep_index(cfg, sweep, run);
+	sweep_value(cfg->sweeps[sweep], i, opt, name, val, vlen);
+	snprintf(key, klen, "%s", (name[0] != 0) ? name : opt);
+
+	return 0;
+}
+
+/* Sets the swept options to their values for the given run. */
+int
+MSIM_CFG_Sweep(MSIM_CFG *cfg, uint64_t run)
+{
+	const uint32_t len = 4096;
+	char opt[64], name[64], val[256];
+	char buf[len];
+	uint64_t i;
+	int rc = 0;
+
+	for (uint32_t k = 0; (k < cfg->sweeps_num) && (rc == 0); k++) {
+		i = sweep_index(cfg, k, run);
+		sweep_value(cfg->sweeps[k], i, opt, name, val, sizeof val);
+		if (name[0] != 0) {
+			snprintf(buf, len, "%s %s", name, val);
+		} else {
+			snprintf(buf, len, "%s", val);
+		}
+		rc = read_line(cfg, opt, buf, sizeof opt, len);
+		if (rc != 0) {
+			snprintf(buf, len, "cannot set %s to %s", opt, val);
+			MSIM_LOG_ERROR(buf);
+		}
+	}
+
+	return rc;
+}
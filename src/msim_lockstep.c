@@ -0,0 +1,330 @@
+/*
+ * This file is part of MCUSim, an XSPICE library with microcontrollers.
+ *
+ * Copyright (C) 2017-2019 MCUSim Developers, see AUTHORS.txt for contributors.
+ *
+ * MCUSim is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MCUSim is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Runs firmware by the MCU with the decoder engine (reference, cycle by
+ * cycle) and by the MCU with the threaded or JIT engine (in runs of cycles
+ * or by instructions) in lockstep, and reports the first instruction the MCUs
+ * diverge at.
+ */
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "mcusim/mcusim.h"
+#include "mcusim/getopt.h"
+#include "mcusim/config.h"
+
+#define EVERY_DEF		10000		/* Compare MCUs each N inst. */
+
+/* Command line options */
+#define CLI_OPTIONS		":n:e:m:j"
+#define VERSION_OPT		7576
+#define PRINT_USAGE_OPT		7580
+
+/* Long command line options */
+static struct MSIM_OPT_Option longopts[] = {
+	{ "version", MSIM_OPT_NO_ARGUMENT, NULL, VERSION_OPT },
+	{ "help", MSIM_OPT_NO_ARGUMENT, NULL, PRINT_USAGE_OPT },
+};
+
+static const char *loc_names[] = {
+	"PC", "tick", "state", "result", "DM", "PM"
+};
+
+static void	print_usage(void);
+static void	print_short_usage(void);
+static int	init_mcu(struct MSIM_AVR *mcu, struct MSIM_CFG *cfg,
+		         enum MSIM_AVR_Engine engine);
+static void	report(struct MSIM_AVR *ref, struct MSIM_AVR *test,
+		       enum MSIM_AVR_LockstepMode mode,
+		       const struct MSIM_AVR_Diverge *div);
+static void	dm_name(struct MSIM_AVR *mcu, uint32_t addr, char *buf,
+		        size_t len);
+static void	print_regs(struct MSIM_AVR *mcu, const char *name);
+
+int
+main(int argc, char *argv[])
+{
+	struct MSIM_AVR *ref = NULL, *test = NULL;
+	struct MSIM_CFG *cfg = NULL;
+	struct MSIM_AVR_Diverge div;
+	enum MSIM_AVR_LockstepMode mode = AVR_LOCKSTEP_RUN;
+	enum MSIM_AVR_Engine engine = AVR_THREADED_ENGINE;
+	uint64_t insts = UINT64_MAX;
+	uint32_t every = EVERY_DEF;
+	unsigned long long val;
+	uint8_t inited = 0;
+	char *end;
+	char msg[256];
+	int c, rc = 0;
+
+	/* Read command line arguments */
+	c = MSIM_OPT_Getopt_long(argc, argv, CLI_OPTIONS, longopts, NULL);
+	while (c != -1) {
+		switch (c) {
+		case ':':		/* Missing operand */
+		case '?':		/* Unknown option */
+			MSIM_CFG_OptError(c);
+			return 1;
+		case 'n':
+		case 'e':
+			val = strtoull(MSIM_OPT_optarg, &end, 10);
+			if ((*end != 0) || (val == 0U) ||
+			                ((c == 'e') && (val > UINT32_MAX))) {
+				snprintf(msg, sizeof msg, "invalid number: "
+				         "%s", MSIM_OPT_optarg);
+				MSIM_LOG_FATAL(msg);
+				return 1;
+			}
+			if (c == 'n') {
+				insts = (uint64_t)val;
+			} else {
+				every = (uint32_t)val;
+			}
+			break;
+		case 'm':
+			if (strcmp(MSIM_OPT_optarg, "run") == 0) {
+				mode = AVR_LOCKSTEP_RUN;
+			} else if (strcmp(MSIM_OPT_optarg, "inst") == 0) {
+				mode = AVR_LOCKSTEP_INST;
+			} else {
+				snprintf(msg, sizeof msg, "unknown mode: %s",
+				         MSIM_OPT_optarg);
+				MSIM_LOG_FATAL(msg);
+				return 1;
+			}
+			break;
+		case 'j':
+			engine = AVR_JIT_ENGINE;
+			break;
+		case VERSION_OPT:
+			print_short_usage();
+			return 2;
+		case PRINT_USAGE_OPT:
+			print_usage();
+			return 2;
+		default:
+			MSIM_CFG_OptError(c);
+			break;
+		}
+		c = MSIM_OPT_Getopt_long(argc, argv, CLI_OPTIONS,
+		                         longopts, NULL);
+	}
+	if (MSIM_OPT_optind != (argc - 1)) {
+		print_short_usage();
+		return 1;
+	}
+
+	do {
+		ref = malloc(sizeof *ref);
+		test = malloc(sizeof *test);
+		cfg = malloc(sizeof *cfg);
+		if ((ref == NULL) || (test == NULL) || (cfg == NULL)) {
+			MSIM_LOG_FATAL("failed to allocate memory for MCU");
+			rc = 1;
+			break;
+		}
+		memset(ref, 0, sizeof *ref);
+		memset(test, 0, sizeof *test);
+		memset(cfg, 0, sizeof *cfg);
+		cfg->rsp_port = MSIM_CFG_RSP_PORT;
+
+		rc = MSIM_CFG_Read(cfg, argv[MSIM_OPT_optind]);
+		if (rc != 0) {
+			break;
+		}
+
+		/* There is no debugger to wait for and MCUs shouldn't
+		 * write the same VCD file or open pseudo-terminals */
+		cfg->firmware_test = 1;
+		cfg->dump_regs_num = 0;
+		cfg->usart_pty = 0;
+
+		rc = init_mcu(ref, cfg, AVR_DECODER_ENGINE);
+		if (rc != 0) {
+			break;
+		}
+		inited |= 1;
+		rc = init_mcu(test, cfg, engine);
+		if (rc != 0) {
+			break;
+		}
+		inited |= 2;
+
+		rc = MSIM_AVR_Lockstep(ref, test, mode, insts, every,
+		                       &div);
+		if (rc == 0) {
+			snprintf(msg, sizeof msg, "MCUs haven't diverged, "
+			         "%" PRIu64 " cycles", ref->tick);
+			MSIM_LOG_INFO(msg);
+		} else if (rc > 0) {
+			report(ref, test, mode, &div);
+		} else {
+			/* Error is reported already */
+		}
+		rc = (rc != 0) ? 1 : 0;
+	} while (0);
+
+	if ((inited & 1) != 0) {
+		if (ref->pty != NULL) {
+			MSIM_PTY_Close(ref->pty);
+		}
+		MSIM_AVR_LUACleanModels(ref);
+		MSIM_AVR_Free(ref);
+	}
+	if ((inited & 2) != 0) {
+		if (test->pty != NULL) {
+			MSIM_PTY_Close(test->pty);
+		}
+		MSIM_AVR_LUACleanModels(test);
+		MSIM_AVR_Free(test);
+	}
+	free(ref);
+	free(test);
+	free(cfg);
+
+	return rc;
+}
+
+/* Initializes the MCU with the given engine. */
+static int
+init_mcu(struct MSIM_AVR *mcu, struct MSIM_CFG *cfg,
+         enum MSIM_AVR_Engine engine)
+{
+	int rc;
+
+	cfg->engine = engine;
+	rc = MSIM_AVR_Init(mcu, cfg);
+	if (rc != 0) {
+		MSIM_LOG_FATAL("failed to initialize MCU");
+	} else {
+		mcu->state = AVR_RUNNING;
+	}
+	return rc;
+}
+
+/* Prints the divergent instruction (or run) and states of the MCUs after
+ * it. */
+static void
+report(struct MSIM_AVR *ref, struct MSIM_AVR *test,
+       enum MSIM_AVR_LockstepMode mode, const struct MSIM_AVR_Diverge *div)
+{
+	const MSIM_AVR_DivergeVal *v;
+	char msg[256], name[32];
+
+	snprintf(msg, sizeof msg, "MCUs diverged at instruction %" PRIu64
+	         ": pc=0x%06" PRIX32 ", opcode=0x%04" PRIX16 " 0x%04" PRIX16
+	         ", tick=%" PRIu64, div->inst, div->pc, div->opcode[0],
+	         div->opcode[1], div->tick);
+	MSIM_LOG_ERROR(msg);
+	if (div->run > 1U) {
+		snprintf(msg, sizeof msg, "divergent instruction isn't "
+		         "found, MCUs differ after the run of %" PRIu64
+		         " %s", div->run, (mode == AVR_LOCKSTEP_RUN) ?
+		         "cycles" : "instructions");
+		MSIM_LOG_ERROR(msg);
+	}
+
+	for (uint32_t i = 0; i < div->vals_num; i++) {
+		v = &div->vals[i];
+		if (v->loc == AVR_DIVERGE_DM) {
+			dm_name(ref, v->addr, name, sizeof name);
+		} else if (v->loc == AVR_DIVERGE_PM) {
+			snprintf(name, sizeof name, "PM 0x%06" PRIX32,
+			         v->addr);
+		} else {
+			snprintf(name, sizeof name, "%s", loc_names[v->loc]);
+		}
+		snprintf(msg, sizeof msg, "%s: decoder=0x%" PRIX64
+		         ", threaded=0x%" PRIX64, name, v->ref, v->test);
+		MSIM_LOG_ERROR(msg);
+	}
+
+	print_regs(ref, "decoder");
+	print_regs(test, "threaded");
+}
+
+/* Names the byte of the data memory. */
+static void
+dm_name(struct MSIM_AVR *mcu, uint32_t addr, char *buf, size_t len)
+{
+	if (addr < mcu->regs_num) {
+		snprintf(buf, len, "r%" PRIu32, addr);
+	} else if ((addr < (mcu->regs_num + mcu->ioregs_num)) &&
+	                (mcu->ioregs[addr].off >= 0)) {
+		snprintf(buf, len, "%s", mcu->ioregs[addr].name);
+	} else {
+		snprintf(buf, len, "DM 0x%04" PRIX32, addr);
+	}
+}
+
+/* Prints general purpose registers, SREG and SP of the MCU. */
+static void
+print_regs(struct MSIM_AVR *mcu, const char *name)
+{
+	char msg[256];
+	int n;
+
+	for (uint32_t i = 0; i < mcu->regs_num; i += 16) {
+		n = snprintf(msg, sizeof msg, "%s: r%-2" PRIu32 ":", name, i);
+		for (uint32_t k = i; (k < (i + 16)) && (k < mcu->regs_num) &&
+		                (n > 0) && ((size_t)n < sizeof msg); k++) {
+			n += snprintf(msg + n, sizeof msg - (size_t)n,
+			              " %02" PRIX8, mcu->dm[k]);
+		}
+		MSIM_LOG_ERROR(msg);
+	}
+	snprintf(msg, sizeof msg, "%s: pc=0x%06" PRIX32 ", SREG=0x%02"
+	         PRIX8 ", SP=0x%02" PRIX8 "%02" PRIX8, name, mcu->pc,
+	         *mcu->sreg, (mcu->sph != NULL) ? *mcu->sph : 0,
+	         *mcu->spl);
+	MSIM_LOG_ERROR(msg);
+}
+
+static void
+print_short_usage(void)
+{
+	printf("Usage: mcusim-lockstep --help\n");
+}
+
+static void
+print_usage(void)
+{
+	/* Print usage and options */
+	printf("Usage: mcusim-lockstep [options] <config_file>\n"
+	       "Options:\n"
+	       "  -n <instructions>    Stop after this number of "
+	       "instructions.\n"
+	       "  -e <number>          Compare MCUs after this number of "
+	       "cycles (run mode)\n"
+	       "                       or instructions (%d by default).\n"
+	       "  -m <mode>            Run the threaded engine by runs of "
+	       "cycles (run,\n"
+	       "                       default) or by instructions "
+	       "(inst).\n"
+	       "  -j                   Test the JIT engine instead of the "
+	       "threaded one.\n"
+	       "  --help               Print this message.\n"
+	       "  --version            Print version.\n"
+	       "Firmware is run by the decoder engine cycle by cycle and by "
+	       "the threaded\n"
+	       "(or JIT) engine until MCUs stop or diverge.\n", EVERY_DEF);
+}
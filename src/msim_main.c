@@ -34,6 +34,9 @@
 #include <limits.h>
 #include <inttypes.h>
 #include <signal.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
 
 #include "mcusim/mcusim.h"
 #include "mcusim/getopt.h"
@@ -41,7 +44,6 @@
 #include "mcusim/avr/sim/private/macro.h"
 
 #define FLASH_FILE		".mcusim.flash"
-#define GDB_RSP_PORT		12750
 
 /* Command line options */
 #define CLI_OPTIONS		":c:"
@@ -59,10 +61,32 @@ static struct MSIM_OPT_Option longopts[] = {
 static struct MSIM_AVR avr_mcu;
 static struct MSIM_AVR *mcu = &avr_mcu;
 static struct MSIM_CFG conf;
+static struct MSIM_CFG scen_conf;
+static struct MSIM_CFG run_conf;
+
+/* Run of the parameter sweep in a child process */
+struct sweep_run {
+	pid_t pid;
+	int fd;				/* Pipe to read cycles from */
+	uint64_t run;
+};
+
+/* Result of the parameter sweep run */
+struct sweep_res {
+	uint64_t cycles;
+	uint8_t passed;
+};
 
 static void	print_usage(void);
 static void	print_short_usage(void);
 static void	dump_flash_handler(int s);
+static void	checkpoint_handler(int s);
+static int	fan_out(void);
+static int	run_scenario(const char *file);
+static int	sweep(void);
+static int	start_run(struct sweep_run *r, uint64_t run);
+static int	run_sweep(uint64_t run, int fd);
+static int	write_sweep(const struct sweep_res *res, uint64_t runs);
 
 int
 main(int argc, char *argv[])
@@ -73,7 +97,7 @@ main(int argc, char *argv[])
 	conf.mcu_freq = 0;
 	conf.trap_at_isr = 0;
 	conf.firmware_test = 0;
-	conf.rsp_port = GDB_RSP_PORT;
+	conf.rsp_port = MSIM_CFG_RSP_PORT;
 
 #ifdef DEBUG
 	MSIM_LOG_SetLevel(MSIM_LOG_LVLDEBUG);
@@ -91,6 +115,14 @@ main(int argc, char *argv[])
 		sigaction(signals[i], &dmpflash_act, NULL);
 	}
 
+	/* Checkpoint can be requested by a signal. */
+	struct sigaction ckpt_act;
+
+	memset(&ckpt_act, 0, sizeof ckpt_act);
+	sigemptyset(&ckpt_act.sa_mask);
+	ckpt_act.sa_handler = checkpoint_handler;
+	sigaction(SIGUSR1, &ckpt_act, NULL);
+
 	MSIM_CFG_PrintVersion();
 
 	/* Raad command line arguments */
@@ -98,14 +130,8 @@ main(int argc, char *argv[])
 	while (c != -1) {
 		switch (c) {
 		case ':':		/* Missing operand */
-			snprintf(LOG, LOGSZ, "-%c requires operand",
-			         MSIM_OPT_optopt);
-			MSIM_LOG_FATAL(LOG);
-			return 1;
 		case '?':		/* Unknown option */
-			snprintf(LOG, LOGSZ, "unknown option: -%c",
-			         MSIM_OPT_optopt);
-			MSIM_LOG_FATAL(LOG);
+			MSIM_CFG_OptError(c);
 			return 1;
 		case 'c':
 			conf_file = MSIM_OPT_optarg;
@@ -120,9 +146,7 @@ main(int argc, char *argv[])
 			print_usage();
 			return 2;
 		default:
-			snprintf(LOG, LOGSZ, "unknown option: -%c",
-			         MSIM_OPT_optopt);
-			MSIM_LOG_WARN(LOG);
+			MSIM_CFG_OptError(c);
 			break;
 		}
 		c = MSIM_OPT_Getopt_long(argc, argv, CLI_OPTIONS,
@@ -135,6 +159,22 @@ main(int argc, char *argv[])
 		if (rc != 0) {
 			break;
 		}
+		if (conf.scenarios_num > 0U) {
+			conf.firmware_test = 1;
+		}
+		if ((conf.sweeps_num > 0U) && (conf.scenarios_num > 0U)) {
+			MSIM_LOG_ERROR("options can't be swept for scenarios");
+			rc = 1;
+			break;
+		}
+		if (conf.sweeps_num > 0U) {
+			/* Runs don't dump registers and load Lua models with
+			 * their own parameters */
+			conf.firmware_test = 1;
+			conf.dump_regs_num = 0;
+			memcpy(&run_conf, &conf, sizeof run_conf);
+			conf.lua_models_num = 0;
+		}
 
 		/* Initialize AVR */
 		rc = MSIM_AVR_Init(mcu, &conf);
@@ -151,10 +191,16 @@ main(int argc, char *argv[])
 			MSIM_AVR_RSPInit(mcu, (uint16_t)conf.rsp_port);
 		}
 
-		rc = MSIM_AVR_Simulate(mcu, conf.firmware_test);
+		if (conf.scenarios_num > 0U) {
+			rc = fan_out();
+		} else if (conf.sweeps_num > 0U) {
+			rc = sweep();
+		} else {
+			rc = MSIM_AVR_Simulate(mcu, conf.firmware_test);
+		}
 
-		MSIM_PTY_Close(&mcu->pty);
-		MSIM_AVR_LUACleanModels();
+		MSIM_PTY_Close(mcu->pty);
+		MSIM_AVR_LUACleanModels(mcu);
 		if (conf.firmware_test == 0) {
 			MSIM_AVR_RSPClose(mcu);
 		}
@@ -165,6 +211,366 @@ main(int argc, char *argv[])
 		break;
 	} while (0);
 
+	MSIM_AVR_Free(mcu);
+
+	return rc;
+}
+
+/*
+ * Boots the MCU up to the configured address once and runs each of the
+ * scenarios from a copy-on-write clone of the booted MCU (in a child
+ * process). Returns non-zero if any of the scenarios failed.
+ */
+static int
+fan_out(void)
+{
+	uint32_t failed = 0;
+	pid_t pid;
+	int rc = 0, status;
+
+	do {
+		/* Boot the MCU once */
+		while ((rc == 0) && conf.has_warm_pc &&
+		                (mcu->pc != (conf.warm_pc >> 1))) {
+			rc = MSIM_AVR_SimRunTo(mcu, 1, UINT64_MAX,
+			                       conf.warm_pc >> 1);
+		}
+		if (rc != 0) {
+			snprintf(LOG, LOGSZ, "MCU stopped before 0x%06" PRIx32
+			         ", no scenarios to run", conf.warm_pc);
+			MSIM_LOG_ERROR(LOG);
+			rc = 1;
+			break;
+		}
+		snprintf(LOG, LOGSZ, "MCU booted in %" PRIu64 " cycles, "
+		         "running %" PRIu32 " scenarios", mcu->tick,
+		         conf.scenarios_num);
+		MSIM_LOG_INFO(LOG);
+
+		for (uint32_t i = 0; i < conf.scenarios_num; i++) {
+			/* Buffered output shouldn't be written twice */
+			fflush(NULL);
+
+			pid = fork();
+			if (pid == 0) {
+				exit(run_scenario(conf.scenarios[i]));
+			}
+
+			status = -1;
+			if ((pid < 0) || (waitpid(pid, &status, 0) != pid) ||
+			                !WIFEXITED(status) ||
+			                (WEXITSTATUS(status) != 0)) {
+				snprintf(LOG, LOGSZ, "scenario failed: %s",
+				         conf.scenarios[i]);
+				MSIM_LOG_WARN(LOG);
+				failed++;
+			} else {
+				snprintf(LOG, LOGSZ, "scenario passed: %s",
+				         conf.scenarios[i]);
+				MSIM_LOG_INFO(LOG);
+			}
+		}
+
+		snprintf(LOG, LOGSZ, "%" PRIu32 " of %" PRIu32 " scenarios "
+		         "failed", failed, conf.scenarios_num);
+		MSIM_LOG_INFO(LOG);
+		rc = (failed > 0U) ? 1 : 0;
+	} while (0);
+
+	return rc;
+}
+
+/* Runs a scenario from the booted MCU (in a child process). */
+static int
+run_scenario(const char *file)
+{
+	struct MSIM_AVR_VCD *vcd = mcu->vcd;
+	FILE *f;
+	int rc = 0;
+
+	do {
+		/* Configuration is read from the working directory if
+		 * there is no such file, it's not the scenario */
+		f = fopen(file, "r");
+		if (f == NULL) {
+			snprintf(LOG, LOGSZ, "failed to open scenario: %s",
+			         file);
+			MSIM_LOG_ERROR(LOG);
+			rc = 1;
+			break;
+		}
+		fclose(f);
+
+		rc = MSIM_CFG_Read(&scen_conf, file);
+		if (rc != 0) {
+			break;
+		}
+
+		/* VCD file of the booted MCU isn't shared */
+		MSIM_AVR_VCDClose(mcu);
+		vcd->dump = NULL;
+		if (scen_conf.vcd_file[0] != 0) {
+			memcpy(vcd->dump_file, scen_conf.vcd_file,
+			       sizeof vcd->dump_file);
+			vcd->dump_file[sizeof vcd->dump_file - 1] = 0;
+		}
+
+		for (uint32_t k = 0; (k < scen_conf.lua_models_num) &&
+		                (rc == 0); k++) {
+			rc = MSIM_AVR_LUALoadModel(mcu, scen_conf.lua_models[k],
+			                           scen_conf.lua_params,
+			                           scen_conf.lua_params_num);
+			if (rc != 0) {
+				MSIM_LOG_FATAL("loading Lua model failed");
+				rc = 1;
+			}
+		}
+		if (rc != 0) {
+			break;
+		}
+
+		rc = MSIM_AVR_Simulate(mcu, 1);
+		MSIM_PTY_Close(mcu->pty);
+		MSIM_AVR_LUACleanModels(mcu);
+	} while (0);
+
+	return (rc == 0) ? 0 : 1;
+}
+
+/*
+ * Runs the MCU for each combination of the swept options in parallel.
+ * Firmware is parsed and decoded once, each run is a copy-on-write clone
+ * of the initialized MCU (in a child process) which applies its options
+ * and sends the number of cycles back. Results are written to the CSV file.
+ */
+static int
+sweep(void)
+{
+	const uint64_t runs = MSIM_CFG_SweepRuns(&run_conf);
+	struct sweep_run *r = NULL;
+	struct sweep_res *res = NULL;
+	uint64_t next = 0, done = 0;
+	uint32_t jobs, running = 0, failed = 0, k;
+	long cpus;
+	pid_t pid;
+	int rc = 0, status;
+
+	do {
+		if (runs == 0U) {
+			MSIM_LOG_ERROR("too many combinations of the swept "
+			               "options");
+			rc = 1;
+			break;
+		}
+		cpus = sysconf(_SC_NPROCESSORS_ONLN);
+		jobs = (cpus > 0) ? (uint32_t)cpus : 1U;
+		jobs = (jobs > runs) ? (uint32_t)runs : jobs;
+
+		r = malloc(jobs * sizeof *r);
+		res = calloc((size_t)runs, sizeof *res);
+		if ((r == NULL) || (res == NULL)) {
+			MSIM_LOG_ERROR("failed to allocate memory for runs");
+			rc = 1;
+			break;
+		}
+
+		/* Runs share the decoded program instead of decoding it
+		 * on their own */
+		MSIM_AVR_DecodeAll(mcu);
+
+		snprintf(LOG, LOGSZ, "sweeping %" PRIu64 " runs, %" PRIu32
+		         " in parallel", runs, jobs);
+		MSIM_LOG_INFO(LOG);
+
+		while (done < runs) {
+			while ((running < jobs) && (next < runs)) {
+				if (start_run(&r[running], next) == 0) {
+					running++;
+				} else {
+					done++;
+				}
+				next++;
+			}
+			if (running == 0U) {
+				continue;
+			}
+
+			pid = waitpid(-1, &status, 0);
+			for (k = 0; k < running; k++) {
+				if (r[k].pid == pid) {
+					break;
+				}
+			}
+			if (k == running) {
+				continue;
+			}
+
+			if (read(r[k].fd, &res[r[k].run].cycles,
+			         sizeof res[0].cycles) !=
+			                (ssize_t)sizeof res[0].cycles) {
+				res[r[k].run].cycles = 0;
+			}
+			res[r[k].run].passed = (uint8_t)(WIFEXITED(status) &&
+			                        (WEXITSTATUS(status) == 0));
+			close(r[k].fd);
+
+			r[k] = r[--running];
+			done++;
+		}
+
+		for (uint64_t i = 0; i < runs; i++) {
+			failed += (res[i].passed == 0U) ? 1U : 0U;
+		}
+		snprintf(LOG, LOGSZ, "%" PRIu32 " of %" PRIu64 " runs failed",
+		         failed, runs);
+		MSIM_LOG_INFO(LOG);
+
+		rc = write_sweep(res, runs);
+		if ((rc == 0) && (failed > 0U)) {
+			rc = 1;
+		}
+	} while (0);
+
+	free(r);
+	free(res);
+
+	return rc;
+}
+
+/* Forks a child process to simulate the given run of the sweep. */
+static int
+start_run(struct sweep_run *r, uint64_t run)
+{
+	int fds[2];
+	int rc = 0;
+
+	do {
+		if (pipe(fds) != 0) {
+			MSIM_LOG_ERROR("failed to create pipe for run");
+			rc = 1;
+			break;
+		}
+
+		/* Buffered output shouldn't be written twice */
+		fflush(NULL);
+
+		r->pid = fork();
+		if (r->pid == 0) {
+			close(fds[0]);
+			exit(run_sweep(run, fds[1]));
+		}
+		close(fds[1]);
+		if (r->pid < 0) {
+			snprintf(LOG, LOGSZ, "failed to start run %" PRIu64,
+			         run);
+			MSIM_LOG_ERROR(LOG);
+			close(fds[0]);
+			rc = 1;
+			break;
+		}
+		r->fd = fds[0];
+		r->run = run;
+	} while (0);
+
+	return rc;
+}
+
+/* Simulates the run of the sweep from the initialized MCU (in a child
+ * process) and writes the number of cycles to the pipe. */
+static int
+run_sweep(uint64_t run, int fd)
+{
+	int rc = 0;
+
+	do {
+		rc = MSIM_CFG_Sweep(&run_conf, run);
+		if (rc != 0) {
+			break;
+		}
+
+		/* Low fuse selects the clock source again, maximum clock
+		 * frequency of the run is known then */
+		if (run_conf.has_lfuse == 0U) {
+			run_conf.mcu_lfuse = mcu->fuse[0];
+			run_conf.has_lfuse = 1;
+		}
+		MSIM_AVR_Configure(mcu, &run_conf);
+
+		for (uint32_t k = 0; (k < run_conf.lua_models_num) &&
+		                (rc == 0); k++) {
+			rc = MSIM_AVR_LUALoadModel(mcu, run_conf.lua_models[k],
+			                           run_conf.lua_params,
+			                           run_conf.lua_params_num);
+			if (rc != 0) {
+				MSIM_LOG_FATAL("loading Lua model failed");
+				rc = 1;
+			}
+		}
+		if (rc != 0) {
+			break;
+		}
+
+		rc = MSIM_AVR_Simulate(mcu, 1);
+		if (write(fd, &mcu->tick, sizeof mcu->tick) !=
+		                (ssize_t)sizeof mcu->tick) {
+			MSIM_LOG_ERROR("failed to send cycles of run");
+		}
+		MSIM_PTY_Close(mcu->pty);
+		MSIM_AVR_LUACleanModels(mcu);
+	} while (0);
+
+	close(fd);
+
+	return (rc == 0) ? 0 : 1;
+}
+
+/* Writes values of the swept options and results of the runs as CSV. */
+static int
+write_sweep(const struct sweep_res *res, uint64_t runs)
+{
+	char key[64], val[256];
+	FILE *f;
+	int rc = 0;
+
+	f = fopen(run_conf.sweep_file, "w");
+	if (f == NULL) {
+		snprintf(LOG, LOGSZ, "failed to open sweep file: %s",
+		         run_conf.sweep_file);
+		MSIM_LOG_ERROR(LOG);
+		return 1;
+	}
+
+	fprintf(f, "run");
+	for (uint32_t k = 0; k < run_conf.sweeps_num; k++) {
+		MSIM_CFG_SweepValue(&run_conf, k, 0, key, sizeof key,
+		                    val, sizeof val);
+		fprintf(f, ",%s", key);
+	}
+	fprintf(f, ",result,cycles\n");
+
+	for (uint64_t i = 0; i < runs; i++) {
+		fprintf(f, "%" PRIu64, i);
+		for (uint32_t k = 0; k < run_conf.sweeps_num; k++) {
+			MSIM_CFG_SweepValue(&run_conf, k, i, key, sizeof key,
+			                    val, sizeof val);
+			fprintf(f, ",%s", val);
+		}
+		fprintf(f, ",%s,%" PRIu64 "\n",
+		        (res[i].passed != 0U) ? "passed" : "failed",
+		        res[i].cycles);
+	}
+
+	if (fclose(f) != 0) {
+		snprintf(LOG, LOGSZ, "failed to write sweep file: %s",
+		         run_conf.sweep_file);
+		MSIM_LOG_ERROR(LOG);
+		rc = 1;
+	} else {
+		snprintf(LOG, LOGSZ, "results of the sweep: %s",
+		         run_conf.sweep_file);
+		MSIM_LOG_INFO(LOG);
+	}
+
 	return rc;
 }
 
@@ -191,8 +597,21 @@ dump_flash_handler(int s)
 {
 	int rc;
 
+	/* Program memory isn't allocated before MCU is initialized */
+	if (mcu->pm == NULL) {
+		return;
+	}
+
 	rc = MSIM_AVR_SaveProgMem(mcu, FLASH_FILE);
 	if (rc != 0) {
 		MSIM_LOG_ERROR("failed to dump memory to: " FLASH_FILE);
 	}
 }
+
+static void
+checkpoint_handler(int s)
+{
+	/* Checkpoint is written between instructions by the simulation
+	 * loop, if there is a file to write it to */
+	mcu->ckpt_req = 1;
+}
@@ -119,6 +119,8 @@ MSIM_PTY_Open(struct MSIM_PTY *pty)
 		if (pty->master_fd >= 0) {
 			close(pty->master_fd);
 		}
+		pty->slave_fd = -1;
+		pty->master_fd = -1;
 	}
 	return pty_err;
 }
@@ -131,6 +133,11 @@ MSIM_PTY_Close(struct MSIM_PTY *pty)
 	void *status;
 	int rc;
 
+	/* There is no pseudo-terminal opened */
+	if (pty->master_fd < 0) {
+		return 0;
+	}
+
 	/* Mark the reading thread to be stopped */
 	pthread_mutex_lock(&t->mutex);
 	t->stop_thr = 1;
@@ -152,6 +159,8 @@ MSIM_PTY_Close(struct MSIM_PTY *pty)
 		MSIM_LOG_WARN(log);
 	}
 	pthread_mutex_destroy(&t->mutex);
+	pty->slave_fd = -1;
+	pty->master_fd = -1;
 
 	return 0;
 }
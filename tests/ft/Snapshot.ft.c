@@ -0,0 +1,266 @@
+/*
+ * This file is part of MCUSim, an XSPICE library with microcontrollers.
+ *
+ * Copyright (C) 2017-2019 MCUSim Developers, see AUTHORS.txt for contributors.
+ *
+ * MCUSim is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MCUSim is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* Unit tests for snapshots and checkpoints of the MCU state */
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include "mcusim/mcusim.h"
+#include "mcusim/config.h"
+#include "mcusim/log.h"
+#include "mcusim/avr/sim/private/macro.h"
+
+#define CONF_FILE		"files/XlingFirmware.ft.conf"
+#define CKPT_FILE		"Snapshot.ckpt"
+#define FRM_TEST		1
+
+/* Cycles to run before the checkpoint is written and after it's loaded */
+#define CKPT_TICK		200000U
+#define RUN_CYCLES		300000U
+
+static MSIM_AVR _avr;
+static MSIM_AVR _res;
+static MSIM_AVR *mcu = &_avr;
+static MSIM_AVR *res = &_res;
+
+static MSIM_CFG conf = {
+	.firmware_test = FRM_TEST,
+};
+
+/* Parts of the MCU state to be checked after a snapshot is restored */
+static uint16_t *orig_pm;
+static MSIM_AVR_Inst *orig_dpm;
+static MSIM_AVR_TMR *orig_tmr;
+static uint8_t orig_dm[sizeof _avr.dm];
+
+static void save_orig(MSIM_AVR *m);
+static void check_orig(MSIM_AVR *m);
+static void modify_state(MSIM_AVR *m, uint32_t page);
+
+/*
+ * Writes a checkpoint at CKPT_TICK cycle, loads it to another instance of
+ * the MCU and runs both of them. MCU resumed from the checkpoint should
+ * be in the same state as the original one.
+ */
+static void
+checkpoint_roundtrip(void **state)
+{
+	int rc;
+
+	rc = MSIM_AVR_SimRun(mcu, FRM_TEST, CKPT_TICK - mcu->tick);
+	assert_int_equal(rc, 0);
+	rc = MSIM_AVR_SaveCheckpoint(mcu, CKPT_FILE);
+	assert_int_equal(rc, 0);
+
+	rc = MSIM_AVR_LoadCheckpoint(res, CKPT_FILE);
+	assert_int_equal(rc, 0);
+	assert_int_equal(res->tick, mcu->tick);
+	assert_int_equal(res->pc, mcu->pc);
+	assert_memory_equal(res->dm, mcu->dm, mcu->ramend + 1);
+	assert_memory_equal(res->pm, mcu->pm, mcu->pm_size * sizeof *mcu->pm);
+
+	rc = MSIM_AVR_SimRun(mcu, FRM_TEST, RUN_CYCLES);
+	assert_int_equal(rc, 0);
+	rc = MSIM_AVR_SimRun(res, FRM_TEST, RUN_CYCLES);
+	assert_int_equal(rc, 0);
+
+	assert_int_equal(res->tick, mcu->tick);
+	assert_int_equal(res->pc, mcu->pc);
+	assert_memory_equal(res->dm, mcu->dm, mcu->ramend + 1);
+}
+
+/*
+ * Takes a snapshot, modifies a page of the program memory, SRAM and timers
+ * of the MCU and restores the snapshot. Only the modified pages of the
+ * program memory are restored in this case.
+ */
+static void
+snapshot_restore(void **state)
+{
+	MSIM_AVR_Snap snap = {0};
+	const uint32_t page = mcu->pc / MSIM_AVR_SNAP_PAGESZ;
+	int rc;
+
+	save_orig(mcu);
+	rc = MSIM_AVR_Snapshot(mcu, &snap);
+	assert_int_equal(rc, 0);
+
+	modify_state(mcu, page);
+	rc = MSIM_AVR_Restore(mcu, &snap);
+	assert_int_equal(rc, 0);
+	check_orig(mcu);
+
+	/* MCU should be able to run from the restored state */
+	rc = MSIM_AVR_SimRun(mcu, FRM_TEST, RUN_CYCLES);
+	assert_int_equal(rc, 0);
+
+	MSIM_AVR_SnapFree(&snap);
+}
+
+/*
+ * Restores a snapshot which isn't the latest one. Pages of the program
+ * memory modified before the latest snapshot aren't tracked, so the whole
+ * program memory should be restored.
+ */
+static void
+snapshot_restore_older(void **state)
+{
+	MSIM_AVR_Snap a = {0};
+	MSIM_AVR_Snap b = {0};
+	const uint32_t pages = (mcu->pm_size + MSIM_AVR_SNAP_PAGESZ - 1) /
+	                       MSIM_AVR_SNAP_PAGESZ;
+	const uint32_t page = mcu->pc / MSIM_AVR_SNAP_PAGESZ;
+	int rc;
+
+	save_orig(mcu);
+	rc = MSIM_AVR_Snapshot(mcu, &a);
+	assert_int_equal(rc, 0);
+
+	modify_state(mcu, page);
+	rc = MSIM_AVR_Snapshot(mcu, &b);
+	assert_int_equal(rc, 0);
+	assert_true(a.id != mcu->snap_id);
+
+	modify_state(mcu, (page + 1U) % pages);
+	rc = MSIM_AVR_Restore(mcu, &a);
+	assert_int_equal(rc, 0);
+	check_orig(mcu);
+
+	/* Snapshot taken after the restored one */
+	rc = MSIM_AVR_Restore(mcu, &b);
+	assert_int_equal(rc, 0);
+	assert_memory_equal(mcu->pm, b.pm, mcu->pm_size * sizeof *mcu->pm);
+
+	rc = MSIM_AVR_Restore(mcu, &a);
+	assert_int_equal(rc, 0);
+	check_orig(mcu);
+
+	MSIM_AVR_SnapFree(&a);
+	MSIM_AVR_SnapFree(&b);
+}
+
+/* Copies parts of the MCU state to be checked by check_orig() later. */
+static void
+save_orig(MSIM_AVR *m)
+{
+	free(orig_pm);
+	free(orig_dpm);
+	free(orig_tmr);
+	orig_pm = malloc(m->pm_size * sizeof *orig_pm);
+	orig_dpm = malloc(m->pm_size * sizeof *orig_dpm);
+	orig_tmr = malloc((m->timers_num + 1U) * sizeof *orig_tmr);
+	assert_true((orig_pm != NULL) && (orig_dpm != NULL) &&
+	            (orig_tmr != NULL));
+
+	MSIM_AVR_DecodeAll(m);
+	memcpy(orig_pm, m->pm, m->pm_size * sizeof *orig_pm);
+	memcpy(orig_dpm, m->dpm, m->pm_size * sizeof *orig_dpm);
+	memcpy(orig_tmr, m->timers, m->timers_num * sizeof *orig_tmr);
+	memcpy(orig_dm, m->dm, m->ramend + 1);
+}
+
+/* Checks that the MCU state is equal to the one saved by save_orig(). */
+static void
+check_orig(MSIM_AVR *m)
+{
+	assert_memory_equal(m->pm, orig_pm, m->pm_size * sizeof *orig_pm);
+	assert_memory_equal(m->dm, orig_dm, m->ramend + 1);
+	assert_memory_equal(m->timers, orig_tmr,
+	                    m->timers_num * sizeof *orig_tmr);
+
+	/* Instructions of the restored pages should be decoded again */
+	MSIM_AVR_DecodeAll(m);
+	for (uint32_t pc = 0; pc < m->pm_size; pc++) {
+		assert_int_equal(m->dpm[pc].inst, orig_dpm[pc].inst);
+		assert_int_equal(m->dpm[pc].op, orig_dpm[pc].op);
+	}
+}
+
+/* Modifies a page of the program memory (as SPM does), SRAM and timers. */
+static void
+modify_state(MSIM_AVR *m, uint32_t page)
+{
+	const uint32_t addr = page * MSIM_AVR_SNAP_PAGESZ;
+
+	assert_true(m->timers_num > 0U);
+
+	for (uint32_t i = addr; (i < (addr + MSIM_AVR_SNAP_PAGESZ)) &&
+	                (i < m->pm_size); i++) {
+		m->pm[i] ^= 0xFFFFU;
+	}
+	MSIM_AVR_FlushDecoded(m, addr, MSIM_AVR_SNAP_PAGESZ);
+
+	/* Instructions of the modified page are decoded */
+	MSIM_AVR_DecodeAll(m);
+
+	memset(&m->dm[m->ramstart], 0xA5, m->ramend - m->ramstart + 1);
+	for (uint32_t i = 0; i < m->timers_num; i++) {
+		m->timers[i].scnt += 7U;
+		m->timers[i].idle = 0;
+	}
+}
+
+int
+main(void)
+{
+	int rc = 0;
+
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(checkpoint_roundtrip),
+		cmocka_unit_test(snapshot_restore),
+		cmocka_unit_test(snapshot_restore_older),
+	};
+
+	MSIM_CFG_PrintVersion();
+
+	do {
+		MSIM_LOG_SetLevel(MSIM_LOG_LVLINFO);
+
+		/* Read config file */
+		rc = MSIM_CFG_Read(&conf, CONF_FILE);
+		if (rc != 0) {
+			break;
+		}
+
+		/* Force firmware test option */
+		conf.firmware_test = 1;
+
+		/* Original MCU and the one to resume from a checkpoint */
+		rc = MSIM_AVR_Init(mcu, &conf);
+		rc = (rc == 0) ? MSIM_AVR_Init(res, &conf) : rc;
+		if (rc != 0) {
+			break;
+		}
+
+		/* Don't write any registers to VCD */
+		mcu->vcd->regs[0].i = -1;
+		res->vcd->regs[0].i = -1;
+
+		/* Force running state */
+		mcu->state = AVR_RUNNING;
+		res->state = AVR_RUNNING;
+	} while (0);
+
+	return rc != 0 ? rc : cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -37,8 +37,8 @@
 #define SREGR			(*mcu->sreg)
 
 #define RESTORE_MCU() do {						\
-	_ctl = _orig;							\
-	_avr = _orig;							\
+	MSIM_AVR_Restore(mcu, &snap);					\
+	_ctl = *mcu;							\
 } while (0)
 
 /* Structure to keep a PC value and a dump of the data memory. */
@@ -47,7 +47,7 @@ struct dm_checkpoint {
 	char dump[1024];
 };
 
-static MSIM_AVR _orig;
+static MSIM_AVR_Snap snap;
 static MSIM_AVR _ctl;
 static MSIM_AVR _avr;
 static MSIM_AVR *mcu = &_avr;
@@ -103,7 +103,8 @@ check_datamem(void **state)
 	}
 
 	do {
-		int rc = MSIM_AVR_SimStep(mcu, FRM_TEST);
+		int rc = MSIM_AVR_SimRunTo(mcu, FRM_TEST, UINT64_MAX,
+		                           dm_checkpoints[dmcp].pc);
 
 		/* Stop if there was an error during simulation step. */
 		if (rc != 0) {
@@ -154,6 +155,17 @@ static int
 restore_mcu(void **state)
 {
 	RESTORE_MCU();
+	dmcp = 0;
+	mcu->engine = AVR_DECODER_ENGINE;
+	return 0;
+}
+
+static int
+restore_mcu_threaded(void **state)
+{
+	RESTORE_MCU();
+	dmcp = 0;
+	mcu->engine = AVR_THREADED_ENGINE;
 	return 0;
 }
 
@@ -164,6 +176,7 @@ main(void)
 
 	const struct CMUnitTest tests[] = {
 		cmocka_unit_test_setup(check_datamem, restore_mcu),
+		cmocka_unit_test_setup(check_datamem, restore_mcu_threaded),
 	};
 
 	MSIM_CFG_PrintVersion();
@@ -183,11 +196,11 @@ main(void)
 
 		/* Initialize AVR MCU */
 		rc = MSIM_AVR_Init(mcu, &conf);
-		_orig = *mcu;
+		rc = (rc == 0) ? MSIM_AVR_Snapshot(mcu, &snap) : rc;
 		_ctl = *mcu;
 
 		/* Don't write any registers to VCD */
-		mcu->vcd.regs[0].i = -1;
+		mcu->vcd->regs[0].i = -1;
 
 		/* Force running state */
 		mcu->state = AVR_RUNNING;